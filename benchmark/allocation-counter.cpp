@@ -0,0 +1,98 @@
+#include <new>      // for bad_alloc, align_val_t
+#include <atomic>
+#include <cstddef>  // for max_align_t
+#include <cstdlib>  // for malloc(), free()
+
+#include "allocation-counter.h"
+
+
+namespace asc::cpp_practice_ws20::ex08::benchmark {
+
+    namespace detail {
+
+
+        std::atomic<std::size_t> numAllocations{ 0 };
+        std::atomic<std::size_t> numBytes{ 0 };
+        std::atomic<std::size_t> numLiveBytes{ 0 };
+        std::atomic<std::size_t> numPeakBytes{ 0 };
+
+        // Every allocation starts with a header holding its size, so that deallocations without a size can be subtracted
+        // from the live bytes. The header keeps the alignment `operator new` guarantees.
+        constexpr std::size_t headerSize = alignof(std::max_align_t);
+
+        void addLiveBytes(std::size_t size) noexcept
+        {
+            auto live = numLiveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+            auto peak = numPeakBytes.load(std::memory_order_relaxed);
+            while (live > peak && !numPeakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+            {
+            }
+        }
+
+
+    } // namespace detail
+
+
+    std::size_t allocationCount() noexcept
+    {
+        return detail::numAllocations.load(std::memory_order_relaxed);
+    }
+
+    std::size_t allocatedBytes() noexcept
+    {
+        return detail::numBytes.load(std::memory_order_relaxed);
+    }
+
+    std::size_t liveBytes() noexcept
+    {
+        return detail::numLiveBytes.load(std::memory_order_relaxed);
+    }
+
+    std::size_t peakBytes() noexcept
+    {
+        return detail::numPeakBytes.load(std::memory_order_relaxed);
+    }
+
+    void resetPeakBytes() noexcept
+    {
+        detail::numPeakBytes.store(liveBytes(), std::memory_order_relaxed);
+    }
+
+
+} // namespace asc::cpp_practice_ws20::ex08::benchmark
+
+
+// Replacements of the global allocation functions. The array and nothrow forms forward to these by default.
+
+void* operator new(std::size_t size)
+{
+    using namespace asc::cpp_practice_ws20::ex08::benchmark;
+
+    detail::numAllocations.fetch_add(1, std::memory_order_relaxed);
+    detail::numBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(detail::headerSize + size))
+    {
+        *static_cast<std::size_t*>(p) = size;
+        detail::addLiveBytes(size);
+        return static_cast<char*>(p) + detail::headerSize;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    using namespace asc::cpp_practice_ws20::ex08::benchmark;
+
+    if (p == nullptr)
+    {
+        return;
+    }
+    void* block = static_cast<char*>(p) - detail::headerSize;
+    detail::numLiveBytes.fetch_sub(*static_cast<std::size_t*>(block), std::memory_order_relaxed);
+    std::free(block);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    operator delete(p);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#ifndef INCLUDED_CPP_PRACTICE_EX08_ALLOCATION_COUNTER_H_
+#define INCLUDED_CPP_PRACTICE_EX08_ALLOCATION_COUNTER_H_
+
+
+#include <cstddef>  // for size_t
+
+
+namespace asc::cpp_practice_ws20::ex08::benchmark {
+
+
+    // Returns the number of calls to the global `operator new` made by the process so far.
+    // Linking "allocation-counter.cpp" replaces the global allocation functions with counting versions.
+    std::size_t allocationCount() noexcept;
+
+    // Returns the number of bytes requested from the global `operator new` so far.
+    std::size_t allocatedBytes() noexcept;
+
+    // Returns the number of bytes allocated by the global `operator new` and not freed yet.
+    std::size_t liveBytes() noexcept;
+
+    // Returns the largest value `liveBytes()` had since the last call to `resetPeakBytes()`, or since the start.
+    std::size_t peakBytes() noexcept;
+
+    // Starts measuring the peak anew from the current number of live bytes.
+    void resetPeakBytes() noexcept;
+
+
+} // namespace asc::cpp_practice_ws20::ex08::benchmark
+
+
+#endif // INCLUDED_CPP_PRACTICE_EX08_ALLOCATION_COUNTER_H_
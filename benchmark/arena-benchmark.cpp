@@ -0,0 +1,123 @@
+#include <string>
+#include <cstdlib>        // for strtoul()
+#include <iostream>
+#include <stdexcept>      // for runtime_error
+#include <unordered_map>
+
+#include "expression.h"
+#include "expression-arena.h"
+#include "expression-evaluate.h"
+
+#include "workloads.h"
+#include "benchmark-utility.h"
+#include "allocation-counter.h"
+
+
+// Compares the `unique_ptr<>`-based expression tree with the flat `ExpressionArena` representation.
+//
+// Usage:
+//   arena-benchmark [<number of terms> [<evaluation repetitions>]]
+
+
+using namespace asc::cpp_practice_ws20::ex08;
+using benchmark::measureSeconds;
+
+void
+report(std::string_view what, std::size_t numAllocations, double seconds)
+{
+    std::cout << what << ": " << numAllocations << " allocations, " << seconds * 1000 << " ms\n";
+}
+
+int main(int argc, char* argv[])
+try
+{
+    std::size_t numTerms = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 5000;
+    std::size_t numRepetitions = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 100;
+
+    auto text = benchmark::randomPolynomial(numTerms);
+    auto variableSubstitutions = std::unordered_map<std::string, double>{ };
+    for (auto const& name : benchmark::workloadVariables())
+    {
+        variableSubstitutions[name] = 1.25;
+    }
+
+    // Parse into a `unique_ptr<>` tree.
+    auto allocationsBefore = benchmark::allocationCount();
+    auto tree = expr::Expression{ expr::RationalConstant{ 0 } };
+    double treeParseSeconds = measureSeconds([&] { tree = expr::Expression::parse(text); });
+    report("tree parse", benchmark::allocationCount() - allocationsBefore, treeParseSeconds);
+
+    // The Pratt parser, which also parses into arenas.
+    allocationsBefore = benchmark::allocationCount();
+    auto prattTree = expr::Expression{ expr::RationalConstant{ 0 } };
+    double prattParseSeconds = measureSeconds([&]
+        {
+            prattTree = expr::Expression::parse(text, expr::ParserBackend::pratt);
+        });
+    report("tree parse (Pratt)", benchmark::allocationCount() - allocationsBefore, prattParseSeconds);
+
+    // Copy the tree into an arena; this isolates the cost of the flat representation itself.
+    auto arena = expr::ExpressionArena{ };
+    allocationsBefore = benchmark::allocationCount();
+    auto arenaExpr = expr::ArenaExpression{ arena, 0 };
+    double arenaBuildSeconds = measureSeconds([&] { arenaExpr = arena.add(tree); });
+    report("arena build from tree", benchmark::allocationCount() - allocationsBefore, arenaBuildSeconds);
+
+    // Parse directly into a second arena, without a tree.
+    auto parseArena = expr::ExpressionArena{ };
+    allocationsBefore = benchmark::allocationCount();
+    auto parsedExpr = expr::ArenaExpression{ parseArena, 0 };
+    double arenaParseSeconds = measureSeconds([&] { parsedExpr = parseArena.parse(text); });
+    report("arena parse", benchmark::allocationCount() - allocationsBefore, arenaParseSeconds);
+
+    std::cout << "nodes: " << arena.size() << ", bytes per arena node: " << sizeof(expr::ArenaNode)
+              << ", bytes per tree node: " << sizeof(expr::Expression::RawExpression) << " + allocation overhead\n";
+
+    if (to_string(tree) != to_string(arenaExpr))
+    {
+        throw std::runtime_error("arena and tree print differently");
+    }
+    if (prattTree != tree || parsedExpr != arenaExpr)
+    {
+        throw std::runtime_error("the parsers build different expressions");
+    }
+
+    // Walk both representations by evaluating them repeatedly.
+    double treeResult = 0;
+    allocationsBefore = benchmark::allocationCount();
+    double treeWalkSeconds = measureSeconds([&]
+        {
+            for (std::size_t i = 0; i != numRepetitions; ++i)
+            {
+                treeResult += evaluate(tree, variableSubstitutions);
+            }
+        });
+    report("tree walk", benchmark::allocationCount() - allocationsBefore, treeWalkSeconds);
+
+    double arenaResult = 0;
+    allocationsBefore = benchmark::allocationCount();
+    double arenaWalkSeconds = measureSeconds([&]
+        {
+            for (std::size_t i = 0; i != numRepetitions; ++i)
+            {
+                arenaResult += evaluate(arenaExpr, variableSubstitutions);
+            }
+        });
+    report("arena walk", benchmark::allocationCount() - allocationsBefore, arenaWalkSeconds);
+
+    if (treeResult != arenaResult)
+    {
+        throw std::runtime_error("arena and tree evaluate differently");
+    }
+
+    // Release both representations.
+    double treeFreeSeconds = measureSeconds([&] { tree = expr::Expression{ expr::RationalConstant{ 0 } }; });
+    double arenaFreeSeconds = measureSeconds([&] { arena.clear(); parseArena.clear(); });
+    std::cout << "tree release: " << treeFreeSeconds * 1000 << " ms, arena clear: " << arenaFreeSeconds * 1000 << " ms\n";
+    std::cout << "walk speedup: " << treeWalkSeconds / arenaWalkSeconds << "x\n";
+}
+catch (std::exception const& e)
+{
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+}
@@ -0,0 +1,279 @@
+#include <span>
+#include <cmath>          // for abs(), isnan()
+#include <string>
+#include <vector>
+#include <cstdio>         // for snprintf()
+#include <cstdlib>        // for strtod(), strtoul()
+#include <fstream>
+#include <utility>        // for pair<>
+#include <sstream>
+#include <iostream>
+#include <algorithm>      // for max()
+#include <stdexcept>      // for runtime_error
+#include <filesystem>     // for temp_directory_path(), remove()
+#include <string_view>
+#include <unordered_map>
+
+#include "expression.h"
+#include "expression-evaluate.h"
+#include "lines.h"
+
+#include "workloads.h"
+#include "benchmark-utility.h"
+
+
+// Measures the hot paths of the expression parser on generated workloads of varying size and depth: parsing, scalar
+// and vectorized evaluation, printing, and reading the lines of a file. The results are written to standard output as
+// JSON, so that runs can be compared by a script, e.g. before and after a change.
+//
+// Usage:
+//   benchmark-suite [<minimum seconds per measurement> [<size scale>]] > results.json
+
+
+using namespace asc::cpp_practice_ws20::ex08;
+using benchmark::measureSeconds;
+namespace read_lines = arithmetic_expression_::read_lines;
+
+
+struct Measurement
+{
+    std::string operation;
+    std::string workload;
+    std::size_t size;               // a measure of the workload: terms, depth or megabytes
+    std::size_t repetitions;
+    double seconds;                 // per repetition
+    std::size_t bytes = 0;          // processed per repetition, if meaningful
+    std::size_t elements = 0;       // evaluated per repetition, if meaningful
+};
+
+// Calls `f()` often enough to take at least `minSeconds`, doubling the number of calls until it does, and returns the
+// number of calls and the time per call.
+template <typename F>
+std::pair<std::size_t, double>
+measureRepeated(F&& f, double minSeconds)
+{
+    f();    // warm up caches and the scratch space of the evaluators
+    for (std::size_t numRepetitions = 1; ; numRepetitions *= 2)
+    {
+        double seconds = measureSeconds([&]
+            {
+                for (std::size_t i = 0; i != numRepetitions; ++i)
+                {
+                    f();
+                }
+            });
+        if (seconds >= minSeconds)
+        {
+            return { numRepetitions, seconds / double(numRepetitions) };
+        }
+    }
+}
+
+std::string
+jsonString(std::string_view text)
+{
+    std::string result = "\"";
+    for (char c : text)
+    {
+        switch (c)
+        {
+        case '"': result += "\\\""; break;
+        case '\\': result += "\\\\"; break;
+        case '\n': result += "\\n"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char escaped[8];
+                std::snprintf(escaped, sizeof escaped, "\\u%04x", unsigned(c));
+                result += escaped;
+            }
+            else
+            {
+                result += c;
+            }
+        }
+    }
+    return result + '"';
+}
+
+void
+writeJson(std::ostream& out, std::vector<Measurement> const& measurements, double minSeconds)
+{
+    out << "{\n  \"min_seconds\": " << minSeconds << ",\n  \"benchmarks\": [";
+    char const* separator = "\n";
+    for (auto const& m : measurements)
+    {
+        out << separator << "    { \"operation\": " << jsonString(m.operation) << ", \"workload\": "
+            << jsonString(m.workload) << ", \"size\": " << m.size << ", \"repetitions\": " << m.repetitions
+            << ", \"ns_per_op\": " << m.seconds * 1e9;
+        if (m.bytes != 0)
+        {
+            out << ", \"bytes\": " << m.bytes << ", \"mb_per_s\": " << double(m.bytes) / m.seconds / 1e6;
+        }
+        if (m.elements != 0)
+        {
+            out << ", \"elements\": " << m.elements << ", \"ns_per_element\": " << m.seconds * 1e9 / double(m.elements);
+        }
+        out << " }";
+        separator = ",\n";
+    }
+    out << "\n  ]\n}\n";
+}
+
+class Suite
+{
+private:
+    double minSeconds_;
+    std::vector<Measurement> measurements_;
+
+public:
+    explicit Suite(double minSeconds)
+        : minSeconds_(minSeconds)
+    {
+    }
+
+    void
+    benchmarkExpression(std::string const& workload, std::size_t size, std::string const& text)
+    {
+        auto e = expr::Expression::parse(text);
+
+        auto [parseRepetitions, parseSeconds] = measureRepeated([&] { auto parsed = expr::Expression::parse(text); },
+            minSeconds_);
+        measurements_.push_back({ "parse", workload, size, parseRepetitions, parseSeconds, text.size() });
+
+        auto printed = to_string(e);
+        auto [printRepetitions, printSeconds] = measureRepeated([&] { printed = to_string(e); }, minSeconds_);
+        measurements_.push_back({ "to_string", workload, size, printRepetitions, printSeconds, printed.size() });
+
+        auto stream = std::ostringstream{ };
+        auto [streamRepetitions, streamSeconds] = measureRepeated([&]
+            {
+                stream.str({ });
+                stream << e;
+            }, minSeconds_);
+        measurements_.push_back({ "operator<<", workload, size, streamRepetitions, streamSeconds, printed.size() });
+        if (stream.str() != printed)
+        {
+            throw std::runtime_error("to_string() and operator<< disagree for workload " + workload);
+        }
+
+        auto scalars = std::unordered_map<std::string, double>{ };
+        auto columns = std::vector<std::vector<double>>{ };
+        auto arrays = std::unordered_map<std::string, expr::VariableSubstitution>{ };
+        constexpr std::size_t numElements = 4096;
+        for (auto const& name : benchmark::workloadVariables())
+        {
+            scalars[name] = 1.25;
+            auto& column = columns.emplace_back(numElements);
+            for (std::size_t i = 0; i != numElements; ++i)
+            {
+                column[i] = 0.5 + 0.001 * double(i);
+            }
+            arrays[name] = std::span<double const>(column);
+        }
+
+        double value = 0;
+        auto [scalarRepetitions, scalarSeconds] = measureRepeated([&] { value = evaluate(e, scalars); }, minSeconds_);
+        measurements_.push_back({ "evaluate", workload, size, scalarRepetitions, scalarSeconds, 0, 1 });
+
+        auto result = expr::EvaluationResult{ };
+        auto [vectorRepetitions, vectorSeconds] = measureRepeated([&] { result = evaluate(e, arrays); }, minSeconds_);
+        measurements_.push_back({ "evaluate (vectorized)", workload, size, vectorRepetitions, vectorSeconds, 0,
+            numElements });
+
+        // An element with the inputs of the scalar evaluation must agree with it, up to the last bits in which the
+        // array functions of "vector-math.h" may differ from the scalar ones.
+        auto const& values = std::get<std::vector<double>>(result);
+        for (auto& column : columns)
+        {
+            column[750] = 1.25;
+        }
+        double vectorValue = std::get<std::vector<double>>(evaluate(e, arrays))[750];
+        bool agree = std::isnan(value) ? std::isnan(vectorValue)
+            : std::abs(vectorValue - value) <= 1e-12 * std::max(1.0, std::abs(value));
+        if (values.size() != numElements || !agree)
+        {
+            throw std::runtime_error("scalar and vectorized evaluate() disagree for workload " + workload);
+        }
+    }
+
+    void
+    benchmarkLines(std::size_t numMegabytes)
+    {
+        auto path = std::filesystem::temp_directory_path() / "benchmark-suite-input.txt";
+        auto input = benchmark::randomInputLines(numMegabytes << 20);
+        {
+            auto file = std::ofstream(path, std::ios::binary);
+            file << input;
+            if (!file.flush())
+            {
+                throw std::runtime_error("cannot write " + path.string());
+            }
+        }
+
+        auto countBytes = [](read_lines::LineRange lines)
+        {
+            std::size_t numBytes = 0;
+            for (auto line : lines)
+            {
+                numBytes += line.size() + 1;
+            }
+            return numBytes;
+        };
+        std::size_t mappedBytes = 0;
+        auto [mappedRepetitions, mappedSeconds] = measureRepeated([&]
+            {
+                mappedBytes = countBytes(read_lines::linesInFile(path));
+            }, minSeconds_);
+        std::size_t readBytes = 0;
+        auto [readRepetitions, readSeconds] = measureRepeated([&]
+            {
+                readBytes = countBytes(read_lines::linesInFile(
+                    FileReader::open(path, arithmetic_expression_::file_reader::FileMode::binary)));
+            }, minSeconds_);
+        std::filesystem::remove(path);
+        if (mappedBytes != input.size() || readBytes != input.size())
+        {
+            throw std::runtime_error("LineRange did not return all lines of the input file");
+        }
+        measurements_.push_back({ "LineRange", "lines (mapped)", numMegabytes, mappedRepetitions, mappedSeconds,
+            input.size() });
+        measurements_.push_back({ "LineRange", "lines (read)", numMegabytes, readRepetitions, readSeconds,
+            input.size() });
+    }
+
+    void
+    write(std::ostream& out) const
+    {
+        writeJson(out, measurements_, minSeconds_);
+    }
+};
+
+int main(int argc, char* argv[])
+try
+{
+    double minSeconds = argc > 1 ? std::strtod(argv[1], nullptr) : 0.2;
+    std::size_t scale = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1;
+
+    auto suite = Suite(minSeconds);
+    for (std::size_t numTerms : { 10, 100, 1000 })
+    {
+        suite.benchmarkExpression("polynomial", numTerms * scale, benchmark::randomPolynomial(numTerms * scale));
+    }
+    for (std::size_t numTerms : { 10, 100, 1000 })
+    {
+        suite.benchmarkExpression("chain", numTerms * scale, benchmark::deepChain(numTerms * scale));
+    }
+    // The size of these trees grows exponentially with their depth, so the depth is not scaled.
+    for (std::size_t depth : { 4, 8, 16 })
+    {
+        suite.benchmarkExpression("transcendental", depth, benchmark::randomTranscendentalFormula(depth));
+    }
+    suite.benchmarkLines(16 * scale);
+    suite.write(std::cout);
+}
+catch (std::exception const& e)
+{
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#ifndef INCLUDED_CPP_PRACTICE_EX08_BENCHMARK_UTILITY_H_
+#define INCLUDED_CPP_PRACTICE_EX08_BENCHMARK_UTILITY_H_
+
+
+#include <chrono>
+
+
+namespace asc::cpp_practice_ws20::ex08::benchmark {
+
+
+    // Returns the wall time in seconds needed to call `f()`.
+    template <typename F>
+    double
+        measureSeconds(F&& f)
+    {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        auto stop = std::chrono::steady_clock::now();
+        return std::chrono::duration<double>(stop - start).count();
+    }
+
+
+} // namespace asc::cpp_practice_ws20::ex08::benchmark
+
+
+#endif // INCLUDED_CPP_PRACTICE_EX08_BENCHMARK_UTILITY_H_
@@ -0,0 +1,122 @@
+#include <span>
+#include <string>
+#include <vector>
+#include <cstdlib>        // for strtoul()
+#include <iomanip>        // for setw()
+#include <iostream>
+#include <stdexcept>      // for runtime_error
+#include <unordered_map>
+
+#include "expression.h"
+#include "expression-evaluate.h"
+
+#include "workloads.h"
+#include "allocation-counter.h"
+#include "benchmark-utility.h"
+
+
+// Compares the memory use of the vectorized evaluators: the whole-array evaluator, which reuses a temporary only when
+// an operation gets it as an rvalue, the buffer-planned evaluator, which assigns the temporaries to a minimal set of
+// arrays up front, and, for reference, the tiled evaluator. Reports the allocations of one evaluation, the bytes they
+// request and the peak memory, both including the result and measured in arrays of the result's size, and the time
+// per row.
+//
+// Usage:
+//   buffer-plan-benchmark [<rows>]
+
+
+using namespace asc::cpp_practice_ws20::ex08;
+using benchmark::measureSeconds;
+
+
+// A complete binary tree of the given depth, whose leaves are the workload variables. Its operands are all arrays, so
+// the whole-array evaluator allocates a temporary for each operation on two variables.
+std::string
+balancedTree(std::size_t depth, std::size_t& leaf)
+{
+    auto const& variables = benchmark::workloadVariables();
+    if (depth == 0)
+    {
+        return variables[leaf++ % variables.size()];
+    }
+    char const* op = depth % 2 == 0 ? " * " : " + ";
+    auto x = balancedTree(depth - 1, leaf);
+    auto y = balancedTree(depth - 1, leaf);
+    return "(" + x + op + y + ")";
+}
+
+std::string
+balancedTree(std::size_t depth)
+{
+    std::size_t leaf = 0;
+    return balancedTree(depth, leaf);
+}
+
+void
+benchmarkBufferPlan(std::string const& text, std::size_t numRows)
+{
+    auto e = expr::Expression::parse(text);
+
+    auto columns = std::vector<std::vector<double>>{ };
+    auto variableSubstitutions = std::unordered_map<std::string, expr::VariableSubstitution>{ };
+    for (auto const& name : benchmark::workloadVariables())
+    {
+        auto& column = columns.emplace_back(numRows);
+        for (std::size_t i = 0; i != numRows; ++i)
+        {
+            column[i] = 1.0 + 0.001 * double(i % 1000 + columns.size());
+        }
+        variableSubstitutions[name] = std::span<double const>(column);
+    }
+
+    std::cout << (text.size() > 40 ? text.substr(0, 37) + "..." : text) << " (" << numRows << " rows)\n";
+    double const arrayBytes = double(numRows * sizeof(double));
+    auto expected = expr::EvaluationResult{ };
+    auto report = [&](char const* name, expr::VectorizedEvaluation mode)
+    {
+        // Measure the memory of a single evaluation, then the time of another one.
+        auto liveBefore = benchmark::liveBytes();
+        benchmark::resetPeakBytes();
+        auto allocationsBefore = benchmark::allocationCount();
+        auto bytesBefore = benchmark::allocatedBytes();
+        auto result = evaluate(e, variableSubstitutions, mode);
+        auto numAllocations = benchmark::allocationCount() - allocationsBefore;
+        double allocatedArrays = double(benchmark::allocatedBytes() - bytesBefore) / arrayBytes;
+        double peakArrays = double(benchmark::peakBytes() - liveBefore) / arrayBytes;
+        double seconds = measureSeconds([&] { result = evaluate(e, variableSubstitutions, mode); });
+
+        if (expected.index() == 0)
+        {
+            expected = result;
+        }
+        else if (result != expected)
+        {
+            throw std::runtime_error(std::string(name) + " evaluation disagrees for " + text);
+        }
+        std::cout << "  " << std::left << std::setw(14) << name << std::right << std::setw(6) << numAllocations
+                  << " allocations of " << std::setw(8) << allocatedArrays << " arrays, peak " << std::setw(8)
+                  << peakArrays << " arrays ("
+                  << std::setw(8) << peakArrays * arrayBytes / (1 << 20) << " MiB), "
+                  << seconds / double(numRows) * 1e9 << " ns/row\n";
+    };
+    report("whole arrays", expr::VectorizedEvaluation::wholeArrays);
+    report("planned", expr::VectorizedEvaluation::planned);
+    report("tiled", expr::VectorizedEvaluation::tiled);
+}
+
+int main(int argc, char* argv[])
+try
+{
+    std::size_t numRows = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+    benchmarkBufferPlan("a*x^2 + b*x + c", numRows);
+    benchmarkBufferPlan("(a*b + c*d) * (x*y + z*a) - (a + b)*(c + d)", numRows);
+    benchmarkBufferPlan(balancedTree(6), numRows);
+    benchmarkBufferPlan(benchmark::randomPolynomial(10), numRows);
+    benchmarkBufferPlan(benchmark::randomPolynomial(100), numRows);
+}
+catch (std::exception const& e)
+{
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+}
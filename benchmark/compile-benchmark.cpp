@@ -0,0 +1,231 @@
+#include <string>
+#include <vector>
+#include <cstdlib>        // for strtoul()
+#include <iostream>
+#include <stdexcept>      // for runtime_error
+#include <unordered_map>
+
+#include "expression.h"
+#include "expression-compile.h"
+#include "expression-evaluate.h"
+#include "expression-jit.h"
+#include "variable-layout.h"
+
+#include "workloads.h"
+#include "benchmark-utility.h"
+
+
+// Compares the per-call cost of the recursive tree evaluator with the compiled stack machine and its native code, and
+// the vectorized tree evaluator, with whole-array temporaries and tiled, with the compiled stack machine and its native
+// code evaluating a `VariableLayout`-ordered table.
+//
+// Usage:
+//   compile-benchmark [<evaluation repetitions> [<rows>]]
+
+
+using namespace asc::cpp_practice_ws20::ex08;
+using benchmark::measureSeconds;
+
+
+void
+benchmarkExpression(std::string const& text, std::size_t numRepetitions)
+{
+    auto e = expr::Expression::parse(text);
+    auto compiled = expr::compile(e);
+    auto native = expr::JitExpression(compiled);
+
+    // Use different inputs on every call, as a parameter sweep would. The map entries are updated through pointers so
+    // that the setup does not hash any strings.
+    auto variableSubstitutions = std::unordered_map<std::string, double>{ };
+    auto variableValues = std::vector<double>(compiled.variables().size());
+    auto mapValues = std::vector<double*>{ };
+    for (auto const& name : compiled.variables())
+    {
+        mapValues.push_back(&variableSubstitutions[name]);
+    }
+    auto setInputs = [&](std::size_t i)
+    {
+        for (std::size_t j = 0; j != variableValues.size(); ++j)
+        {
+            double value = 1.0 + 0.001 * double(i + j);
+            variableValues[j] = value;
+            *mapValues[j] = value;
+        }
+    };
+
+    double treeSum = 0;
+    double treeSeconds = measureSeconds([&]
+        {
+            for (std::size_t i = 0; i != numRepetitions; ++i)
+            {
+                setInputs(i);
+                treeSum += evaluate(e, variableSubstitutions);
+            }
+        });
+    double compiledMapSum = 0;
+    double compiledMapSeconds = measureSeconds([&]
+        {
+            for (std::size_t i = 0; i != numRepetitions; ++i)
+            {
+                setInputs(i);
+                compiledMapSum += evaluate(compiled, variableSubstitutions);
+            }
+        });
+    double compiledSpanSum = 0;
+    double compiledSpanSeconds = measureSeconds([&]
+        {
+            for (std::size_t i = 0; i != numRepetitions; ++i)
+            {
+                setInputs(i);
+                compiledSpanSum += evaluate(compiled, std::span<double const>(variableValues));
+            }
+        });
+    double jitSum = 0;
+    double jitSeconds = measureSeconds([&]
+        {
+            for (std::size_t i = 0; i != numRepetitions; ++i)
+            {
+                setInputs(i);
+                jitSum += evaluate(native, std::span<double const>(variableValues));
+            }
+        });
+    if (treeSum != compiledMapSum || treeSum != compiledSpanSum)
+    {
+        throw std::runtime_error("compiled and tree evaluation disagree for " + text);
+    }
+    if (treeSum != jitSum)
+    {
+        throw std::runtime_error("native and tree evaluation disagree for " + text);
+    }
+
+    // The time for setting up the inputs is included in all measurements.
+    double n = double(numRepetitions);
+    std::cout << (text.size() > 40 ? text.substr(0, 37) + "..." : text) << '\n'
+              << "  instructions: " << compiled.code().size() << ", stack size: " << compiled.stackSize() << '\n'
+              << "  tree + map:     " << treeSeconds / n * 1e9 << " ns/call\n"
+              << "  compiled + map: " << compiledMapSeconds / n * 1e9 << " ns/call ("
+              << treeSeconds / compiledMapSeconds << "x)\n"
+              << "  compiled + span: " << compiledSpanSeconds / n * 1e9 << " ns/call ("
+              << treeSeconds / compiledSpanSeconds << "x)\n"
+              << "  jit + span:     " << jitSeconds / n * 1e9 << " ns/call (" << treeSeconds / jitSeconds << "x"
+              << (native.isNative() ? "" : ", interpreted") << ")\n";
+}
+
+void
+benchmarkVectorized(std::string const& text, std::size_t numRows)
+{
+    auto e = expr::Expression::parse(text);
+    auto layout = expr::VariableLayout::of(e);
+    auto compiled = expr::compile(e, layout);
+    auto native = expr::JitExpression(compiled);
+
+    // One column of inputs per variable in layout order; the last variable is a broadcast scalar.
+    auto columns = std::vector<std::vector<double>>{ };
+    auto columnSpans = std::vector<std::span<double const>>{ };
+    auto variableSubstitutions = std::unordered_map<std::string, expr::VariableSubstitution>{ };
+    for (std::size_t j = 0; j != layout.size(); ++j)
+    {
+        auto& column = columns.emplace_back(j + 1 == layout.size() ? 1 : numRows);
+        for (std::size_t i = 0; i != column.size(); ++i)
+        {
+            column[i] = 1.0 + 0.001 * double(i + j);
+        }
+        columnSpans.emplace_back(column);
+        variableSubstitutions[layout.names()[j]] = column.size() == 1
+            ? expr::VariableSubstitution{ column[0] }
+            : expr::VariableSubstitution{ std::span<double const>(column) };
+    }
+
+    // Warm up all evaluators so that none pays for first-touch page faults of the result buffers.
+    using expr::VectorizedEvaluation;
+    auto treeResult = evaluate(e, variableSubstitutions, VectorizedEvaluation::wholeArrays);
+    auto tiledResult = evaluate(e, variableSubstitutions, VectorizedEvaluation::tiled);
+    auto compiledResult = evaluate(compiled, columnSpans);
+    auto jitResult = evaluate(native, columnSpans);
+
+    // The native batch function takes a pointer to every row of each column, so the broadcast column is expanded.
+    auto broadcastColumn = std::vector<double>(numRows, columns.back()[0]);
+    auto columnPointers = std::vector<double const*>{ };
+    for (auto const& column : columns)
+    {
+        columnPointers.push_back(column.size() == 1 ? broadcastColumn.data() : column.data());
+    }
+    auto batchResult = std::vector<double>(numRows);
+    auto runBatchFunction = [&]
+    {
+        if (native.isNative())
+        {
+            native.batchFunction()(columnPointers.data(), batchResult.data(), numRows);
+        }
+    };
+    runBatchFunction();
+    double treeSeconds = measureSeconds([&]
+        {
+            treeResult = evaluate(e, variableSubstitutions, VectorizedEvaluation::wholeArrays);
+        });
+    double tiledSeconds = measureSeconds([&]
+        {
+            tiledResult = evaluate(e, variableSubstitutions, VectorizedEvaluation::tiled);
+        });
+    double compiledSeconds = measureSeconds([&] { compiledResult = evaluate(compiled, columnSpans); });
+    double jitSeconds = measureSeconds([&] { jitResult = evaluate(native, columnSpans); });
+    double batchSeconds = measureSeconds(runBatchFunction);
+    if (std::get<std::vector<double>>(treeResult) != compiledResult)
+    {
+        throw std::runtime_error("compiled and tree evaluation disagree for " + text);
+    }
+    if (tiledResult != treeResult)
+    {
+        throw std::runtime_error("tiled and whole-array evaluation disagree for " + text);
+    }
+    if (jitResult != compiledResult)
+    {
+        throw std::runtime_error("native and compiled evaluation disagree for " + text);
+    }
+    // The native batch function calls the scalar functions, whereas the compiled stack machine uses the array kernels,
+    // which may differ in the last bit. So its results are compared with the scalar evaluation of each row.
+    auto rowValues = std::vector<double>(layout.size());
+    for (std::size_t i = 0; i != numRows && native.isNative(); ++i)
+    {
+        for (std::size_t j = 0; j != layout.size(); ++j)
+        {
+            rowValues[j] = columns[j].size() == 1 ? columns[j][0] : columns[j][i];
+        }
+        if (batchResult[i] != evaluate(compiled, std::span<double const>(rowValues)))
+        {
+            throw std::runtime_error("native batch function and scalar evaluation disagree for " + text);
+        }
+    }
+
+    double n = double(numRows);
+    std::cout << (text.size() > 40 ? text.substr(0, 37) + "..." : text) << " (" << numRows << " rows)\n"
+              << "  tree, whole arrays: " << treeSeconds / n * 1e9 << " ns/row\n"
+              << "  tree, tiled:        " << tiledSeconds / n * 1e9 << " ns/row ("
+              << treeSeconds / tiledSeconds << "x)\n"
+              << "  compiled, tiled:    " << compiledSeconds / n * 1e9 << " ns/row ("
+              << treeSeconds / compiledSeconds << "x)\n"
+              << "  jit:                " << jitSeconds / n * 1e9 << " ns/row ("
+              << treeSeconds / jitSeconds << "x)\n"
+              << "  jit batch function: " << batchSeconds / n * 1e9 << " ns/row ("
+              << treeSeconds / batchSeconds << "x)\n";
+}
+
+int main(int argc, char* argv[])
+try
+{
+    std::size_t numRepetitions = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    std::size_t numRows = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 100000;
+
+    benchmarkExpression("a*x^2", numRepetitions);
+    benchmarkExpression("a*x^2 + b*x + c", numRepetitions);
+    benchmarkExpression(benchmark::randomPolynomial(10), numRepetitions);
+    benchmarkExpression(benchmark::randomPolynomial(100), numRepetitions / 10);
+
+    benchmarkVectorized("a*x^2 + b*x + c", numRows);
+    benchmarkVectorized(benchmark::randomPolynomial(10), numRows);
+}
+catch (std::exception const& e)
+{
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+}
@@ -0,0 +1,172 @@
+#include <span>
+#include <string>
+#include <vector>
+#include <cstdlib>        // for strtoul()
+#include <iomanip>        // for setw()
+#include <iostream>
+#include <stdexcept>      // for runtime_error
+#include <unordered_map>
+
+#include "expression.h"
+#include "expression-dag.h"
+#include "expression-arena.h"
+#include "expression-compile.h"
+#include "expression-evaluate.h"
+#include "thread-pool.h"
+
+#include "workloads.h"
+#include "benchmark-utility.h"
+
+
+// Compares evaluating expressions with repeated subexpressions as trees and as a hash-consed DAG.
+//
+// Usage:
+//   dag-benchmark [<number of terms> [<number of distinct subexpressions> [<evaluation repetitions> [<rows>]]]]
+
+
+using namespace asc::cpp_practice_ws20::ex08;
+using benchmark::measureSeconds;
+
+
+int main(int argc, char* argv[])
+try
+{
+    std::size_t numTerms = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200;
+    std::size_t numDistinct = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 10;
+    std::size_t numRepetitions = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 10000;
+    std::size_t numRows = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 100000;
+
+    auto text = benchmark::randomRepetitiveFormula(numTerms, numDistinct);
+    auto tree = expr::Expression::parse(text);
+    auto arena = expr::ExpressionArena{ };
+    auto arenaExpr = arena.add(tree);
+
+    auto dag = expr::ExpressionDag{ };
+    double dagBuildSeconds = 0;
+    auto dagExpr = expr::ArenaExpression{ dag.arena(), 0 };
+    dagBuildSeconds = measureSeconds([&] { dagExpr = dag.add(tree); });
+    if (dagExpr.toExpression() != tree)
+    {
+        throw std::runtime_error("DAG and tree differ");
+    }
+
+    std::cout << "tree nodes: " << arena.size() << ", DAG nodes: " << dag.size()
+              << ", deduplicated: " << dag.deduplicatedNodes()
+              << ", DAG build: " << dagBuildSeconds * 1000 << " ms\n";
+
+    auto variableSubstitutions = std::unordered_map<std::string, double>{ };
+    for (auto const& name : benchmark::workloadVariables())
+    {
+        variableSubstitutions[name] = 1.25;
+    }
+
+    auto treeCompiled = expr::compile(arenaExpr);
+    auto dagCompiled = expr::compile(dagExpr);
+    std::cout << "instructions: tree " << treeCompiled.code().size() << ", DAG " << dagCompiled.code().size()
+              << " (" << dagCompiled.temporaryCount() << " temporaries)\n";
+
+    auto variableValues = std::vector<double>{ };
+    for (auto const& name : dagCompiled.variables())
+    {
+        variableValues.push_back(variableSubstitutions.at(name));
+    }
+
+    double treeResult = 0;
+    double treeSeconds = measureSeconds([&]
+        {
+            for (std::size_t i = 0; i != numRepetitions; ++i)
+            {
+                treeResult += evaluate(tree, variableSubstitutions);
+            }
+        });
+    double sweepResult = 0;
+    double sweepSeconds = measureSeconds([&]
+        {
+            for (std::size_t i = 0; i != numRepetitions; ++i)
+            {
+                sweepResult += evaluate(dagExpr, variableSubstitutions);
+            }
+        });
+    double treeCompiledResult = 0;
+    double treeCompiledSeconds = measureSeconds([&]
+        {
+            for (std::size_t i = 0; i != numRepetitions; ++i)
+            {
+                treeCompiledResult += evaluate(treeCompiled, variableSubstitutions);
+            }
+        });
+    double dagCompiledResult = 0;
+    double dagCompiledSeconds = measureSeconds([&]
+        {
+            for (std::size_t i = 0; i != numRepetitions; ++i)
+            {
+                dagCompiledResult += evaluate(dagCompiled, std::span<double const>(variableValues));
+            }
+        });
+    if (treeResult != sweepResult || treeResult != treeCompiledResult || treeResult != dagCompiledResult)
+    {
+        throw std::runtime_error("DAG and tree evaluate differently");
+    }
+
+    double n = double(numRepetitions);
+    std::cout << "tree walk:           " << treeSeconds / n * 1e6 << " us/call\n"
+              << "DAG sweep:           " << sweepSeconds / n * 1e6 << " us/call ("
+              << treeSeconds / sweepSeconds << "x)\n"
+              << "compiled tree:       " << treeCompiledSeconds / n * 1e6 << " us/call ("
+              << treeSeconds / treeCompiledSeconds << "x)\n"
+              << "compiled DAG + span: " << dagCompiledSeconds / n * 1e6 << " us/call ("
+              << treeSeconds / dagCompiledSeconds << "x)\n";
+
+    // The vectorized evaluators, with a column of values for every variable.
+    auto columns = std::vector<std::vector<double>>{ };
+    auto columnSubstitutions = std::unordered_map<std::string, expr::VariableSubstitution>{ };
+    for (auto const& name : benchmark::workloadVariables())
+    {
+        auto& column = columns.emplace_back(numRows);
+        for (std::size_t i = 0; i != numRows; ++i)
+        {
+            column[i] = 1.0 + 0.001 * double(i % 1000 + columns.size());
+        }
+        columnSubstitutions[name] = std::span<double const>(column);
+    }
+    auto pool = ThreadPool(2);
+    auto out = std::vector<double>(numRows);
+    auto reportVectorized = [&](char const* name, auto evaluateColumns)
+    {
+        auto treeColumn = evaluateColumns(arenaExpr);
+        auto dagColumn = evaluateColumns(dagExpr);
+        if (dagColumn != treeColumn)
+        {
+            throw std::runtime_error(std::string(name) + ": DAG and tree evaluate differently");
+        }
+        double treeColumnSeconds = measureSeconds([&] { treeColumn = evaluateColumns(arenaExpr); });
+        double dagColumnSeconds = measureSeconds([&] { dagColumn = evaluateColumns(dagExpr); });
+        std::cout << std::left << std::setw(14) << name << std::right << " tree " << std::setw(8)
+                  << treeColumnSeconds / double(numRows) * 1e9 << " ns/row, DAG " << std::setw(8)
+                  << dagColumnSeconds / double(numRows) * 1e9 << " ns/row ("
+                  << treeColumnSeconds / dagColumnSeconds << "x)\n";
+    };
+    std::cout << numRows << " rows:\n";
+    reportVectorized("planned", [&](expr::ArenaExpression const& e)
+        {
+            return evaluate(e, columnSubstitutions, expr::VectorizedEvaluation::planned);
+        });
+    reportVectorized("tiled", [&](expr::ArenaExpression const& e)
+        {
+            return evaluate(e, columnSubstitutions, expr::VectorizedEvaluation::tiled);
+        });
+    reportVectorized("evaluateInto", [&](expr::ArenaExpression const& e)
+        {
+            evaluateInto(e, columnSubstitutions, out);
+            return out;
+        });
+    reportVectorized("2 threads", [&](expr::ArenaExpression const& e)
+        {
+            return evaluate(e, columnSubstitutions, pool, 4096);
+        });
+}
+catch (std::exception const& e)
+{
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+}
@@ -0,0 +1,161 @@
+#include <span>
+#include <cmath>          // for abs()
+#include <string>
+#include <vector>
+#include <utility>        // for pair<>
+#include <cstdlib>        // for strtoul()
+#include <iostream>
+#include <algorithm>      // for max()
+#include <stdexcept>      // for runtime_error
+
+#include "utility.h"      // for overload<>
+#include "expression.h"
+#include "expression-dag.h"
+#include "expression-compile.h"
+#include "variable-layout.h"
+#include "expression-gradient.h"
+#include "expression-differentiate.h"
+
+#include "workloads.h"
+#include "benchmark-utility.h"
+
+
+// Measures the size of symbolic derivatives, as trees and in a DAG shared with the original, and the cost of
+// evaluating them compared with the original. Checks the derivatives against `evaluateGradient()`.
+//
+// Usage:
+//   differentiate-benchmark [<evaluation repetitions> [<highest order>]]
+
+
+using namespace asc::cpp_practice_ws20::ex08;
+using benchmark::measureSeconds;
+
+
+std::size_t
+countNodes(expr::Expression const& e)
+{
+    return std::visit(
+        overload{
+            [](expr::UnaryFunctionExpression const& unaryExpr) { return 1 + countNodes(unaryExpr.x); },
+            [](expr::BinaryFunctionExpression const& binaryExpr) { return 1 + countNodes(binaryExpr.x) + countNodes(binaryExpr.y); },
+            [](auto const&) { return std::size_t(1); }
+        },
+        e.value());
+}
+
+void
+checkClose(std::string const& what, double expected, double actual, double tolerance)
+{
+    if (std::abs(expected - actual) > tolerance * std::max(1.0, std::abs(expected)))
+    {
+        throw std::runtime_error(what + ": expected " + std::to_string(expected) + ", got " + std::to_string(actual));
+    }
+}
+
+// The evaluation time per call of a compiled expression at `x`, and the value.
+std::pair<double, double>
+measureEvaluation(expr::CompiledExpression const& compiled, std::span<double const> x, std::size_t numRepetitions)
+{
+    double value = 0;
+    double seconds = measureSeconds([&]
+        {
+            for (std::size_t i = 0; i != numRepetitions; ++i)
+            {
+                value += evaluate(compiled, x);
+            }
+        });
+    return { seconds / double(numRepetitions), value / double(numRepetitions) };
+}
+
+void
+benchmarkDerivatives(std::string const& text, std::size_t numRepetitions)
+{
+    auto e = expr::Expression::parse(text);
+    auto dag = expr::ExpressionDag{ };
+    auto root = dag.add(e);
+    std::size_t originalDagSize = dag.size();
+
+    auto layout = expr::VariableLayout::of(root);
+    auto compiled = expr::compile(root, layout);
+    auto x = std::vector<double>(layout.names().size());
+    for (std::size_t j = 0; j != x.size(); ++j)
+    {
+        x[j] = 0.5 + 0.125 * double(j);
+    }
+    auto gradient = std::vector<double>(x.size());
+    evaluateGradient(compiled, x, gradient);
+    double originalSeconds = measureEvaluation(compiled, x, numRepetitions).first;
+
+    std::cout << (text.size() > 40 ? text.substr(0, 37) + "..." : text) << '\n'
+              << "  original: " << countNodes(e) << " tree nodes, " << originalDagSize << " DAG nodes, "
+              << compiled.code().size() << " instructions, " << originalSeconds * 1e9 << " ns/call\n";
+
+    for (auto const& variable : layout.names())
+    {
+        std::size_t dagSize = dag.size();
+        auto derivative = differentiate(dag, root, variable);
+        auto derivativeTree = differentiate(e, variable);
+        auto derivativeCompiled = expr::compile(derivative, layout);
+
+        auto [seconds, value] = measureEvaluation(derivativeCompiled, x, numRepetitions);
+        double expected = gradient[layout.indexOf(variable)];
+        checkClose("derivative of " + text + " by " + variable, expected, value, 1e-9);
+        checkClose("derivative tree of " + text + " by " + variable, expected,
+            evaluate(expr::compile(derivativeTree, layout), x), 1e-9);
+
+        std::cout << "  d/d" << variable << ": " << countNodes(derivativeTree) << " tree nodes, +" << dag.size() - dagSize
+                  << " DAG nodes, " << derivativeCompiled.code().size() << " instructions, " << seconds * 1e9
+                  << " ns/call (" << seconds / originalSeconds << " evaluations)\n";
+    }
+}
+
+// Repeated differentiation, where the product rule doubles the terms with every order: the trees grow exponentially,
+// the DAG only by the nodes which are actually new.
+void
+benchmarkHigherDerivatives(std::string const& text, std::string const& variable, std::size_t maxOrder)
+{
+    auto tree = expr::Expression::parse(text);
+    auto dag = expr::ExpressionDag{ };
+    auto derivative = dag.add(tree);
+
+    std::cout << "derivatives of " << text << " by " << variable << '\n';
+    for (std::size_t order = 1; order <= maxOrder; ++order)
+    {
+        auto previous = derivative;
+        derivative = differentiate(dag, derivative, variable);
+        tree = differentiate(tree, variable);
+
+        // Check against a central difference of the previous derivative.
+        auto layout = expr::VariableLayout{ variable };
+        auto previousCompiled = expr::compile(previous, layout);
+        auto compiled = expr::compile(derivative, layout);
+        auto at = [](expr::CompiledExpression const& c, double x) { return evaluate(c, std::span<double const>(&x, 1)); };
+        double x = 0.75;
+        double h = 1e-5;
+        double difference = (at(previousCompiled, x + h) - at(previousCompiled, x - h)) / (2 * h);
+        checkClose("derivative of order " + std::to_string(order) + " of " + text, difference, at(compiled, x), 1e-4);
+
+        std::cout << "  order " << order << ": " << countNodes(tree) << " tree nodes, " << dag.size() << " DAG nodes, "
+                  << compiled.code().size() << " instructions\n";
+    }
+}
+
+int main(int argc, char* argv[])
+try
+{
+    std::size_t numRepetitions = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    std::size_t maxOrder = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 8;
+
+    benchmarkDerivatives("a*x^2 + b*x + c", numRepetitions);
+    benchmarkDerivatives("sqrt(x)*exp(-y) + log(x)*sin(y) - cos(x)/tan(y) + arcsin(x/4) + arccos(y/4)*arctan(x*y)",
+        numRepetitions);
+    benchmarkDerivatives("x^y + y^(1/2) + log(x, y) + log(2, x*y)", numRepetitions);
+    benchmarkDerivatives(benchmark::randomRepetitiveFormula(20, 4), numRepetitions / 10);
+    benchmarkDerivatives(benchmark::randomPolynomial(100), numRepetitions / 10);
+    benchmarkHigherDerivatives("exp(sin(x))/x", "x", maxOrder);
+}
+catch (std::exception const& e)
+{
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+}
@@ -0,0 +1,122 @@
+#include <span>
+#include <string>
+#include <vector>
+#include <cstdlib>        // for strtoul()
+#include <iostream>
+#include <stdexcept>      // for runtime_error
+#include <unordered_map>
+
+#include "expression.h"
+#include "expression-arena.h"
+#include "expression-evaluate.h"
+
+#include "workloads.h"
+#include "allocation-counter.h"
+#include "benchmark-utility.h"
+
+
+// Compares the tiled vectorized `evaluate()`, which returns a new array, with `evaluateInto()`, which writes to an
+// array owned by the caller, and checks that `evaluateInto()` does not allocate memory once it has evaluated an
+// expression: the check fails if any allocation happens in the measured repetitions.
+//
+// Usage:
+//   evaluate-into-benchmark [<repetitions> [<rows>]]
+
+
+using namespace asc::cpp_practice_ws20::ex08;
+using benchmark::measureSeconds;
+
+
+template <typename ExpressionT>
+void
+checkNoAllocations(char const* what, ExpressionT const& e,
+    std::unordered_map<std::string, expr::VariableSubstitution> const& variableSubstitutions, std::span<double> out,
+    std::size_t numRepetitions)
+{
+    // The first evaluation may grow the scratch space of this thread.
+    evaluateInto(e, variableSubstitutions, out);
+    auto allocationsBefore = benchmark::allocationCount();
+    for (std::size_t r = 0; r != numRepetitions; ++r)
+    {
+        evaluateInto(e, variableSubstitutions, out);
+    }
+    auto numAllocations = benchmark::allocationCount() - allocationsBefore;
+    if (numAllocations != 0)
+    {
+        throw std::runtime_error(std::string("evaluateInto() of ") + what + " allocated memory "
+            + std::to_string(numAllocations) + " times in " + std::to_string(numRepetitions) + " calls");
+    }
+}
+
+void
+benchmarkEvaluateInto(std::string const& text, std::size_t numRepetitions, std::size_t numRows)
+{
+    auto e = expr::Expression::parse(text);
+    auto arena = expr::ExpressionArena{ };
+    auto arenaExpression = arena.add(e);
+
+    auto columns = std::vector<std::vector<double>>{ };
+    auto variableSubstitutions = std::unordered_map<std::string, expr::VariableSubstitution>{ };
+    for (auto const& name : benchmark::workloadVariables())
+    {
+        auto& column = columns.emplace_back(numRows);
+        for (std::size_t i = 0; i != numRows; ++i)
+        {
+            column[i] = 1.0 + 0.001 * double(i % 1000 + columns.size());
+        }
+        variableSubstitutions[name] = std::span<double const>(column);
+    }
+
+    // `evaluate()` allocates its result on every call, so it writes to new pages each time for large arrays.
+    auto result = evaluate(e, variableSubstitutions);
+    auto allocationsBefore = benchmark::allocationCount();
+    double evaluateSeconds = measureSeconds([&]
+        {
+            for (std::size_t r = 0; r != numRepetitions; ++r)
+            {
+                result = evaluate(e, variableSubstitutions);
+            }
+        });
+    auto evaluateAllocations = benchmark::allocationCount() - allocationsBefore;
+
+    auto out = std::vector<double>(numRows);
+    checkNoAllocations("a tree", e, variableSubstitutions, out, numRepetitions);
+    checkNoAllocations("an arena expression", arenaExpression, variableSubstitutions, out, numRepetitions);
+    double intoSeconds = measureSeconds([&]
+        {
+            for (std::size_t r = 0; r != numRepetitions; ++r)
+            {
+                evaluateInto(e, variableSubstitutions, out);
+            }
+        });
+    if (std::get<std::vector<double>>(result) != out)
+    {
+        throw std::runtime_error("evaluate() and evaluateInto() disagree for " + text);
+    }
+
+    double n = double(numRepetitions * numRows);
+    std::cout << (text.size() > 40 ? text.substr(0, 37) + "..." : text) << " (" << numRows << " rows)\n"
+              << "  evaluate():     " << evaluateSeconds / n * 1e9 << " ns/row, "
+              << double(evaluateAllocations) / double(numRepetitions) << " allocations/call\n"
+              << "  evaluateInto(): " << intoSeconds / n * 1e9 << " ns/row (" << evaluateSeconds / intoSeconds
+              << "x), 0 allocations/call\n";
+}
+
+int main(int argc, char* argv[])
+try
+{
+    std::size_t numRepetitions = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100;
+    std::size_t numRows = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1000000;
+
+    benchmarkEvaluateInto("a*x^2 + b*x + c", numRepetitions, numRows);
+    benchmarkEvaluateInto("sin(x)*exp(-y/1000) + sqrt(z)*arctan(a/b)", numRepetitions, numRows);
+    benchmarkEvaluateInto(benchmark::randomPolynomial(10), numRepetitions, numRows);
+
+    // Small arrays show the cost of the calls themselves.
+    benchmarkEvaluateInto("a*x^2 + b*x + c", numRepetitions * 1000, 100);
+}
+catch (std::exception const& e)
+{
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+}
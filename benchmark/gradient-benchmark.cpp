@@ -0,0 +1,175 @@
+#include <span>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <cstdlib>        // for strtoul()
+#include <iostream>
+#include <algorithm>      // for max()
+#include <stdexcept>      // for runtime_error
+
+#include "expression.h"
+#include "expression-compile.h"
+#include "expression-gradient.h"
+
+#include "workloads.h"
+#include "benchmark-utility.h"
+
+
+// Compares the cost of a gradient by central finite differences, which takes 2N + 1 evaluations for N variables, with
+// reverse-mode automatic differentiation, both relative to a single evaluation of the compiled expression, and the
+// batch gradient with the batch evaluation. Checks that the gradients agree.
+//
+// Usage:
+//   gradient-benchmark [<gradient repetitions> [<rows>]]
+
+
+using namespace asc::cpp_practice_ws20::ex08;
+using benchmark::measureSeconds;
+
+
+// The gradient by central differences; the result is the value at `x`.
+double
+finiteDifferenceGradient(expr::CompiledExpression const& compiled, std::vector<double>& x, std::span<double> gradient)
+{
+    double value = evaluate(compiled, std::span<double const>(x));
+    for (std::size_t j = 0; j != x.size(); ++j)
+    {
+        double xj = x[j];
+        double h = 1e-6 * std::max(1.0, std::abs(xj));
+        x[j] = xj + h;
+        double forward = evaluate(compiled, std::span<double const>(x));
+        x[j] = xj - h;
+        double backward = evaluate(compiled, std::span<double const>(x));
+        x[j] = xj;
+        gradient[j] = (forward - backward) / (2 * h);
+    }
+    return value;
+}
+
+void
+checkGradient(std::string const& text, std::span<double const> expected, std::span<double const> actual, double tolerance)
+{
+    for (std::size_t j = 0; j != expected.size(); ++j)
+    {
+        if (std::abs(expected[j] - actual[j]) > tolerance * std::max(1.0, std::abs(expected[j])))
+        {
+            throw std::runtime_error("gradients disagree for " + text);
+        }
+    }
+}
+
+void
+benchmarkGradient(std::string const& text, std::size_t numRepetitions, std::size_t numRows)
+{
+    auto e = expr::Expression::parse(text);
+    auto compiled = expr::compile(e);
+    std::size_t numVariables = compiled.variables().size();
+
+    // Use different inputs on every call, as an optimisation loop would.
+    auto x = std::vector<double>(numVariables);
+    auto setInputs = [&x](std::size_t i)
+    {
+        for (std::size_t j = 0; j != x.size(); ++j)
+        {
+            x[j] = 1.0 + 0.001 * double(i % 1000 + j);
+        }
+    };
+
+    double evaluateSum = 0;
+    double evaluateSeconds = measureSeconds([&]
+        {
+            for (std::size_t i = 0; i != numRepetitions; ++i)
+            {
+                setInputs(i);
+                evaluateSum += evaluate(compiled, std::span<double const>(x));
+            }
+        });
+    auto differenceGradient = std::vector<double>(numVariables);
+    double differenceSum = 0;
+    double differenceSeconds = measureSeconds([&]
+        {
+            for (std::size_t i = 0; i != numRepetitions; ++i)
+            {
+                setInputs(i);
+                differenceSum += finiteDifferenceGradient(compiled, x, differenceGradient);
+            }
+        });
+    auto gradient = std::vector<double>(numVariables);
+    double gradientSum = 0;
+    double gradientSeconds = measureSeconds([&]
+        {
+            for (std::size_t i = 0; i != numRepetitions; ++i)
+            {
+                setInputs(i);
+                gradientSum += evaluateGradient(compiled, x, gradient);
+            }
+        });
+    if (evaluateSum != differenceSum || evaluateSum != gradientSum)
+    {
+        throw std::runtime_error("gradient evaluation and evaluate() disagree for " + text);
+    }
+    // Both gradients are those of the last inputs.
+    checkGradient(text, gradient, differenceGradient, 1e-5);
+
+    // The batch gradient of `numRows` rows, the last variable being a broadcast scalar.
+    auto columns = std::vector<std::vector<double>>{ };
+    auto columnSpans = std::vector<std::span<double const>>{ };
+    for (std::size_t j = 0; j != numVariables; ++j)
+    {
+        auto& column = columns.emplace_back(j + 1 == numVariables ? 1 : numRows);
+        for (std::size_t i = 0; i != column.size(); ++i)
+        {
+            column[i] = 1.0 + 0.001 * double(i % 1000 + j);
+        }
+        columnSpans.emplace_back(column);
+    }
+    auto batchValues = evaluate(compiled, columnSpans);
+    auto batchGradient = evaluateGradient(compiled, columnSpans);
+    double batchEvaluateSeconds = measureSeconds([&] { batchValues = evaluate(compiled, columnSpans); });
+    double batchGradientSeconds = measureSeconds([&] { batchGradient = evaluateGradient(compiled, columnSpans); });
+    if (batchGradient.values != batchValues)
+    {
+        throw std::runtime_error("batch gradient evaluation and evaluate() disagree for " + text);
+    }
+    for (std::size_t i = 0; i < numRows; i += numRows / 16 + 1)
+    {
+        for (std::size_t j = 0; j != numVariables; ++j)
+        {
+            x[j] = columns[j].size() == 1 ? columns[j][0] : columns[j][i];
+        }
+        evaluateGradient(compiled, x, gradient);
+        for (std::size_t j = 0; j != numVariables; ++j)
+        {
+            differenceGradient[j] = batchGradient.gradient[j][i];
+        }
+        checkGradient(text, gradient, differenceGradient, 1e-12);
+    }
+
+    double n = double(numRepetitions);
+    std::cout << (text.size() > 40 ? text.substr(0, 37) + "..." : text) << " (" << numVariables << " variables)\n"
+              << "  evaluate():             " << evaluateSeconds / n * 1e9 << " ns/call\n"
+              << "  finite differences:     " << differenceSeconds / n * 1e9 << " ns/gradient ("
+              << differenceSeconds / evaluateSeconds << " evaluations)\n"
+              << "  evaluateGradient():     " << gradientSeconds / n * 1e9 << " ns/gradient ("
+              << gradientSeconds / evaluateSeconds << " evaluations)\n"
+              << "  batch evaluate():       " << batchEvaluateSeconds / double(numRows) * 1e9 << " ns/row\n"
+              << "  batch evaluateGradient(): " << batchGradientSeconds / double(numRows) * 1e9 << " ns/row ("
+              << batchGradientSeconds / batchEvaluateSeconds << " evaluations)\n";
+}
+
+int main(int argc, char* argv[])
+try
+{
+    std::size_t numRepetitions = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    std::size_t numRows = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 100000;
+
+    benchmarkGradient("a*x^2 + b*x + c", numRepetitions, numRows);
+    benchmarkGradient("sin(x)*exp(-y/1000) + sqrt(z)*arctan(a/b)", numRepetitions, numRows);
+    benchmarkGradient(benchmark::randomPolynomial(10), numRepetitions, numRows);
+    benchmarkGradient(benchmark::randomPolynomial(100), numRepetitions / 10, numRows);
+}
+catch (std::exception const& e)
+{
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+}
@@ -0,0 +1,117 @@
+#include <span>
+#include <string>
+#include <vector>
+#include <cstdlib>        // for strtoul()
+#include <iostream>
+#include <stdexcept>      // for runtime_error
+#include <unordered_map>
+
+#include "expression.h"
+#include "expression-compile.h"
+#include "expression-evaluate.h"
+#include "incremental-evaluator.h"
+
+#include "workloads.h"
+#include "benchmark-utility.h"
+
+
+// Compares a parameter sweep which changes one variable per call, evaluated by the compiled expression from scratch
+// and by an `IncrementalEvaluator`, and reports how many nodes the incremental updates recompute. Checks that both
+// agree bit for bit.
+//
+// Usage:
+//   incremental-benchmark [<number of variables> [<number of terms> [<updates>]]]
+
+
+using namespace asc::cpp_practice_ws20::ex08;
+using benchmark::measureSeconds;
+
+
+void
+benchmarkSweep(std::string const& text, std::size_t numUpdates)
+{
+    auto e = expr::Expression::parse(text);
+    auto compiled = expr::compile(e);
+    auto names = compiled.variables();
+
+    auto variableSubstitutions = std::unordered_map<std::string, double>{ };
+    for (auto const& name : names)
+    {
+        variableSubstitutions[name] = 0.5;
+    }
+    auto evaluator = expr::IncrementalEvaluator(e, variableSubstitutions);
+
+    // The value of the variable changed by the `i`-th update.
+    auto sweepValue = [](std::size_t i) { return 0.5 + 0.001 * double(i % 1000); };
+
+    auto x = std::vector<double>(names.size(), 0.5);
+    double compiledSum = 0;
+    double compiledSeconds = measureSeconds([&]
+        {
+            for (std::size_t i = 0; i != numUpdates; ++i)
+            {
+                x[i % x.size()] = sweepValue(i);
+                compiledSum += evaluate(compiled, std::span<double const>(x));
+            }
+        });
+
+    // The positional update, since the sweep knows the slots of its variables anyway.
+    auto positions = std::vector<std::size_t>{ };
+    for (auto const& name : names)
+    {
+        positions.push_back(evaluator.layout().indexOf(name));
+    }
+    double incrementalSum = 0;
+    std::size_t numRecomputed = 0;
+    double incrementalSeconds = measureSeconds([&]
+        {
+            for (std::size_t i = 0; i != numUpdates; ++i)
+            {
+                incrementalSum += evaluator.update(positions[i % positions.size()], sweepValue(i));
+                numRecomputed += evaluator.lastUpdate().recomputedNodes;
+            }
+        });
+    if (compiledSum != incrementalSum)
+    {
+        throw std::runtime_error("incremental evaluation and evaluate() disagree for " + text);
+    }
+
+    // Changing several variables at once recomputes the union of their paths.
+    for (std::size_t j = 0; j != names.size(); ++j)
+    {
+        variableSubstitutions[names[j]] = x[j] = 0.25 + 0.125 * double(j % 4);
+    }
+    if (evaluator.update(variableSubstitutions) != evaluate(compiled, std::span<double const>(x))
+        || evaluator.value() != evaluate(e, variableSubstitutions))
+    {
+        throw std::runtime_error("incremental evaluation of several changes and evaluate() disagree for " + text);
+    }
+
+    double n = double(numUpdates);
+    double recomputed = double(numRecomputed) / n;
+    std::cout << (text.size() > 40 ? text.substr(0, 37) + "..." : text) << " (" << names.size() << " variables, "
+              << evaluator.size() << " nodes)\n"
+              << "  compiled evaluate(): " << compiledSeconds / n * 1e9 << " ns/call\n"
+              << "  incremental update(): " << incrementalSeconds / n * 1e9 << " ns/call ("
+              << compiledSeconds / incrementalSeconds << "x), " << recomputed << " nodes recomputed, "
+              << double(evaluator.size()) - recomputed << " skipped\n"
+              << "  update of all variables: " << evaluator.lastUpdate().recomputedNodes << " nodes recomputed, "
+              << evaluator.lastUpdate().skippedNodes << " skipped\n";
+}
+
+int main(int argc, char* argv[])
+try
+{
+    std::size_t numVariables = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20;
+    std::size_t numTerms = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 40;
+    std::size_t numUpdates = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 1000000;
+
+    benchmarkSweep(benchmark::randomParameterFormula(numVariables, numTerms), numUpdates);
+    benchmarkSweep(benchmark::randomParameterFormula(numVariables, 10 * numTerms), numUpdates / 10);
+    benchmarkSweep(benchmark::randomPolynomial(numTerms), numUpdates);
+}
+catch (std::exception const& e)
+{
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+}
@@ -0,0 +1,107 @@
+#include <string>
+#include <vector>
+#include <cstddef>        // for size_t
+#include <cstdlib>        // for strtoul()
+#include <iostream>
+#include <algorithm>      // for find()
+#include <stdexcept>      // for runtime_error
+
+#include "line-scan.h"
+
+#include "workloads.h"
+#include "benchmark-utility.h"
+
+
+// Measures how fast a buffer is split into lines with each newline scanner, in GB/s, and how many lines are classified
+// as comments or blank lines on the way.
+//
+// Usage:
+//   line-scan-benchmark [<megabytes of input> [<repetitions>]]
+
+
+using namespace asc::cpp_practice_ws20::ex08;
+using benchmark::measureSeconds;
+namespace read_lines = arithmetic_expression_::read_lines;
+
+
+struct SplitResult
+{
+    std::size_t numContentLines = 0;
+    std::size_t numSkippedLines = 0;
+    std::size_t numContentBytes = 0;
+
+    friend bool operator ==(SplitResult const&, SplitResult const&) = default;
+};
+
+template <typename FindNewline>
+SplitResult
+splitLines(std::string const& input, std::vector<std::string> const& commentPrefixes, FindNewline findNewline)
+{
+    auto result = SplitResult{ };
+    char const* last = input.data() + input.size();
+    for (char const* first = input.data(); first != last; )
+    {
+        char const* lineEnd = findNewline(first, last);
+        auto line = std::string_view(first, std::size_t(lineEnd - first));
+        if (read_lines::classifyLine(line, commentPrefixes) == read_lines::LineKind::content)
+        {
+            ++result.numContentLines;
+            result.numContentBytes += line.size();
+        }
+        else
+        {
+            ++result.numSkippedLines;
+        }
+        first = lineEnd != last ? lineEnd + 1 : last;
+    }
+    return result;
+}
+
+int main(int argc, char* argv[])
+try
+{
+    std::size_t numMegabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 256;
+    std::size_t numRepetitions = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 10;
+
+    auto input = benchmark::randomInputLines(numMegabytes << 20);
+    auto commentPrefixes = std::vector<std::string>{ "//", "#" };
+
+    auto expected = SplitResult{ };
+    auto benchmarkScanner = [&](char const* name, auto findNewline)
+    {
+        auto result = SplitResult{ };
+        double seconds = measureSeconds([&]
+            {
+                for (std::size_t i = 0; i != numRepetitions; ++i)
+                {
+                    result = splitLines(input, commentPrefixes, findNewline);
+                }
+            });
+        if (expected == SplitResult{ })
+        {
+            expected = result;
+        }
+        else if (result != expected)
+        {
+            throw std::runtime_error(std::string(name) + " splits lines differently");
+        }
+        std::cout << "  " << name << ": " << double(input.size()) * double(numRepetitions) / seconds / 1e9 << " GB/s\n";
+    };
+
+    std::cout << "Splitting " << input.size() / 1e6 << " MB into lines:\n";
+    benchmarkScanner("std::find (before)", [](char const* first, char const* last) { return std::find(first, last, '\n'); });
+#if defined(__x86_64__) || defined(_M_X64)
+    benchmarkScanner("SSE2", read_lines::detail::findNewlineSse2);
+    if (read_lines::detail::cpuSupportsAvx2())
+    {
+        benchmarkScanner("AVX2", read_lines::detail::findNewlineAvx2);
+    }
+#endif // defined(__x86_64__) || defined(_M_X64)
+    benchmarkScanner("findNewline (dispatched)", read_lines::findNewline);
+    std::cout << expected.numContentLines << " content lines, " << expected.numSkippedLines << " comments and blank lines\n";
+}
+catch (std::exception const& e)
+{
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+}
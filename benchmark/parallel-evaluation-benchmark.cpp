@@ -0,0 +1,98 @@
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdlib>        // for strtoul()
+#include <iomanip>        // for setw()
+#include <iostream>
+#include <algorithm>      // for max()
+#include <stdexcept>      // for runtime_error
+#include <unordered_map>
+
+#include "expression.h"
+#include "expression-evaluate.h"
+#include "thread-pool.h"
+
+#include "workloads.h"
+#include "benchmark-utility.h"
+
+
+// Measures how the parallel vectorized evaluator scales from 1 to N threads, compared to the sequential tiled
+// evaluator, for a memory-bound and a compute-bound expression.
+//
+// Usage:
+//   parallel-evaluation-benchmark [<rows> [<max threads> [<grain size>]]]
+//
+// The maximal number of threads defaults to the number of hardware threads.
+
+
+using namespace asc::cpp_practice_ws20::ex08;
+using benchmark::measureSeconds;
+
+
+void
+benchmarkScaling(std::string const& text, std::size_t numRows, std::size_t maxThreads, std::size_t grainSize)
+{
+    auto e = expr::Expression::parse(text);
+
+    // One column per workload variable; every column has a different set of values.
+    auto columns = std::vector<std::vector<double>>{ };
+    auto variableSubstitutions = std::unordered_map<std::string, expr::VariableSubstitution>{ };
+    for (auto const& name : benchmark::workloadVariables())
+    {
+        auto& column = columns.emplace_back(numRows);
+        for (std::size_t i = 0; i != numRows; ++i)
+        {
+            column[i] = 1.0 + 0.001 * double(i % 1000 + columns.size());
+        }
+        variableSubstitutions[name] = std::span<double const>(column);
+    }
+
+    // The sequential evaluation is the baseline; it also pays for first-touch page faults of the allocator.
+    auto expected = evaluate(e, variableSubstitutions);
+    double sequentialSeconds = measureSeconds([&] { expected = evaluate(e, variableSubstitutions); });
+
+    double n = double(numRows);
+    std::cout << (text.size() > 40 ? text.substr(0, 37) + "..." : text) << " (" << numRows << " rows, grain size "
+              << grainSize << ")\n"
+              << "  sequential:  " << std::setw(10) << sequentialSeconds / n * 1e9 << " ns/row\n";
+
+    double oneThreadSeconds = 0;
+    for (std::size_t numThreads = 1; numThreads <= maxThreads; ++numThreads)
+    {
+        auto pool = ThreadPool(numThreads);
+        auto result = evaluate(e, variableSubstitutions, pool, grainSize);
+        double seconds = measureSeconds([&] { result = evaluate(e, variableSubstitutions, pool, grainSize); });
+        if (result != expected)
+        {
+            throw std::runtime_error("parallel and sequential evaluation disagree for " + text);
+        }
+        if (numThreads == 1)
+        {
+            oneThreadSeconds = seconds;
+        }
+        double speedup = oneThreadSeconds / seconds;
+        std::cout << "  " << std::setw(3) << numThreads << " threads: " << std::setw(10) << seconds / n * 1e9
+                  << " ns/row (" << speedup << "x, efficiency " << speedup / double(numThreads) << ")\n";
+    }
+}
+
+int main(int argc, char* argv[])
+try
+{
+    std::size_t numRows = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000000;
+    std::size_t maxThreads = argc > 2 ? std::strtoul(argv[2], nullptr, 10)
+        : std::max(std::thread::hardware_concurrency(), 1u);
+    std::size_t grainSize = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : expr::defaultEvaluationGrainSize;
+
+    // Reads three columns per row and computes little, so memory bandwidth limits the scaling.
+    benchmarkScaling("a*x^2 + b*x + c", numRows, maxThreads, grainSize);
+    // Transcendental functions keep the cores busy.
+    benchmarkScaling("sin(x)*exp(-y/1000) + sqrt(z)*arctan(a/b)", numRows, maxThreads, grainSize);
+    benchmarkScaling(benchmark::randomPolynomial(10), numRows, maxThreads, grainSize);
+}
+catch (std::exception const& e)
+{
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+}
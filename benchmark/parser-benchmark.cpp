@@ -0,0 +1,156 @@
+#include <bit>            // for bit_cast<>()
+#include <random>
+#include <string>
+#include <vector>
+#include <cstdint>        // for uint64_t
+#include <cstdlib>        // for strtoul()
+#include <iostream>
+#include <optional>
+#include <stdexcept>      // for runtime_error
+
+#include "utility.h"      // for overload<>
+#include "expression.h"
+
+#include "workloads.h"
+#include "benchmark-utility.h"
+
+
+// Compares the throughput of the Spirit X3 and the Pratt parser backends, and checks that both produce identical
+// expressions, both for generated formulas and for random token soup which is mostly not well-formed.
+//
+// Usage:
+//   parser-benchmark [<number of terms> [<parse repetitions> [<number of random inputs>]]]
+
+
+using namespace asc::cpp_practice_ws20::ex08;
+using benchmark::measureSeconds;
+
+
+// Like `operator ==`, but compares real constants by bit pattern so that NaNs and signed zeros are told apart too.
+bool
+identical(expr::Expression const& lhs, expr::Expression const& rhs)
+{
+    if (lhs.value().index() != rhs.value().index())
+    {
+        return false;
+    }
+    return std::visit(
+        overload{
+            [&rhs](expr::RealConstant c)
+            {
+                return std::bit_cast<std::uint64_t>(c.value) == std::bit_cast<std::uint64_t>(std::get<expr::RealConstant>(rhs.value()).value);
+            },
+            [&rhs](expr::UnaryFunctionExpression const& unaryExpr)
+            {
+                auto const& other = std::get<expr::UnaryFunctionExpression>(rhs.value());
+                return unaryExpr.f.index() == other.f.index() && identical(unaryExpr.x, other.x);
+            },
+            [&rhs](expr::BinaryFunctionExpression const& binaryExpr)
+            {
+                auto const& other = std::get<expr::BinaryFunctionExpression>(rhs.value());
+                return binaryExpr.f.index() == other.f.index() && identical(binaryExpr.x, other.x) && identical(binaryExpr.y, other.y);
+            },
+            [&rhs]
+            <typename T>
+            (T const& c)
+            {
+                return c == std::get<T>(rhs.value());
+            }
+        },
+        lhs.value());
+}
+
+std::optional<expr::Expression>
+tryParse(std::string const& text, expr::ParserBackend backend)
+{
+    try
+    {
+        return expr::Expression::parse(text, backend);
+    }
+    catch (std::runtime_error const&)
+    {
+        return std::nullopt;
+    }
+}
+
+// Returns whether the text could be parsed.
+bool
+checkBackendsAgree(std::string const& text)
+{
+    auto spirit = tryParse(text, expr::ParserBackend::spirit);
+    auto pratt = tryParse(text, expr::ParserBackend::pratt);
+    if (spirit.has_value() != pratt.has_value() || (spirit && !identical(*spirit, *pratt)))
+    {
+        throw std::runtime_error("parser backends disagree on \"" + text + "\"");
+    }
+    return spirit.has_value();
+}
+
+// Concatenates random tokens, separators and near-misses of the grammar. They are all ASCII: on any other character the
+// X3 parser tries `x3::alpha`, which is only defined for ASCII and fails an assertion in debug builds.
+std::string
+randomTokenSoup(std::mt19937& rng)
+{
+    static auto const fragments = std::vector<std::string>{
+        "x", "y1", "a_b", "e", "pi", "pix", "ex", "exp", "sin", "log", "pow", "sqrt", "foo", "nan", "NaN(", "inf",
+        "Infinity", "i", "n", "0", "1", "23", "007", "2147483647", "2147483648", "1.5", ".5", "5.", "1e5", "2e", "1E-3",
+        "1e+", "+", "-", "*", "**", "/", "^", "(", ")", ",", " ", "\t", "_"
+    };
+    auto numFragments = std::uniform_int_distribution<std::size_t>(1, 12)(rng);
+    auto pickFragment = std::uniform_int_distribution<std::size_t>(0, fragments.size() - 1);
+    std::string result;
+    for (std::size_t i = 0; i != numFragments; ++i)
+    {
+        result += fragments[pickFragment(rng)];
+    }
+    return result;
+}
+
+void
+benchmarkBackends(std::string const& text, std::size_t numRepetitions)
+{
+    checkBackendsAgree(text);
+
+    auto measureThroughput = [&](expr::ParserBackend backend)
+    {
+        double seconds = measureSeconds([&]
+            {
+                for (std::size_t i = 0; i != numRepetitions; ++i)
+                {
+                    auto e = expr::Expression::parse(text, backend);
+                }
+            });
+        return double(text.size()) * double(numRepetitions) / seconds / 1e6;
+    };
+    double spiritThroughput = measureThroughput(expr::ParserBackend::spirit);
+    double prattThroughput = measureThroughput(expr::ParserBackend::pratt);
+
+    std::cout << (text.size() > 40 ? text.substr(0, 37) + "..." : text) << " (" << text.size() << " bytes)\n"
+              << "  spirit: " << spiritThroughput << " MB/s\n"
+              << "  pratt:  " << prattThroughput << " MB/s (" << prattThroughput / spiritThroughput << "x)\n";
+}
+
+int main(int argc, char* argv[])
+try
+{
+    std::size_t numTerms = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100;
+    std::size_t numRepetitions = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1000;
+    std::size_t numRandomInputs = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 100000;
+
+    auto rng = std::mt19937(42);
+    std::size_t numParsed = 0;
+    for (std::size_t i = 0; i != numRandomInputs; ++i)
+    {
+        numParsed += checkBackendsAgree(randomTokenSoup(rng));
+    }
+    std::cout << "Backends agree on " << numRandomInputs << " random inputs, " << numParsed << " of which parse\n";
+
+    benchmarkBackends(benchmark::randomPolynomial(numTerms), numRepetitions);
+    benchmarkBackends(benchmark::randomUnsimplifiedPolynomial(numTerms), numRepetitions);
+    benchmarkBackends(benchmark::randomRepetitiveFormula(numTerms, 8), numRepetitions);
+}
+catch (std::exception const& e)
+{
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+}
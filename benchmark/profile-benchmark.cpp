@@ -0,0 +1,301 @@
+#include <bit>            // for bit_cast<>()
+#include <span>
+#include <string>
+#include <vector>
+#include <cstdint>        // for uint64_t
+#include <cstdlib>        // for strtoul()
+#include <fstream>
+#include <utility>        // for move()
+#include <iostream>
+#include <algorithm>      // for equal(), min()
+#include <stdexcept>      // for runtime_error
+#include <unordered_map>
+
+#include "utility.h"      // for overload<>
+#include "expression.h"
+#include "expression-evaluate.h"
+#include "expression-profile.h"
+
+#include "workloads.h"
+#include "benchmark-utility.h"
+
+
+// Profiles the scalar and the vectorized evaluation of generated expressions node by node, prints the expressions with
+// their hot subexpressions marked, and reports the overhead of profiling. Checks that the profiled evaluations agree
+// with `evaluate()` bit for bit, that the times of the nodes add up, and that `x^2.5` is the hottest operator of the
+// hand-written expression.
+//
+// Usage:
+//   profile-benchmark [<depth> [<prefix of folded stack files>]]
+//
+// With a prefix, writes the profiles of the generated expression to "<prefix>.scalar.folded" and
+// "<prefix>.vectorized.folded", which "flamegraph.pl" renders.
+
+
+using namespace asc::cpp_practice_ws20::ex08;
+using benchmark::measureSeconds;
+
+
+bool
+isSameValue(double x, double y)
+{
+    return std::bit_cast<std::uint64_t>(x) == std::bit_cast<std::uint64_t>(y);
+}
+
+// Calls `f(node)` for every node of an expression.
+template <typename F>
+void
+forEachNode(expr::Expression const& node, F&& f)
+{
+    f(node);
+    std::visit(
+        overload{
+            [&](expr::UnaryFunctionExpression const& unaryExpr) { forEachNode(unaryExpr.x, f); },
+            [&](expr::BinaryFunctionExpression const& binaryExpr)
+            {
+                forEachNode(binaryExpr.x, f);
+                forEachNode(binaryExpr.y, f);
+            },
+            [](auto const&) { }
+        },
+        node.value());
+}
+
+// Checks that the times of the nodes are consistent: the root was evaluated as often as the profile should record, and
+// the self times of all nodes add up to its total time. Checks that the profile neither includes the overhead of
+// profiling nor loses time: the time per evaluation is within 25% of that of the unprofiled evaluation.
+void
+checkProfile(expr::Expression const& e, expr::EvaluationProfile const& profile, std::uint64_t numCalls,
+    double plainSecondsPerCall, std::string const& text)
+{
+    auto root = profile.find(e);
+    if (root.calls != numCalls || root.totalNanoseconds != profile.totalNanoseconds())
+    {
+        throw std::runtime_error("the profile does not record every evaluation of " + text);
+    }
+    std::uint64_t selfNanoseconds = 0;
+    forEachNode(e, [&](expr::Expression const& node) { selfNanoseconds += profile.find(node).selfNanoseconds; });
+    if (selfNanoseconds != profile.totalNanoseconds() || selfNanoseconds != profile.selfNanoseconds())
+    {
+        throw std::runtime_error("the self times of the nodes do not add up to the total time for " + text);
+    }
+
+    double ratio = double(selfNanoseconds) * 1e-9 / double(numCalls) / plainSecondsPerCall;
+    std::cout << "  profiled time / unprofiled time: " << ratio << "\n";
+    if (ratio < 0.75 || ratio > 1.25)
+    {
+        throw std::runtime_error("the profiled time per evaluation is far from the unprofiled time for " + text);
+    }
+}
+
+// Checks that the function or operator node with the largest self time is `expected`, e.g. "x^2.5".
+void
+checkHottestOperator(expr::Expression const& e, expr::EvaluationProfile const& profile, std::string const& expected)
+{
+    expr::Expression const* hottest = nullptr;
+    std::uint64_t hottestNanoseconds = 0;
+    forEachNode(e, [&](expr::Expression const& node)
+        {
+            bool isOperator = std::holds_alternative<expr::UnaryFunctionExpression>(node.value())
+                || std::holds_alternative<expr::BinaryFunctionExpression>(node.value());
+            auto selfNanoseconds = profile.find(node).selfNanoseconds;
+            if (isOperator && (hottest == nullptr || selfNanoseconds > hottestNanoseconds))
+            {
+                hottest = &node;
+                hottestNanoseconds = selfNanoseconds;
+            }
+        });
+    auto hottestText = to_string(*hottest);
+    if (hottestText != expected)
+    {
+        throw std::runtime_error("the hottest operator is " + hottestText + " rather than " + expected);
+    }
+}
+
+void
+writeFoldedStacks(std::string const& path, expr::Expression const& e, expr::EvaluationProfile const& profile)
+{
+    auto file = std::ofstream(path);
+    expr::writeFoldedStacks(file, e, profile);
+    if (!file.flush())
+    {
+        throw std::runtime_error("cannot write " + path);
+    }
+    std::cout << "  folded stacks written to " << path << "\n";
+}
+
+// The number of rounds of evaluations measured. The fastest round counts, since it is the one least disturbed by
+// interrupts and other processes, whose time the profile would add to whichever node was being evaluated.
+constexpr int numRounds = 20;
+
+struct Rounds
+{
+    // The least time of the unprofiled rounds.
+    double plainSeconds = 0;
+
+    // The profile of the profiled round with the least total time, and the time the round took.
+    expr::EvaluationProfile profile;
+    double profiledSeconds = 0;
+};
+
+// Calls `evaluatePlainRound()` and `evaluateProfiledRound(profile)` with an empty profile alternately, `numRounds` times
+// each, so that a change in the load of the machine affects both alike, and returns the fastest rounds.
+template <typename F, typename G>
+Rounds
+fastestRounds(F&& evaluatePlainRound, G&& evaluateProfiledRound)
+{
+    auto fastest = Rounds{ };
+    for (int round = 0; round != numRounds; ++round)
+    {
+        double plainSeconds = measureSeconds(evaluatePlainRound);
+        auto profile = expr::EvaluationProfile{ };
+        double profiledSeconds = measureSeconds([&] { evaluateProfiledRound(profile); });
+        if (round == 0 || plainSeconds < fastest.plainSeconds)
+        {
+            fastest.plainSeconds = plainSeconds;
+        }
+        if (round == 0 || profile.totalNanoseconds() < fastest.profile.totalNanoseconds())
+        {
+            fastest.profile = std::move(profile);
+            fastest.profiledSeconds = profiledSeconds;
+        }
+    }
+    return fastest;
+}
+
+// `hottestOperator` is the expected hottest operator node, or empty.
+void
+profileScalar(std::string const& text, std::string const& hottestOperator, std::string const& foldedPrefix)
+{
+    auto e = expr::Expression::parse(text);
+    auto variableSubstitutions = std::unordered_map<std::string, double>{ };
+    for (auto const& name : benchmark::workloadVariables())
+    {
+        variableSubstitutions[name] = 1.25;
+    }
+
+    constexpr std::size_t numEvaluations = 2000;     // per round
+    // Every profiled evaluation evaluates every subexpression `repetitions` times again.
+    constexpr std::size_t numProfiledEvaluations = 20;     // per round
+    constexpr std::size_t repetitions = 64;
+    double value = evaluate(e, variableSubstitutions);
+    bool agree = true;
+    auto [plainSeconds, profile, profiledSeconds] = fastestRounds(
+        [&]
+        {
+            for (std::size_t i = 0; i != numEvaluations; ++i)
+            {
+                value = evaluate(e, variableSubstitutions);
+            }
+        },
+        [&](expr::EvaluationProfile& roundProfile)
+        {
+            for (std::size_t i = 0; i != numProfiledEvaluations; ++i)
+            {
+                agree &= isSameValue(evaluate(e, variableSubstitutions, roundProfile, repetitions), value);
+            }
+        });
+    if (!agree)
+    {
+        throw std::runtime_error("profiled and plain scalar evaluate() disagree for " + text);
+    }
+    double plainSecondsPerCall = plainSeconds / double(numEvaluations);
+    std::cout << "scalar evaluate() (" << profile.size() << " nodes): " << plainSecondsPerCall * 1e9 << " ns/call, "
+              << profiledSeconds / double(numProfiledEvaluations) * 1e6 << " us/call profiled\n";
+    checkProfile(e, profile, numProfiledEvaluations * repetitions, plainSecondsPerCall, text);
+    std::cout << "  ";
+    printProfile(std::cout, e, profile);
+    std::cout << "\n";
+    if (!hottestOperator.empty())
+    {
+        checkHottestOperator(e, profile, hottestOperator);
+    }
+    if (!foldedPrefix.empty())
+    {
+        writeFoldedStacks(foldedPrefix + ".scalar.folded", e, profile);
+    }
+}
+
+void
+profileVectorized(std::string const& text, std::string const& hottestOperator, std::string const& foldedPrefix)
+{
+    auto e = expr::Expression::parse(text);
+    constexpr std::size_t numElements = 4096;
+    auto columns = std::vector<std::vector<double>>{ };
+    auto variableSubstitutions = std::unordered_map<std::string, expr::VariableSubstitution>{ };
+    for (auto const& name : benchmark::workloadVariables())
+    {
+        auto& column = columns.emplace_back(numElements);
+        for (std::size_t i = 0; i != numElements; ++i)
+        {
+            column[i] = 0.5 + 0.001 * double(i);
+        }
+        variableSubstitutions[name] = std::span<double const>(column);
+    }
+
+    constexpr std::size_t numEvaluations = 20;       // per round
+    auto mode = expr::VectorizedEvaluation::wholeArrays;
+    auto result = evaluate(e, variableSubstitutions, mode);
+    auto const values = std::get<std::vector<double>>(result);
+    bool agree = true;
+    auto [plainSeconds, profile, profiledSeconds] = fastestRounds(
+        [&]
+        {
+            for (std::size_t i = 0; i != numEvaluations; ++i)
+            {
+                result = evaluate(e, variableSubstitutions, mode);
+            }
+        },
+        [&](expr::EvaluationProfile& roundProfile)
+        {
+            for (std::size_t i = 0; i != numEvaluations; ++i)
+            {
+                auto profiled = evaluate(e, variableSubstitutions, roundProfile);
+                auto const& profiledValues = std::get<std::vector<double>>(profiled);
+                agree &= std::equal(values.begin(), values.end(), profiledValues.begin(), profiledValues.end(),
+                    isSameValue);
+            }
+        });
+    if (!agree)
+    {
+        throw std::runtime_error("profiled and plain vectorized evaluate() disagree for " + text);
+    }
+    double n = double(numEvaluations);
+    std::cout << "vectorized evaluate() (" << profile.size() << " nodes, " << numElements << " elements): "
+              << plainSeconds / n * 1e6 << " us/call, " << profiledSeconds / n * 1e6 << " us/call profiled\n";
+    checkProfile(e, profile, numEvaluations, plainSeconds / n, text);
+    std::cout << "  ";
+    printProfile(std::cout, e, profile);
+    std::cout << "\n";
+    if (!hottestOperator.empty())
+    {
+        checkHottestOperator(e, profile, hottestOperator);
+    }
+    if (!foldedPrefix.empty())
+    {
+        writeFoldedStacks(foldedPrefix + ".vectorized.folded", e, profile);
+    }
+}
+
+int main(int argc, char* argv[])
+try
+{
+    std::size_t depth = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 5;
+    std::string foldedPrefix = argc > 2 ? argv[2] : "";
+
+    // A real exponent and a logarithm to another base are the expensive operations here.
+    auto handWritten = std::string("x^2.5*log(y, 3) + 3*x*y - a/b");
+    std::cout << handWritten << "\n";
+    profileScalar(handWritten, "x^2.5", "");
+    profileVectorized(handWritten, "x^2.5", "");
+
+    auto generated = benchmark::randomTranscendentalFormula(depth);
+    std::cout << "\n" << generated << "\n";
+    profileScalar(generated, "", foldedPrefix);
+    profileVectorized(generated, "", foldedPrefix);
+}
+catch (std::exception const& e)
+{
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+}
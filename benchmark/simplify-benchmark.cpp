@@ -0,0 +1,149 @@
+#include <bit>            // for bit_cast<>()
+#include <cmath>          // for abs()
+#include <string>
+#include <cstdint>        // for uint64_t
+#include <variant>
+#include <utility>        // for pair<>
+#include <cstdlib>        // for strtoul()
+#include <iostream>
+#include <stdexcept>      // for runtime_error
+#include <unordered_map>
+
+#include "utility.h"      // for overload<>
+#include "expression.h"
+#include "expression-compile.h"
+#include "expression-evaluate.h"
+#include "expression-simplify.h"
+
+#include "workloads.h"
+#include "benchmark-utility.h"
+
+
+// Measures how much `simplify()` shrinks an expression and how much faster the simplified expression evaluates. Checks
+// first that the identities do not change values or errors.
+//
+// Usage:
+//   simplify-benchmark [<number of terms> [<evaluation repetitions>]]
+
+
+using namespace asc::cpp_practice_ws20::ex08;
+using benchmark::measureSeconds;
+
+
+std::size_t
+countNodes(expr::Expression const& e)
+{
+    return std::visit(
+        overload{
+            [](expr::UnaryFunctionExpression const& unaryExpr) { return 1 + countNodes(unaryExpr.x); },
+            [](expr::BinaryFunctionExpression const& binaryExpr) { return 1 + countNodes(binaryExpr.x) + countNodes(binaryExpr.y); },
+            [](auto const&) { return std::size_t(1); }
+        },
+        e.value());
+}
+
+void
+benchmarkExpression(std::string const& text, std::size_t numRepetitions)
+{
+    auto e = expr::Expression::parse(text);
+    auto simplified = expr::Expression{ expr::RationalConstant{ 0 } };
+    double simplifySeconds = measureSeconds([&] { simplified = expr::simplify(e); });
+
+    auto variableSubstitutions = std::unordered_map<std::string, double>{ };
+    for (auto const& name : benchmark::workloadVariables())
+    {
+        variableSubstitutions[name] = 1.25;
+    }
+
+    auto measureEvaluation = [&](expr::Expression const& expression)
+    {
+        double sum = 0;
+        double seconds = measureSeconds([&]
+            {
+                for (std::size_t i = 0; i != numRepetitions; ++i)
+                {
+                    sum += evaluate(expression, variableSubstitutions);
+                }
+            });
+        return std::pair{ sum, seconds };
+    };
+    auto [originalSum, originalSeconds] = measureEvaluation(e);
+    auto [simplifiedSum, simplifiedSeconds] = measureEvaluation(simplified);
+
+    // Exact folding may round differently than evaluating the original constants one operation at a time.
+    if (std::abs(originalSum - simplifiedSum) > 1e-9 * std::abs(originalSum))
+    {
+        throw std::runtime_error("simplified expression evaluates differently for " + text);
+    }
+
+    auto originalCode = expr::compile(e).code().size();
+    auto simplifiedCode = expr::compile(simplified).code().size();
+
+    double n = double(numRepetitions);
+    std::cout << (text.size() > 40 ? text.substr(0, 37) + "..." : text) << '\n'
+              << "  simplify: " << simplifySeconds * 1000 << " ms\n"
+              << "  nodes: " << countNodes(e) << " -> " << countNodes(simplified)
+              << ", instructions: " << originalCode << " -> " << simplifiedCode << '\n'
+              << "  evaluate: " << originalSeconds / n * 1e9 << " -> " << simplifiedSeconds / n * 1e9 << " ns/call ("
+              << originalSeconds / simplifiedSeconds << "x)\n";
+}
+
+// Evaluates an expression to its value, or to the message of the error evaluating it.
+std::variant<double, std::string>
+evaluateOrError(expr::Expression const& e, std::unordered_map<std::string, double> const& variableSubstitutions)
+{
+    try
+    {
+        return evaluate(e, variableSubstitutions);
+    }
+    catch (expr::UnknownVariableValue const& error)
+    {
+        return std::string(error.what()) + " (" + std::string(error.variable()) + ")";
+    }
+}
+
+// Checks that the identities keep the sign of zero results and the errors for variables without a value, for `x` of
+// either sign of zero and without a value.
+void
+checkIdentities()
+{
+    for (auto text : { "sin(x) + 0", "0 + x", "x + (-0.0)", "(-0.0) + x", "x - 0", "x - (-0.0)", "x - 0.0", "x*1", "1*x",
+             "x/1", "x^1", "x^0", "x^(1 - 1)", "2^0", "+x", "-(-x)" })
+    {
+        auto e = expr::Expression::parse(text);
+        auto simplified = expr::simplify(e);
+        for (auto const& variableSubstitutions : { std::unordered_map<std::string, double>{ { "x", 0.0 } },
+                 std::unordered_map<std::string, double>{ { "x", -0.0 } },
+                 std::unordered_map<std::string, double>{ } })
+        {
+            auto original = evaluateOrError(e, variableSubstitutions);
+            auto result = evaluateOrError(simplified, variableSubstitutions);
+            bool agree = original.index() == result.index()
+                && (std::holds_alternative<std::string>(original)
+                    ? original == result
+                    : std::bit_cast<std::uint64_t>(std::get<double>(original))
+                        == std::bit_cast<std::uint64_t>(std::get<double>(result)));
+            if (!agree)
+            {
+                throw std::runtime_error("simplified expression " + to_string(simplified) + " evaluates differently for "
+                    + text);
+            }
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+try
+{
+    std::size_t numTerms = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100;
+    std::size_t numRepetitions = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 10000;
+
+    checkIdentities();
+    benchmarkExpression(benchmark::randomPolynomial(numTerms), numRepetitions);
+    benchmarkExpression(benchmark::randomUnsimplifiedPolynomial(numTerms), numRepetitions);
+}
+catch (std::exception const& e)
+{
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+}
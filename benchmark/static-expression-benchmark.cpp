@@ -0,0 +1,134 @@
+#include <span>
+#include <array>
+#include <string>
+#include <vector>
+#include <cstdlib>        // for strtoul()
+#include <iostream>
+#include <stdexcept>      // for runtime_error
+#include <unordered_map>
+
+#include "expression.h"
+#include "expression-compile.h"
+#include "expression-evaluate.h"
+#include "static-expression.h"
+
+#include "allocation-counter.h"
+#include "benchmark-utility.h"
+
+
+// Compares the per-call cost of the recursive tree evaluator and the compiled stack machine with an expression parsed
+// at compile time by the `_cexpr` literal. Checks that the compile-time parser builds the same expression as the
+// runtime parser, that all evaluators agree, and that evaluating the static expression does not allocate.
+//
+// Usage:
+//   static-expression-benchmark [<evaluation repetitions>]
+
+
+using namespace asc::cpp_practice_ws20::ex08;
+using namespace asc::cpp_practice_ws20::ex08::expr::literals;
+using benchmark::measureSeconds;
+
+
+// The parse happens in the compiler: a malformed formula or an unknown variable name does not compile.
+static_assert(decltype("a*x^2 + b*x + c"_cexpr)::numVariables == 4);
+static_assert("a*x^2 + b*x + c"_cexpr.slot("c") == 3);
+static_assert(decltype("2^x^y - x"_cexpr)::variables[1] == "y");
+
+
+template <typename StaticExpressionT>
+void
+benchmarkStaticExpression(StaticExpressionT f, std::size_t numRepetitions)
+{
+    auto text = std::string(f.text);
+    auto e = expr::Expression::parse(text);
+    auto compiled = expr::compile(e);
+    if (f.toExpression() != e)
+    {
+        throw std::runtime_error("compile-time and runtime parser disagree for " + text);
+    }
+
+    // Both the compiled and the static expression assign slots in order of first occurrence.
+    auto variableSubstitutions = std::unordered_map<std::string, double>{ };
+    auto variableValues = std::vector<double>(compiled.variables().size());
+    auto staticValues = std::array<double, f.numVariables>{ };
+    auto mapValues = std::vector<double*>{ };
+    for (auto const& name : compiled.variables())
+    {
+        mapValues.push_back(&variableSubstitutions[name]);
+    }
+    auto setInputs = [&](std::size_t i)
+    {
+        for (std::size_t j = 0; j != variableValues.size(); ++j)
+        {
+            double value = 1.0 + 0.001 * double(i + j);
+            variableValues[j] = value;
+            staticValues[j] = value;
+            *mapValues[j] = value;
+        }
+    };
+
+    double treeSum = 0;
+    double treeSeconds = measureSeconds([&]
+        {
+            for (std::size_t i = 0; i != numRepetitions; ++i)
+            {
+                setInputs(i);
+                treeSum += evaluate(e, variableSubstitutions);
+            }
+        });
+    double compiledSum = 0;
+    double compiledSeconds = measureSeconds([&]
+        {
+            for (std::size_t i = 0; i != numRepetitions; ++i)
+            {
+                setInputs(i);
+                compiledSum += evaluate(compiled, std::span<double const>(variableValues));
+            }
+        });
+    double staticSum = 0;
+    auto allocationsBefore = benchmark::allocationCount();
+    double staticSeconds = measureSeconds([&]
+        {
+            for (std::size_t i = 0; i != numRepetitions; ++i)
+            {
+                setInputs(i);
+                staticSum += f.evaluate(staticValues);
+            }
+        });
+    auto numAllocations = benchmark::allocationCount() - allocationsBefore;
+    if (treeSum != compiledSum || treeSum != staticSum)
+    {
+        throw std::runtime_error("static and tree evaluation disagree for " + text);
+    }
+    if (numAllocations != 0)
+    {
+        throw std::runtime_error("static evaluation allocated memory for " + text);
+    }
+
+    // The time for setting up the inputs is included in all measurements.
+    double n = double(numRepetitions);
+    std::cout << (text.size() > 40 ? text.substr(0, 37) + "..." : text) << '\n'
+              << "  tree + map:      " << treeSeconds / n * 1e9 << " ns/call\n"
+              << "  compiled + span: " << compiledSeconds / n * 1e9 << " ns/call ("
+              << treeSeconds / compiledSeconds << "x)\n"
+              << "  _cexpr:          " << staticSeconds / n * 1e9 << " ns/call ("
+              << treeSeconds / staticSeconds << "x)\n";
+}
+
+int main(int argc, char* argv[])
+try
+{
+    std::size_t numRepetitions = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+    benchmarkStaticExpression("a*x^2"_cexpr, numRepetitions);
+    benchmarkStaticExpression("a*x^2 + b*x + c"_cexpr, numRepetitions);
+    benchmarkStaticExpression("sin(x)*exp(-y/1000) + sqrt(z)*arctan(a/b)"_cexpr, numRepetitions);
+    benchmarkStaticExpression(
+        "4*z + 8*x + 2/a*z^2 + 2*x - 9*y*b^1 - 9/x*x^3 - 4/c*x^2 - 1*z*b^2 - 8*b*d^4 + 5/z*x^1"_cexpr,
+        numRepetitions);
+}
+catch (std::exception const& e)
+{
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+}
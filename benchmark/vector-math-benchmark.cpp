@@ -0,0 +1,261 @@
+#include <bit>            // for bit_cast<>()
+#include <cmath>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstdint>        // for int64_t
+#include <cstdlib>        // for strtoul()
+#include <iomanip>        // for setw()
+#include <iostream>
+#include <algorithm>      // for min(), max()
+#include <stdexcept>      // for runtime_error
+#include <functional>
+
+#include "expression.h"
+#include "expression-functions.h"
+#include "vector-math.h"
+
+#include "benchmark-utility.h"
+
+
+// Measures the array functions of "vector-math.h" with every instruction set the CPU supports: the time per element
+// compared to a loop over the scalar function, which is how the vectorized evaluators computed them before, and the
+// largest difference to the scalar function in units in the last place (ulp). Also checks that special arguments give
+// the same results as the scalar functions.
+//
+// Usage:
+//   vector-math-benchmark [<elements> [<repetitions>]]
+
+
+using namespace asc::cpp_practice_ws20::ex08;
+using benchmark::measureSeconds;
+using expr::detail::VectorMathKernels;
+
+
+// The number of representable doubles between `a` and `b`. NaNs are equal to each other, and zeros of different signs
+// and infinities are infinitely far apart from everything else.
+double
+ulpDistance(double a, double b)
+{
+    if (std::isnan(a) || std::isnan(b))
+    {
+        return std::isnan(a) && std::isnan(b) ? 0 : HUGE_VAL;
+    }
+    if (a == b)
+    {
+        return std::signbit(a) == std::signbit(b) ? 0 : HUGE_VAL;
+    }
+    if (std::isinf(a) || std::isinf(b))
+    {
+        return HUGE_VAL;
+    }
+    // Maps the doubles in order to the integers, so that neighbouring doubles differ by 1.
+    auto ordered = [](double x)
+    {
+        auto bits = std::bit_cast<std::int64_t>(x);
+        return std::uint64_t(bits < 0 ? std::numeric_limits<std::int64_t>::min() - bits : bits);
+    };
+    auto difference = ordered(a) - ordered(b);
+    return double(std::min(difference, -difference));
+}
+
+struct Function
+{
+    char const* name;
+    char const* domain;
+    bool isBinary;
+    std::function<double(std::mt19937_64&)> randomX;
+    std::function<double(std::mt19937_64&)> randomY;
+    std::function<double(double, double)> scalar;
+    void (*run)(VectorMathKernels const& kernels, double const* x, double const* y, double* result, std::size_t n);
+};
+
+template <expr::detail::UnaryKernel VectorMathKernels::* kernel>
+void
+runUnary(VectorMathKernels const& kernels, double const* x, double const*, double* result, std::size_t n)
+{
+    (kernels.*kernel)(x, result, n);
+}
+
+template <expr::detail::BinaryKernel VectorMathKernels::* kernel>
+void
+runBinary(VectorMathKernels const& kernels, double const* x, double const* y, double* result, std::size_t n)
+{
+    (kernels.*kernel)(x, false, y, false, result, n);
+}
+
+double
+uniform(std::mt19937_64& rng, double min, double max)
+{
+    return std::uniform_real_distribution<double>(min, max)(rng);
+}
+
+// A positive number with uniformly distributed exponent, including subnormal numbers if `minExponent` < -1022.
+double
+logUniform(std::mt19937_64& rng, int minExponent, int maxExponent)
+{
+    return std::ldexp(uniform(rng, 1, 2), std::uniform_int_distribution<int>(minExponent, maxExponent)(rng));
+}
+
+std::vector<Function>
+functions()
+{
+    auto functions = std::vector<Function>{ };
+    auto unary = [&](char const* name, char const* domain, auto f, auto randomX, auto run)
+    {
+        functions.push_back({ name, domain, false, randomX, nullptr,
+            [f](double x, double) { return expr::evaluate(f, x); }, run });
+    };
+    auto binary = [&](char const* name, char const* domain, auto f, auto randomX, auto randomY, auto run)
+    {
+        functions.push_back({ name, domain, true, randomX, randomY,
+            [f](double x, double y) { return expr::evaluate(f, x, y); }, run });
+    };
+
+    unary("sqrt", "[0, 1e6]", expr::Sqrt{ }, [](auto& rng) { return uniform(rng, 0, 1e6); },
+        runUnary<&VectorMathKernels::sqrt>);
+    unary("exp", "[-745, 710]", expr::Exp{ }, [](auto& rng) { return uniform(rng, -745, 710); },
+        runUnary<&VectorMathKernels::exp>);
+    unary("log", "(0, 2^1024)", expr::Log{ }, [](auto& rng) { return logUniform(rng, -1074, 1023); },
+        runUnary<&VectorMathKernels::log>);
+    unary("sin", "[-1e5, 1e5]", expr::Sin{ }, [](auto& rng) { return uniform(rng, -1e5, 1e5); },
+        runUnary<&VectorMathKernels::sin>);
+    unary("cos", "[-1e5, 1e5]", expr::Cos{ }, [](auto& rng) { return uniform(rng, -1e5, 1e5); },
+        runUnary<&VectorMathKernels::cos>);
+    unary("tan", "[-1e5, 1e5]", expr::Tan{ }, [](auto& rng) { return uniform(rng, -1e5, 1e5); },
+        runUnary<&VectorMathKernels::tan>);
+    unary("asin", "[-1, 1]", expr::ArcSin{ }, [](auto& rng) { return uniform(rng, -1, 1); },
+        runUnary<&VectorMathKernels::arcSin>);
+    unary("acos", "[-1, 1]", expr::ArcCos{ }, [](auto& rng) { return uniform(rng, -1, 1); },
+        runUnary<&VectorMathKernels::arcCos>);
+    unary("atan", "tan([-pi/2, pi/2])", expr::ArcTan{ }, [](auto& rng) { return std::tan(uniform(rng, -1.5708, 1.5708)); },
+        runUnary<&VectorMathKernels::arcTan>);
+    binary("pow", "+-[1e-3, 1e3]^[-60, 60]", expr::Pow{ },
+        [](auto& rng) { return (rng() & 1 ? -1 : 1) * logUniform(rng, -10, 10); },
+        [](auto& rng) { return rng() & 1 ? std::round(uniform(rng, -60, 60)) : uniform(rng, -60, 60); },
+        runBinary<&VectorMathKernels::pow>);
+    binary("logBase", "(0, 2^1024)^2", expr::LogBase{ },
+        [](auto& rng) { return logUniform(rng, -1074, 1023); },
+        [](auto& rng) { return logUniform(rng, -1074, 1023); },
+        runBinary<&VectorMathKernels::logBase>);
+    return functions;
+}
+
+// Arguments with special results, and arguments next to the boundaries of the algorithms.
+std::vector<double>
+specialArguments()
+{
+    double const inf = HUGE_VAL;
+    double const nan = std::numeric_limits<double>::quiet_NaN();
+    auto result = std::vector<double>{ 0.0, -0.0, inf, -inf, nan, 1, -1, 2, -2, 0.5, -0.5, 3, -3, 1e-310, -1e-310,
+        std::numeric_limits<double>::min(), std::numeric_limits<double>::max(), -std::numeric_limits<double>::max(),
+        std::numeric_limits<double>::denorm_min(), 709.78, 709.79, -745.13, -745.14, 1.6e6, -1.6e6, 1e300, 1e-300,
+        std::nextafter(1.0, 2.0), std::nextafter(1.0, 0.0), 0.4375, 0.6875, 1.1875, 2.4375, 1.5707963267948966,
+        3.141592653589793, 1e22 };
+    return result;
+}
+
+int main(int argc, char* argv[])
+try
+{
+    std::size_t numElements = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1 << 20;
+    std::size_t numRepetitions = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 10;
+
+    auto kernels = expr::detail::supportedVectorMathKernels();
+    if (kernels.empty())
+    {
+        std::cout << "No vectorized kernels for this CPU\n";
+        return 0;
+    }
+
+    std::cout << numElements << " elements, ns per element (speedup over the scalar loop) and maximal error in ulp\n"
+              << std::left << std::setw(9) << "function" << std::setw(26) << "arguments" << std::setw(10) << "scalar";
+    for (auto const& k : kernels)
+    {
+        std::cout << std::setw(24) << k.name;
+    }
+    std::cout << "\n";
+
+    auto specials = specialArguments();
+    for (auto const& function : functions())
+    {
+        auto rng = std::mt19937_64(42);
+        auto x = std::vector<double>(numElements);
+        auto y = std::vector<double>(numElements);
+        for (std::size_t i = 0; i != numElements; ++i)
+        {
+            x[i] = function.randomX(rng);
+            y[i] = function.isBinary ? function.randomY(rng) : 0;
+        }
+
+        // The loop the vectorized evaluators used to run.
+        auto expected = std::vector<double>(numElements);
+        double scalarSeconds = measureSeconds([&]
+            {
+                for (std::size_t r = 0; r != numRepetitions; ++r)
+                {
+                    for (std::size_t i = 0; i != numElements; ++i)
+                    {
+                        expected[i] = function.scalar(x[i], y[i]);
+                    }
+                }
+            });
+        double const perElement = 1e9 / double(numElements * numRepetitions);
+        std::cout << std::setw(9) << function.name << std::setw(26) << function.domain << std::setw(10)
+                  << std::setprecision(3) << scalarSeconds * perElement;
+
+        // Special arguments are combined with each other for binary functions.
+        auto specialX = std::vector<double>{ };
+        auto specialY = std::vector<double>{ };
+        for (double a : specials)
+        {
+            for (double b : function.isBinary ? specials : std::vector<double>{ 0 })
+            {
+                specialX.push_back(a);
+                specialY.push_back(b);
+            }
+        }
+
+        for (auto const& k : kernels)
+        {
+            auto result = std::vector<double>(numElements);
+            double seconds = measureSeconds([&]
+                {
+                    for (std::size_t r = 0; r != numRepetitions; ++r)
+                    {
+                        function.run(k, x.data(), y.data(), result.data(), numElements);
+                    }
+                });
+            double maxUlp = 0;
+            for (std::size_t i = 0; i != numElements; ++i)
+            {
+                maxUlp = std::max(maxUlp, ulpDistance(result[i], expected[i]));
+            }
+
+            auto specialResult = std::vector<double>(specialX.size());
+            function.run(k, specialX.data(), specialY.data(), specialResult.data(), specialX.size());
+            for (std::size_t i = 0; i != specialX.size(); ++i)
+            {
+                double scalarResult = function.scalar(specialX[i], specialY[i]);
+                if (ulpDistance(specialResult[i], scalarResult) > 2)
+                {
+                    throw std::runtime_error(std::string(k.name) + " " + function.name + " differs for special arguments "
+                        + std::to_string(specialX[i]) + ", " + std::to_string(specialY[i]) + ": "
+                        + std::to_string(specialResult[i]) + " instead of " + std::to_string(scalarResult));
+                }
+            }
+
+            auto cell = std::to_string(seconds * perElement).substr(0, 5) + " ("
+                + std::to_string(scalarSeconds / seconds).substr(0, 4) + "x) "
+                + (maxUlp == HUGE_VAL ? std::string("inf") : std::to_string(int(maxUlp)));
+            std::cout << std::setw(24) << cell;
+        }
+        std::cout << std::endl;
+    }
+}
+catch (std::exception const& e)
+{
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+}
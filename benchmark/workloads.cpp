@@ -0,0 +1,218 @@
+#include <random>
+#include <iterator>   // for size()
+
+#include "workloads.h"
+
+
+namespace asc::cpp_practice_ws20::ex08::benchmark {
+
+
+    std::vector<std::string> const& workloadVariables()
+    {
+        static auto const variables = std::vector<std::string>{ "a", "b", "c", "d", "x", "y", "z" };
+        return variables;
+    }
+
+    std::string randomPolynomial(std::size_t numTerms, unsigned seed)
+    {
+        auto const& variables = workloadVariables();
+        auto rng = std::mt19937(seed);
+        auto coefficient = std::uniform_int_distribution<int>(1, 9);
+        auto variable = std::uniform_int_distribution<std::size_t>(0, variables.size() - 1);
+        auto exponent = std::uniform_int_distribution<int>(1, 4);
+        auto choice = std::uniform_int_distribution<int>(0, 3);
+
+        std::string result;
+        for (std::size_t i = 0; i != numTerms; ++i)
+        {
+            if (i != 0)
+            {
+                result += choice(rng) == 0 ? " - " : " + ";
+            }
+            result += std::to_string(coefficient(rng));
+            result += choice(rng) == 0 ? '/' : '*';
+            result += variables[variable(rng)];
+            if (choice(rng) != 0)
+            {
+                result += '*';
+                result += variables[variable(rng)];
+                result += '^';
+                result += std::to_string(exponent(rng));
+            }
+        }
+        return result;
+    }
+
+    std::string randomUnsimplifiedPolynomial(std::size_t numTerms, unsigned seed)
+    {
+        auto const& variables = workloadVariables();
+        auto rng = std::mt19937(seed);
+        auto coefficient = std::uniform_int_distribution<int>(1, 9);
+        auto variable = std::uniform_int_distribution<std::size_t>(0, variables.size() - 1);
+        auto exponent = std::uniform_int_distribution<int>(0, 3);
+        auto choice = std::uniform_int_distribution<int>(0, 3);
+
+        std::string result;
+        for (std::size_t i = 0; i != numTerms; ++i)
+        {
+            if (i != 0)
+            {
+                result += choice(rng) == 0 ? " - " : " + ";
+            }
+            result += '(';
+            result += std::to_string(coefficient(rng));
+            result += '*';
+            result += std::to_string(coefficient(rng));
+            result += '/';
+            result += std::to_string(coefficient(rng));
+            result += ")*";
+            result += variables[variable(rng)];
+            result += "^(";
+            result += std::to_string(exponent(rng));
+            result += " + 1)";
+            if (choice(rng) == 0)
+            {
+                result += "*1 + 0";
+            }
+        }
+        return result;
+    }
+
+    std::string randomRepetitiveFormula(std::size_t numTerms, std::size_t numDistinct, unsigned seed)
+    {
+        static char const* const functions[] = { "sin", "cos", "exp", "sqrt" };
+
+        auto const& variables = workloadVariables();
+        auto rng = std::mt19937(seed);
+        auto coefficient = std::uniform_int_distribution<int>(1, 9);
+        auto variable = std::uniform_int_distribution<std::size_t>(0, variables.size() - 1);
+        auto function = std::uniform_int_distribution<std::size_t>(0, std::size(functions) - 1);
+
+        auto pool = std::vector<std::string>{ };
+        for (std::size_t i = 0; i != numDistinct; ++i)
+        {
+            pool.push_back(std::string(functions[function(rng)]) + "(" + std::to_string(coefficient(rng)) + "*"
+                + variables[variable(rng)] + " + " + variables[variable(rng)] + ")");
+        }
+
+        auto subexpression = std::uniform_int_distribution<std::size_t>(0, numDistinct - 1);
+        std::string result;
+        for (std::size_t i = 0; i != numTerms; ++i)
+        {
+            if (i != 0)
+            {
+                result += " + ";
+            }
+            result += std::to_string(coefficient(rng));
+            result += '*';
+            result += variables[variable(rng)];
+            result += '*';
+            result += pool[subexpression(rng)];
+        }
+        return result;
+    }
+
+
+    std::string randomParameterFormula(std::size_t numVariables, std::size_t numTerms, unsigned seed)
+    {
+        static char const* const functions[] = { "sin", "cos", "exp", "sqrt" };
+
+        auto rng = std::mt19937(seed);
+        auto coefficient = std::uniform_int_distribution<int>(1, 9);
+        auto variable = std::uniform_int_distribution<std::size_t>(0, numVariables - 1);
+        auto function = std::uniform_int_distribution<std::size_t>(0, std::size(functions) - 1);
+        auto parameter = [&] { return std::string("p").append(std::to_string(variable(rng))); };
+
+        std::string result;
+        for (std::size_t i = 0; i != numTerms; ++i)
+        {
+            if (i != 0)
+            {
+                result += " + ";
+            }
+            result += std::to_string(coefficient(rng));
+            result += '*';
+            result += parameter();
+            result += '*';
+            result += functions[function(rng)];
+            result += '(';
+            result += parameter();
+            result += " + ";
+            result += std::to_string(coefficient(rng));
+            result += '*';
+            result += parameter();
+            result += ')';
+        }
+        return result;
+    }
+
+    std::string deepChain(std::size_t numTerms)
+    {
+        std::string result = "a";
+        for (std::size_t i = 1; i < numTerms; ++i)
+        {
+            result += " + a";
+        }
+        return result;
+    }
+
+    static void appendTranscendentalFormula(std::string& result, std::size_t depth, std::mt19937& rng)
+    {
+        static char const* const functions[] = { "sin", "cos", "exp", "arctan", "sqrt", "log" };
+        static char const* const operators[] = { " + ", " - ", "*", "/" };
+
+        auto const& variables = workloadVariables();
+        auto choice = std::uniform_int_distribution<int>(0, 3);
+        if (depth == 0)
+        {
+            result += variables[std::uniform_int_distribution<std::size_t>(0, variables.size() - 1)(rng)];
+            if (choice(rng) == 0)
+            {
+                result += '/';
+                result += std::to_string(std::uniform_int_distribution<int>(2, 9)(rng));
+            }
+            return;
+        }
+        // Arguments of "sqrt" and "log" are wrapped in "exp", so that they stay in the domain.
+        if (choice(rng) != 0)
+        {
+            auto f = std::uniform_int_distribution<std::size_t>(0, std::size(functions) - 1)(rng);
+            result += functions[f];
+            result += f < 4 ? "(" : "(exp(";
+            appendTranscendentalFormula(result, depth - 1, rng);
+            result += f < 4 ? ")" : "))";
+        }
+        else
+        {
+            result += '(';
+            appendTranscendentalFormula(result, depth - 1, rng);
+            result += operators[choice(rng)];
+            appendTranscendentalFormula(result, depth - 1, rng);
+            result += ')';
+        }
+    }
+
+    std::string randomTranscendentalFormula(std::size_t depth, unsigned seed)
+    {
+        auto rng = std::mt19937(seed);
+        std::string result;
+        appendTranscendentalFormula(result, depth, rng);
+        return result;
+    }
+
+    std::string randomInputLines(std::size_t numBytes)
+    {
+        std::string result;
+        for (unsigned seed = 0; result.size() < numBytes; ++seed)
+        {
+            switch (seed % 16)
+            {
+            case 0: result += "# a comment\n"; break;
+            case 1: result += "\n"; break;
+            default: result += randomPolynomial(1 + seed % 6, seed) + " x=1.5 y=2 z=0.25\n"; break;
+            }
+        }
+        return result;
+    }
+
+} // namespace asc::cpp_practice_ws20::ex08::benchmark
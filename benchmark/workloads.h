@@ -0,0 +1,49 @@
+#pragma once
+
+#ifndef INCLUDED_CPP_PRACTICE_EX08_WORKLOADS_H_
+#define INCLUDED_CPP_PRACTICE_EX08_WORKLOADS_H_
+
+
+#include <string>
+#include <vector>
+#include <cstddef>  // for size_t
+
+
+namespace asc::cpp_practice_ws20::ex08::benchmark {
+
+
+    // The variables used by the generated expressions.
+    std::vector<std::string> const& workloadVariables();
+
+    // Generates a random polynomial such as "3*a*x^2 + 5*b*y - 7/c" with the given number of terms. The same seed always
+    // produces the same expression.
+    std::string randomPolynomial(std::size_t numTerms, unsigned seed = 42);
+
+    // Generates a random polynomial like `randomPolynomial()`, but spells coefficients and exponents as constant
+    // subexpressions and adds neutral elements, e.g. "(2*3/4)*a*x^(1 + 1)*1 + 0". Used to measure simplification.
+    std::string randomUnsimplifiedPolynomial(std::size_t numTerms, unsigned seed = 42);
+
+    // Generates a random sum of terms such as "3*x*sin(2*a + b)" where the function calls are drawn from a pool of
+    // `numDistinct` different subexpressions, so that large subexpressions repeat. Used to measure hash-consing.
+    std::string randomRepetitiveFormula(std::size_t numTerms, std::size_t numDistinct, unsigned seed = 42);
+
+    // Generates a random sum of terms such as "3*p4*sin(p0 + 2*p17)" over the variables "p0", "p1", ... of the given
+    // number, so that every term depends on only a few of many variables. Used to measure incremental evaluation.
+    std::string randomParameterFormula(std::size_t numVariables, std::size_t numTerms, unsigned seed = 42);
+
+    // Generates the chain "a + a + ... + a" of the given number of terms, whose tree is as deep as it is long.
+    std::string deepChain(std::size_t numTerms);
+
+    // Generates a random tree of the given depth whose inner nodes are mostly transcendental functions, such as
+    // "sin(exp(x/2)*cos(y)) + arctan(b)".
+    std::string randomTranscendentalFormula(std::size_t depth, unsigned seed = 42);
+
+    // Generates the contents of an input file of at least the given size: one formula with variable substitutions per
+    // line, interspersed with comments and blank lines.
+    std::string randomInputLines(std::size_t numBytes);
+
+
+} // namespace asc::cpp_practice_ws20::ex08::benchmark
+
+
+#endif // INCLUDED_CPP_PRACTICE_EX08_WORKLOADS_H_
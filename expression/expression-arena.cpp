@@ -0,0 +1,152 @@
+#include <limits>       // for numeric_limits<>
+#include <stdexcept>    // for length_error
+
+#include "utility.h"    // for overload<>
+#include "expression-arena.h"
+
+namespace asc::cpp_practice_ws20::ex08 {
+
+	namespace expr {
+
+		NodeIndex ExpressionArena::push(ArenaNode node)
+		{
+			if (nodes_.size() >= std::numeric_limits<NodeIndex>::max())
+			{
+				throw std::length_error("expression arena is full");
+			}
+			nodes_.push_back(node);
+			return static_cast<NodeIndex>(nodes_.size() - 1);
+		}
+
+		NodeIndex ExpressionArena::internVariable(std::string_view name)
+		{
+			auto [it, inserted] = variableIndices_.try_emplace(std::string(name), static_cast<NodeIndex>(variables_.size()));
+			if (inserted)
+			{
+				variables_.push_back(Variable{ it->first });
+			}
+			return it->second;
+		}
+
+		static NodeIndex addNodes(ExpressionArena& arena, Expression const& expr)
+		{
+			// Children are appended before their parent, so the nodes end up in post-order.
+			return std::visit(
+				overload{
+					[&arena]
+					(Variable const& v)
+					{
+						return arena.push(ArenaVariable{ arena.internVariable(v.name) });
+					},
+
+					[&arena]
+					(UnaryFunctionExpression const& unaryExpr)
+					{
+						auto x = addNodes(arena, unaryExpr.x);
+						return arena.push(ArenaUnaryFunctionExpression{ unaryExpr.f, x });
+					},
+
+					[&arena]
+					(BinaryFunctionExpression const& binaryExpr)
+					{
+						auto x = addNodes(arena, binaryExpr.x);
+						auto y = addNodes(arena, binaryExpr.y);
+						return arena.push(ArenaBinaryFunctionExpression{ binaryExpr.f, x, y });
+					},
+
+					[&arena]
+					(auto const& c)
+					{
+						return arena.push(c);
+					}
+				}, expr.value());
+		}
+
+		ArenaExpression ExpressionArena::add(Expression const& expr)
+		{
+			return { *this, addNodes(*this, expr) };
+		}
+
+		void ExpressionArena::clear() noexcept
+		{
+			nodes_.clear();
+			variables_.clear();
+			variableIndices_.clear();
+		}
+
+		Expression ArenaExpression::toExpression() const
+		{
+			return std::visit(
+				overload{
+					[this]
+					(ArenaVariable v) -> Expression
+					{
+						return { arena_->variable(v.name) };
+					},
+
+					[this]
+					(ArenaUnaryFunctionExpression const& unaryExpr) -> Expression
+					{
+						return { UnaryFunctionExpression{ unaryExpr.f, subexpression(unaryExpr.x).toExpression() } };
+					},
+
+					[this]
+					(ArenaBinaryFunctionExpression const& binaryExpr) -> Expression
+					{
+						return { BinaryFunctionExpression{
+							binaryExpr.f,
+							subexpression(binaryExpr.x).toExpression(),
+							subexpression(binaryExpr.y).toExpression() } };
+					},
+
+					[]
+					(auto const& c) -> Expression
+					{
+						return { c };
+					}
+				}, value());
+		}
+
+		bool operator ==(ArenaExpression const& lhs, ArenaExpression const& rhs)
+		{
+			auto const& lhsNode = lhs.value();
+			auto const& rhsNode = rhs.value();
+			if (lhsNode.index() != rhsNode.index())
+			{
+				return false;
+			}
+			return std::visit(
+				overload{
+					[&lhs, &rhs, &rhsNode]
+					(ArenaVariable v)
+					{
+						return lhs.arena().variable(v.name) == rhs.arena().variable(std::get<ArenaVariable>(rhsNode).name);
+					},
+
+					[&lhs, &rhs, &rhsNode]
+					(ArenaUnaryFunctionExpression const& unaryExpr)
+					{
+						auto const& other = std::get<ArenaUnaryFunctionExpression>(rhsNode);
+						return unaryExpr.f.index() == other.f.index()
+							&& lhs.subexpression(unaryExpr.x) == rhs.subexpression(other.x);
+					},
+
+					[&lhs, &rhs, &rhsNode]
+					(ArenaBinaryFunctionExpression const& binaryExpr)
+					{
+						auto const& other = std::get<ArenaBinaryFunctionExpression>(rhsNode);
+						return binaryExpr.f.index() == other.f.index()
+							&& lhs.subexpression(binaryExpr.x) == rhs.subexpression(other.x)
+							&& lhs.subexpression(binaryExpr.y) == rhs.subexpression(other.y);
+					},
+
+					[&rhsNode]
+					<typename T>
+					(T const& c)
+					{
+						return c == std::get<T>(rhsNode);
+					}
+				}, lhsNode);
+		}
+	}
+}
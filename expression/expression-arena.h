@@ -0,0 +1,190 @@
+#pragma once
+
+#ifndef ARITHMETIC_EXPRESSION_PARSER_EXPRESSION_ARENA_HPP
+#define ARITHMETIC_EXPRESSION_PARSER_EXPRESSION_ARENA_HPP
+
+#include <vector>
+#include <string>
+#include <cstdint>      // for uint32_t
+#include <variant>
+#include <iostream>
+#include <string_view>
+#include <unordered_map>
+
+#include "expression.h"
+
+namespace asc::cpp_practice_ws20::ex08 {
+
+	namespace expr {
+
+		// Nodes of an arena are addressed by 32-bit indices rather than by pointers. This halves the size of a child
+		// reference on 64-bit platforms and keeps all nodes of an expression in one contiguous buffer.
+		using NodeIndex = std::uint32_t;
+
+		// A variable node only stores the index of its name in the variable table of the arena, so that every node is
+		// trivially copyable and much smaller than `Expression::RawExpression`, whose size is dominated by `std::string`.
+		struct ArenaVariable {
+			NodeIndex name;
+		};
+
+		struct ArenaUnaryFunctionExpression {
+			UnaryFunction f;
+			NodeIndex x;
+		};
+
+		struct ArenaBinaryFunctionExpression {
+			BinaryFunction f;
+			NodeIndex x;
+			NodeIndex y;
+		};
+
+		using ArenaNode = std::variant<RealConstant,
+									   RationalConstant,
+									   NamedConstant,
+									   ArenaVariable,
+									   ArenaUnaryFunctionExpression,
+									   ArenaBinaryFunctionExpression>;
+
+		class ArenaExpression;
+
+		// Flat node storage for expressions. All nodes live in a single `std::vector<>` and are appended in post-order,
+		// i.e. the children of a node always have smaller indices than the node itself. Variable names are interned, so
+		// every distinct name is stored only once per arena.
+		//
+		// Nodes are never freed individually; destroying or clearing the arena releases all of them at once. An
+		// `ArenaExpression` refers to the arena it was created from and must not outlive it.
+		class ExpressionArena {
+		private:
+			std::vector<ArenaNode> nodes_;
+			std::vector<Variable> variables_;
+			std::unordered_map<std::string, NodeIndex> variableIndices_;
+
+		public:
+			ExpressionArena() = default;
+
+			// The arena cannot be copied because `ArenaExpression`s refer to it by address.
+			ExpressionArena(ExpressionArena const&) = delete;
+			ExpressionArena& operator= (ExpressionArena const&) = delete;
+
+			// Copy the given expression tree into the arena and return a handle to its root.
+			ArenaExpression add(Expression const& expr);
+
+			// Parse an expression from a given string and store it in the arena. The Pratt parser appends the nodes as it
+			// parses them, without building a tree first; if the string cannot be parsed, they are dropped again.
+			// Throws `std::runtime_error` if the argument cannot be parsed.
+			// Implemented in "expression-pratt-parser.cpp".
+			ArenaExpression parse(std::string_view expr);
+
+			// Append a single node. The children referenced by the node must already be stored in the arena.
+			// Throws `std::length_error` if the arena cannot be addressed with 32-bit indices any more.
+			NodeIndex push(ArenaNode node);
+
+			// Return the index of the given variable name in the variable table, adding it if necessary.
+			NodeIndex internVariable(std::string_view name);
+
+			const ArenaNode& node(NodeIndex index) const {
+				return nodes_[index];
+			}
+
+			const Variable& variable(NodeIndex name) const {
+				return variables_[name];
+			}
+
+			std::size_t size() const noexcept {
+				return nodes_.size();
+			}
+
+			std::size_t variableCount() const noexcept {
+				return variables_.size();
+			}
+
+			void reserve(std::size_t numNodes) {
+				nodes_.reserve(numNodes);
+			}
+
+			// Drop all nodes at once but keep the allocated storage for reuse. Invalidates all `ArenaExpression`s referring
+			// to this arena.
+			void clear() noexcept;
+		};
+
+		// A lightweight handle to an expression stored in an `ExpressionArena`. Copying the handle does not copy the
+		// expression.
+		class ArenaExpression {
+		private:
+			const ExpressionArena* arena_;
+			NodeIndex root_;
+
+		public:
+			ArenaExpression(const ExpressionArena& arena, NodeIndex root)
+				: arena_(&arena), root_(root) {}
+
+			const ArenaNode& value() const {
+				return arena_->node(root_);
+			}
+
+			const ExpressionArena& arena() const noexcept {
+				return *arena_;
+			}
+
+			NodeIndex index() const noexcept {
+				return root_;
+			}
+
+			// Return a handle to a child node of this expression.
+			ArenaExpression subexpression(NodeIndex index) const {
+				return { *arena_, index };
+			}
+
+			// Copy the expression back into a `unique_ptr<>`-based tree.
+			Expression toExpression() const;
+
+			friend bool operator ==(ArenaExpression const& lhs, ArenaExpression const& rhs);
+			friend bool operator !=(ArenaExpression const& lhs, ArenaExpression const& rhs) { return !(lhs == rhs); }
+
+			// Write a string representation of the expression to the stream.
+			// Implemented in "expression-print.cpp".
+			friend std::ostream& operator<< (std::ostream& stream, const ArenaExpression& expr);
+		};
+
+		// Return a string representation of the expression.
+		// Implemented in "expression-print.cpp".
+		std::string to_string(const ArenaExpression& expr);
+
+		// Uniform access to the node types of both expression representations, so that tree walks can be written once
+		// for `Expression` and `ArenaExpression`.
+		template <typename ExpressionT>
+		struct ExpressionTraits;
+
+		template <>
+		struct ExpressionTraits<Expression> {
+			using VariableType = Variable;
+			using UnaryFunctionExpressionType = UnaryFunctionExpression;
+			using BinaryFunctionExpressionType = BinaryFunctionExpression;
+		};
+
+		template <>
+		struct ExpressionTraits<ArenaExpression> {
+			using VariableType = ArenaVariable;
+			using UnaryFunctionExpressionType = ArenaUnaryFunctionExpression;
+			using BinaryFunctionExpressionType = ArenaBinaryFunctionExpression;
+		};
+
+		inline const Expression& subexpression(const Expression&, const Expression& arg) {
+			return arg;
+		}
+
+		inline ArenaExpression subexpression(const ArenaExpression& expr, NodeIndex arg) {
+			return expr.subexpression(arg);
+		}
+
+		inline const Variable& variable(const Expression&, const Variable& v) {
+			return v;
+		}
+
+		inline const Variable& variable(const ArenaExpression& expr, ArenaVariable v) {
+			return expr.arena().variable(v.name);
+		}
+	}
+}
+
+#endif // !ARITHMETIC_EXPRESSION_PARSER_EXPRESSION_ARENA_HPP
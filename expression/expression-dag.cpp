@@ -0,0 +1,151 @@
+#include <bit>          // for bit_cast<>()
+#include <cstdint>      // for uint64_t
+
+#include <boost/container_hash/hash.hpp>   // for hash_combine()
+
+#include "utility.h"    // for overload<>
+#include "expression-dag.h"
+
+namespace asc::cpp_practice_ws20::ex08 {
+
+	namespace expr {
+
+		std::size_t ArenaNodeHash::operator()(ArenaNode const& node) const
+		{
+			std::size_t seed = node.index();
+			std::visit(
+				overload{
+					[&seed](RealConstant c)
+					{
+						boost::hash_combine(seed, std::bit_cast<std::uint64_t>(c.value));
+					},
+					[&seed](RationalConstant c)
+					{
+						boost::hash_combine(seed, c.value.numerator());
+						boost::hash_combine(seed, c.value.denominator());
+					},
+					[&seed](NamedConstant c)
+					{
+						boost::hash_combine(seed, static_cast<int>(c));
+					},
+					[&seed](ArenaVariable v)
+					{
+						boost::hash_combine(seed, v.name);
+					},
+					[&seed](ArenaUnaryFunctionExpression const& unaryExpr)
+					{
+						boost::hash_combine(seed, unaryExpr.f.index());
+						boost::hash_combine(seed, unaryExpr.x);
+					},
+					[&seed](ArenaBinaryFunctionExpression const& binaryExpr)
+					{
+						boost::hash_combine(seed, binaryExpr.f.index());
+						boost::hash_combine(seed, binaryExpr.x);
+						boost::hash_combine(seed, binaryExpr.y);
+					}
+				},
+				node);
+			return seed;
+		}
+
+		bool ArenaNodeEqual::operator()(ArenaNode const& lhs, ArenaNode const& rhs) const
+		{
+			if (lhs.index() != rhs.index())
+			{
+				return false;
+			}
+			return std::visit(
+				overload{
+					[&rhs](RealConstant c)
+					{
+						return std::bit_cast<std::uint64_t>(c.value) == std::bit_cast<std::uint64_t>(std::get<RealConstant>(rhs).value);
+					},
+					[&rhs](ArenaVariable v)
+					{
+						return v.name == std::get<ArenaVariable>(rhs).name;
+					},
+					[&rhs](ArenaUnaryFunctionExpression const& unaryExpr)
+					{
+						auto const& other = std::get<ArenaUnaryFunctionExpression>(rhs);
+						return unaryExpr.f.index() == other.f.index() && unaryExpr.x == other.x;
+					},
+					[&rhs](ArenaBinaryFunctionExpression const& binaryExpr)
+					{
+						auto const& other = std::get<ArenaBinaryFunctionExpression>(rhs);
+						return binaryExpr.f.index() == other.f.index() && binaryExpr.x == other.x && binaryExpr.y == other.y;
+					},
+					[&rhs]
+					<typename T>
+					(T const& c)
+					{
+						return c == std::get<T>(rhs);
+					}
+				},
+				lhs);
+		}
+
+		NodeIndex ExpressionDag::addNodes(Expression const& expr)
+		{
+			// Children are interned before their parent, so a parent can be looked up by the indices of its children.
+			auto node = std::visit(
+				overload{
+					[this]
+					(Variable const& v) -> ArenaNode
+					{
+						return ArenaVariable{ arena_.internVariable(v.name) };
+					},
+
+					[this]
+					(UnaryFunctionExpression const& unaryExpr) -> ArenaNode
+					{
+						return ArenaUnaryFunctionExpression{ unaryExpr.f, addNodes(unaryExpr.x) };
+					},
+
+					[this]
+					(BinaryFunctionExpression const& binaryExpr) -> ArenaNode
+					{
+						auto x = addNodes(binaryExpr.x);
+						auto y = addNodes(binaryExpr.y);
+						return ArenaBinaryFunctionExpression{ binaryExpr.f, x, y };
+					},
+
+					[]
+					(auto const& c) -> ArenaNode
+					{
+						return c;
+					}
+				}, expr.value());
+			return intern(node);
+		}
+
+		NodeIndex ExpressionDag::intern(ArenaNode const& node)
+		{
+			++numAddedNodes_;
+			auto it = nodeIndices_.find(node);
+			if (it != nodeIndices_.end())
+			{
+				return it->second;
+			}
+			auto index = arena_.push(node);
+			nodeIndices_.emplace(node, index);
+			return index;
+		}
+
+		ArenaExpression ExpressionDag::add(Expression const& expr)
+		{
+			return { arena_, addNodes(expr) };
+		}
+
+		ArenaExpression ExpressionDag::parse(std::string_view expr)
+		{
+			return add(Expression::parse(expr));
+		}
+
+		void ExpressionDag::clear() noexcept
+		{
+			arena_.clear();
+			nodeIndices_.clear();
+			numAddedNodes_ = 0;
+		}
+	}
+}
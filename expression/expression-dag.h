@@ -0,0 +1,78 @@
+#pragma once
+
+#ifndef ARITHMETIC_EXPRESSION_PARSER_EXPRESSION_DAG_HPP
+#define ARITHMETIC_EXPRESSION_PARSER_EXPRESSION_DAG_HPP
+
+#include <cstddef>      // for size_t
+#include <string_view>
+#include <unordered_map>
+
+#include "expression.h"
+#include "expression-arena.h"
+
+namespace asc::cpp_practice_ws20::ex08 {
+
+	namespace expr {
+
+		// Hash and equality of arena nodes by value. Children are compared by index, which is sufficient in a hash-consed
+		// arena because equal subexpressions have equal indices. Real constants are compared by bit pattern so that
+		// `0.0` and `-0.0` are not merged.
+		struct ArenaNodeHash {
+			std::size_t operator()(ArenaNode const& node) const;
+		};
+
+		struct ArenaNodeEqual {
+			bool operator()(ArenaNode const& lhs, ArenaNode const& rhs) const;
+		};
+
+		// A hash-consed expression store: every distinct subexpression is stored only once, no matter how often it occurs
+		// in the expressions added, so the nodes form a directed acyclic graph rather than a forest of trees. Nodes are kept
+		// in an `ExpressionArena` in post-order, hence every node can be evaluated once in a single sweep.
+		class ExpressionDag {
+		private:
+			ExpressionArena arena_;
+			std::unordered_map<ArenaNode, NodeIndex, ArenaNodeHash, ArenaNodeEqual> nodeIndices_;
+			std::size_t numAddedNodes_ = 0;
+
+			NodeIndex addNodes(Expression const& expr);
+
+		public:
+			ExpressionDag() = default;
+
+			// Add an expression, sharing all subexpressions which are already stored, and return a handle to its root.
+			ArenaExpression add(Expression const& expr);
+
+			// Parse an expression from a given string and add it.
+			// Throws `std::runtime_error` if the argument cannot be parsed.
+			ArenaExpression parse(std::string_view expr);
+
+			// Add a single node whose children are already stored, and return the index of the equal node stored if
+			// there is one. Lets transformations build their results in the DAG directly.
+			NodeIndex intern(ArenaNode const& node);
+
+			const ExpressionArena& arena() const noexcept {
+				return arena_;
+			}
+
+			// The number of distinct nodes stored.
+			std::size_t size() const noexcept {
+				return arena_.size();
+			}
+
+			// The number of nodes of all expressions added, counting every occurrence.
+			std::size_t addedNodes() const noexcept {
+				return numAddedNodes_;
+			}
+
+			// The number of nodes that were not stored because an equal node was stored already.
+			std::size_t deduplicatedNodes() const noexcept {
+				return numAddedNodes_ - arena_.size();
+			}
+
+			// Drop all nodes. Invalidates all `ArenaExpression`s referring to this DAG.
+			void clear() noexcept;
+		};
+	}
+}
+
+#endif // !ARITHMETIC_EXPRESSION_PARSER_EXPRESSION_DAG_HPP
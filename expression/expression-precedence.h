@@ -0,0 +1,106 @@
+#pragma once
+
+#ifndef INCLUDED_CPP_PRACTICE_EX08_EXPRESSION_PRECEDENCE_H_
+#define INCLUDED_CPP_PRACTICE_EX08_EXPRESSION_PRECEDENCE_H_
+
+
+#include <compare>      // for strong_ordering
+
+#include "utility.h"    // for overload<>
+#include "expression.h"
+
+
+// The textual form of the operators and functions, their precedence and their associativity. The printer and the
+// compile-time parser of "static-expression.h" share these definitions, so that what one prints the other reads back.
+
+
+namespace asc::cpp_practice_ws20::ex08 {
+
+    namespace expr {
+
+
+        constexpr auto
+            unaryFunctionName = overload{
+                [](Positive) { return "+";      },
+                [](Negative) { return "-";      },
+                [](Sqrt) { return "sqrt";   },
+                [](Exp) { return "exp";    },
+                [](Log) { return "log";    },
+                [](Sin) { return "sin";    },
+                [](Cos) { return "cos";    },
+                [](Tan) { return "tan";    },
+                [](ArcSin) { return "arcsin"; },
+                [](ArcCos) { return "arccos"; },
+                [](ArcTan) { return "arctan"; }
+        };
+
+        constexpr auto
+            binaryFunctionName = overload{
+                [](Add) { return " + "; },
+                [](Subtract) { return " - "; },
+                [](Multiply) { return "*";   },
+                [](Divide) { return "/";   },
+                [](Pow) { return "^";   },
+                [](LogBase) { return "log"; }
+        };
+
+        // Operator precedence
+        enum class OperatorPrecedence : int
+        {
+            additive = 0,
+            additiveUnary = 1,
+            multiplicative = 2,
+            power = 3,
+            none = -1
+        };
+
+        // C++17 and earlier: need to define all relational operators
+        //constexpr bool operator < (OperatorPrecedence lhs, OperatorPrecedence rhs) { return int(lhs) <  int(rhs); }
+        //constexpr bool operator > (OperatorPrecedence lhs, OperatorPrecedence rhs) { return int(lhs) >  int(rhs); }
+        //constexpr bool operator <=(OperatorPrecedence lhs, OperatorPrecedence rhs) { return int(lhs) <= int(rhs); }
+        //constexpr bool operator >=(OperatorPrecedence lhs, OperatorPrecedence rhs) { return int(lhs) >= int(rhs); }
+        // C++20 and later: only need to define "spaceship operator"
+        constexpr std::strong_ordering operator <=>(OperatorPrecedence lhs, OperatorPrecedence rhs)
+        {
+            return int(lhs) <=> int(rhs);
+        }
+
+        // Precedence of the unary operators
+        constexpr auto unaryOperatorPrecedence = overload{
+                [](Positive) { return OperatorPrecedence::additiveUnary; },
+                [](Negative) { return OperatorPrecedence::additiveUnary; },
+                [](auto) { return OperatorPrecedence::none;          }
+        };
+
+        // Precedence of the binary operators
+        constexpr auto binaryOperatorPrecedence = overload{
+                [](Add) { return OperatorPrecedence::additive;       },
+                [](Subtract) { return OperatorPrecedence::additive;       },
+                [](Multiply) { return OperatorPrecedence::multiplicative; },
+                [](Divide) { return OperatorPrecedence::multiplicative; },
+                [](Pow) { return OperatorPrecedence::power;          },
+                [](auto) { return OperatorPrecedence::none;           }
+        };
+
+        using BinaryFunctionFlag = unsigned;
+        constexpr BinaryFunctionFlag bffNone = 0;
+        constexpr BinaryFunctionFlag bffLeftAssociative = 1;
+        constexpr BinaryFunctionFlag bffRightAssociative = 2;
+        constexpr BinaryFunctionFlag bffAssociative = 4;
+
+        constexpr auto binaryFunctionFlags = overload{
+                [](Add) { return bffLeftAssociative | bffAssociative; },
+                [](Subtract) { return bffLeftAssociative;                  },
+                [](Multiply) { return bffLeftAssociative | bffAssociative; },
+                [](Divide) { return bffLeftAssociative;                  },
+                [](Pow) { return bffRightAssociative;                 },
+                [](auto) { return bffNone;                             }
+        };
+
+
+    } // namespace expr
+
+} // namespace asc::cpp_practice_ws20::ex08
+
+
+#endif // INCLUDED_CPP_PRACTICE_EX08_EXPRESSION_PRECEDENCE_H_
@@ -1,3 +1,6 @@
+#include <boost/container_hash/hash.hpp>   // for hash_combine()
+
+#include "utility.h"    // for overload<>
 #include "expression.h"
 
 namespace asc::cpp_practice_ws20::ex08 {
@@ -19,6 +22,46 @@ namespace asc::cpp_practice_ws20::ex08 {
         {
             return lhs.value() == rhs.value();
         }
+
+        std::size_t hash_value(Expression const& expr)
+        {
+            // Mix in the kind of the node first so that e.g. `x` and `-x` hash differently.
+            std::size_t seed = expr.value().index();
+            std::visit(
+                overload{
+                    [&seed](RealConstant c)
+                    {
+                        // `0.0 == -0.0`, so both must hash alike.
+                        boost::hash_combine(seed, c.value == 0 ? 0.0 : c.value);
+                    },
+                    [&seed](RationalConstant c)
+                    {
+                        boost::hash_combine(seed, c.value.numerator());
+                        boost::hash_combine(seed, c.value.denominator());
+                    },
+                    [&seed](NamedConstant c)
+                    {
+                        boost::hash_combine(seed, static_cast<int>(c));
+                    },
+                    [&seed](Variable const& v)
+                    {
+                        boost::hash_combine(seed, v.name);
+                    },
+                    [&seed](UnaryFunctionExpression const& unaryExpr)
+                    {
+                        boost::hash_combine(seed, unaryExpr.f.index());
+                        boost::hash_combine(seed, hash_value(unaryExpr.x));
+                    },
+                    [&seed](BinaryFunctionExpression const& binaryExpr)
+                    {
+                        boost::hash_combine(seed, binaryExpr.f.index());
+                        boost::hash_combine(seed, hash_value(binaryExpr.x));
+                        boost::hash_combine(seed, hash_value(binaryExpr.y));
+                    }
+                },
+                expr.value());
+            return seed;
+        }
 	}
 
 }
\ No newline at end of file
@@ -5,7 +5,9 @@
 
 #include <iostream>
 #include <string>
+#include <cstddef>      // for size_t
 #include <memory>       // for shared_ptr<>
+#include <functional>   // for hash<>
 #include <utility>      // for move()
 #include <variant>
 #include <string_view>
@@ -13,7 +15,7 @@
 
 #include <boost/rational.hpp>
 
-namespace arithmetic_expression_parser::expression {
+namespace asc::cpp_practice_ws20::ex08::expr {
 
 	struct Positive { };
 	struct Negative { };
@@ -96,6 +98,14 @@ namespace arithmetic_expression_parser::expression {
 		}
 	};
 
+	// The parsers available to `Expression::parse()`. Both accept the same language and produce equal expressions.
+	enum class ParserBackend {
+		// The Boost.Spirit X3 grammar in "expression-parser.cpp".
+		spirit,
+		// A hand-written precedence-climbing parser in "expression-pratt-parser.cpp", which is considerably faster.
+		pratt
+	};
+
 	// recursive basic expressions must be forward-declared here.
 	struct UnaryFunctionExpression;
 	struct BinaryFunctionExpression;
@@ -114,18 +124,21 @@ namespace arithmetic_expression_parser::expression {
 		std::unique_ptr<RawExpression> rawExpression;
 
 	public:
-		Expression(RawExpression _rawExpression)
-			: rawExpression(std::make_unique<RawExpression>(std::move(_rawExpression))) {};
+		// Defined below, where the alternatives of `RawExpression` are complete.
+		Expression(RawExpression _rawExpression);
 
-		const RawExpression& value() const {
-			return *rawExpression;
-		}
+		const RawExpression& value() const;
 
 		// Parse an expression from a given string.
 		// Throws `std::runtime_error` if the argument cannot be parsed.
 		// Implemented in "expression-parse.cpp".
 		static Expression parse(std::string_view expr);
 
+		// Parse an expression from a given string with the given parser backend.
+		// Throws `std::runtime_error` if the argument cannot be parsed.
+		// Implemented in "expression-pratt-parser.cpp".
+		static Expression parse(std::string_view expr, ParserBackend backend);
+
 		friend bool operator ==(Expression const& lhs, Expression const& rhs);
 		friend bool operator !=(Expression const& lhs, Expression const& rhs) { return !(lhs == rhs); }
 
@@ -138,6 +151,10 @@ namespace arithmetic_expression_parser::expression {
 	// Implemented in "expression-print.cpp".
 	std::string to_string(const Expression& expr);
 
+	// Return a structural hash of the expression. Expressions which compare equal have equal hashes.
+	// Implemented in "expression.cpp".
+	std::size_t hash_value(const Expression& expr);
+
 	struct UnaryFunctionExpression {
 		UnaryFunction f;
 		Expression x;
@@ -154,6 +171,20 @@ namespace arithmetic_expression_parser::expression {
 		friend bool operator ==(BinaryFunctionExpression const& lhs, BinaryFunctionExpression const& rhs);
 		friend bool operator !=(BinaryFunctionExpression const& lhs, BinaryFunctionExpression const& rhs) { return !(lhs == rhs); }
 	};
+
+	inline Expression::Expression(RawExpression _rawExpression)
+		: rawExpression(std::make_unique<RawExpression>(std::move(_rawExpression))) {}
+
+	inline const Expression::RawExpression& Expression::value() const {
+		return *rawExpression;
+	}
 }
 
+template <>
+struct std::hash<asc::cpp_practice_ws20::ex08::expr::Expression> {
+	std::size_t operator()(asc::cpp_practice_ws20::ex08::expr::Expression const& expr) const {
+		return hash_value(expr);
+	}
+};
+
 #endif // !ARITHMETIC_EXPRESSION_PARSER_EXPRESSION_HPP
@@ -0,0 +1,558 @@
+#include <bit>          // for bit_cast<>()
+#include <algorithm>    // for max(), min(), fill_n(), copy_n()
+#include <stdexcept>    // for invalid_argument
+
+#include "utility.h"    // for overload<>
+#include "expression-compile.h"
+#include "expression-evaluate.h"   // for UnknownVariableValue
+#include "expression-functions.h"
+#include "vector-math.h"
+
+namespace asc::cpp_practice_ws20::ex08 {
+
+	namespace expr {
+
+		constexpr auto
+			unaryFunctionOpCode = overload{
+				[](Negative) { return OpCode::negative; },
+				[](Sqrt) { return OpCode::sqrt; },
+				[](Exp) { return OpCode::exp; },
+				[](Log) { return OpCode::log; },
+				[](Sin) { return OpCode::sin; },
+				[](Cos) { return OpCode::cos; },
+				[](Tan) { return OpCode::tan; },
+				[](ArcSin) { return OpCode::arcSin; },
+				[](ArcCos) { return OpCode::arcCos; },
+				[](ArcTan) { return OpCode::arcTan; }
+		};
+
+		constexpr auto
+			binaryFunctionOpCode = overload{
+				[](Add) { return OpCode::add; },
+				[](Subtract) { return OpCode::subtract; },
+				[](Multiply) { return OpCode::multiply; },
+				[](Divide) { return OpCode::divide; },
+				[](Pow) { return OpCode::pow; },
+				[](LogBase) { return OpCode::logBase; }
+		};
+
+		// Returns the number of values an instruction pops off the stack. Every instruction pushes exactly one value.
+		static std::ptrdiff_t stackInputs(OpCode op)
+		{
+			switch (op)
+			{
+			case OpCode::constant:
+			case OpCode::variable:
+			case OpCode::load:
+				return 0;
+			case OpCode::add:
+			case OpCode::subtract:
+			case OpCode::multiply:
+			case OpCode::divide:
+			case OpCode::pow:
+			case OpCode::logBase:
+				return 2;
+			default:
+				return 1;
+			}
+		}
+
+		static bool readsConstant(OpCode op)
+		{
+			return op == OpCode::constant || (op >= OpCode::addConstant && op <= OpCode::divideConstant);
+		}
+
+		static bool readsVariable(OpCode op)
+		{
+			return op == OpCode::variable || (op >= OpCode::addVariable && op <= OpCode::divideVariable);
+		}
+
+		CompiledExpression::CompiledExpression(
+				std::vector<Instruction> code, std::vector<double> constants, std::vector<std::string> variables)
+			: code_(std::move(code)), constants_(std::move(constants)), variables_(std::move(variables))
+		{
+			// Simulate the stack to validate the program and to determine the stack size required.
+			std::ptrdiff_t depth = 0;
+			std::ptrdiff_t maxDepth = 0;
+			std::vector<bool> stored;
+			for (auto instruction : code_)
+			{
+				if ((readsConstant(instruction.op) && instruction.operand >= constants_.size())
+					|| (readsVariable(instruction.op) && instruction.operand >= variables_.size()))
+				{
+					throw std::invalid_argument("instruction operand out of range");
+				}
+				if (instruction.op == OpCode::store)
+				{
+					stored.resize(std::max(stored.size(), std::size_t(instruction.operand) + 1));
+					stored[instruction.operand] = true;
+				}
+				if (instruction.op == OpCode::load && (instruction.operand >= stored.size() || !stored[instruction.operand]))
+				{
+					throw std::invalid_argument("temporary loaded before it is stored");
+				}
+				auto numInputs = stackInputs(instruction.op);
+				if (depth < numInputs)
+				{
+					throw std::invalid_argument("stack underflow in instruction stream");
+				}
+				depth += 1 - numInputs;
+				maxDepth = std::max(maxDepth, depth);
+			}
+			if (depth != 1)
+			{
+				throw std::invalid_argument("instruction stream must leave exactly one value on the stack");
+			}
+			stackSize_ = static_cast<std::size_t>(maxDepth);
+			temporaryCount_ = stored.size();
+		}
+
+		namespace {
+
+			class Compiler {
+			private:
+				std::vector<Instruction> code_;
+				std::vector<double> constants_;
+				std::vector<std::string> variables_;
+				std::unordered_map<std::uint64_t, std::uint32_t> constantIndices_;
+				std::unordered_map<std::string, std::uint32_t> variableIndices_;
+				VariableLayout const* layout_ = nullptr;
+
+				// For arena expressions: the number of parents referring to a node, and the temporaries holding the values of
+				// shared nodes which have been emitted already.
+				std::vector<std::uint32_t> uses_;
+				std::unordered_map<NodeIndex, std::uint32_t> temporaries_;
+
+				void emitConstant(double value)
+				{
+					// Constants are deduplicated by bit pattern so that `0.0` and `-0.0` stay distinct.
+					auto [it, inserted] = constantIndices_.try_emplace(
+						std::bit_cast<std::uint64_t>(value), static_cast<std::uint32_t>(constants_.size()));
+					if (inserted)
+					{
+						constants_.push_back(value);
+					}
+					code_.push_back({ OpCode::constant, it->second });
+				}
+
+				void emitVariable(std::string const& name)
+				{
+					if (layout_)
+					{
+						code_.push_back({ OpCode::variable, static_cast<std::uint32_t>(layout_->indexOf(name)) });
+						return;
+					}
+					auto [it, inserted] = variableIndices_.try_emplace(name, static_cast<std::uint32_t>(variables_.size()));
+					if (inserted)
+					{
+						variables_.push_back(name);
+					}
+					code_.push_back({ OpCode::variable, it->second });
+				}
+
+				void countUsesImpl(ArenaExpression const& expr)
+				{
+					// Children of a shared node are emitted only once, so they are only counted once.
+					if (uses_[expr.index()]++ != 0)
+					{
+						return;
+					}
+					std::visit(
+						overload{
+							[this, &expr](ArenaUnaryFunctionExpression const& unaryExpr)
+							{
+								countUsesImpl(expr.subexpression(unaryExpr.x));
+							},
+							[this, &expr](ArenaBinaryFunctionExpression const& binaryExpr)
+							{
+								countUsesImpl(expr.subexpression(binaryExpr.x));
+								countUsesImpl(expr.subexpression(binaryExpr.y));
+							},
+							[](auto const&) { }
+						}, expr.value());
+				}
+
+				template <typename ExpressionT>
+				static bool isConstantTwo(ExpressionT const& expr)
+				{
+					return std::visit(
+						overload{
+							[](RationalConstant c) { return c.value.numerator() == 2 && c.value.denominator() == 1; },
+							[](RealConstant c) { return c.value == 2; },
+							[](auto const&) { return false; }
+						}, expr.value());
+				}
+
+			public:
+				Compiler() = default;
+
+				// Use the slots of a fixed layout instead of assigning slots in order of first occurrence.
+				explicit Compiler(VariableLayout const& layout)
+					: variables_(layout.names().begin(), layout.names().end()), layout_(&layout) {}
+
+				template <typename ExpressionT>
+				void emitNode(ExpressionT const& expr)
+				{
+					using Traits = ExpressionTraits<ExpressionT>;
+
+					std::visit(
+						overload{
+							[this, &expr]
+							(typename Traits::VariableType const& v)
+							{
+								emitVariable(variable(expr, v).name);
+							},
+
+							[this, &expr]
+							(typename Traits::UnaryFunctionExpressionType const& unaryExpr)
+							{
+								emit(subexpression(expr, unaryExpr.x));
+								std::visit(
+									overload{
+										// The identity does not need an instruction.
+										[](Positive) { },
+										[this](auto f) { code_.push_back({ unaryFunctionOpCode(f), 0 }); }
+									},
+									unaryExpr.f);
+							},
+
+							[this, &expr]
+							(typename Traits::BinaryFunctionExpressionType const& binaryExpr)
+							{
+								emit(subexpression(expr, binaryExpr.x));
+								if (std::holds_alternative<Pow>(binaryExpr.f) && isConstantTwo(subexpression(expr, binaryExpr.y)))
+								{
+									code_.push_back({ OpCode::square, 0 });
+									return;
+								}
+								emit(subexpression(expr, binaryExpr.y));
+								auto op = std::visit(binaryFunctionOpCode, binaryExpr.f);
+								if (op >= OpCode::add && op <= OpCode::divide
+									&& (code_.back().op == OpCode::constant || code_.back().op == OpCode::variable))
+								{
+									// Fold the leaf that was just pushed into the operand of the function instruction.
+									auto base = code_.back().op == OpCode::constant ? OpCode::addConstant : OpCode::addVariable;
+									code_.back().op = static_cast<OpCode>(
+										static_cast<int>(base) + (static_cast<int>(op) - static_cast<int>(OpCode::add)));
+									return;
+								}
+								code_.push_back({ op, 0 });
+							},
+
+							[this]
+							(auto const& c)
+							{
+								emitConstant(evaluate(c));
+							}
+						}, expr.value());
+				}
+
+				void emit(Expression const& expr)
+				{
+					emitNode(expr);
+				}
+
+				void emit(ArenaExpression const& expr)
+				{
+					if (auto it = temporaries_.find(expr.index()); it != temporaries_.end())
+					{
+						code_.push_back({ OpCode::load, it->second });
+						return;
+					}
+					emitNode(expr);
+
+					// Leaves are cheaper to push again than to keep in a temporary.
+					bool isLeaf = !std::holds_alternative<ArenaUnaryFunctionExpression>(expr.value())
+						&& !std::holds_alternative<ArenaBinaryFunctionExpression>(expr.value());
+					if (!isLeaf && expr.index() < uses_.size() && uses_[expr.index()] > 1)
+					{
+						auto temporary = static_cast<std::uint32_t>(temporaries_.size());
+						temporaries_.emplace(expr.index(), temporary);
+						code_.push_back({ OpCode::store, temporary });
+					}
+				}
+
+				// Count how often every node reachable from `root` is referred to. Must be called before `emit()` to enable
+				// the elimination of common subexpressions.
+				void countUses(ArenaExpression const& root)
+				{
+					// Nodes are stored in post-order, so no node reachable from the root has a larger index.
+					uses_.assign(std::size_t(root.index()) + 1, 0);
+					countUsesImpl(root);
+				}
+
+				CompiledExpression finish() &&
+				{
+					return { std::move(code_), std::move(constants_), std::move(variables_) };
+				}
+			};
+
+		} // anonymous namespace
+
+		CompiledExpression compile(Expression const& expr)
+		{
+			Compiler compiler;
+			compiler.emit(expr);
+			return std::move(compiler).finish();
+		}
+
+		CompiledExpression compile(ArenaExpression const& expr)
+		{
+			Compiler compiler;
+			compiler.countUses(expr);
+			compiler.emit(expr);
+			return std::move(compiler).finish();
+		}
+
+		CompiledExpression compile(Expression const& expr, VariableLayout const& layout)
+		{
+			Compiler compiler(layout);
+			compiler.emit(expr);
+			return std::move(compiler).finish();
+		}
+
+		CompiledExpression compile(ArenaExpression const& expr, VariableLayout const& layout)
+		{
+			Compiler compiler(layout);
+			compiler.countUses(expr);
+			compiler.emit(expr);
+			return std::move(compiler).finish();
+		}
+
+		static double run(std::span<const Instruction> code, double const* constants, double const* variableValues,
+			double* stack, double* temporaries)
+		{
+			// The top of the stack is kept in `top`, which the compiler can keep in a register, so that an instruction
+			// operating on it does not wait for the previous one to store it. `stack[0]` to `stack[sp - 1]` are the values
+			// below it; a push moves the old top there.
+			double top = 0;
+			std::size_t sp = 0;
+			for (auto instruction : code)
+			{
+				switch (instruction.op)
+				{
+				case OpCode::constant: stack[sp++] = top; top = constants[instruction.operand]; break;
+				case OpCode::variable: stack[sp++] = top; top = variableValues[instruction.operand]; break;
+
+				case OpCode::negative: top = evaluate(Negative{ }, top); break;
+				case OpCode::sqrt: top = evaluate(Sqrt{ }, top); break;
+				case OpCode::exp: top = evaluate(Exp{ }, top); break;
+				case OpCode::log: top = evaluate(Log{ }, top); break;
+				case OpCode::sin: top = evaluate(Sin{ }, top); break;
+				case OpCode::cos: top = evaluate(Cos{ }, top); break;
+				case OpCode::tan: top = evaluate(Tan{ }, top); break;
+				case OpCode::arcSin: top = evaluate(ArcSin{ }, top); break;
+				case OpCode::arcCos: top = evaluate(ArcCos{ }, top); break;
+				case OpCode::arcTan: top = evaluate(ArcTan{ }, top); break;
+				case OpCode::square: top = evaluate(Pow{ }, top, 2); break;
+
+				case OpCode::add: top = evaluate(Add{ }, stack[--sp], top); break;
+				case OpCode::subtract: top = evaluate(Subtract{ }, stack[--sp], top); break;
+				case OpCode::multiply: top = evaluate(Multiply{ }, stack[--sp], top); break;
+				case OpCode::divide: top = evaluate(Divide{ }, stack[--sp], top); break;
+				case OpCode::pow: top = evaluate(Pow{ }, stack[--sp], top); break;
+				case OpCode::logBase: top = evaluate(LogBase{ }, stack[--sp], top); break;
+
+				case OpCode::addConstant: top = evaluate(Add{ }, top, constants[instruction.operand]); break;
+				case OpCode::subtractConstant: top = evaluate(Subtract{ }, top, constants[instruction.operand]); break;
+				case OpCode::multiplyConstant: top = evaluate(Multiply{ }, top, constants[instruction.operand]); break;
+				case OpCode::divideConstant: top = evaluate(Divide{ }, top, constants[instruction.operand]); break;
+				case OpCode::addVariable: top = evaluate(Add{ }, top, variableValues[instruction.operand]); break;
+				case OpCode::subtractVariable: top = evaluate(Subtract{ }, top, variableValues[instruction.operand]); break;
+				case OpCode::multiplyVariable: top = evaluate(Multiply{ }, top, variableValues[instruction.operand]); break;
+				case OpCode::divideVariable: top = evaluate(Divide{ }, top, variableValues[instruction.operand]); break;
+
+				case OpCode::store: temporaries[instruction.operand] = top; break;
+				case OpCode::load: stack[sp++] = top; top = temporaries[instruction.operand]; break;
+				}
+			}
+			return top;
+		}
+
+		// Stacks and temporaries up to this size live on the native stack, so that evaluating typical expressions does not
+		// allocate.
+		constexpr std::size_t localStackSize = 64;
+
+		double evaluate(CompiledExpression const& expr, std::span<double const> variableValues)
+		{
+			if (variableValues.size() < expr.variables().size())
+			{
+				throw std::invalid_argument("not enough variable values");
+			}
+
+			// The temporaries are placed behind the stack.
+			if (expr.stackSize() + expr.temporaryCount() > localStackSize)
+			{
+				auto heapStack = std::vector<double>(expr.stackSize() + expr.temporaryCount());
+				return run(expr.code(), expr.constants().data(), variableValues.data(),
+					heapStack.data(), heapStack.data() + expr.stackSize());
+			}
+			double localStack[localStackSize];
+			return run(expr.code(), expr.constants().data(), variableValues.data(),
+				localStack, localStack + expr.stackSize());
+		}
+
+		double evaluate(CompiledExpression const& expr,
+			std::unordered_map<std::string, double> const& variableSubsitituions)
+		{
+			// Look up every variable once rather than once per occurrence.
+			auto variables = expr.variables();
+			double localValues[localStackSize];
+			std::vector<double> heapValues;
+			double* values = localValues;
+			if (variables.size() > localStackSize)
+			{
+				heapValues.resize(variables.size());
+				values = heapValues.data();
+			}
+			for (std::size_t i = 0; i != variables.size(); ++i)
+			{
+				auto it = variableSubsitituions.find(variables[i]);
+				if (it == variableSubsitituions.end())
+				{
+					throw UnknownVariableValue(variables[i], "No value given for variable.");
+				}
+				values[i] = it->second;
+			}
+			return evaluate(expr, std::span<double const>(values, variables.size()));
+		}
+
+		// Rows are evaluated in tiles of this size, one instruction for the whole tile at a time, so that the cost of
+		// dispatching an instruction is shared by many rows. A stack slot is a whole tile.
+		constexpr std::size_t tileSize = 256;
+
+		static void runTile(std::span<const Instruction> code, double const* constants,
+			std::span<std::span<double const> const> columns, std::size_t offset, std::size_t n,
+			double* stack, double* temporaries)
+		{
+			std::size_t sp = 0;
+			auto top = [stack, &sp] { return stack + (sp - 1) * tileSize; };
+
+			// The array functions are those of the tree evaluators, so that the results agree bit for bit.
+			auto unary = [&](auto f)
+			{
+				auto x = std::span<double>(top(), n);
+				evaluate(f, std::span<double const>(x), x);
+			};
+			auto binary = [&](auto f)
+			{
+				--sp;
+				auto x = std::span<double>(top(), n);
+				evaluate(f, std::span<double const>(x), std::span<double const>(top() + tileSize, n), x);
+			};
+			auto withConstant = [&](auto f, double y)
+			{
+				auto x = std::span<double>(top(), n);
+				evaluate(f, std::span<double const>(x), y, x);
+			};
+			auto withVariable = [&](auto f, std::span<double const> column)
+			{
+				if (column.size() == 1)
+				{
+					withConstant(f, column[0]);
+					return;
+				}
+				auto x = std::span<double>(top(), n);
+				evaluate(f, std::span<double const>(x), column.subspan(offset, n), x);
+			};
+
+			for (auto instruction : code)
+			{
+				switch (instruction.op)
+				{
+				case OpCode::constant:
+					++sp;
+					std::fill_n(top(), n, constants[instruction.operand]);
+					break;
+				case OpCode::variable:
+				{
+					++sp;
+					auto column = columns[instruction.operand];
+					if (column.size() == 1)
+					{
+						std::fill_n(top(), n, column[0]);
+					}
+					else
+					{
+						std::copy_n(column.data() + offset, n, top());
+					}
+					break;
+				}
+
+				case OpCode::negative: unary(Negative{ }); break;
+				case OpCode::sqrt: unary(Sqrt{ }); break;
+				case OpCode::exp: unary(Exp{ }); break;
+				case OpCode::log: unary(Log{ }); break;
+				case OpCode::sin: unary(Sin{ }); break;
+				case OpCode::cos: unary(Cos{ }); break;
+				case OpCode::tan: unary(Tan{ }); break;
+				case OpCode::arcSin: unary(ArcSin{ }); break;
+				case OpCode::arcCos: unary(ArcCos{ }); break;
+				case OpCode::arcTan: unary(ArcTan{ }); break;
+				case OpCode::square: withConstant(Pow{ }, 2); break;
+
+				case OpCode::add: binary(Add{ }); break;
+				case OpCode::subtract: binary(Subtract{ }); break;
+				case OpCode::multiply: binary(Multiply{ }); break;
+				case OpCode::divide: binary(Divide{ }); break;
+				case OpCode::pow: binary(Pow{ }); break;
+				case OpCode::logBase: binary(LogBase{ }); break;
+
+				case OpCode::addConstant: withConstant(Add{ }, constants[instruction.operand]); break;
+				case OpCode::subtractConstant: withConstant(Subtract{ }, constants[instruction.operand]); break;
+				case OpCode::multiplyConstant: withConstant(Multiply{ }, constants[instruction.operand]); break;
+				case OpCode::divideConstant: withConstant(Divide{ }, constants[instruction.operand]); break;
+				case OpCode::addVariable: withVariable(Add{ }, columns[instruction.operand]); break;
+				case OpCode::subtractVariable: withVariable(Subtract{ }, columns[instruction.operand]); break;
+				case OpCode::multiplyVariable: withVariable(Multiply{ }, columns[instruction.operand]); break;
+				case OpCode::divideVariable: withVariable(Divide{ }, columns[instruction.operand]); break;
+
+				case OpCode::store: std::copy_n(top(), n, temporaries + instruction.operand * tileSize); break;
+				case OpCode::load:
+					++sp;
+					std::copy_n(temporaries + instruction.operand * tileSize, n, top());
+					break;
+				}
+			}
+		}
+
+		std::vector<double> evaluate(CompiledExpression const& expr,
+			std::span<std::span<double const> const> variableValues)
+		{
+			auto numVariables = expr.variables().size();
+			if (variableValues.size() < numVariables)
+			{
+				throw std::invalid_argument("not enough variable values");
+			}
+			auto columns = variableValues.first(numVariables);
+
+			// Determine the number of results. Columns with a single value are broadcast.
+			std::size_t numResults = 1;
+			bool haveLength = false;
+			for (auto column : columns)
+			{
+				if (column.size() == 1)
+				{
+					continue;
+				}
+				if (haveLength && column.size() != numResults)
+				{
+					throw BroadcastError("operands with different shapes could not be broadcast together");
+				}
+				numResults = column.size();
+				haveLength = true;
+			}
+
+			auto result = std::vector<double>(numResults);
+			auto stack = std::vector<double>((expr.stackSize() + expr.temporaryCount()) * tileSize);
+			auto temporaries = stack.data() + expr.stackSize() * tileSize;
+			for (std::size_t offset = 0; offset < numResults; offset += tileSize)
+			{
+				auto n = std::min(tileSize, numResults - offset);
+				runTile(expr.code(), expr.constants().data(), columns, offset, n, stack.data(), temporaries);
+				std::copy_n(stack.data(), n, result.data() + offset);
+			}
+			return result;
+		}
+	}
+}
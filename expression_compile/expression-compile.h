@@ -0,0 +1,146 @@
+#pragma once
+
+#ifndef ARITHMETIC_EXPRESSION_PARSER_EXPRESSION_COMPILE_HPP
+#define ARITHMETIC_EXPRESSION_PARSER_EXPRESSION_COMPILE_HPP
+
+#include <span>
+#include <string>
+#include <vector>
+#include <cstdint>      // for uint8_t, uint32_t
+#include <string_view>
+#include <unordered_map>
+
+#include "expression.h"
+#include "expression-arena.h"
+#include "variable-layout.h"
+
+namespace asc::cpp_practice_ws20::ex08 {
+
+	namespace expr {
+
+		enum class OpCode : std::uint8_t {
+			// Push a value onto the stack. The operand is an index into the constant table or a variable slot.
+			constant,
+			variable,
+
+			// Replace the top of the stack with the function value.
+			negative,
+			sqrt,
+			exp,
+			log,
+			sin,
+			cos,
+			tan,
+			arcSin,
+			arcCos,
+			arcTan,
+			square,
+
+			// Pop two values `x` and `y` (`y` is on top) and push the function value of `(x, y)`.
+			add,
+			subtract,
+			multiply,
+			divide,
+			pow,
+			logBase,
+
+			// Replace the top of the stack `x` with the function value of `(x, y)`, where `y` is the constant or variable
+			// referred to by the operand. These save a dispatch for the common case of a leaf as the right-hand operand.
+			addConstant,
+			subtractConstant,
+			multiplyConstant,
+			divideConstant,
+			addVariable,
+			subtractVariable,
+			multiplyVariable,
+			divideVariable,
+
+			// Common subexpressions are evaluated once and kept in temporaries. `store` copies the top of the stack into
+			// the temporary referred to by the operand without popping it; `load` pushes the value of a temporary.
+			store,
+			load
+		};
+
+		struct Instruction {
+			OpCode op;
+			std::uint32_t operand;
+		};
+
+		// An expression lowered into a linear instruction stream for a stack machine. Constants are converted to `double`
+		// once, and variables are referred to by slot indices rather than by name, so evaluating a compiled expression
+		// neither recurses nor hashes strings.
+		//
+		// Dispatching an instruction costs a few nanoseconds, so the stack machine is only about 5 times as fast per
+		// call as the tree walk with a map for expressions with several variables, such as the polynomials of
+		// "test.txt", and less for smaller ones: 2.8 times for `a*x^2` in "compile-benchmark.cpp". The native code of
+		// a `JitExpression` (see "expression-jit.h") is at least 6 times as fast for all of them.
+		class CompiledExpression {
+		private:
+			std::vector<Instruction> code_;
+			std::vector<double> constants_;
+			std::vector<std::string> variables_;
+			std::size_t stackSize_ = 0;
+			std::size_t temporaryCount_ = 0;
+
+		public:
+			// Throws `std::invalid_argument` if the instruction stream does not leave exactly one value on the stack,
+			// refers to constants or variables that do not exist, or loads a temporary before storing it.
+			CompiledExpression(
+				std::vector<Instruction> code, std::vector<double> constants, std::vector<std::string> variables);
+
+			std::span<const Instruction> code() const noexcept {
+				return code_;
+			}
+
+			std::span<const double> constants() const noexcept {
+				return constants_;
+			}
+
+			// The names of the variables in slot order.
+			std::span<const std::string> variables() const noexcept {
+				return variables_;
+			}
+
+			// The maximal number of values on the stack during evaluation.
+			std::size_t stackSize() const noexcept {
+				return stackSize_;
+			}
+
+			// The number of temporaries used for common subexpressions.
+			std::size_t temporaryCount() const noexcept {
+				return temporaryCount_;
+			}
+		};
+
+		// Lower an expression into an instruction stream. Variables are assigned slots in order of first occurrence.
+		// Subexpressions shared by several parents, as in an `ExpressionDag`, are evaluated only once.
+		CompiledExpression compile(Expression const& expr);
+		CompiledExpression compile(ArenaExpression const& expr);
+
+		// Lower an expression using the variable slots of the given layout, so that values can be passed in layout
+		// order. The variables of the compiled expression are all variables of the layout, used or not.
+		// Throws an exception of type `UnknownVariableValue` if the expression refers to a variable that is not part
+		// of the layout.
+		CompiledExpression compile(Expression const& expr, VariableLayout const& layout);
+		CompiledExpression compile(ArenaExpression const& expr, VariableLayout const& layout);
+
+		// Evaluates a compiled expression using the provided variable substitutions.
+		// Throws an exception of type `UnknownVariableValue` if no substitution was provided for a variable.
+		double evaluate(CompiledExpression const& expr,
+			std::unordered_map<std::string, double> const& variableSubsitituions);
+
+		// Evaluates a compiled expression. `variableValues[i]` is the value of the variable `expr.variables()[i]`.
+		// Throws `std::invalid_argument` if fewer values than variables are given.
+		double evaluate(CompiledExpression const& expr, std::span<double const> variableValues);
+
+		// Evaluates a compiled expression for many sets of inputs. `variableValues[i]` holds the values of the variable
+		// `expr.variables()[i]`, and the `j`-th result is computed from the `j`-th value of every column. Columns with
+		// a single value are broadcast.
+		// Throws `std::invalid_argument` if fewer columns than variables are given.
+		// Throws an exception of type `BroadcastError` if two columns of more than one value differ in length.
+		std::vector<double> evaluate(CompiledExpression const& expr,
+			std::span<std::span<double const> const> variableValues);
+	}
+}
+
+#endif // !ARITHMETIC_EXPRESSION_PARSER_EXPRESSION_COMPILE_HPP
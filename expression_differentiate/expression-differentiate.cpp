@@ -0,0 +1,285 @@
+#include <vector>
+#include <cstdint>      // for int8_t
+#include <variant>
+#include <optional>
+#include <stdexcept>    // for invalid_argument
+#include <unordered_map>
+
+#include "utility.h"    // for overload<>
+#include "expression-simplify.h"
+#include "expression-differentiate.h"
+
+namespace asc::cpp_practice_ws20::ex08 {
+
+	namespace expr {
+
+		namespace {
+
+			// The derivative of a node, or `nullopt` if it is identically zero.
+			using Derivative = std::optional<NodeIndex>;
+
+			// Builds derivatives in a DAG, node by node. Derivatives are memoised per node, so shared subexpressions are
+			// differentiated only once, and new nodes are interned, so equal terms of the derivative are shared too.
+			class Differentiator {
+			private:
+				ExpressionDag& dag_;
+				std::string_view variable_;
+				std::unordered_map<NodeIndex, Derivative> derivatives_;
+
+				// Whether a node is free of variables: 1 if so, 0 if not, -1 if not yet known.
+				std::vector<std::int8_t> isConstant_;
+
+				// Nodes are copied, since interning new nodes may reallocate the storage of the arena.
+				ArenaNode node(NodeIndex index) const
+				{
+					return dag_.arena().node(index);
+				}
+
+				bool isConstant(NodeIndex index)
+				{
+					if (index >= isConstant_.size())
+					{
+						isConstant_.resize(dag_.size(), -1);
+					}
+					if (isConstant_[index] < 0)
+					{
+						isConstant_[index] = std::visit(
+							overload{
+								[](ArenaVariable) { return false; },
+								[this](ArenaUnaryFunctionExpression const& unaryExpr) { return isConstant(unaryExpr.x); },
+								[this](ArenaBinaryFunctionExpression const& binaryExpr)
+								{
+									return isConstant(binaryExpr.x) && isConstant(binaryExpr.y);
+								},
+								[](auto const&) { return true; }
+							}, node(index));
+					}
+					return isConstant_[index] != 0;
+				}
+
+				bool isNumber(NodeIndex index, int n) const
+				{
+					return std::visit(
+						overload{
+							[n](RationalConstant c) { return c.value.numerator() == n && c.value.denominator() == 1; },
+							[n](RealConstant c) { return c.value == n; },
+							[](auto const&) { return false; }
+						}, node(index));
+				}
+
+				Expression toExpression(NodeIndex index) const
+				{
+					return ArenaExpression{ dag_.arena(), index }.toExpression();
+				}
+
+				NodeIndex number(int n)
+				{
+					return dag_.intern(RationalConstant{ n });
+				}
+
+				// Constant nodes are folded by `simplify()`, so that e.g. the exponent `3 - 1` becomes `2`.
+				NodeIndex unary(UnaryFunction f, NodeIndex x)
+				{
+					if (isConstant(x))
+					{
+						return dag_.add(simplify(Expression{ UnaryFunctionExpression{ f, toExpression(x) } })).index();
+					}
+					return dag_.intern(ArenaUnaryFunctionExpression{ f, x });
+				}
+
+				NodeIndex binary(BinaryFunction f, NodeIndex x, NodeIndex y)
+				{
+					if (isConstant(x) && isConstant(y))
+					{
+						return dag_.add(simplify(Expression{
+							BinaryFunctionExpression{ f, toExpression(x), toExpression(y) } })).index();
+					}
+					return dag_.intern(ArenaBinaryFunctionExpression{ f, x, y });
+				}
+
+				// The identities of `simplify()` which occur in derivatives.
+				NodeIndex negate(NodeIndex x)
+				{
+					auto const* unaryExpr = std::get_if<ArenaUnaryFunctionExpression>(&dag_.arena().node(x));
+					if (unaryExpr && std::holds_alternative<Negative>(unaryExpr->f))
+					{
+						return unaryExpr->x;
+					}
+					return unary(Negative{ }, x);
+				}
+
+				NodeIndex add(NodeIndex x, NodeIndex y)
+				{
+					return isNumber(x, 0) ? y : isNumber(y, 0) ? x : binary(Add{ }, x, y);
+				}
+
+				NodeIndex subtract(NodeIndex x, NodeIndex y)
+				{
+					return isNumber(y, 0) ? x : binary(Subtract{ }, x, y);
+				}
+
+				NodeIndex multiply(NodeIndex x, NodeIndex y)
+				{
+					return isNumber(x, 1) ? y : isNumber(y, 1) ? x : binary(Multiply{ }, x, y);
+				}
+
+				NodeIndex divide(NodeIndex x, NodeIndex y)
+				{
+					return isNumber(y, 1) ? x : binary(Divide{ }, x, y);
+				}
+
+				NodeIndex pow(NodeIndex x, NodeIndex y)
+				{
+					return isNumber(y, 1) ? x : isNumber(y, 0) ? number(1) : binary(Pow{ }, x, y);
+				}
+
+				NodeIndex square(NodeIndex x)
+				{
+					return pow(x, number(2));
+				}
+
+				// The sum and difference of derivatives which may be zero.
+				Derivative add(Derivative x, Derivative y)
+				{
+					return !x ? y : !y ? x : add(*x, *y);
+				}
+
+				Derivative subtract(Derivative x, Derivative y)
+				{
+					return !y ? x : !x ? negate(*y) : subtract(*x, *y);
+				}
+
+				// `self` is the node `f(x)` itself, which some derivatives refer to.
+				NodeIndex differentiate(UnaryFunction f, NodeIndex self, NodeIndex x, NodeIndex dx)
+				{
+					return std::visit(
+						overload{
+							[&](Positive) { return dx; },
+							[&](Negative) { return negate(dx); },
+							[&](Sqrt) { return divide(dx, multiply(number(2), self)); },
+							[&](Exp) { return multiply(dx, self); },
+							[&](Log) { return divide(dx, x); },
+							[&](Sin) { return multiply(dx, unary(Cos{ }, x)); },
+							[&](Cos) { return negate(multiply(dx, unary(Sin{ }, x))); },
+							[&](Tan) { return divide(dx, square(unary(Cos{ }, x))); },
+							[&](ArcSin) { return divide(dx, unary(Sqrt{ }, subtract(number(1), square(x)))); },
+							[&](ArcCos) { return negate(divide(dx, unary(Sqrt{ }, subtract(number(1), square(x))))); },
+							[&](ArcTan) { return divide(dx, add(number(1), square(x))); }
+						}, f);
+				}
+
+				Derivative differentiate(BinaryFunction f, NodeIndex self, NodeIndex x, NodeIndex y, Derivative dx,
+					Derivative dy)
+				{
+					return std::visit(
+						overload{
+							[&](Add) { return add(dx, dy); },
+							[&](Subtract) { return subtract(dx, dy); },
+							[&](Multiply)
+							{
+								return add(dx ? Derivative(multiply(*dx, y)) : std::nullopt,
+									dy ? Derivative(multiply(x, *dy)) : std::nullopt);
+							},
+							[&](Divide) -> Derivative
+							{
+								if (!dy)
+								{
+									return divide(*dx, y);
+								}
+								auto numerator = subtract(dx ? Derivative(multiply(*dx, y)) : std::nullopt, multiply(x, *dy));
+								return divide(*numerator, square(y));
+							},
+							[&](Pow) -> Derivative
+							{
+								// A constant exponent does not need the logarithm of the base, which may be negative.
+								if (!dy)
+								{
+									return multiply(multiply(y, pow(x, subtract(y, number(1)))), *dx);
+								}
+								// d(x^y) = x^y * (y' log(x) + y x'/x)
+								auto inner = add(Derivative(multiply(*dy, unary(Log{ }, x))),
+									dx ? Derivative(divide(multiply(y, *dx), x)) : std::nullopt);
+								return multiply(self, *inner);
+							},
+							[&](LogBase) -> Derivative
+							{
+								// log_x(y) = log(y)/log(x), hence d(log_x(y)) = (y'/y - log_x(y) x'/x) / log(x)
+								auto numerator = subtract(dy ? Derivative(divide(*dy, y)) : std::nullopt,
+									dx ? Derivative(divide(multiply(self, *dx), x)) : std::nullopt);
+								return divide(*numerator, unary(Log{ }, x));
+							}
+						}, f);
+				}
+
+			public:
+				Differentiator(ExpressionDag& dag, std::string_view variable)
+					: dag_(dag), variable_(variable) {}
+
+				Derivative derivative(NodeIndex index)
+				{
+					if (auto it = derivatives_.find(index); it != derivatives_.end())
+					{
+						return it->second;
+					}
+					auto result = std::visit(
+						overload{
+							[this](ArenaVariable v) -> Derivative
+							{
+								if (dag_.arena().variable(v.name).name != variable_)
+								{
+									return std::nullopt;
+								}
+								return number(1);
+							},
+							[this, index](ArenaUnaryFunctionExpression const& unaryExpr) -> Derivative
+							{
+								auto dx = derivative(unaryExpr.x);
+								if (!dx)
+								{
+									return std::nullopt;
+								}
+								return differentiate(unaryExpr.f, index, unaryExpr.x, *dx);
+							},
+							[this, index](ArenaBinaryFunctionExpression const& binaryExpr) -> Derivative
+							{
+								auto dx = derivative(binaryExpr.x);
+								auto dy = derivative(binaryExpr.y);
+								if (!dx && !dy)
+								{
+									return std::nullopt;
+								}
+								return differentiate(binaryExpr.f, index, binaryExpr.x, binaryExpr.y, dx, dy);
+							},
+							[](auto const&) -> Derivative
+							{
+								return std::nullopt;
+							}
+						}, node(index));
+					derivatives_.emplace(index, result);
+					return result;
+				}
+
+				NodeIndex derivativeOrZero(NodeIndex index)
+				{
+					auto result = derivative(index);
+					return result ? *result : number(0);
+				}
+			};
+		}
+
+		Expression differentiate(Expression const& expr, std::string_view variable)
+		{
+			auto dag = ExpressionDag{ };
+			return simplify(differentiate(dag, dag.add(expr), variable).toExpression());
+		}
+
+		ArenaExpression differentiate(ExpressionDag& dag, ArenaExpression expr, std::string_view variable)
+		{
+			if (&expr.arena() != &dag.arena())
+			{
+				throw std::invalid_argument("the expression to differentiate is not stored in the DAG");
+			}
+			return { dag.arena(), Differentiator{ dag, variable }.derivativeOrZero(expr.index()) };
+		}
+	}
+}
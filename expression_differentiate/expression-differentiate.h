@@ -0,0 +1,33 @@
+#pragma once
+
+#ifndef ARITHMETIC_EXPRESSION_PARSER_EXPRESSION_DIFFERENTIATE_HPP
+#define ARITHMETIC_EXPRESSION_PARSER_EXPRESSION_DIFFERENTIATE_HPP
+
+#include <string_view>
+
+#include "expression.h"
+#include "expression-dag.h"
+
+namespace asc::cpp_practice_ws20::ex08 {
+
+	namespace expr {
+
+		// Returns the derivative of the expression by the given variable, in simplified form. Subexpressions which do
+		// not depend on the variable have the derivative zero, and terms multiplied by such a derivative are dropped
+		// rather than simplified away later. Thus the derivative may be finite where a term of the original is not.
+		//
+		// Every subexpression is differentiated only once, but since a tree cannot share subexpressions, the result may
+		// repeat subexpressions of the original, e.g. `exp(f)` in the derivative of `exp(f)^2`. To keep them shared, use
+		// the overload for an `ExpressionDag` and compile the result.
+		Expression differentiate(Expression const& expr, std::string_view variable);
+
+		// Adds the derivative of an expression stored in the DAG to the same DAG and returns a handle to its root. The
+		// derivative refers to the nodes of the original wherever possible, so it grows by at most a constant number of
+		// nodes per node of the original. The identities of `simplify()` are applied as the nodes are built, and
+		// constant subexpressions of the derivative are folded with `simplify()`.
+		// Throws `std::invalid_argument` if `expr` is not stored in `dag`.
+		ArenaExpression differentiate(ExpressionDag& dag, ArenaExpression expr, std::string_view variable);
+	}
+}
+
+#endif // !ARITHMETIC_EXPRESSION_PARSER_EXPRESSION_DIFFERENTIATE_HPP
@@ -0,0 +1,556 @@
+#include <span>
+#include <vector>
+#include <cmath>
+#include <cstdint>      // for uint32_t
+#include <algorithm>    // for fill_n(), copy_n(), min()
+#include <stdexcept>    // for invalid_argument
+
+#include "expression-gradient.h"
+#include "expression-evaluate.h"   // for BroadcastError
+#include "expression-functions.h"
+#include "vector-math.h"
+
+namespace asc::cpp_practice_ws20::ex08 {
+
+	namespace expr {
+
+		namespace {
+
+			// The instructions which computed the operands of an instruction, and whether its value depends on any
+			// variable. The partial derivatives of inactive instructions are not needed.
+			struct Operands {
+				std::uint32_t x = 0;
+				std::uint32_t y = 0;
+				bool isActive = false;
+			};
+
+			// The tape of an evaluation: one entry per instruction. `store` and `load` compute no value of their own; a
+			// `load` pushes the instruction which computed the stored value, so the adjoints of all uses of a common
+			// subexpression accumulate at that instruction.
+			struct Tape {
+				std::vector<Operands> operands;
+				std::vector<double> values;
+				std::vector<double> adjoints;
+				std::vector<std::uint32_t> stack;
+				std::vector<std::uint32_t> temporaries;
+				// The number of entries on `stack`.
+				std::size_t sp = 0;
+
+				void reset(CompiledExpression const& expr)
+				{
+					operands.resize(expr.code().size());
+					stack.resize(expr.stackSize());
+					temporaries.resize(expr.temporaryCount());
+					sp = 0;
+				}
+
+				// Links the `k`-th instruction to its operands, simulating the stack of the compiled evaluator.
+				void link(std::uint32_t k, Instruction instruction)
+				{
+					auto& entry = operands[k];
+					switch (instruction.op)
+					{
+					case OpCode::constant:
+					case OpCode::variable:
+						entry = { 0, 0, instruction.op == OpCode::variable };
+						stack[sp++] = k;
+						break;
+
+					case OpCode::add:
+					case OpCode::subtract:
+					case OpCode::multiply:
+					case OpCode::divide:
+					case OpCode::pow:
+					case OpCode::logBase:
+					{
+						auto y = stack[--sp];
+						auto x = stack[sp - 1];
+						entry = { x, y, operands[x].isActive || operands[y].isActive };
+						stack[sp - 1] = k;
+						break;
+					}
+
+					case OpCode::addVariable:
+					case OpCode::subtractVariable:
+					case OpCode::multiplyVariable:
+					case OpCode::divideVariable:
+						entry = { stack[sp - 1], 0, true };
+						stack[sp - 1] = k;
+						break;
+
+					case OpCode::store:
+						entry = { };
+						temporaries[instruction.operand] = stack[sp - 1];
+						break;
+					case OpCode::load:
+						entry = { };
+						stack[sp++] = temporaries[instruction.operand];
+						break;
+
+					default:
+						// The unary functions and the operations with a constant operand.
+						entry = { stack[sp - 1], 0, operands[stack[sp - 1]].isActive };
+						stack[sp - 1] = k;
+						break;
+					}
+				}
+
+				// The instruction which computes the result, once all instructions are linked.
+				std::uint32_t root() const
+				{
+					return stack[0];
+				}
+
+				// Links every instruction to its operands.
+				void link(CompiledExpression const& expr)
+				{
+					reset(expr);
+					auto code = expr.code();
+					for (std::uint32_t k = 0; k != code.size(); ++k)
+					{
+						link(k, code[k]);
+					}
+				}
+			};
+
+			// A tape which remembers the instructions it was linked for, so that an expression differentiated
+			// repeatedly, as in an optimisation loop, is linked only once. Comparing the instructions is much cheaper
+			// than linking them.
+			struct CachedTape : Tape {
+				std::vector<Instruction> linkedCode;
+
+				void linkIfChanged(CompiledExpression const& expr)
+				{
+					auto code = expr.code();
+					bool isLinked = std::equal(code.begin(), code.end(), linkedCode.begin(), linkedCode.end(),
+						[](Instruction lhs, Instruction rhs) { return lhs.op == rhs.op && lhs.operand == rhs.operand; });
+					if (!isLinked)
+					{
+						link(expr);
+						linkedCode.assign(code.begin(), code.end());
+					}
+				}
+			};
+
+			// The partial derivatives of `pow(base, exp)`. `pow(base, exp - 1)` is derived from the value where possible,
+			// which saves a call of `std::pow()`. A zero power does not grow with the exponent, which avoids `0 * log(0)`
+			// for a zero base.
+			double powPartialByBase(double base, double exp, double value)
+			{
+				return base != 0 && value != 0 && std::isfinite(value) ? exp * (value / base)
+					: exp * std::pow(base, exp - 1);
+			}
+
+			double powPartialByExponent(double base, double value)
+			{
+				return value == 0 ? 0 : value * std::log(base);
+			}
+		}
+
+		double evaluateGradient(CompiledExpression const& expr, std::span<double const> variableValues,
+			std::span<double> gradient)
+		{
+			auto numVariables = expr.variables().size();
+			if (variableValues.size() < numVariables || gradient.size() < numVariables)
+			{
+				throw std::invalid_argument("not enough variable values");
+			}
+
+			// The tape of this thread is reused, so repeated evaluations do not allocate.
+			thread_local CachedTape tape;
+			tape.linkIfChanged(expr);
+			auto code = expr.code();
+			auto constants = expr.constants();
+			auto const* operands = tape.operands.data();
+			tape.values.resize(code.size());
+			tape.adjoints.assign(code.size(), 0.0);
+			double* values = tape.values.data();
+			double* adjoints = tape.adjoints.data();
+
+			// The forward pass computes the same operations in the same order as `evaluate()`.
+			for (std::size_t k = 0; k != code.size(); ++k)
+			{
+				auto operand = code[k].operand;
+				double x = values[operands[k].x];
+				double y = values[operands[k].y];
+				switch (code[k].op)
+				{
+				case OpCode::constant: values[k] = constants[operand]; break;
+				case OpCode::variable: values[k] = variableValues[operand]; break;
+
+				case OpCode::negative: values[k] = evaluate(Negative{ }, x); break;
+				case OpCode::sqrt: values[k] = evaluate(Sqrt{ }, x); break;
+				case OpCode::exp: values[k] = evaluate(Exp{ }, x); break;
+				case OpCode::log: values[k] = evaluate(Log{ }, x); break;
+				case OpCode::sin: values[k] = evaluate(Sin{ }, x); break;
+				case OpCode::cos: values[k] = evaluate(Cos{ }, x); break;
+				case OpCode::tan: values[k] = evaluate(Tan{ }, x); break;
+				case OpCode::arcSin: values[k] = evaluate(ArcSin{ }, x); break;
+				case OpCode::arcCos: values[k] = evaluate(ArcCos{ }, x); break;
+				case OpCode::arcTan: values[k] = evaluate(ArcTan{ }, x); break;
+				case OpCode::square: values[k] = evaluate(Pow{ }, x, 2); break;
+
+				case OpCode::add: values[k] = evaluate(Add{ }, x, y); break;
+				case OpCode::subtract: values[k] = evaluate(Subtract{ }, x, y); break;
+				case OpCode::multiply: values[k] = evaluate(Multiply{ }, x, y); break;
+				case OpCode::divide: values[k] = evaluate(Divide{ }, x, y); break;
+				case OpCode::pow: values[k] = evaluate(Pow{ }, x, y); break;
+				case OpCode::logBase: values[k] = evaluate(LogBase{ }, x, y); break;
+
+				case OpCode::addConstant: values[k] = evaluate(Add{ }, x, constants[operand]); break;
+				case OpCode::subtractConstant: values[k] = evaluate(Subtract{ }, x, constants[operand]); break;
+				case OpCode::multiplyConstant: values[k] = evaluate(Multiply{ }, x, constants[operand]); break;
+				case OpCode::divideConstant: values[k] = evaluate(Divide{ }, x, constants[operand]); break;
+				case OpCode::addVariable: values[k] = evaluate(Add{ }, x, variableValues[operand]); break;
+				case OpCode::subtractVariable: values[k] = evaluate(Subtract{ }, x, variableValues[operand]); break;
+				case OpCode::multiplyVariable: values[k] = evaluate(Multiply{ }, x, variableValues[operand]); break;
+				case OpCode::divideVariable: values[k] = evaluate(Divide{ }, x, variableValues[operand]); break;
+
+				case OpCode::store:
+				case OpCode::load:
+					break;
+				}
+			}
+
+			// The backward pass propagates the adjoint of every active instruction to its operands.
+			auto root = tape.root();
+			std::fill_n(gradient.begin(), numVariables, 0.0);
+			adjoints[root] = 1;
+			for (std::size_t k = code.size(); k-- != 0; )
+			{
+				if (!operands[k].isActive)
+				{
+					continue;
+				}
+				auto operand = code[k].operand;
+				double a = adjoints[k];
+				double v = values[k];
+				double x = values[operands[k].x];
+				double y = values[operands[k].y];
+				double& ax = adjoints[operands[k].x];
+				double& ay = adjoints[operands[k].y];
+				switch (code[k].op)
+				{
+				case OpCode::constant: break;
+				case OpCode::variable: gradient[operand] += a; break;
+
+				case OpCode::negative: ax -= a; break;
+				case OpCode::sqrt: ax += a * 0.5 / v; break;
+				case OpCode::exp: ax += a * v; break;
+				case OpCode::log: ax += a / x; break;
+				case OpCode::sin: ax += a * std::cos(x); break;
+				case OpCode::cos: ax -= a * std::sin(x); break;
+				case OpCode::tan: ax += a * (1 + v * v); break;
+				case OpCode::arcSin: ax += a / std::sqrt(1 - x * x); break;
+				case OpCode::arcCos: ax -= a / std::sqrt(1 - x * x); break;
+				case OpCode::arcTan: ax += a / (1 + x * x); break;
+				case OpCode::square: ax += a * 2 * x; break;
+
+				case OpCode::add: ax += a; ay += a; break;
+				case OpCode::subtract: ax += a; ay -= a; break;
+				case OpCode::multiply: ax += a * y; ay += a * x; break;
+				case OpCode::divide: ax += a / y; ay -= a * v / y; break;
+				case OpCode::pow:
+					ax += a * powPartialByBase(x, y, v);
+					if (operands[operands[k].y].isActive)
+					{
+						ay += a * powPartialByExponent(x, v);
+					}
+					break;
+				case OpCode::logBase:
+				{
+					// `log(y) / log(x)`
+					double logBase = std::log(x);
+					ax -= a * v / (x * logBase);
+					ay += a / (y * logBase);
+					break;
+				}
+
+				case OpCode::addConstant: ax += a; break;
+				case OpCode::subtractConstant: ax += a; break;
+				case OpCode::multiplyConstant: ax += a * constants[operand]; break;
+				case OpCode::divideConstant: ax += a / constants[operand]; break;
+				case OpCode::addVariable: ax += a; gradient[operand] += a; break;
+				case OpCode::subtractVariable: ax += a; gradient[operand] -= a; break;
+				case OpCode::multiplyVariable: ax += a * variableValues[operand]; gradient[operand] += a * x; break;
+				case OpCode::divideVariable:
+					ax += a / variableValues[operand];
+					gradient[operand] -= a * v / variableValues[operand];
+					break;
+
+				case OpCode::store:
+				case OpCode::load:
+					break;
+				}
+			}
+			return values[root];
+		}
+
+		// Rows are differentiated in tiles of this size. The tape holds a tile for every instruction, so the tiles are
+		// smaller than those of the compiled evaluator.
+		constexpr std::size_t gradientTileSize = 128;
+
+		// Evaluates and differentiates rows `offset` to `offset + n` of a tile. `values` and `adjoints` hold a tile
+		// per instruction, and `scratch` one tile.
+		static void differentiateTile(CompiledExpression const& expr, Tape const& tape, std::uint32_t root,
+			std::span<std::span<double const> const> columns, std::size_t offset, std::size_t n,
+			double* values, double* adjoints, double* scratch, BatchGradient& result)
+		{
+			constexpr std::size_t T = gradientTileSize;
+			auto code = expr.code();
+			auto constants = expr.constants();
+			auto const* operands = tape.operands.data();
+			auto tile = [n](double* p) { return std::span<double>(p, n); };
+			auto input = [n](double const* p) { return std::span<double const>(p, n); };
+			auto column = [&columns, offset, n](std::uint32_t slot)
+			{
+				return columns[slot].size() == 1 ? columns[slot] : columns[slot].subspan(offset, n);
+			};
+			// The value of a variable in row `r` of the tile.
+			auto at = [](std::span<double const> column, std::size_t r)
+			{
+				return column.size() == 1 ? column[0] : column[r];
+			};
+
+			// The forward pass uses the array functions of the compiled evaluator, so the values agree bit for bit.
+			for (std::size_t k = 0; k != code.size(); ++k)
+			{
+				auto operand = code[k].operand;
+				auto v = tile(values + k * T);
+				auto x = input(values + operands[k].x * T);
+				auto y = input(values + operands[k].y * T);
+				auto withConstant = [&](auto f, double c) { evaluate(f, x, c, v); };
+				auto withVariable = [&](auto f)
+				{
+					auto c = column(operand);
+					if (c.size() == 1)
+					{
+						evaluate(f, x, c[0], v);
+					}
+					else
+					{
+						evaluate(f, x, c, v);
+					}
+				};
+				switch (code[k].op)
+				{
+				case OpCode::constant: std::fill_n(v.data(), n, constants[operand]); break;
+				case OpCode::variable:
+				{
+					auto c = column(operand);
+					for (std::size_t r = 0; r != n; ++r)
+					{
+						v[r] = at(c, r);
+					}
+					break;
+				}
+
+				case OpCode::negative: evaluate(Negative{ }, x, v); break;
+				case OpCode::sqrt: evaluate(Sqrt{ }, x, v); break;
+				case OpCode::exp: evaluate(Exp{ }, x, v); break;
+				case OpCode::log: evaluate(Log{ }, x, v); break;
+				case OpCode::sin: evaluate(Sin{ }, x, v); break;
+				case OpCode::cos: evaluate(Cos{ }, x, v); break;
+				case OpCode::tan: evaluate(Tan{ }, x, v); break;
+				case OpCode::arcSin: evaluate(ArcSin{ }, x, v); break;
+				case OpCode::arcCos: evaluate(ArcCos{ }, x, v); break;
+				case OpCode::arcTan: evaluate(ArcTan{ }, x, v); break;
+				case OpCode::square: withConstant(Pow{ }, 2); break;
+
+				case OpCode::add: evaluate(Add{ }, x, y, v); break;
+				case OpCode::subtract: evaluate(Subtract{ }, x, y, v); break;
+				case OpCode::multiply: evaluate(Multiply{ }, x, y, v); break;
+				case OpCode::divide: evaluate(Divide{ }, x, y, v); break;
+				case OpCode::pow: evaluate(Pow{ }, x, y, v); break;
+				case OpCode::logBase: evaluate(LogBase{ }, x, y, v); break;
+
+				case OpCode::addConstant: withConstant(Add{ }, constants[operand]); break;
+				case OpCode::subtractConstant: withConstant(Subtract{ }, constants[operand]); break;
+				case OpCode::multiplyConstant: withConstant(Multiply{ }, constants[operand]); break;
+				case OpCode::divideConstant: withConstant(Divide{ }, constants[operand]); break;
+				case OpCode::addVariable: withVariable(Add{ }); break;
+				case OpCode::subtractVariable: withVariable(Subtract{ }); break;
+				case OpCode::multiplyVariable: withVariable(Multiply{ }); break;
+				case OpCode::divideVariable: withVariable(Divide{ }); break;
+
+				case OpCode::store:
+				case OpCode::load:
+					break;
+				}
+			}
+			std::copy_n(values + root * T, n, result.values.data() + offset);
+
+			// The backward pass. The derivatives of the transcendental functions are computed by the array functions
+			// into the scratch tile.
+			std::fill_n(adjoints, code.size() * T, 0.0);
+			std::fill_n(adjoints + root * T, n, 1.0);
+			auto s0 = tile(scratch);
+			for (std::size_t k = code.size(); k-- != 0; )
+			{
+				if (!operands[k].isActive)
+				{
+					continue;
+				}
+				auto operand = code[k].operand;
+				double const* a = adjoints + k * T;
+				double const* v = values + k * T;
+				double const* x = values + operands[k].x * T;
+				double const* y = values + operands[k].y * T;
+				double* ax = adjoints + operands[k].x * T;
+				double* ay = adjoints + operands[k].y * T;
+				// The gradient of the variable an instruction refers to.
+				auto gradient = [&result, operand, offset] { return result.gradient[operand].data() + offset; };
+				auto rows = [n](auto f)
+				{
+					for (std::size_t r = 0; r != n; ++r)
+					{
+						f(r);
+					}
+				};
+				switch (code[k].op)
+				{
+				case OpCode::constant: break;
+				case OpCode::variable:
+				{
+					double* g = gradient();
+					rows([&](std::size_t r) { g[r] += a[r]; });
+					break;
+				}
+
+				case OpCode::negative: rows([&](std::size_t r) { ax[r] -= a[r]; }); break;
+				case OpCode::sqrt: rows([&](std::size_t r) { ax[r] += a[r] * 0.5 / v[r]; }); break;
+				case OpCode::exp: rows([&](std::size_t r) { ax[r] += a[r] * v[r]; }); break;
+				case OpCode::log: rows([&](std::size_t r) { ax[r] += a[r] / x[r]; }); break;
+				case OpCode::sin:
+					evaluate(Cos{ }, input(x), s0);
+					rows([&](std::size_t r) { ax[r] += a[r] * s0[r]; });
+					break;
+				case OpCode::cos:
+					evaluate(Sin{ }, input(x), s0);
+					rows([&](std::size_t r) { ax[r] -= a[r] * s0[r]; });
+					break;
+				case OpCode::tan: rows([&](std::size_t r) { ax[r] += a[r] * (1 + v[r] * v[r]); }); break;
+				case OpCode::arcSin: rows([&](std::size_t r) { ax[r] += a[r] / std::sqrt(1 - x[r] * x[r]); }); break;
+				case OpCode::arcCos: rows([&](std::size_t r) { ax[r] -= a[r] / std::sqrt(1 - x[r] * x[r]); }); break;
+				case OpCode::arcTan: rows([&](std::size_t r) { ax[r] += a[r] / (1 + x[r] * x[r]); }); break;
+				case OpCode::square: rows([&](std::size_t r) { ax[r] += a[r] * 2 * x[r]; }); break;
+
+				case OpCode::add: rows([&](std::size_t r) { ax[r] += a[r]; ay[r] += a[r]; }); break;
+				case OpCode::subtract: rows([&](std::size_t r) { ax[r] += a[r]; ay[r] -= a[r]; }); break;
+				case OpCode::multiply: rows([&](std::size_t r) { ax[r] += a[r] * y[r]; ay[r] += a[r] * x[r]; }); break;
+				case OpCode::divide:
+					rows([&](std::size_t r) { ax[r] += a[r] / y[r]; ay[r] -= a[r] * v[r] / y[r]; });
+					break;
+				case OpCode::pow:
+					rows([&](std::size_t r) { ax[r] += a[r] * powPartialByBase(x[r], y[r], v[r]); });
+					if (operands[operands[k].y].isActive)
+					{
+						// `powPartialByExponent()` with `log(base)` computed by the array function.
+						evaluate(Log{ }, input(x), s0);
+						rows([&](std::size_t r) { ay[r] += a[r] * (v[r] == 0 ? 0 : v[r] * s0[r]); });
+					}
+					break;
+				case OpCode::logBase:
+					evaluate(Log{ }, input(x), s0);
+					rows([&](std::size_t r)
+						{
+							ax[r] -= a[r] * v[r] / (x[r] * s0[r]);
+							ay[r] += a[r] / (y[r] * s0[r]);
+						});
+					break;
+
+				case OpCode::addConstant:
+				case OpCode::subtractConstant:
+					rows([&](std::size_t r) { ax[r] += a[r]; });
+					break;
+				case OpCode::multiplyConstant:
+				{
+					double c = constants[operand];
+					rows([&](std::size_t r) { ax[r] += a[r] * c; });
+					break;
+				}
+				case OpCode::divideConstant:
+				{
+					double c = constants[operand];
+					rows([&](std::size_t r) { ax[r] += a[r] / c; });
+					break;
+				}
+				case OpCode::addVariable:
+				{
+					double* g = gradient();
+					rows([&](std::size_t r) { ax[r] += a[r]; g[r] += a[r]; });
+					break;
+				}
+				case OpCode::subtractVariable:
+				{
+					double* g = gradient();
+					rows([&](std::size_t r) { ax[r] += a[r]; g[r] -= a[r]; });
+					break;
+				}
+				case OpCode::multiplyVariable:
+				{
+					double* g = gradient();
+					auto c = column(operand);
+					rows([&](std::size_t r) { ax[r] += a[r] * at(c, r); g[r] += a[r] * x[r]; });
+					break;
+				}
+				case OpCode::divideVariable:
+				{
+					double* g = gradient();
+					auto c = column(operand);
+					rows([&](std::size_t r) { ax[r] += a[r] / at(c, r); g[r] -= a[r] * v[r] / at(c, r); });
+					break;
+				}
+
+				case OpCode::store:
+				case OpCode::load:
+					break;
+				}
+			}
+		}
+
+		BatchGradient evaluateGradient(CompiledExpression const& expr,
+			std::span<std::span<double const> const> variableValues)
+		{
+			auto numVariables = expr.variables().size();
+			if (variableValues.size() < numVariables)
+			{
+				throw std::invalid_argument("not enough variable values");
+			}
+			auto columns = variableValues.first(numVariables);
+
+			// Determine the number of results. Columns with a single value are broadcast.
+			std::size_t numResults = 1;
+			bool haveLength = false;
+			for (auto column : columns)
+			{
+				if (column.size() == 1)
+				{
+					continue;
+				}
+				if (haveLength && column.size() != numResults)
+				{
+					throw BroadcastError("operands with different shapes could not be broadcast together");
+				}
+				numResults = column.size();
+				haveLength = true;
+			}
+
+			auto result = BatchGradient{ std::vector<double>(numResults),
+				std::vector<std::vector<double>>(numVariables, std::vector<double>(numResults)) };
+			auto tape = Tape{ };
+			tape.link(expr);
+			auto root = tape.root();
+			auto values = std::vector<double>(expr.code().size() * gradientTileSize);
+			auto adjoints = std::vector<double>(values.size());
+			auto scratch = std::vector<double>(gradientTileSize);
+			for (std::size_t offset = 0; offset < numResults; offset += gradientTileSize)
+			{
+				auto n = std::min(gradientTileSize, numResults - offset);
+				differentiateTile(expr, tape, root, columns, offset, n, values.data(), adjoints.data(), scratch.data(),
+					result);
+			}
+			return result;
+		}
+	}
+}
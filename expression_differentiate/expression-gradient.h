@@ -0,0 +1,43 @@
+#pragma once
+
+#ifndef ARITHMETIC_EXPRESSION_PARSER_EXPRESSION_GRADIENT_HPP
+#define ARITHMETIC_EXPRESSION_PARSER_EXPRESSION_GRADIENT_HPP
+
+#include <span>
+#include <vector>
+
+#include "expression-compile.h"
+
+namespace asc::cpp_practice_ws20::ex08 {
+
+	namespace expr {
+
+		// The values and gradients of an expression evaluated for many sets of inputs.
+		struct BatchGradient {
+			std::vector<double> values;
+
+			// `gradient[i][j]` is the partial derivative by the variable `expr.variables()[i]` in the `j`-th row.
+			std::vector<std::vector<double>> gradient;
+		};
+
+		// Evaluates a compiled expression and its gradient by reverse-mode automatic differentiation: the values of all
+		// instructions are recorded on a tape, which is then walked backwards to accumulate the partial derivatives. This
+		// costs about two evaluations, however many variables there are. The value agrees bit for bit with `evaluate()`.
+		//
+		// `variableValues[i]` is the value of the variable `expr.variables()[i]`, and `gradient[i]` is set to the
+		// partial derivative by it.
+		// Throws `std::invalid_argument` if fewer values or gradient elements than variables are given.
+		double evaluateGradient(CompiledExpression const& expr, std::span<double const> variableValues,
+			std::span<double> gradient);
+
+		// Evaluates a compiled expression and its gradient for many sets of inputs, like the corresponding `evaluate()`.
+		// The values agree bit for bit with that `evaluate()`; since both use the array functions of "vector-math.h",
+		// the gradients may differ from those of the scalar `evaluateGradient()` in the last bits.
+		// Throws `std::invalid_argument` if fewer columns than variables are given.
+		// Throws an exception of type `BroadcastError` if two columns of more than one value differ in length.
+		BatchGradient evaluateGradient(CompiledExpression const& expr,
+			std::span<std::span<double const> const> variableValues);
+	}
+}
+
+#endif // !ARITHMETIC_EXPRESSION_PARSER_EXPRESSION_GRADIENT_HPP
@@ -1,61 +1,123 @@
 #include <cmath>
+#include <atomic>
+#include <future>
+#include <chrono>
+#include <cstdint>      // for uintptr_t, uint32_t, uint64_t
+#include <utility>      // for exchange()
+#include <algorithm>    // for max(), min(), copy_n(), fill()
+#include <exception>    // for terminate()
+#include <type_traits>  // for is_same_v
 
 #include "utility.h"
+#include "thread-pool.h"
 #include "expression-evaluate.h"
+#include "expression-profile.h"
+#include "expression-functions.h"
+#include "vector-math.h"
 
 namespace asc::cpp_practice_ws20::ex08 {
 
 	namespace expr {
-		// unaryFucntion
-		double evaluate(Positive, double x) { return x; }
-		double evaluate(Negative, double x) { return -x; }
-		double evaluate(Sin, double x) { return std::sin(x); }
-		double evaluate(Cos, double x) { return std::cos(x); }
-		double evaluate(Tan, double x) { return std::tan(x); }
-		double evaluate(ArcSin, double x) { return std::asin(x); }
-		double evaluate(ArcCos, double x) { return std::acos(x); }
-		double evaluate(ArcTan, double x) { return std::atan(x); }
-		double evaluate(Exp, double x) { return std::exp(x); }
-		double evaluate(Log, double x) { return std::log(x); }
-		double evaluate(Sqrt, double x) { return std::sqrt(x); }
+		// The tree walks evaluate every node through a profiling hook, `profiling(node, evaluateNode)`, which calls
+		// `evaluateNode()` and returns its result. Without profiling, the hook does nothing else.
+		struct NoProfiling {
+			template <typename ExpressionT, typename F>
+			decltype(auto) operator()(ExpressionT const&, F&& evaluateNode) const
+			{
+				return evaluateNode();
+			}
+		};
 
-		// binaryFucntion
-		double evaluate(Add, double lhs, double rhs) { return lhs + rhs; }
-		double evaluate(Subtract, double lhs, double rhs) { return lhs - rhs; }
-		double evaluate(Multiply, double lhs, double rhs) { return lhs * rhs; }
-		double evaluate(Divide, double num, double den) { return num / den; }
-		double evaluate(Pow, double base, double exp) { return std::pow(base, exp); }
-		double evaluate(LogBase, double base, double val) { return std::log(val) / std::log(base); }
+		constexpr auto noProfiling = NoProfiling{ };
 
-		constexpr double evaluate(RationalConstant c)
-		{
-			return boost::rational_cast<double>(c.value);
-		}
+		// The profiling hook of the vectorized evaluation: times every node, and subtracts the times of its subexpressions, which are timed
+		// themselves, and the cost of the hook to get its self time. The total time of a node is its self time plus
+		// the total times of its subexpressions, so neither includes the overhead of profiling, and the self times of
+		// all nodes add up to the total time of the root.
+		class NodeProfiler {
+		private:
+			// The cost of the hook, estimated once by `calibrate()`.
+			struct Overhead {
+				// The time a node measures besides its evaluation: the part of its clock reads between them.
+				std::uint64_t nodeNanoseconds = 0;
 
-		constexpr double evaluate(RealConstant c)
-		{
-			return c.value;
-		}
+				// The time the hook of a subexpression adds to the time its parent measures, besides the time the
+				// subexpression measures: the rest of the clock reads, recording in the profile and the calls around them.
+				std::uint64_t childNanoseconds = 0;
+			};
 
-		constexpr double evaluate(NamedConstant c)
-		{
-			switch (c)
+			// The subexpressions of the node being evaluated, so far.
+			struct Children {
+				std::uint64_t totalNanoseconds = 0;
+
+				// The time the parent measures for them besides their total times, including that of their own
+				// subexpressions.
+				std::uint64_t overheadNanoseconds = 0;
+			};
+
+			EvaluationProfile& profile_;
+			Overhead overhead_;
+			Children children_;
+
+			// The total time of the node evaluated last, which is the root once the evaluation is complete.
+			std::uint64_t lastNanoseconds_ = 0;
+
+			NodeProfiler(EvaluationProfile& profile, Overhead overhead)
+				: profile_(profile), overhead_(overhead)
 			{
-			case NamedConstant::e: return 2.71828182845904523536;
-			case NamedConstant::pi: return 3.14159265358979323846;
 			}
-			std::terminate();
-		}
 
-		double evaluate(
-				Expression const& expr,
-				std::unordered_map<std::string, double> const& variableSubsitituions)
+			static Overhead calibrate();
+
+		public:
+			explicit NodeProfiler(EvaluationProfile& profile)
+				: profile_(profile)
+			{
+				static Overhead const overhead = calibrate();
+				overhead_ = overhead;
+			}
+
+			template <typename F>
+			auto operator()(Expression const& node, F&& evaluateNode)
+			{
+				auto outerChildren = std::exchange(children_, { });
+				auto start = std::chrono::steady_clock::now();
+				auto result = evaluateNode();
+				auto stop = std::chrono::steady_clock::now();
+				auto measuredNanoseconds = std::uint64_t(std::chrono::nanoseconds(stop - start).count());
+				auto overhead = children_.totalNanoseconds + children_.overheadNanoseconds + overhead_.nodeNanoseconds;
+				auto selfNanoseconds = measuredNanoseconds > overhead ? measuredNanoseconds - overhead : 0;
+				auto totalNanoseconds = selfNanoseconds + children_.totalNanoseconds;
+				profile_.record(node, 1, totalNanoseconds, selfNanoseconds);
+				lastNanoseconds_ = totalNanoseconds;
+				children_ = {
+					outerChildren.totalNanoseconds + totalNanoseconds,
+					outerChildren.overheadNanoseconds + overhead_.childNanoseconds
+						+ (measuredNanoseconds > totalNanoseconds ? measuredNanoseconds - totalNanoseconds : 0) };
+				return result;
+			}
+
+			void finish()
+			{
+				profile_.recordRoot(lastNanoseconds_);
+			}
+		};
+
+		// The scalar tree walk is shared by the `unique_ptr<>`-based tree and the arena representation.
+		template <typename ExpressionT, typename Profiling>
+		double evaluateScalar(
+				ExpressionT const& expr,
+				std::unordered_map<std::string, double> const& variableSubsitituions,
+				Profiling& profiling)
 		{
-			return std::visit(
+			using Traits = ExpressionTraits<ExpressionT>;
+
+			return profiling(expr, [&] { return std::visit(
 				overload{
-					[&variableSubsitituions]
-					(Variable const& v)
+					[&expr, &variableSubsitituions]
+					(typename Traits::VariableType const& var)
 					{
+						auto const& v = variable(expr, var);
 						auto it = variableSubsitituions.find(v.name);
 						if (it == variableSubsitituions.end())
 						{
@@ -64,11 +126,11 @@ namespace asc::cpp_practice_ws20::ex08 {
 						return it->second;
 					},
 
-					[&variableSubsitituions]
-					(UnaryFunctionExpression const& unaryExpr)
+					[&expr, &variableSubsitituions, &profiling]
+					(typename Traits::UnaryFunctionExpressionType const& unaryExpr)
 					{
 						return std::visit(
-						[x = evaluate(unaryExpr.x, variableSubsitituions)]
+						[x = evaluateScalar(subexpression(expr, unaryExpr.x), variableSubsitituions, profiling)]
 						(auto f)
 						{
 							return evaluate(f, x);
@@ -76,12 +138,12 @@ namespace asc::cpp_practice_ws20::ex08 {
 						unaryExpr.f);
 					},
 
-					[&variableSubsitituions]
-					(BinaryFunctionExpression const& binaryExpr)
+					[&expr, &variableSubsitituions, &profiling]
+					(typename Traits::BinaryFunctionExpressionType const& binaryExpr)
 					{
 						return std::visit(
-							[x = evaluate(binaryExpr.x, variableSubsitituions),
-							 y = evaluate(binaryExpr.y, variableSubsitituions)]
+							[x = evaluateScalar(subexpression(expr, binaryExpr.x), variableSubsitituions, profiling),
+							 y = evaluateScalar(subexpression(expr, binaryExpr.y), variableSubsitituions, profiling)]
 							(auto f)
 							{
 								return evaluate(f, x, y);
@@ -94,9 +156,341 @@ namespace asc::cpp_practice_ws20::ex08 {
 					{
 						return evaluate(c);
 					}
+				}, expr.value()); });
+		}
+
+		// The step of the scalar tree walk at a single node, given the values `x` and `y` of its subexpressions, if it
+		// has any: the dispatch on the kind of the node and its function, a variable lookup or a constant.
+		double evaluateStep(
+				Expression const& expr,
+				std::unordered_map<std::string, double> const& variableSubsitituions,
+				double x, double y)
+		{
+			return std::visit(
+				overload{
+					[&variableSubsitituions](Variable const& var)
+					{
+						auto it = variableSubsitituions.find(var.name);
+						if (it == variableSubsitituions.end())
+						{
+							throw UnknownVariableValue(var.name, "No value given for variable.");
+						}
+						return it->second;
+					},
+					[x](UnaryFunctionExpression const& unaryExpr)
+					{
+						return std::visit([x](auto f) { return evaluate(f, x); }, unaryExpr.f);
+					},
+					[x, y](BinaryFunctionExpression const& binaryExpr)
+					{
+						return std::visit([x, y](auto f) { return evaluate(f, x, y); }, binaryExpr.f);
+					},
+					[](auto const& c)
+					{
+						return evaluate(c);
+					}
 				}, expr.value());
 		}
 
+		// The profiled scalar tree walk. A scalar node takes a few nanoseconds, about as long as a clock read, so a
+		// single evaluation cannot be timed. Instead, once the subexpressions of a node are evaluated, its step is
+		// repeated `repetitions` times, in chunks of `chunkSize` steps between two clock reads, and the fastest chunk
+		// counts, which is the one least disturbed by interrupts and other threads. The cost of the clock reads and the
+		// loop is measured by timing empty chunks when the profiler is created, and subtracted. Timing the step alone,
+		// rather than the whole subexpression and subtracting the times of its subexpressions, avoids taking the
+		// difference of much larger times, which would leave little but noise for a cheap node.
+		//
+		// The processor overlaps the steps of independent subexpressions, and of repeated steps, so the step times do
+		// not add up to the time of the whole evaluation. The whole evaluation is timed the same way, and the step
+		// times are scaled to add up to it.
+		class ScalarProfiler {
+		private:
+			static constexpr std::uint64_t chunkSize = 16;
+
+			EvaluationProfile& profile_;
+			std::unordered_map<std::string, double> const& variableSubstitutions_;
+			std::uint64_t numChunks_;
+
+			// The time of an empty chunk.
+			double overheadNanoseconds_;
+
+			// The time of a single step of every node, in the order `evaluateSteps()` visits them.
+			std::vector<double> stepNanoseconds_;
+
+			// Returns the least time of the chunks, in nanoseconds, of evaluating `evaluateOnce()` `chunkSize` times.
+			template <typename F>
+			double fastestChunkNanoseconds(F&& evaluateOnce) const
+			{
+				[[maybe_unused]] double volatile sink = 0;     // so that the evaluations are not optimized away
+				auto fastest = std::chrono::steady_clock::duration::max();
+				for (std::uint64_t chunk = 0; chunk != numChunks_; ++chunk)
+				{
+					auto start = std::chrono::steady_clock::now();
+					for (std::uint64_t i = 0; i != chunkSize; ++i)
+					{
+						sink = evaluateOnce();
+					}
+					fastest = std::min(fastest, std::chrono::steady_clock::now() - start);
+				}
+				return double(std::chrono::nanoseconds(fastest).count());
+			}
+
+			// Returns the time of a single evaluation of `evaluateOnce()`, in nanoseconds.
+			template <typename F>
+			double evaluationNanoseconds(F&& evaluateOnce) const
+			{
+				return std::max(fastestChunkNanoseconds(evaluateOnce) - overheadNanoseconds_, 0.0) / double(chunkSize);
+			}
+
+			// Evaluates the subexpressions of a node and then the node, and times the step of each.
+			double evaluateSteps(Expression const& expr)
+			{
+				double x = 0;
+				double y = 0;
+				std::visit(
+					overload{
+						[&](UnaryFunctionExpression const& unaryExpr)
+						{
+							x = evaluateSteps(unaryExpr.x);
+						},
+						[&](BinaryFunctionExpression const& binaryExpr)
+						{
+							x = evaluateSteps(binaryExpr.x);
+							y = evaluateSteps(binaryExpr.y);
+						},
+						[](auto const&) { }
+					}, expr.value());
+
+				auto evaluateOnce = [&] { return evaluateStep(expr, variableSubstitutions_, x, y); };
+				double result = evaluateOnce();
+				stepNanoseconds_.push_back(evaluationNanoseconds(evaluateOnce));
+				return result;
+			}
+
+			// Records the step times of a node and its subexpressions, multiplied by `scale`, visiting them in the
+			// order of `evaluateSteps()`, and returns the total time of the node.
+			std::uint64_t recordSteps(Expression const& expr, std::size_t& step, double scale)
+			{
+				std::uint64_t childrenNanoseconds = 0;
+				std::visit(
+					overload{
+						[&](UnaryFunctionExpression const& unaryExpr)
+						{
+							childrenNanoseconds = recordSteps(unaryExpr.x, step, scale);
+						},
+						[&](BinaryFunctionExpression const& binaryExpr)
+						{
+							childrenNanoseconds = recordSteps(binaryExpr.x, step, scale);
+							childrenNanoseconds += recordSteps(binaryExpr.y, step, scale);
+						},
+						[](auto const&) { }
+					}, expr.value());
+
+				auto selfNanoseconds = std::uint64_t(std::llround(stepNanoseconds_[step++] * scale));
+				auto totalNanoseconds = selfNanoseconds + childrenNanoseconds;
+				profile_.record(expr, repetitions(), totalNanoseconds, selfNanoseconds);
+				return totalNanoseconds;
+			}
+
+		public:
+			ScalarProfiler(EvaluationProfile& profile,
+				std::unordered_map<std::string, double> const& variableSubstitutions, std::size_t repetitions)
+				: profile_(profile), variableSubstitutions_(variableSubstitutions),
+				  numChunks_(std::max<std::uint64_t>((repetitions + chunkSize - 1) / chunkSize, 1)),
+				  overheadNanoseconds_(fastestChunkNanoseconds([] { return 0.0; }))
+			{
+			}
+
+			// The number of evaluations of every node recorded per evaluation of the root.
+			std::uint64_t repetitions() const noexcept { return numChunks_ * chunkSize; }
+
+			double evaluate(Expression const& expr)
+			{
+				double result = evaluateSteps(expr);
+				double wholeNanoseconds = evaluationNanoseconds(
+					[&] { return evaluateScalar(expr, variableSubstitutions_, noProfiling); });
+				double stepsNanoseconds = 0;
+				for (double nanoseconds : stepNanoseconds_)
+				{
+					stepsNanoseconds += nanoseconds;
+				}
+				double scale = stepsNanoseconds > 0 ? wholeNanoseconds / stepsNanoseconds * double(repetitions()) : 0.0;
+				std::size_t step = 0;
+				profile_.recordRoot(recordSteps(expr, step, scale));
+				return result;
+			}
+		};
+
+		// A balanced tree of additions of constants, whose evaluation is about as cheap as evaluation gets.
+		Expression calibrationTree(int depth)
+		{
+			if (depth == 0)
+			{
+				return Expression{ RationalConstant{ 1 } };
+			}
+			return Expression{ BinaryFunctionExpression{ Add{ }, calibrationTree(depth - 1), calibrationTree(depth - 1) } };
+		}
+
+		// Evaluates a tree once without the overhead of the hook, and once with it, which is all the root measures,
+		// and takes the least time of several rounds, which is the one least disturbed by interrupts and other threads.
+		// The measured time of a constant is its evaluation and `nodeNanoseconds`, which every node measures, so the
+		// remaining difference is `childNanoseconds` for each node but the root.
+		NodeProfiler::Overhead NodeProfiler::calibrate()
+		{
+			constexpr int depth = 5;
+			constexpr std::uint64_t numNodes = (std::uint64_t(1) << (depth + 1)) - 1;
+			constexpr int numRounds = 20;
+			constexpr std::uint64_t numEvaluations = 100;
+			auto const tree = calibrationTree(depth);
+			auto const constant = Expression{ RationalConstant{ 1 } };
+			auto const noVariables = std::unordered_map<std::string, double>{ };
+
+			[[maybe_unused]] double volatile sink = 0;     // so that the unprofiled evaluation is not optimized away
+			auto plainNanoseconds = ~std::uint64_t(0);
+			auto profiledNanoseconds = ~std::uint64_t(0);
+			auto constantNanoseconds = ~std::uint64_t(0);
+			for (int round = 0; round != numRounds; ++round)
+			{
+				auto start = std::chrono::steady_clock::now();
+				for (std::uint64_t i = 0; i != numEvaluations; ++i)
+				{
+					sink = evaluateScalar(tree, noVariables, noProfiling);
+				}
+				plainNanoseconds = std::min(plainNanoseconds,
+					std::uint64_t(std::chrono::nanoseconds(std::chrono::steady_clock::now() - start).count()));
+
+				// Without an overhead to subtract, the total time of every node is the time it measures.
+				auto profile = EvaluationProfile{ };
+				auto profiler = NodeProfiler(profile, { });
+				for (std::uint64_t i = 0; i != numEvaluations; ++i)
+				{
+					evaluateScalar(tree, noVariables, profiler);
+					evaluateScalar(constant, noVariables, profiler);
+				}
+				profiledNanoseconds = std::min(profiledNanoseconds, profile.find(tree).totalNanoseconds);
+				constantNanoseconds = std::min(constantNanoseconds, profile.find(constant).totalNanoseconds);
+			}
+
+			auto overhead = Overhead{ };
+			auto plainConstantNanoseconds = plainNanoseconds / numNodes;
+			overhead.nodeNanoseconds = constantNanoseconds > plainConstantNanoseconds
+				? (constantNanoseconds - plainConstantNanoseconds) / numEvaluations : 0;
+			auto rootOverhead = plainNanoseconds + overhead.nodeNanoseconds * numNodes * numEvaluations;
+			overhead.childNanoseconds = profiledNanoseconds > rootOverhead
+				? (profiledNanoseconds - rootOverhead) / (numEvaluations * (numNodes - 1)) : 0;
+			return overhead;
+		}
+
+		// Counts, for each node reachable from an arena expression, the parents referring to it, plus one for the expression
+		// itself; `uses[i]` is 0 for the other nodes. Nodes are stored in post-order, so no node reachable from the
+		// expression has a larger index, and parents precede their children in a single backward pass.
+		static void countUses(ArenaExpression const& expr, std::vector<std::uint32_t>& uses)
+		{
+			auto root = expr.index();
+			uses.assign(std::size_t(root) + 1, 0);
+			uses[root] = 1;
+			for (NodeIndex i = root + 1; i-- != 0; )
+			{
+				if (uses[i] == 0)
+				{
+					continue;
+				}
+				std::visit(
+					overload{
+						[&uses](ArenaUnaryFunctionExpression const& unaryExpr)
+						{
+							++uses[unaryExpr.x];
+						},
+						[&uses](ArenaBinaryFunctionExpression const& binaryExpr)
+						{
+							++uses[binaryExpr.x];
+							++uses[binaryExpr.y];
+						},
+						[](auto const&) { }
+					},
+					expr.arena().node(i));
+			}
+		}
+
+		double evaluate(
+				Expression const& expr,
+				std::unordered_map<std::string, double> const& variableSubsitituions)
+		{
+			return evaluateScalar(expr, variableSubsitituions, noProfiling);
+		}
+
+		double evaluate(
+				ArenaExpression const& expr,
+				std::unordered_map<std::string, double> const& variableSubsitituions)
+		{
+			auto const& arena = expr.arena();
+			auto root = expr.index();
+
+			// The use counts and values are kept in scratch space of the calling thread, so that they need no memory once
+			// it has grown to the size of the arena.
+			thread_local std::vector<std::uint32_t> uses;
+			thread_local std::vector<double> values;
+			countUses(expr, uses);
+			if (values.size() < uses.size())
+			{
+				values.resize(uses.size());
+			}
+
+			// Children precede their parents, so their values are known when a parent is evaluated.
+			bool hasMissingValue = false;
+			for (NodeIndex i = 0; i <= root && !hasMissingValue; ++i)
+			{
+				if (uses[i] == 0)
+				{
+					continue;
+				}
+				values[i] = std::visit(
+					overload{
+						[&](ArenaVariable v)
+						{
+							auto it = variableSubsitituions.find(arena.variable(v.name).name);
+							if (it == variableSubsitituions.end())
+							{
+								hasMissingValue = true;
+								return 0.0;
+							}
+							return it->second;
+						},
+						[](ArenaUnaryFunctionExpression const& unaryExpr)
+						{
+							return std::visit([x = values[unaryExpr.x]](auto f) { return evaluate(f, x); }, unaryExpr.f);
+						},
+						[](ArenaBinaryFunctionExpression const& binaryExpr)
+						{
+							return std::visit(
+								[x = values[binaryExpr.x], y = values[binaryExpr.y]](auto f) { return evaluate(f, x, y); },
+								binaryExpr.f);
+						},
+						[](auto const& c)
+						{
+							return evaluate(c);
+						}
+					},
+					arena.node(i));
+			}
+			if (hasMissingValue)
+			{
+				// The tree walk throws for the first variable without a value in the order of evaluation, which need not
+				// be the first one in the order of storage.
+				return evaluateScalar(expr, variableSubsitituions, noProfiling);
+			}
+			return values[root];
+		}
+
+		double evaluate(
+				Expression const& expr,
+				std::unordered_map<std::string, double> const& variableSubsitituions,
+				EvaluationProfile& profile,
+				std::size_t repetitions)
+		{
+			return ScalarProfiler(profile, variableSubsitituions, repetitions).evaluate(expr);
+		}
+
 
 		using IntermediaryResult = std::variant<
 			double, // scalar value
@@ -114,12 +508,7 @@ namespace asc::cpp_practice_ws20::ex08 {
 		{
 			// Allocate a result vector.
 			auto result = std::vector<double>(x.size());
-
-			// Plain loops such as this one are trivial to vectorize.
-			for (std::size_t i = 0, n = std::ssize(x); i != n; ++i)
-			{
-				result[i] = evaluate(f, x[i]);
-			}
+			evaluate(f, x, std::span<double>(result));
 			return result;
 		}
 
@@ -127,10 +516,7 @@ namespace asc::cpp_practice_ws20::ex08 {
 		IntermediaryResult evaluateUnaryFunction(F f, std::vector<double> x)
 		{
 			// Reuse vector `x` to save an allocation.
-			for (std::size_t i = 0, n = std::ssize(x); i != n; ++i)
-			{
-				x[i] = evaluate(f, x[i]);
-			}
+			evaluate(f, std::span<double const>(x), std::span<double>(x));
 			return x;
 		}
 
@@ -145,10 +531,7 @@ namespace asc::cpp_practice_ws20::ex08 {
 		{
 			// Allocate a result vector. Broadcast the scalar value `y`.
 			auto result = std::vector<double>(x.size());
-			for (std::size_t i = 0, n = std::ssize(x); i != n; ++i)
-			{
-				result[i] = evaluate(f, x[i], y);
-			}
+			evaluate(f, x, y, std::span<double>(result));
 			return result;
 		}
 
@@ -157,10 +540,7 @@ namespace asc::cpp_practice_ws20::ex08 {
 		{
 			// Allocate a result vector. Broadcast the scalar value `x`.
 			auto result = std::vector<double>(y.size());
-			for (std::size_t i = 0, n = std::ssize(y); i != n; ++i)
-			{
-				result[i] = evaluate(f, x, y[i]);
-			}
+			evaluate(f, x, y, std::span<double>(result));
 			return result;
 		}
 
@@ -168,10 +548,7 @@ namespace asc::cpp_practice_ws20::ex08 {
 		IntermediaryResult evaluateBinaryFunction(F f, std::vector<double> x, double y)
 		{
 			// Reuse vector `x` to save an allocation. Broadcast the scalar value `y`.
-			for (std::size_t i = 0, n = std::ssize(x); i != n; ++i)
-			{
-				x[i] = evaluate(f, x[i], y);
-			}
+			evaluate(f, std::span<double const>(x), y, std::span<double>(x));
 			return x;
 		}
 
@@ -179,10 +556,7 @@ namespace asc::cpp_practice_ws20::ex08 {
 		IntermediaryResult evaluateBinaryFunction(F f, double x, std::vector<double> y)
 		{
 			// Reuse vector `y` to save an allocation. Broadcast the scalar value `x`.
-			for (std::size_t i = 0, n = std::ssize(y); i != n; ++i)
-			{
-				y[i] = evaluate(f, x, y[i]);
-			}
+			evaluate(f, x, std::span<double const>(y), std::span<double>(y));
 			return y;
 		}
 
@@ -217,10 +591,7 @@ namespace asc::cpp_practice_ws20::ex08 {
 
 			// Allocate a result vector.
 			auto result = std::vector<double>(x.size());
-			for (std::size_t i = 0, n = std::ssize(x); i != n; ++i)
-			{
-				result[i] = evaluate(f, x[i], y[i]);
-			}
+			evaluate(f, x, y, std::span<double>(result));
 			return result;
 		}
 
@@ -234,10 +605,7 @@ namespace asc::cpp_practice_ws20::ex08 {
 			}
 
 			// Reuse vector `x` to save an allocation.
-			for (std::size_t i = 0, n = std::ssize(x); i != n; ++i)
-			{
-				x[i] = evaluate(f, x[i], y[i]);
-			}
+			evaluate(f, std::span<double const>(x), std::span<double const>(y), std::span<double>(x));
 			return x;
 		}
 
@@ -251,10 +619,7 @@ namespace asc::cpp_practice_ws20::ex08 {
 			}
 
 			// Reuse vector `y` to save an allocation.
-			for (std::size_t i = 0, n = std::ssize(x); i != n; ++i)
-			{
-				y[i] = evaluate(f, x[i], y[i]);
-			}
+			evaluate(f, x, std::span<double const>(y), std::span<double>(y));
 			return y;
 		}
 
@@ -274,15 +639,20 @@ namespace asc::cpp_practice_ws20::ex08 {
 				std::forward<U>(u));
 		}
 
+		template <typename ExpressionT, typename Profiling>
 		IntermediaryResult evaluateImpl(
-				Expression const& expression,
-				std::unordered_map<std::string, VariableSubstitution> const& variableSubstitutions)
+				ExpressionT const& expression,
+				std::unordered_map<std::string, VariableSubstitution> const& variableSubstitutions,
+				Profiling& profiling)
 		{
-			return std::visit<IntermediaryResult>(
+			using Traits = ExpressionTraits<ExpressionT>;
+
+			return profiling(expression, [&] { return std::visit<IntermediaryResult>(
 				overload{
-					[&variableSubstitutions]
-					(Variable const& v)
+					[&expression, &variableSubstitutions]
+					(typename Traits::VariableType const& var)
 					{
+						auto const& v = variable(expression, var);
 						auto it = variableSubstitutions.find(v.name);
 						if (it == variableSubstitutions.end())
 						{
@@ -291,10 +661,10 @@ namespace asc::cpp_practice_ws20::ex08 {
 						return variant_cast<IntermediaryResult>(it->second);
 					},
 
-					[&variableSubstitutions]
-					(UnaryFunctionExpression const& unaryExpr)
+					[&expression, &variableSubstitutions, &profiling]
+					(typename Traits::UnaryFunctionExpressionType const& unaryExpr)
 					{
-						auto xV = evaluateImpl(unaryExpr.x, variableSubstitutions);
+						auto xV = evaluateImpl(subexpression(expression, unaryExpr.x), variableSubstitutions, profiling);
 						return std::visit(
 							[](auto f, auto x)
 							{
@@ -303,11 +673,11 @@ namespace asc::cpp_practice_ws20::ex08 {
 							unaryExpr.f, std::move(xV));
 					},
 
-					[&variableSubstitutions]
-					(BinaryFunctionExpression const& binaryExpr)
+					[&expression, &variableSubstitutions, &profiling]
+					(typename Traits::BinaryFunctionExpressionType const& binaryExpr)
 					{
-						auto xV = evaluateImpl(binaryExpr.x, variableSubstitutions);
-						auto yV = evaluateImpl(binaryExpr.y, variableSubstitutions);
+						auto xV = evaluateImpl(subexpression(expression, binaryExpr.x), variableSubstitutions, profiling);
+						auto yV = evaluateImpl(subexpression(expression, binaryExpr.y), variableSubstitutions, profiling);
 						return std::visit(
 							[](auto f, auto x, auto y)
 							{
@@ -322,14 +692,747 @@ namespace asc::cpp_practice_ws20::ex08 {
 						return evaluate(c);
 					},
 				},
-				expression.value());
+				expression.value()); });
 		}
 
-		EvaluationResult evaluate(
-				Expression const& expression,
+		// The value of a subexpression in the buffer-planned evaluator: a scalar, which is broadcast, an array given as a
+		// variable substitution, or one of the planned buffers.
+		struct PlannedOperand
+		{
+			enum class Kind { scalar, array, buffer };
+
+			Kind kind;
+			double scalar = 0;
+			std::span<double const> array{ };
+			std::size_t buffer = 0;
+		};
+
+		// An operation of the buffer-planned evaluator, which writes its result to a buffer.
+		struct PlannedStep
+		{
+			bool isUnary = false;
+			UnaryFunction unaryFunction = Positive{ };
+			BinaryFunction binaryFunction = Add{ };
+			PlannedOperand x{ };
+			PlannedOperand y{ };
+			std::size_t result = 0;
+		};
+
+		// Assigns the intermediate values of an expression to buffers of full length, as a register allocator does.
+		// Every intermediate value of a tree is used once, so it is live from the operation computing it to the
+		// operation using it, at which point its buffer is free again, and the result of that operation may take it.
+		// A subexpression shared in a DAG is evaluated once, and its buffer is free once its last parent has used it.
+		// Operands needing more buffers are evaluated first (Sethi-Ullman ordering), which minimizes the number of
+		// buffers live at the same time. Errors are detected in the same order as `evaluateImpl()` detects them.
+		class BufferPlan
+		{
+		private:
+			// A subexpression after variable lookup, with subexpressions without arrays evaluated.
+			struct Node
+			{
+				PlannedOperand value;  // the value of a leaf; a `buffer` for an operation
+				bool isUnary = false;
+				UnaryFunction unaryFunction = Positive{ };
+				BinaryFunction binaryFunction = Add{ };
+				std::size_t x = 0;
+				std::size_t y = 0;
+				std::size_t length = 0;
+				std::size_t numBuffers = 0;  // the number of buffers live at the same time while evaluating the node
+				std::size_t uses = 1;  // the number of parents which have not used the value yet
+				bool isScheduled = false;
+			};
+
+			static constexpr std::size_t notAdded = std::size_t(-1);
+
+			std::vector<Node> nodes_;
+			std::vector<std::size_t> arenaNodes_;  // for an arena expression, the node added for each arena node
+			std::vector<PlannedStep> steps_;
+			PlannedOperand result_;
+			std::size_t length_ = 0;
+			std::size_t numBuffers_ = 0;
+			std::vector<std::size_t> freeBuffers_;
+
+			static bool isArray(Node const& node) noexcept
+			{
+				return node.value.kind != PlannedOperand::Kind::scalar;
+			}
+
+			template <typename ExpressionT>
+			std::size_t add(ExpressionT const& expression,
 				std::unordered_map<std::string, VariableSubstitution> const& variableSubstitutions)
+			{
+				using Traits = ExpressionTraits<ExpressionT>;
+
+				if constexpr (std::is_same_v<ExpressionT, ArenaExpression>)
+				{
+					if (auto index = arenaNodes_[expression.index()]; index != notAdded)
+					{
+						++nodes_[index].uses;
+						return index;
+					}
+				}
+
+				auto node = std::visit(
+					overload{
+						[&expression, &variableSubstitutions]
+						(typename Traits::VariableType const& var)
+						{
+							auto const& v = variable(expression, var);
+							auto it = variableSubstitutions.find(v.name);
+							if (it == variableSubstitutions.end())
+							{
+								throw UnknownVariableValue(v.name, "No value given for variable");
+							}
+							if (auto span = std::get_if<std::span<double const> >(&it->second))
+							{
+								return Node{ .value = { .kind = PlannedOperand::Kind::array, .array = *span },
+									.length = span->size() };
+							}
+							return Node{ .value = { .kind = PlannedOperand::Kind::scalar,
+								.scalar = std::get<double>(it->second) } };
+						},
+
+						[this, &expression, &variableSubstitutions]
+						(typename Traits::UnaryFunctionExpressionType const& unaryExpr)
+						{
+							auto xIndex = add(subexpression(expression, unaryExpr.x), variableSubstitutions);
+							auto const& x = nodes_[xIndex];
+							if (!isArray(x))
+							{
+								return Node{ .value = { .kind = PlannedOperand::Kind::scalar, .scalar = std::visit(
+									[&x](auto f) { return evaluate(f, x.value.scalar); }, unaryExpr.f) } };
+							}
+							return Node{ .value = { .kind = PlannedOperand::Kind::buffer }, .isUnary = true,
+								.unaryFunction = unaryExpr.f, .x = xIndex, .length = x.length,
+								.numBuffers = std::max<std::size_t>(x.numBuffers, 1) };
+						},
+
+						[this, &expression, &variableSubstitutions]
+						(typename Traits::BinaryFunctionExpressionType const& binaryExpr)
+						{
+							auto xIndex = add(subexpression(expression, binaryExpr.x), variableSubstitutions);
+							auto yIndex = add(subexpression(expression, binaryExpr.y), variableSubstitutions);
+							auto const& x = nodes_[xIndex];
+							auto const& y = nodes_[yIndex];
+							if (!isArray(x) && !isArray(y))
+							{
+								return Node{ .value = { .kind = PlannedOperand::Kind::scalar, .scalar = std::visit(
+									[&x, &y](auto f) { return evaluate(f, x.value.scalar, y.value.scalar); },
+									binaryExpr.f) } };
+							}
+							if (isArray(x) && isArray(y) && x.length != y.length)
+							{
+								throw BroadcastError("operands with different shapes could not be broadcast together");
+							}
+
+							// The operand evaluated first holds its buffer while the other one is evaluated.
+							auto const& first = y.numBuffers > x.numBuffers ? y : x;
+							auto const& second = y.numBuffers > x.numBuffers ? x : y;
+							std::size_t firstHeld = first.value.kind == PlannedOperand::Kind::buffer ? 1 : 0;
+							return Node{ .value = { .kind = PlannedOperand::Kind::buffer },
+								.binaryFunction = binaryExpr.f, .x = xIndex, .y = yIndex,
+								.length = isArray(x) ? x.length : y.length,
+								.numBuffers = std::max({ first.numBuffers, firstHeld + second.numBuffers, std::size_t(1) }) };
+						},
+
+						[]
+						(auto const& c)
+						{
+							return Node{ .value = { .kind = PlannedOperand::Kind::scalar, .scalar = evaluate(c) } };
+						}
+					},
+					expression.value());
+				nodes_.push_back(node);
+				if constexpr (std::is_same_v<ExpressionT, ArenaExpression>)
+				{
+					arenaNodes_[expression.index()] = nodes_.size() - 1;
+				}
+				return nodes_.size() - 1;
+			}
+
+			// Called when a parent of a node has used its value.
+			void release(std::size_t index)
+			{
+				auto& node = nodes_[index];
+				if (--node.uses == 0 && node.value.kind == PlannedOperand::Kind::buffer)
+				{
+					freeBuffers_.push_back(node.value.buffer);
+				}
+			}
+
+			std::size_t acquire()
+			{
+				if (freeBuffers_.empty())
+				{
+					return numBuffers_++;
+				}
+				auto buffer = freeBuffers_.back();
+				freeBuffers_.pop_back();
+				return buffer;
+			}
+
+			// Appends the steps evaluating a node in post-order and returns the node's value.
+			PlannedOperand schedule(std::size_t index)
+			{
+				auto node = nodes_[index];
+				if (node.value.kind != PlannedOperand::Kind::buffer || node.isScheduled)
+				{
+					return node.value;
+				}
+
+				auto step = PlannedStep{ .isUnary = node.isUnary, .unaryFunction = node.unaryFunction,
+					.binaryFunction = node.binaryFunction };
+				if (node.isUnary)
+				{
+					step.x = schedule(node.x);
+				}
+				else if (nodes_[node.y].numBuffers > nodes_[node.x].numBuffers)
+				{
+					step.y = schedule(node.y);
+					step.x = schedule(node.x);
+				}
+				else
+				{
+					step.x = schedule(node.x);
+					step.y = schedule(node.y);
+				}
+
+				// The operands die here unless they are shared, so the result may overwrite one of them.
+				release(node.x);
+				if (!node.isUnary)
+				{
+					release(node.y);
+				}
+				step.result = acquire();
+				steps_.push_back(step);
+				nodes_[index].value.buffer = step.result;
+				nodes_[index].isScheduled = true;
+				return nodes_[index].value;
+			}
+
+		public:
+			template <typename ExpressionT>
+			BufferPlan(ExpressionT const& expression,
+				std::unordered_map<std::string, VariableSubstitution> const& variableSubstitutions)
+			{
+				if constexpr (std::is_same_v<ExpressionT, ArenaExpression>)
+				{
+					arenaNodes_.assign(std::size_t(expression.index()) + 1, notAdded);
+				}
+				auto root = add(expression, variableSubstitutions);
+				length_ = nodes_[root].length;
+				result_ = schedule(root);
+				nodes_.clear();
+				arenaNodes_.clear();
+			}
+
+			// The length of the resulting array, and of every buffer.
+			std::size_t length() const noexcept
+			{
+				return length_;
+			}
+
+			// The value of the expression; for a `buffer` it is in that buffer after `run()`.
+			PlannedOperand const& result() const noexcept
+			{
+				return result_;
+			}
+
+			// The number of buffers `run()` needs.
+			std::size_t numBuffers() const noexcept
+			{
+				return numBuffers_;
+			}
+
+			void run(std::vector<std::vector<double> >& buffers) const
+			{
+				auto arrayOf = [&buffers](PlannedOperand const& operand)
+				{
+					return operand.kind == PlannedOperand::Kind::array
+						? operand.array : std::span<double const>(buffers[operand.buffer]);
+				};
+				for (auto const& step : steps_)
+				{
+					auto out = std::span<double>(buffers[step.result]);
+					if (step.isUnary)
+					{
+						std::visit([&](auto f) { evaluate(f, arrayOf(step.x), out); }, step.unaryFunction);
+						continue;
+					}
+					std::visit(
+						[&](auto f)
+						{
+							if (step.x.kind == PlannedOperand::Kind::scalar)
+							{
+								evaluate(f, step.x.scalar, arrayOf(step.y), out);
+							}
+							else if (step.y.kind == PlannedOperand::Kind::scalar)
+							{
+								evaluate(f, arrayOf(step.x), step.y.scalar, out);
+							}
+							else
+							{
+								evaluate(f, arrayOf(step.x), arrayOf(step.y), out);
+							}
+						},
+						step.binaryFunction);
+				}
+			}
+		};
+
+		template <typename ExpressionT>
+		EvaluationResult evaluatePlanned(
+				ExpressionT const& expression,
+				std::unordered_map<std::string, VariableSubstitution> const& variableSubstitutions)
+		{
+			auto plan = BufferPlan(expression, variableSubstitutions);
+			auto const& result = plan.result();
+			switch (result.kind)
+			{
+			case PlannedOperand::Kind::scalar:
+				return result.scalar;
+			case PlannedOperand::Kind::array:
+				return std::vector<double>(result.array.begin(), result.array.end());
+			case PlannedOperand::Kind::buffer:
+				break;
+			}
+
+			// The buffer holding the result is returned, the others are freed.
+			auto buffers = std::vector<std::vector<double> >(plan.numBuffers());
+			for (auto& buffer : buffers)
+			{
+				buffer.resize(plan.length());
+			}
+			plan.run(buffers);
+			return std::move(buffers[result.buffer]);
+		}
+
+		// The tiled evaluator evaluates the whole expression for this many elements at a time. A tile of 4 KiB per
+		// intermediate value keeps the scratch buffers of typical expressions in the L1 cache.
+		constexpr std::size_t evaluationTileSize = 512;
+
+		// One node of an expression as seen by the tiled evaluator. Subexpressions without arrays are evaluated up front,
+		// so they become a single scalar step. A `shared` step stands for a subexpression of a DAG which an earlier step
+		// has already evaluated for the tile.
+		struct TileStep
+		{
+			enum class Kind { scalar, array, unary, binary, shared };
+
+			static constexpr std::size_t notShared = std::size_t(-1);
+
+			Kind kind;
+			double scalar = 0;
+			double const* array = nullptr;
+			UnaryFunction unaryFunction = Positive{ };
+			BinaryFunction binaryFunction = Add{ };
+			std::size_t sharedBuffer = notShared;  // the buffer a `shared` step reads, or a unary or binary step writes
+		};
+
+		// The value of a subexpression for one tile: either a scalar, which is broadcast, or an array of tile length.
+		struct TileOperand
+		{
+			double const* values;  // `nullptr` for a scalar
+			double scalar;
+		};
+
+		// Lays out an expression as a sequence of steps in pre-order, so that evaluating a tile neither looks up
+		// variables nor visits subexpressions which do not depend on arrays. A subexpression shared in a DAG is laid out
+		// once, and its value is kept in a shared buffer of its own until the end of the tile. Errors are detected in the
+		// same order as `evaluateImpl()` detects them.
+		class TilePlan
+		{
+		private:
+			struct Shape
+			{
+				bool isArray;
+				std::size_t length;
+				std::size_t numBuffers;  // the number of scratch buffers needed to evaluate the subexpression
+			};
+
+			// A node of an arena expression referred to by more than one parent, once it has been laid out.
+			struct SharedNode
+			{
+				bool isLaidOut = false;
+				Shape shape{ };
+				TileStep step{ };  // the step standing in for the node where it is reached again
+			};
+
+			std::vector<TileStep> steps_;
+			std::size_t length_ = 0;
+			std::size_t numBuffers_ = 0;
+			std::size_t numSharedBuffers_ = 0;
+			std::vector<std::uint32_t> uses_;
+			std::vector<SharedNode> sharedNodes_;
+
+			// Records the node of the arena laid out at step `index`, so that the next parent referring to it reuses its
+			// value instead of laying it out again.
+			void share(NodeIndex node, std::size_t index, Shape const& shape)
+			{
+				auto& step = steps_[index];
+				if (step.kind == TileStep::Kind::unary || step.kind == TileStep::Kind::binary)
+				{
+					step.sharedBuffer = numSharedBuffers_++;
+					sharedNodes_[node] = { true, Shape{ true, shape.length, 0 },
+						TileStep{ .kind = TileStep::Kind::shared, .sharedBuffer = step.sharedBuffer } };
+					return;
+				}
+
+				// Scalars and variables are cheaper to repeat than to copy.
+				sharedNodes_[node] = { true, shape, step };
+			}
+
+			template <typename ExpressionT>
+			Shape add(ExpressionT const& expression,
+				std::unordered_map<std::string, VariableSubstitution> const& variableSubstitutions)
+			{
+				using Traits = ExpressionTraits<ExpressionT>;
+
+				if constexpr (std::is_same_v<ExpressionT, ArenaExpression>)
+				{
+					if (auto const& shared = sharedNodes_[expression.index()]; shared.isLaidOut)
+					{
+						steps_.push_back(shared.step);
+						return shared.shape;
+					}
+				}
+
+				auto index = steps_.size();
+				steps_.emplace_back();
+				auto shape = std::visit(
+					overload{
+						[this, index, &expression, &variableSubstitutions]
+						(typename Traits::VariableType const& var)
+						{
+							auto const& v = variable(expression, var);
+							auto it = variableSubstitutions.find(v.name);
+							if (it == variableSubstitutions.end())
+							{
+								throw UnknownVariableValue(v.name, "No value given for variable");
+							}
+							if (auto span = std::get_if<std::span<double const> >(&it->second))
+							{
+								steps_[index] = { .kind = TileStep::Kind::array, .array = span->data() };
+								return Shape{ true, span->size(), 0 };
+							}
+							steps_[index] = { .kind = TileStep::Kind::scalar, .scalar = std::get<double>(it->second) };
+							return Shape{ false, 0, 0 };
+						},
+
+						[this, index, &expression, &variableSubstitutions]
+						(typename Traits::UnaryFunctionExpressionType const& unaryExpr)
+						{
+							auto x = add(subexpression(expression, unaryExpr.x), variableSubstitutions);
+							steps_[index] = { .kind = TileStep::Kind::unary, .unaryFunction = unaryExpr.f };
+							return Shape{ x.isArray, x.length, std::max<std::size_t>(x.numBuffers, 1) };
+						},
+
+						[this, index, &expression, &variableSubstitutions]
+						(typename Traits::BinaryFunctionExpressionType const& binaryExpr)
+						{
+							auto x = add(subexpression(expression, binaryExpr.x), variableSubstitutions);
+							auto y = add(subexpression(expression, binaryExpr.y), variableSubstitutions);
+							if (x.isArray && y.isArray && x.length != y.length)
+							{
+								throw BroadcastError("operands with different shapes could not be broadcast together");
+							}
+							steps_[index] = { .kind = TileStep::Kind::binary, .binaryFunction = binaryExpr.f };
+
+							// The value of `x` is kept in the buffer of the result while `y` is evaluated.
+							return Shape{ x.isArray || y.isArray, x.isArray ? x.length : y.length,
+								std::max({ x.numBuffers, y.numBuffers + 1, std::size_t(1) }) };
+						},
+
+						[this, index]
+						(auto const& c)
+						{
+							steps_[index] = { .kind = TileStep::Kind::scalar, .scalar = evaluate(c) };
+							return Shape{ false, 0, 0 };
+						}
+					},
+					expression.value());
+
+				if (!shape.isArray && steps_[index].kind != TileStep::Kind::scalar)
+				{
+					// Evaluate the subexpression once and replace its steps with the value.
+					std::size_t end = index;
+					auto value = run(end, 0, 0, nullptr, nullptr, nullptr);
+					steps_.resize(index + 1);
+					steps_[index] = { .kind = TileStep::Kind::scalar, .scalar = value.scalar };
+					shape = Shape{ false, 0, 0 };
+				}
+				if constexpr (std::is_same_v<ExpressionT, ArenaExpression>)
+				{
+					if (uses_[expression.index()] > 1)
+					{
+						share(expression.index(), index, shape);
+					}
+				}
+				return shape;
+			}
+
+		public:
+			TilePlan() = default;
+
+			template <typename ExpressionT>
+			TilePlan(ExpressionT const& expression,
+				std::unordered_map<std::string, VariableSubstitution> const& variableSubstitutions)
+			{
+				assign(expression, variableSubstitutions);
+			}
+
+			// Replaces the plan with the plan of another expression, reusing the memory of the steps.
+			template <typename ExpressionT>
+			void assign(ExpressionT const& expression,
+				std::unordered_map<std::string, VariableSubstitution> const& variableSubstitutions)
+			{
+				steps_.clear();
+				numSharedBuffers_ = 0;
+				if constexpr (std::is_same_v<ExpressionT, ArenaExpression>)
+				{
+					countUses(expression, uses_);
+					sharedNodes_.assign(uses_.size(), SharedNode{ });
+				}
+				auto shape = add(expression, variableSubstitutions);
+				length_ = shape.isArray ? shape.length : 0;
+				numBuffers_ = shape.numBuffers;
+			}
+
+			bool isScalar() const noexcept
+			{
+				return steps_.size() == 1 && steps_[0].kind == TileStep::Kind::scalar;
+			}
+
+			double scalar() const noexcept
+			{
+				return steps_[0].scalar;
+			}
+
+			// The length of the resulting array.
+			std::size_t length() const noexcept
+			{
+				return length_;
+			}
+
+			// The number of scratch buffers of `evaluationTileSize` elements needed by `run()`, not counting the result
+			// and the shared buffers.
+			std::size_t numBuffers() const noexcept
+			{
+				return numBuffers_;
+			}
+
+			// The number of buffers of `evaluationTileSize` elements keeping the values of shared subexpressions.
+			std::size_t numSharedBuffers() const noexcept
+			{
+				return numSharedBuffers_;
+			}
+
+			// Evaluates the steps from `pc` on, which form one subexpression, for the `n` elements starting at `offset`.
+			// A computed array is written to `result`, or to its shared buffer in `sharedBuffers`; `buffers` is scratch
+			// space for the operands. The steps from 0 on must be evaluated in order for the same tile.
+			TileOperand run(std::size_t& pc, std::size_t offset, std::size_t n, double* result, double* buffers,
+				double* sharedBuffers) const
+			{
+				auto const& step = steps_[pc++];
+				if (step.sharedBuffer != TileStep::notShared && step.kind != TileStep::Kind::shared)
+				{
+					result = sharedBuffers + step.sharedBuffer * evaluationTileSize;
+				}
+				switch (step.kind)
+				{
+				case TileStep::Kind::scalar:
+					return { nullptr, step.scalar };
+
+				case TileStep::Kind::array:
+					return { step.array + offset, 0 };
+
+				case TileStep::Kind::shared:
+					return { sharedBuffers + step.sharedBuffer * evaluationTileSize, 0 };
+
+				case TileStep::Kind::unary:
+				{
+					auto x = run(pc, offset, n, result, buffers, sharedBuffers);
+					if (x.values == nullptr)
+					{
+						return { nullptr, std::visit([x](auto f) { return evaluate(f, x.scalar); }, step.unaryFunction) };
+					}
+					std::visit(
+						[x, n, result](auto f)
+						{
+							evaluate(f, std::span<double const>(x.values, n), std::span<double>(result, n));
+						},
+						step.unaryFunction);
+					return { result, 0 };
+				}
+
+				case TileStep::Kind::binary:
+				{
+					// `x` may be computed into `result`, so `y` uses the first scratch buffer.
+					auto x = run(pc, offset, n, result, buffers, sharedBuffers);
+					auto y = run(pc, offset, n, buffers, buffers + evaluationTileSize, sharedBuffers);
+					if (x.values == nullptr && y.values == nullptr)
+					{
+						return { nullptr,
+							std::visit([x, y](auto f) { return evaluate(f, x.scalar, y.scalar); }, step.binaryFunction) };
+					}
+					std::visit(
+						[x, y, n, result](auto f)
+						{
+							auto out = std::span<double>(result, n);
+							if (x.values == nullptr)
+							{
+								evaluate(f, x.scalar, std::span<double const>(y.values, n), out);
+							}
+							else if (y.values == nullptr)
+							{
+								evaluate(f, std::span<double const>(x.values, n), y.scalar, out);
+							}
+							else
+							{
+								evaluate(f, std::span<double const>(x.values, n), std::span<double const>(y.values, n),
+									out);
+							}
+						},
+						step.binaryFunction);
+					return { result, 0 };
+				}
+				}
+				std::terminate();
+			}
+		};
+
+		// Evaluates the elements from `begin` to `end` into `result`, one tile at a time.
+		static void evaluateTiles(TilePlan const& plan, double* result, std::size_t begin, std::size_t end)
+		{
+			// The scratch buffers are reused by all evaluations on the same thread; the shared buffers follow the others.
+			thread_local std::vector<double> scratch;
+			if (scratch.size() < (plan.numBuffers() + plan.numSharedBuffers()) * evaluationTileSize)
+			{
+				scratch.resize((plan.numBuffers() + plan.numSharedBuffers()) * evaluationTileSize);
+			}
+			auto sharedBuffers = scratch.data() + plan.numBuffers() * evaluationTileSize;
+
+			// Intermediate values only live in the scratch buffers and in the part of the result currently evaluated.
+			for (std::size_t offset = begin; offset < end; offset += evaluationTileSize)
+			{
+				auto n = std::min(evaluationTileSize, end - offset);
+				std::size_t pc = 0;
+				auto value = plan.run(pc, offset, n, result + offset, scratch.data(), sharedBuffers);
+				if (value.values != result + offset)
+				{
+					// The expression is a single variable.
+					std::copy_n(value.values, n, result + offset);
+				}
+			}
+		}
+
+		template <typename ExpressionT>
+		EvaluationResult evaluateTiled(
+				ExpressionT const& expression,
+				std::unordered_map<std::string, VariableSubstitution> const& variableSubstitutions)
+		{
+			auto plan = TilePlan(expression, variableSubstitutions);
+			if (plan.isScalar())
+			{
+				return plan.scalar();
+			}
+
+			auto result = std::vector<double>(plan.length());
+			evaluateTiles(plan, result.data(), 0, result.size());
+			return result;
+		}
+
+		template <typename ExpressionT>
+		void evaluateIntoImpl(
+				ExpressionT const& expression,
+				std::unordered_map<std::string, VariableSubstitution> const& variableSubstitutions,
+				std::span<double> out)
+		{
+			// The plan is reused by all evaluations on the same thread, like the scratch buffers, so that neither needs
+			// memory once it has grown large enough.
+			thread_local TilePlan plan;
+			plan.assign(expression, variableSubstitutions);
+			if (plan.isScalar())
+			{
+				std::fill(out.begin(), out.end(), plan.scalar());
+				return;
+			}
+			if (plan.length() != out.size())
+			{
+				throw BroadcastError("output array and result have different shapes");
+			}
+			evaluateTiles(plan, out.data(), 0, out.size());
+		}
+
+		// The size of a cache line on all current x86-64 and most ARM CPUs.
+		constexpr std::size_t cacheLineSize = 64;
+
+		template <typename ExpressionT>
+		EvaluationResult evaluateParallel(
+				ExpressionT const& expression,
+				std::unordered_map<std::string, VariableSubstitution> const& variableSubstitutions,
+				ThreadPool& pool, std::size_t grainSize)
+		{
+			auto plan = TilePlan(expression, variableSubstitutions);
+			if (plan.isScalar())
+			{
+				return plan.scalar();
+			}
+			auto result = std::vector<double>(plan.length());
+			std::size_t length = result.size();
+
+			// Partition `k` starts at `skew + k * grainSize`, except for the first one, which starts at 0. With a grain
+			// size of whole cache lines, all but the first partition start at a cache line boundary of the result.
+			std::size_t const lineElements = cacheLineSize / sizeof(double);
+			grainSize = std::max((grainSize + lineElements - 1) / lineElements * lineElements, evaluationTileSize);
+			auto address = reinterpret_cast<std::uintptr_t>(result.data());
+			std::size_t skew = (cacheLineSize - address % cacheLineSize) % cacheLineSize / sizeof(double);
+			std::size_t numPartitions = std::max<std::size_t>(1,
+				length > skew ? (length - skew + grainSize - 1) / grainSize : 0);
+			auto partitionStart = [=](std::size_t k)
+			{
+				return k == 0 ? 0 : std::min(skew + k * grainSize, length);
+			};
+			if (numPartitions == 1)
+			{
+				evaluateTiles(plan, result.data(), 0, length);
+				return result;
+			}
+
+			// Every worker takes the next partition until none is left, so that workers which finish early take over the
+			// work of slower ones.
+			auto nextPartition = std::atomic<std::size_t>(0);
+			auto work = [&]
+			{
+				for (;;)
+				{
+					auto k = nextPartition.fetch_add(1, std::memory_order_relaxed);
+					if (k >= numPartitions)
+					{
+						return;
+					}
+					evaluateTiles(plan, result.data(), partitionStart(k), partitionStart(k + 1));
+				}
+			};
+			auto tasks = std::vector<std::future<void> >{ };
+			for (std::size_t i = 0, n = std::min(pool.size(), numPartitions); i != n; ++i)
+			{
+				tasks.push_back(pool.submit(work));
+			}
+
+			// The tasks refer to local variables, so all of them must have finished before an exception is rethrown.
+			for (auto& task : tasks)
+			{
+				task.wait();
+			}
+			for (auto& task : tasks)
+			{
+				task.get();
+			}
+			return result;
+		}
+
+		EvaluationResult toEvaluationResult(IntermediaryResult result)
 		{
-			auto result = evaluateImpl(expression, variableSubstitutions);
 			return std::visit<EvaluationResult>(  // we need to be explicit about the return type here
 				overload{
 					[](double scalar)
@@ -348,5 +1451,81 @@ namespace asc::cpp_practice_ws20::ex08 {
 				std::move(result));
 		}
 
+		template <typename ExpressionT>
+		EvaluationResult evaluateVectorized(
+				ExpressionT const& expression,
+				std::unordered_map<std::string, VariableSubstitution> const& variableSubstitutions,
+				VectorizedEvaluation mode)
+		{
+			if (mode == VectorizedEvaluation::tiled)
+			{
+				return evaluateTiled(expression, variableSubstitutions);
+			}
+			if (mode == VectorizedEvaluation::planned)
+			{
+				return evaluatePlanned(expression, variableSubstitutions);
+			}
+			return toEvaluationResult(evaluateImpl(expression, variableSubstitutions, noProfiling));
+		}
+
+		EvaluationResult evaluate(
+				Expression const& expression,
+				std::unordered_map<std::string, VariableSubstitution> const& variableSubstitutions,
+				VectorizedEvaluation mode)
+		{
+			return evaluateVectorized(expression, variableSubstitutions, mode);
+		}
+
+		EvaluationResult evaluate(
+				ArenaExpression const& expression,
+				std::unordered_map<std::string, VariableSubstitution> const& variableSubstitutions,
+				VectorizedEvaluation mode)
+		{
+			return evaluateVectorized(expression, variableSubstitutions, mode);
+		}
+
+		EvaluationResult evaluate(
+				Expression const& expression,
+				std::unordered_map<std::string, VariableSubstitution> const& variableSubstitutions,
+				EvaluationProfile& profile)
+		{
+			auto profiler = NodeProfiler(profile);
+			auto result = evaluateImpl(expression, variableSubstitutions, profiler);
+			profiler.finish();
+			return toEvaluationResult(std::move(result));
+		}
+
+		void evaluateInto(
+				Expression const& expression,
+				std::unordered_map<std::string, VariableSubstitution> const& variableSubstitutions,
+				std::span<double> out)
+		{
+			evaluateIntoImpl(expression, variableSubstitutions, out);
+		}
+
+		void evaluateInto(
+				ArenaExpression const& expression,
+				std::unordered_map<std::string, VariableSubstitution> const& variableSubstitutions,
+				std::span<double> out)
+		{
+			evaluateIntoImpl(expression, variableSubstitutions, out);
+		}
+
+		EvaluationResult evaluate(
+				Expression const& expression,
+				std::unordered_map<std::string, VariableSubstitution> const& variableSubstitutions,
+				ThreadPool& pool, std::size_t grainSize)
+		{
+			return evaluateParallel(expression, variableSubstitutions, pool, grainSize);
+		}
+
+		EvaluationResult evaluate(
+				ArenaExpression const& expression,
+				std::unordered_map<std::string, VariableSubstitution> const& variableSubstitutions,
+				ThreadPool& pool, std::size_t grainSize)
+		{
+			return evaluateParallel(expression, variableSubstitutions, pool, grainSize);
+		}
+
 	}
 }
\ No newline at end of file
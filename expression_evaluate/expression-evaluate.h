@@ -1,14 +1,19 @@
 #pragma once
 #include <span>
 #include <string>
+#include <vector>
+#include <cstddef>        // for size_t
 #include <variant>
 #include <stdexcept>      // for runtime_error
 #include <string_view>
 #include <unordered_map>
 
 #include "expression.h"
+#include "expression-arena.h"
 
 namespace asc::cpp_practice_ws20::ex08 {
+
+	class ThreadPool;
 	
 	namespace expr {
 		
@@ -44,16 +49,67 @@ namespace asc::cpp_practice_ws20::ex08 {
         // Throws an exception of type `UnknownVariableValue` if no substitution was provided for a variable.
         double evaluate(Expression const& expr, 
             std::unordered_map<std::string, double> const& variableSubsitituions);
+        // Evaluates each node reachable from `expr` exactly once, in a single sweep over the arena, so that subexpressions
+        // shared in a DAG are not evaluated repeatedly.
+        double evaluate(ArenaExpression const& expr,
+            std::unordered_map<std::string, double> const& variableSubsitituions);
 
         using EvaluationResult = std::variant<double, std::vector<double> > ;
         using VariableSubstitution = std::variant<double, std::span<double const> >;
 
+        // How the vectorized `evaluate()` traverses arrays. All modes compute the same values bit for bit.
+        enum class VectorizedEvaluation {
+            // Every operation makes a full pass over its operands and produces a temporary array of full length.
+            wholeArrays,
+
+            // Like `wholeArrays`, but a planning pass assigns the temporaries to as few arrays as possible, like a register
+            // allocator assigns values to registers, and allocates these up front. Operations overwrite operands which are
+            // not used any more, and subexpressions needing more arrays are evaluated first.
+            planned,
+
+            // The whole expression is evaluated for a tile of a few hundred elements at a time, using small scratch
+            // buffers which are reused, so that each input is read once and only the result is written to memory.
+            tiled
+        };
+
         // Evaluates an expression using the provided variable substitutions.
         // Supports implicit broadcasting of scalar values.
         // Throws an exception of type `UnknownVariableValue` if no substitution was provided for a variable.
         // Throws an exception of type `BroadcastError` if two operands cannot be broadcast due to mismatching array sizes.
         EvaluationResult evaluate(Expression const& expr, 
-            std::unordered_map<std::string, VariableSubstitution> const& variableSubsitituions);
+            std::unordered_map<std::string, VariableSubstitution> const& variableSubsitituions,
+            VectorizedEvaluation mode = VectorizedEvaluation::tiled);
+        EvaluationResult evaluate(ArenaExpression const& expr,
+            std::unordered_map<std::string, VariableSubstitution> const& variableSubsitituions,
+            VectorizedEvaluation mode = VectorizedEvaluation::tiled);
+
+        // Evaluates an expression like the tiled vectorized `evaluate()`, but writes the result to `out`, which must not
+        // overlap the arrays of the substitutions. A scalar result is broadcast to all elements of `out`. Does not
+        // allocate memory once the scratch space of the calling thread has grown to what the expression needs.
+        // Throws an exception of type `UnknownVariableValue` if no substitution was provided for a variable.
+        // Throws an exception of type `BroadcastError` if operands cannot be broadcast, or if the result is an array of
+        // another size than `out`.
+        void evaluateInto(Expression const& expr,
+            std::unordered_map<std::string, VariableSubstitution> const& variableSubsitituions,
+            std::span<double> out);
+        void evaluateInto(ArenaExpression const& expr,
+            std::unordered_map<std::string, VariableSubstitution> const& variableSubsitituions,
+            std::span<double> out);
+
+        // The default number of elements the parallel `evaluate()` hands to a worker at a time.
+        constexpr std::size_t defaultEvaluationGrainSize = std::size_t(1) << 16;
+
+        // Like the tiled vectorized `evaluate()`, but splits the elements into partitions of about `grainSize` elements,
+        // which the workers of `pool` evaluate concurrently; the number of threads is the size of the pool. Partitions
+        // start at cache line boundaries of the result, so that no two workers write to the same cache line. Computes the
+        // same values as the sequential evaluation bit for bit.
+        // Must not be called from a task running on `pool`, since it waits for tasks it submits to `pool`.
+        EvaluationResult evaluate(Expression const& expr,
+            std::unordered_map<std::string, VariableSubstitution> const& variableSubsitituions,
+            ThreadPool& pool, std::size_t grainSize = defaultEvaluationGrainSize);
+        EvaluationResult evaluate(ArenaExpression const& expr,
+            std::unordered_map<std::string, VariableSubstitution> const& variableSubsitituions,
+            ThreadPool& pool, std::size_t grainSize = defaultEvaluationGrainSize);
 
 
 	}
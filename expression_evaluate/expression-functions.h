@@ -0,0 +1,71 @@
+#pragma once
+
+#ifndef ARITHMETIC_EXPRESSION_PARSER_EXPRESSION_FUNCTIONS_HPP
+#define ARITHMETIC_EXPRESSION_PARSER_EXPRESSION_FUNCTIONS_HPP
+
+#include <cmath>
+#include <exception>    // for terminate()
+
+#include "expression.h"
+
+namespace asc::cpp_practice_ws20::ex08 {
+
+	namespace expr {
+
+		// Scalar semantics of the functions and constants of an expression. All scalar evaluators use these definitions so
+		// that their results agree bit for bit; the array evaluators use the array functions of "vector-math.h", which
+		// differ from these by a few units in the last place.
+
+		// unaryFucntion
+		inline double evaluate(Positive, double x) { return x; }
+		inline double evaluate(Negative, double x) { return -x; }
+		inline double evaluate(Sin, double x) { return std::sin(x); }
+		inline double evaluate(Cos, double x) { return std::cos(x); }
+		inline double evaluate(Tan, double x) { return std::tan(x); }
+		inline double evaluate(ArcSin, double x) { return std::asin(x); }
+		inline double evaluate(ArcCos, double x) { return std::acos(x); }
+		inline double evaluate(ArcTan, double x) { return std::atan(x); }
+		inline double evaluate(Exp, double x) { return std::exp(x); }
+		inline double evaluate(Log, double x) { return std::log(x); }
+		inline double evaluate(Sqrt, double x) { return std::sqrt(x); }
+
+		// binaryFucntion
+		inline double evaluate(Add, double lhs, double rhs) { return lhs + rhs; }
+		inline double evaluate(Subtract, double lhs, double rhs) { return lhs - rhs; }
+		inline double evaluate(Multiply, double lhs, double rhs) { return lhs * rhs; }
+		inline double evaluate(Divide, double num, double den) { return num / den; }
+		inline double evaluate(Pow, double base, double exp)
+		{
+			// Squares are by far the most common powers in our formulas. `base * base` is correctly rounded and avoids the
+			// cost of a call to `std::pow()`, which is not.
+			if (exp == 2)
+			{
+				return base * base;
+			}
+			return std::pow(base, exp);
+		}
+		inline double evaluate(LogBase, double base, double val) { return std::log(val) / std::log(base); }
+
+		constexpr double evaluate(RationalConstant c)
+		{
+			return boost::rational_cast<double>(c.value);
+		}
+
+		constexpr double evaluate(RealConstant c)
+		{
+			return c.value;
+		}
+
+		constexpr double evaluate(NamedConstant c)
+		{
+			switch (c)
+			{
+			case NamedConstant::e: return 2.71828182845904523536;
+			case NamedConstant::pi: return 3.14159265358979323846;
+			}
+			std::terminate();
+		}
+	}
+}
+
+#endif // !ARITHMETIC_EXPRESSION_PARSER_EXPRESSION_FUNCTIONS_HPP
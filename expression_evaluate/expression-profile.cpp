@@ -0,0 +1,120 @@
+#include <cstdio>       // for snprintf()
+#include <ostream>
+#include <string_view>
+
+#include "utility.h"    // for overload<>
+#include "expression-precedence.h"
+#include "expression-profile.h"
+
+namespace asc::cpp_practice_ws20::ex08 {
+
+	namespace expr {
+
+		NodeProfile EvaluationProfile::find(Expression const& node) const
+		{
+			auto it = nodes_.find(&node);
+			return it != nodes_.end() ? it->second : NodeProfile{ };
+		}
+
+		void EvaluationProfile::clear() noexcept
+		{
+			nodes_.clear();
+			totalNanoseconds_ = 0;
+			selfNanoseconds_ = 0;
+		}
+
+		void EvaluationProfile::record(Expression const& node, std::uint64_t calls, std::uint64_t totalNanoseconds,
+			std::uint64_t selfNanoseconds)
+		{
+			auto& profile = nodes_[&node];
+			profile.calls += calls;
+			profile.totalNanoseconds += totalNanoseconds;
+			profile.selfNanoseconds += selfNanoseconds;
+			selfNanoseconds_ += selfNanoseconds;
+		}
+
+		void printProfile(std::ostream& stream, Expression const& expr, EvaluationProfile const& profile,
+			double threshold)
+		{
+			double total = double(profile.selfNanoseconds());
+			printAnnotated(stream, expr, [&](Expression const& node)
+				{
+					double share = total != 0 ? double(profile.find(node).selfNanoseconds) / total : 0.0;
+					if (share < threshold || share == 0)
+					{
+						return std::string();
+					}
+					char mark[16];
+					std::snprintf(mark, sizeof mark, "{%.1f%%}", 100 * share);
+					return std::string(mark);
+				});
+		}
+
+		// The name of a node in a stack: the node as printed, with "_" in place of its subexpressions, so that the
+		// operators and functions can be told apart, e.g. "-_" and "_ - _".
+		std::string stackFrameName(Expression const& node)
+		{
+			return std::visit(
+				overload{
+					[](UnaryFunctionExpression const& unaryExpr)
+					{
+						auto name = std::string(std::visit(unaryFunctionName, unaryExpr.f));
+						return std::visit(unaryOperatorPrecedence, unaryExpr.f) != OperatorPrecedence::none
+							? name + "_"
+							: name + "(_)";
+					},
+					[](BinaryFunctionExpression const& binaryExpr)
+					{
+						auto name = std::string(std::visit(binaryFunctionName, binaryExpr.f));
+						return std::visit(binaryOperatorPrecedence, binaryExpr.f) != OperatorPrecedence::none
+							? "_" + name + "_"
+							: name + "(_, _)";
+					},
+					[&node](auto const&)
+					{
+						return to_string(node);
+					}
+				},
+				node.value());
+		}
+
+		void writeFoldedStacks(std::ostream& stream, std::string& stack, Expression const& node,
+			EvaluationProfile const& profile)
+		{
+			auto stackSize = stack.size();
+			if (!stack.empty())
+			{
+				stack += ';';
+			}
+			stack += stackFrameName(node);
+
+			auto nodeProfile = profile.find(node);
+			if (nodeProfile.selfNanoseconds != 0)
+			{
+				stream << stack << ' ' << nodeProfile.selfNanoseconds << '\n';
+			}
+			std::visit(
+				overload{
+					[&](UnaryFunctionExpression const& unaryExpr)
+					{
+						writeFoldedStacks(stream, stack, unaryExpr.x, profile);
+					},
+					[&](BinaryFunctionExpression const& binaryExpr)
+					{
+						writeFoldedStacks(stream, stack, binaryExpr.x, profile);
+						writeFoldedStacks(stream, stack, binaryExpr.y, profile);
+					},
+					[](auto const&) { }
+				},
+				node.value());
+
+			stack.resize(stackSize);
+		}
+
+		void writeFoldedStacks(std::ostream& stream, Expression const& expr, EvaluationProfile const& profile)
+		{
+			auto stack = std::string();
+			writeFoldedStacks(stream, stack, expr, profile);
+		}
+	}
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#ifndef ARITHMETIC_EXPRESSION_PARSER_EXPRESSION_PROFILE_HPP
+#define ARITHMETIC_EXPRESSION_PARSER_EXPRESSION_PROFILE_HPP
+
+#include <string>
+#include <cstddef>      // for size_t
+#include <cstdint>      // for uint64_t
+#include <iosfwd>       // for ostream
+#include <functional>
+#include <unordered_map>
+
+#include "expression.h"
+#include "expression-evaluate.h"
+
+namespace asc::cpp_practice_ws20::ex08 {
+
+	namespace expr {
+
+		// The time spent in one node of an expression, summed over all evaluations recorded in a profile.
+		struct NodeProfile {
+			std::uint64_t calls = 0;
+
+			// The time spent in the node itself.
+			std::uint64_t selfNanoseconds = 0;
+
+			// The time spent in the node and its subexpressions, i.e. `selfNanoseconds` plus the `totalNanoseconds` of
+			// its direct subexpressions.
+			std::uint64_t totalNanoseconds = 0;
+		};
+
+		// Per-node times and invocation counts of the evaluations of an expression, to find the subexpressions which
+		// dominate the cost of evaluating it. The nodes are identified by their address, so the profile refers to the
+		// expression it was recorded for and must not outlive it. Repeated evaluations accumulate.
+		//
+		// The scalar evaluation of a node takes a few nanoseconds, about as long as reading the clock, so the profiled
+		// scalar `evaluate()` times the step of every node, given the values of its subexpressions, over many repeated
+		// steps, and scales the step times to add up to the time of the whole evaluation; the shares of the nodes are
+		// those of their steps. The vectorized evaluation of a node takes much longer than reading the clock, so every
+		// evaluation of a node is timed, and the estimated cost of the profiling is subtracted. Either way, the self
+		// times of all nodes add up to the total time of the root. Interrupts and other processes add their time to
+		// whichever node is being evaluated, so profiles should be recorded on a quiet machine.
+		class EvaluationProfile {
+		private:
+			std::unordered_map<Expression const*, NodeProfile> nodes_;
+			std::uint64_t totalNanoseconds_ = 0;
+			std::uint64_t selfNanoseconds_ = 0;
+
+		public:
+			// Returns the profile of a node, or an empty profile if the node was never evaluated.
+			NodeProfile find(Expression const& node) const;
+
+			// The sum of the total times of all evaluations of root expressions.
+			std::uint64_t totalNanoseconds() const noexcept { return totalNanoseconds_; }
+
+			// The sum of the self times of all nodes, which is `totalNanoseconds()` for the profile of a single
+			// expression.
+			std::uint64_t selfNanoseconds() const noexcept { return selfNanoseconds_; }
+
+			// The number of distinct nodes evaluated.
+			std::size_t size() const noexcept { return nodes_.size(); }
+
+			void clear() noexcept;
+
+			// Records `calls` evaluations of a node, which took the given times together; used by the profiling
+			// evaluators.
+			void record(Expression const& node, std::uint64_t calls, std::uint64_t totalNanoseconds,
+				std::uint64_t selfNanoseconds);
+
+			// Records the evaluations of a root expression; used by the profiling evaluators.
+			void recordRoot(std::uint64_t totalNanoseconds) noexcept { totalNanoseconds_ += totalNanoseconds; }
+		};
+
+		// Evaluate an expression like `evaluate()`, with the same results bit for bit, and add the time spent in each
+		// node to `profile`. To time them, the step of every node, and the whole evaluation, are repeated
+		// `repetitions` times, rounded up to a multiple of 16, and the profile records that many evaluations of every
+		// node; this takes about twice as long as `repetitions` evaluations. The fastest of the chunks of 16 repeated
+		// steps counts, so that interrupts do not distort the profile.
+		// Implemented in "expression-evaluate.cpp".
+		double evaluate(Expression const& expr,
+			std::unordered_map<std::string, double> const& variableSubsitituions,
+			EvaluationProfile& profile,
+			std::size_t repetitions = 64);
+
+		// Evaluate an expression like the vectorized `evaluate()` in the `VectorizedEvaluation::wholeArrays` mode, in
+		// which every node is a separate pass over the arrays that can be timed, and add the time spent in each node to
+		// `profile`. The other modes compute the same values with the same operations, interleaved across nodes.
+		// Implemented in "expression-evaluate.cpp".
+		EvaluationResult evaluate(Expression const& expr,
+			std::unordered_map<std::string, VariableSubstitution> const& variableSubsitituions,
+			EvaluationProfile& profile);
+
+		// Print an expression like `operator <<`, but enclose every subexpression for which `annotation` returns a
+		// non-empty string in brackets, followed by that string.
+		// Implemented in "expression-print.cpp".
+		std::ostream& printAnnotated(std::ostream& stream, Expression const& expr,
+			std::function<std::string(Expression const&)> const& annotation);
+
+		// Print an expression like `operator <<`, marking each subexpression whose self time is at least `threshold`
+		// of the sum of the self times in the profile with its share, e.g. "[sin(x)]{42.0%}".
+		void printProfile(std::ostream& stream, Expression const& expr, EvaluationProfile const& profile,
+			double threshold = 0.05);
+
+		// Write the profile in the folded stack format of flame graph tools, e.g. "flamegraph.pl" or speedscope: one
+		// line per node with the path of node names from the root, separated by ';', and its self time in nanoseconds.
+		// Nodes are named by their function or operator, variable name or constant.
+		void writeFoldedStacks(std::ostream& stream, Expression const& expr, EvaluationProfile const& profile);
+	}
+}
+
+#endif // ARITHMETIC_EXPRESSION_PARSER_EXPRESSION_PROFILE_HPP
@@ -0,0 +1,221 @@
+#include <bit>          // for bit_cast<>()
+#include <cstdint>      // for uint64_t
+#include <iterator>     // for back_inserter()
+#include <algorithm>    // for set_union(), sort(), unique()
+#include <stdexcept>    // for out_of_range
+
+#include "utility.h"    // for overload<>
+#include "expression-functions.h"
+#include "expression-evaluate.h"   // for UnknownVariableValue
+#include "incremental-evaluator.h"
+
+namespace asc::cpp_practice_ws20::ex08 {
+
+	namespace expr {
+
+		IncrementalEvaluator::IncrementalEvaluator(Expression const& expr,
+			std::unordered_map<std::string, double> const& variableSubsitituions)
+			: dag_(std::make_unique<ExpressionDag>()), root_(dag_->add(expr))
+		{
+			initialize(variableSubsitituions);
+		}
+
+		IncrementalEvaluator::IncrementalEvaluator(ArenaExpression expr,
+			std::unordered_map<std::string, double> const& variableSubsitituions)
+			: root_(expr)
+		{
+			initialize(variableSubsitituions);
+		}
+
+		void IncrementalEvaluator::initialize(std::unordered_map<std::string, double> const& variableSubsitituions)
+		{
+			auto const& arena = root_.arena();
+			NodeIndex end = root_.index() + 1;
+
+			// Children precede their parents, so a single backward sweep finds the nodes of the expression, which may
+			// share the arena with others.
+			auto isReachable = std::vector<bool>(end);
+			isReachable[root_.index()] = true;
+			for (NodeIndex i = end; i-- != 0; )
+			{
+				if (!isReachable[i])
+				{
+					continue;
+				}
+				std::visit(
+					overload{
+						[&isReachable](ArenaUnaryFunctionExpression const& unaryExpr)
+						{
+							isReachable[unaryExpr.x] = true;
+						},
+						[&isReachable](ArenaBinaryFunctionExpression const& binaryExpr)
+						{
+							isReachable[binaryExpr.x] = true;
+							isReachable[binaryExpr.y] = true;
+						},
+						[](auto const&) { }
+					},
+					arena.node(i));
+			}
+
+			// The variables each node depends on, as sorted layout positions, are only needed to invert them into the
+			// rows of `dependents_`.
+			variablePositions_.assign(arena.variableCount(), 0);
+			auto dependencies = std::vector<std::vector<std::size_t>>(end);
+			for (NodeIndex i = 0; i != end; ++i)
+			{
+				if (!isReachable[i])
+				{
+					continue;
+				}
+				++numNodes_;
+				auto& dependsOn = dependencies[i];
+				std::visit(
+					overload{
+						[&](ArenaVariable v)
+						{
+							auto position = layout_.add(arena.variable(v.name).name);
+							variablePositions_[v.name] = position;
+							dependsOn.push_back(position);
+						},
+						[&](ArenaUnaryFunctionExpression const& unaryExpr)
+						{
+							dependsOn = dependencies[unaryExpr.x];
+						},
+						[&](ArenaBinaryFunctionExpression const& binaryExpr)
+						{
+							auto const& x = dependencies[binaryExpr.x];
+							auto const& y = dependencies[binaryExpr.y];
+							std::set_union(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(dependsOn));
+						},
+						[](auto const&) { }
+					},
+					arena.node(i));
+			}
+
+			dependents_.resize(layout_.size());
+			for (NodeIndex i = 0; i != end; ++i)
+			{
+				for (auto position : dependencies[i])
+				{
+					dependents_[position].push_back(i);
+				}
+			}
+
+			variableValues_.resize(layout_.size());
+			for (std::size_t position = 0; position != layout_.size(); ++position)
+			{
+				auto const& name = layout_.names()[position];
+				auto it = variableSubsitituions.find(name);
+				if (it == variableSubsitituions.end())
+				{
+					throw UnknownVariableValue(name, "No value given for variable.");
+				}
+				variableValues_[position] = it->second;
+			}
+
+			values_.resize(end);
+			for (NodeIndex i = 0; i != end; ++i)
+			{
+				if (isReachable[i])
+				{
+					values_[i] = evaluateNode(i);
+				}
+			}
+			lastUpdate_ = { numNodes_, 0 };
+		}
+
+		double IncrementalEvaluator::evaluateNode(NodeIndex index) const
+		{
+			return std::visit(
+				overload{
+					[this](ArenaVariable v)
+					{
+						return variableValues_[variablePositions_[v.name]];
+					},
+					[this](ArenaUnaryFunctionExpression const& unaryExpr)
+					{
+						return std::visit([x = values_[unaryExpr.x]](auto f) { return evaluate(f, x); }, unaryExpr.f);
+					},
+					[this](ArenaBinaryFunctionExpression const& binaryExpr)
+					{
+						return std::visit(
+							[x = values_[binaryExpr.x], y = values_[binaryExpr.y]](auto f) { return evaluate(f, x, y); },
+							binaryExpr.f);
+					},
+					[](auto const& c)
+					{
+						return evaluate(c);
+					}
+				},
+				root_.arena().node(index));
+		}
+
+		bool IncrementalEvaluator::assign(std::size_t position, double value)
+		{
+			// Compare bit patterns, since `0.0` and `-0.0` may lead to different results and a NaN is never equal.
+			if (std::bit_cast<std::uint64_t>(variableValues_[position]) == std::bit_cast<std::uint64_t>(value))
+			{
+				return false;
+			}
+			variableValues_[position] = value;
+			return true;
+		}
+
+		void IncrementalEvaluator::recompute(std::vector<NodeIndex> const& nodes)
+		{
+			for (auto i : nodes)
+			{
+				values_[i] = evaluateNode(i);
+			}
+			lastUpdate_ = { nodes.size(), numNodes_ - nodes.size() };
+		}
+
+		double IncrementalEvaluator::update(std::string_view variable, double value)
+		{
+			auto position = layout_.find(variable);
+			if (!position)
+			{
+				lastUpdate_ = { 0, numNodes_ };
+				return this->value();
+			}
+			return update(*position, value);
+		}
+
+		double IncrementalEvaluator::update(std::size_t position, double value)
+		{
+			if (position >= layout_.size())
+			{
+				throw std::out_of_range("variable position out of range");
+			}
+			if (assign(position, value))
+			{
+				recompute(dependents_[position]);
+			}
+			else
+			{
+				lastUpdate_ = { 0, numNodes_ };
+			}
+			return this->value();
+		}
+
+		double IncrementalEvaluator::update(std::unordered_map<std::string, double> const& variableSubsitituions)
+		{
+			pending_.clear();
+			for (auto const& [name, value] : variableSubsitituions)
+			{
+				auto position = layout_.find(name);
+				if (position && assign(*position, value))
+				{
+					auto const& nodes = dependents_[*position];
+					pending_.insert(pending_.end(), nodes.begin(), nodes.end());
+				}
+			}
+			// Nodes depending on several of the variables are recomputed once, after all of their children.
+			std::sort(pending_.begin(), pending_.end());
+			pending_.erase(std::unique(pending_.begin(), pending_.end()), pending_.end());
+			recompute(pending_);
+			return value();
+		}
+	}
+}
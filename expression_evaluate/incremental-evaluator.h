@@ -0,0 +1,107 @@
+#pragma once
+
+#ifndef ARITHMETIC_EXPRESSION_PARSER_INCREMENTAL_EVALUATOR_HPP
+#define ARITHMETIC_EXPRESSION_PARSER_INCREMENTAL_EVALUATOR_HPP
+
+#include <memory>       // for unique_ptr<>
+#include <string>
+#include <vector>
+#include <cstddef>      // for size_t
+#include <string_view>
+#include <unordered_map>
+
+#include "expression.h"
+#include "expression-arena.h"
+#include "expression-dag.h"
+#include "variable-layout.h"
+
+namespace asc::cpp_practice_ws20::ex08 {
+
+	namespace expr {
+
+		// How much work the last update of an `IncrementalEvaluator` did.
+		struct IncrementalUpdateStatistics {
+			std::size_t recomputedNodes = 0;
+			std::size_t skippedNodes = 0;
+		};
+
+		// Keeps the value of every node of an expression between evaluations, so that changing some variables recomputes
+		// only the nodes which depend on them, i.e. the paths from their occurrences to the root. This pays off when few
+		// of many variables change between evaluations, as in a parameter sweep. The values agree bit for bit with
+		// `evaluate()`.
+		class IncrementalEvaluator {
+		private:
+			// Set only if the evaluator was created from an `Expression`, which is then stored as a DAG.
+			std::unique_ptr<ExpressionDag> dag_;
+			ArenaExpression root_;
+
+			VariableLayout layout_;
+			std::vector<double> variableValues_;
+
+			// The layout position of every variable of the arena which occurs in the expression.
+			std::vector<std::size_t> variablePositions_;
+
+			// Indexed by node index; only the nodes of the expression are used.
+			std::vector<double> values_;
+			std::size_t numNodes_ = 0;
+
+			// `dependents_[i]` are the nodes which depend on the variable `layout().names()[i]`, in post-order, so that
+			// recomputing them in this order sees the new values of their children.
+			std::vector<std::vector<NodeIndex>> dependents_;
+
+			// The nodes to recompute when several variables change at once.
+			std::vector<NodeIndex> pending_;
+
+			IncrementalUpdateStatistics lastUpdate_;
+
+			void initialize(std::unordered_map<std::string, double> const& variableSubsitituions);
+			double evaluateNode(NodeIndex index) const;
+			bool assign(std::size_t position, double value);
+			void recompute(std::vector<NodeIndex> const& nodes);
+
+		public:
+			// Evaluates the expression once with the given substitutions.
+			// Throws an exception of type `UnknownVariableValue` if no substitution was provided for a variable.
+			IncrementalEvaluator(Expression const& expr,
+				std::unordered_map<std::string, double> const& variableSubsitituions);
+
+			// Like above, but refers to an expression stored in an arena or DAG, which must outlive the evaluator.
+			IncrementalEvaluator(ArenaExpression expr,
+				std::unordered_map<std::string, double> const& variableSubsitituions);
+
+			// The variables of the expression in order of first occurrence, for the positional `update()`.
+			VariableLayout const& layout() const noexcept {
+				return layout_;
+			}
+
+			// The value of the expression for the current values of the variables.
+			double value() const {
+				return values_[root_.index()];
+			}
+
+			// The number of distinct nodes of the expression.
+			std::size_t size() const noexcept {
+				return numNodes_;
+			}
+
+			// Sets a variable and returns the new value of the expression. Nothing is recomputed if the value of the
+			// variable does not change or the expression does not depend on it.
+			double update(std::string_view variable, double value);
+
+			// Sets the variable `layout().names()[position]` and returns the new value of the expression.
+			// Throws `std::out_of_range` if there is no such variable.
+			double update(std::size_t position, double value);
+
+			// Sets several variables at once, recomputing every node at most once, and returns the new value of the
+			// expression. Variables the expression does not depend on are ignored.
+			double update(std::unordered_map<std::string, double> const& variableSubsitituions);
+
+			// The work done by the last update, or by the initial evaluation if there was no update yet.
+			IncrementalUpdateStatistics const& lastUpdate() const noexcept {
+				return lastUpdate_;
+			}
+		};
+	}
+}
+
+#endif // !ARITHMETIC_EXPRESSION_PARSER_INCREMENTAL_EVALUATOR_HPP
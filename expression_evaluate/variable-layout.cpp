@@ -0,0 +1,101 @@
+#include <stdexcept>    // for invalid_argument
+
+#include "utility.h"    // for overload<>
+#include "variable-layout.h"
+#include "expression-evaluate.h"   // for UnknownVariableValue
+
+namespace asc::cpp_practice_ws20::ex08 {
+
+	namespace expr {
+
+		VariableLayout::VariableLayout(std::vector<std::string> names)
+		{
+			names_.reserve(names.size());
+			for (auto& name : names)
+			{
+				if (!indices_.try_emplace(name, names_.size()).second)
+				{
+					throw std::invalid_argument("variable '" + name + "' occurs twice in layout");
+				}
+				names_.push_back(std::move(name));
+			}
+		}
+
+		template <typename ExpressionT>
+		static void collectVariables(VariableLayout& layout, ExpressionT const& expr)
+		{
+			using Traits = ExpressionTraits<ExpressionT>;
+
+			std::visit(
+				overload{
+					[&layout, &expr]
+					(typename Traits::VariableType const& v)
+					{
+						layout.add(variable(expr, v).name);
+					},
+
+					[&layout, &expr]
+					(typename Traits::UnaryFunctionExpressionType const& unaryExpr)
+					{
+						collectVariables(layout, subexpression(expr, unaryExpr.x));
+					},
+
+					[&layout, &expr]
+					(typename Traits::BinaryFunctionExpressionType const& binaryExpr)
+					{
+						collectVariables(layout, subexpression(expr, binaryExpr.x));
+						collectVariables(layout, subexpression(expr, binaryExpr.y));
+					},
+
+					[]
+					(auto const&)
+					{
+					}
+				}, expr.value());
+		}
+
+		VariableLayout VariableLayout::of(Expression const& expr)
+		{
+			auto layout = VariableLayout{ };
+			collectVariables(layout, expr);
+			return layout;
+		}
+
+		VariableLayout VariableLayout::of(ArenaExpression const& expr)
+		{
+			auto layout = VariableLayout{ };
+			collectVariables(layout, expr);
+			return layout;
+		}
+
+		std::size_t VariableLayout::add(std::string_view name)
+		{
+			auto [it, inserted] = indices_.try_emplace(std::string(name), names_.size());
+			if (inserted)
+			{
+				names_.push_back(it->first);
+			}
+			return it->second;
+		}
+
+		std::optional<std::size_t> VariableLayout::find(std::string_view name) const
+		{
+			auto it = indices_.find(std::string(name));
+			if (it == indices_.end())
+			{
+				return std::nullopt;
+			}
+			return it->second;
+		}
+
+		std::size_t VariableLayout::indexOf(std::string_view name) const
+		{
+			auto index = find(name);
+			if (!index)
+			{
+				throw UnknownVariableValue(std::string(name), "Variable is not part of the layout.");
+			}
+			return *index;
+		}
+	}
+}
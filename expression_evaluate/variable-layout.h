@@ -0,0 +1,60 @@
+#pragma once
+
+#ifndef ARITHMETIC_EXPRESSION_PARSER_VARIABLE_LAYOUT_HPP
+#define ARITHMETIC_EXPRESSION_PARSER_VARIABLE_LAYOUT_HPP
+
+#include <span>
+#include <string>
+#include <vector>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <initializer_list>
+
+#include "expression.h"
+#include "expression-arena.h"
+
+namespace asc::cpp_practice_ws20::ex08 {
+
+	namespace expr {
+
+		// A dense assignment of variable names to positions. Values for the variables are then passed positionally,
+		// i.e. `values[layout.indexOf("x")]` is the value of `x`, so that evaluation does not hash variable names.
+		class VariableLayout {
+		private:
+			std::vector<std::string> names_;
+			std::unordered_map<std::string, std::size_t> indices_;
+
+		public:
+			VariableLayout() = default;
+
+			// Throws `std::invalid_argument` if a name occurs twice.
+			explicit VariableLayout(std::vector<std::string> names);
+			VariableLayout(std::initializer_list<std::string> names)
+				: VariableLayout(std::vector<std::string>(names)) {}
+
+			// Return the layout of all variables occurring in the expression, in order of first occurrence.
+			static VariableLayout of(Expression const& expr);
+			static VariableLayout of(ArenaExpression const& expr);
+
+			// Append a variable and return its position. Returns the existing position if the variable is already known.
+			std::size_t add(std::string_view name);
+
+			std::optional<std::size_t> find(std::string_view name) const;
+
+			// Throws an exception of type `UnknownVariableValue` if the variable is not part of the layout.
+			std::size_t indexOf(std::string_view name) const;
+
+			// The names of the variables in positional order.
+			std::span<const std::string> names() const noexcept {
+				return names_;
+			}
+
+			std::size_t size() const noexcept {
+				return names_.size();
+			}
+		};
+	}
+}
+
+#endif // !ARITHMETIC_EXPRESSION_PARSER_VARIABLE_LAYOUT_HPP
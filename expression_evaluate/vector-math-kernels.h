@@ -0,0 +1,623 @@
+// The vectorized algorithms of "vector-math.h", written once against a small set of operations on `Vec`, a vector of
+// `lanes` doubles, `Bits`, the same lanes as 64-bit integers, and `Mask`, the result of a comparison.
+//
+// "vector-math.cpp" includes this file once per instruction set, each time in a namespace which defines these
+// operations and in which every function is compiled for that instruction set. Hence there is no include guard.
+//
+// The algorithms follow those of fdlibm, the basis of most C libraries, with the branches on the argument replaced by
+// selects. Arguments are passed to the scalar functions where that is not possible.
+
+
+// Helpers
+//
+// Constants are written as hexadecimal floating-point literals where the exact bits matter.
+
+inline Vec abs(Vec x)
+{
+	return fromBits(andBits(toBits(x), broadcastBits(0x7fffffffffffffff)));
+}
+
+inline Bits signBit(Vec x)
+{
+	return andBits(toBits(x), broadcastBits(0x8000000000000000));
+}
+
+// Flips the sign of the lanes of `x` in which `sign` has the sign bit set.
+inline Vec flipSign(Vec x, Bits sign)
+{
+	return fromBits(xorBits(toBits(x), sign));
+}
+
+inline Vec negate(Vec x)
+{
+	return flipSign(x, broadcastBits(0x8000000000000000));
+}
+
+inline Mask isNaN(Vec x)
+{
+	return ne(x, x);
+}
+
+// True for finite numbers, false for infinities and NaNs.
+inline Mask isFinite(Vec x)
+{
+	return lt(abs(x), broadcast(HUGE_VAL));
+}
+
+// Adding 1.5 * 2^52 to an integral double `k` with |k| < 2^51 moves `k` into the low bits of the mantissa.
+constexpr double integerShift = 0x1.8p52;
+
+// Returns 2^k for integral `k` in [-1022, 1023].
+inline Vec pow2(Vec k)
+{
+	return fromBits(shiftLeft<52>(toBits(add(k, broadcast(integerShift + 1023)))));
+}
+
+// Returns the low bits of an integral `k` with |k| < 2^51, in two's complement.
+inline Bits integerBits(Vec k)
+{
+	return toBits(add(k, broadcast(integerShift)));
+}
+
+// Returns `hi + lo == a + b` with `hi` the rounded sum.
+inline void twoSum(Vec a, Vec b, Vec& hi, Vec& lo)
+{
+	hi = add(a, b);
+	Vec bb = sub(hi, a);
+	lo = add(sub(a, sub(hi, bb)), sub(b, bb));
+}
+
+// Like `twoSum()`, but only if `|a| >= |b|`.
+inline void fastTwoSum(Vec a, Vec b, Vec& hi, Vec& lo)
+{
+	hi = add(a, b);
+	lo = sub(b, sub(hi, a));
+}
+
+// Splits `x` into `hi + lo` with halves of 26 bits, whose products are exact.
+inline void splitHalves(Vec x, Vec& hi, Vec& lo)
+{
+	Vec c = mul(x, broadcast(0x1p27 + 1));
+	hi = sub(c, sub(c, x));
+	lo = sub(x, hi);
+}
+
+// Returns `hi + lo == a * b` with `hi` the rounded product.
+inline void twoProduct(Vec a, Vec b, Vec& hi, Vec& lo)
+{
+	hi = mul(a, b);
+	if constexpr (hasFma)
+	{
+		lo = mulAdd(a, b, negate(hi));
+	}
+	else
+	{
+		// Dekker's algorithm
+		Vec aHi, aLo, bHi, bLo;
+		splitHalves(a, aHi, aLo);
+		splitHalves(b, bHi, bLo);
+		lo = add(add(add(sub(mul(aHi, bHi), hi), mul(aHi, bLo)), mul(aLo, bHi)), mul(aLo, bLo));
+	}
+}
+
+// Evaluates the polynomial with the given coefficients, starting with the constant term, at `x`.
+template <std::size_t N>
+inline Vec polynomial(Vec x, double const (&coefficients)[N])
+{
+	Vec p = broadcast(coefficients[N - 1]);
+	for (std::size_t i = N - 1; i-- != 0; )
+	{
+		p = mulAdd(p, x, broadcast(coefficients[i]));
+	}
+	return p;
+}
+
+// ln(2), split so that `k * ln2Hi` is exact for |k| < 2^21.
+constexpr double ln2Hi = 0x1.62e42feep-1;
+constexpr double ln2Lo = 0x1.a39ef35793c76p-33;
+
+
+// Exponential and logarithm
+
+// Returns e^(hi + lo) for |lo| <= ulp(hi). Overflows to infinity and underflows to zero like `std::exp()`.
+inline Vec expKernel(Vec hi, Vec lo)
+{
+	// e^x = 2^k * e^r with |r| <= ln(2) / 2. Subtracting k * ln2Hi is exact.
+	Vec k = round(mul(hi, broadcast(0x1.71547652b82fep0)));  // 1 / ln(2)
+	Vec r = sub(hi, mul(k, broadcast(ln2Hi)));
+	r = sub(r, sub(mul(k, broadcast(ln2Lo)), lo));
+
+	// e^r = 1 + r + r^2 * q(r), with the Taylor coefficients 1/2!, ..., 1/13!, which is accurate to 2^-57. Adding
+	// the 1 last keeps the error of the sum below an ulp.
+	static constexpr double q[] = {
+		1.0 / 2, 1.0 / 6, 1.0 / 24, 1.0 / 120, 1.0 / 720, 1.0 / 5040, 1.0 / 40320, 1.0 / 362880, 1.0 / 3628800,
+		1.0 / 39916800, 1.0 / 479001600, 1.0 / 6227020800
+	};
+	Vec p = add(broadcast(1), mulAdd(mul(r, r), polynomial(r, q), r));
+
+	// Scale in two steps, so that both factors are normal numbers for k in [-1075, 1024]. The first product is exact;
+	// the second rounds results in the subnormal range correctly and overflows to infinity.
+	Vec k1 = round(mul(k, broadcast(0.5)));
+	Vec k2 = sub(k, k1);
+	Vec result = mul(mul(p, pow2(k1)), pow2(k2));
+
+	result = select(lt(broadcast(709.8), hi), broadcast(HUGE_VAL), result);
+	result = select(lt(hi, broadcast(-745.2)), broadcast(0), result);
+	return select(isNaN(hi), hi, result);
+}
+
+// Splits positive finite `x` into 2^k * m with m in [sqrt(2) / 2, sqrt(2)), and returns `k` and `f = m - 1`, which is
+// exact.
+inline void splitLogArgument(Vec x, Vec& k, Vec& f)
+{
+	// Scale subnormal numbers into the normal range.
+	Mask subnormal = lt(x, broadcast(0x1p-1022));
+	x = select(subnormal, mul(x, broadcast(0x1p54)), x);
+
+	// Adding the difference of the exponent bits of 1 and sqrt(2) / 2 carries into the exponent exactly if m >= sqrt(2).
+	Bits bits = addBits(toBits(x), broadcastBits(0x3ff0000000000000 - 0x3fe6a09e00000000));
+	Vec biasedExponent = sub(fromBits(orBits(shiftRight<52>(bits), toBits(broadcast(integerShift)))),
+		broadcast(integerShift + 1023));
+	k = sub(biasedExponent, select(subnormal, broadcast(54), broadcast(0)));
+	Bits m = addBits(andBits(bits, broadcastBits(0x000fffffffffffff)), broadcastBits(0x3fe6a09e00000000));
+	f = sub(fromBits(m), broadcast(1));
+}
+
+inline Vec logKernel(Vec x)
+{
+	Vec k, f;
+	splitLogArgument(x, k, f);
+
+	// log(1 + f) = f - f^2 / 2 + s * (f^2 / 2 + R(s^2)) with s = f / (2 + f), see fdlibm's "e_log.c".
+	static constexpr double lgOdd[] = {
+		0x1.5555555555593p-1, 0x1.2492494229359p-2, 0x1.7466496cb03dep-3, 0x1.2f112df3e5244p-3
+	};
+	static constexpr double lgEven[] = { 0x1.999999997fa04p-2, 0x1.c71c51d8e78afp-3, 0x1.39a09d078c69fp-3 };
+	Vec hfsq = mul(mul(broadcast(0.5), f), f);
+	Vec s = div(f, add(broadcast(2), f));
+	Vec z = mul(s, s);
+	Vec w = mul(z, z);
+	Vec r = add(mul(z, polynomial(w, lgOdd)), mul(w, polynomial(w, lgEven)));
+	Vec result = add(add(sub(mulAdd(s, add(hfsq, r), mul(k, broadcast(ln2Lo))), hfsq), f), mul(k, broadcast(ln2Hi)));
+
+	result = select(lt(x, broadcast(0)), broadcast(std::numeric_limits<double>::quiet_NaN()), result);
+	result = select(eq(x, broadcast(0)), broadcast(-HUGE_VAL), result);
+	return select(orMask(eq(x, broadcast(HUGE_VAL)), isNaN(x)), x, result);
+}
+
+// Returns `hi + lo` = log(x) with a relative error of about 2^-66, for positive finite `x`.
+inline void logExtendedKernel(Vec x, Vec& hi, Vec& lo)
+{
+	Vec k, f;
+	splitLogArgument(x, k, f);
+
+	// s = f / (2 + f) as a double-double. `d + dLo` is 2 + f exactly.
+	Vec d, dLo;
+	fastTwoSum(broadcast(2), f, d, dLo);
+	Vec s = div(f, d);
+	Vec p, pLo;
+	twoProduct(s, d, p, pLo);
+	Vec sLo = div(sub(sub(sub(f, p), pLo), mul(s, dLo)), d);
+
+	// log(1 + f) = 2 s + 2/3 s^3 + s^5 * R(s^2), where R has the Taylor coefficients 2/5, 2/7, ... The first two terms
+	// are computed as double-doubles.
+	Vec z, zLo;
+	twoProduct(s, s, z, zLo);
+	Vec s3, s3Lo;
+	twoProduct(z, s, s3, s3Lo);
+	s3Lo = add(s3Lo, mulAdd(zLo, s, mul(mul(broadcast(3), z), sLo)));
+	Vec u, uLo;
+	twoProduct(s3, broadcast(0x1.5555555555555p-1), u, uLo);  // 2/3
+	uLo = add(uLo, mulAdd(s3, broadcast(0x1.5555555555555p-55), mul(s3Lo, broadcast(0x1.5555555555555p-1))));
+	static constexpr double rest[] = {
+		2.0 / 5, 2.0 / 7, 2.0 / 9, 2.0 / 11, 2.0 / 13, 2.0 / 15, 2.0 / 17, 2.0 / 19, 2.0 / 21, 2.0 / 23, 2.0 / 25
+	};
+	Vec tail = mul(mul(s3, z), polynomial(z, rest));
+
+	Vec h, e1, h2, e2;
+	twoSum(mul(k, broadcast(ln2Hi)), add(s, s), h, e1);
+	twoSum(h, u, h2, e2);
+	Vec l = add(add(add(e1, e2), add(sLo, sLo)), add(add(uLo, tail), mul(k, broadcast(ln2Lo))));
+	fastTwoSum(h2, l, hi, lo);
+}
+
+struct ExpOp
+{
+	static Vec vector(Vec x, Mask&)
+	{
+		return expKernel(x, broadcast(0));
+	}
+
+	static double scalar(double x) { return evaluate(Exp{ }, x); }
+};
+
+struct LogOp
+{
+	static Vec vector(Vec x, Mask&)
+	{
+		return logKernel(x);
+	}
+
+	static double scalar(double x) { return evaluate(Log{ }, x); }
+};
+
+struct SqrtOp
+{
+	static Vec vector(Vec x, Mask&)
+	{
+		return sqrt(x);
+	}
+
+	static double scalar(double x) { return evaluate(Sqrt{ }, x); }
+};
+
+
+// Trigonometric functions
+
+// Reduces `x` to `hi + lo` = x - n * pi/2 with |hi + lo| <= pi/4, and returns the integer `n`. Requires |x| < 1.6e6,
+// so that n < 2^20.
+inline Vec reduceQuadrant(Vec x, Vec& hi, Vec& lo)
+{
+	// pi/2 is split into parts of at most 33 bits, so that their products with `n` are exact, and a last part of 53
+	// bits, see fdlibm's "e_rem_pio2.c".
+	Vec n = round(mul(x, broadcast(0x1.45f306dc9c883p-1)));  // 2 / pi
+	Vec r = sub(x, mul(n, broadcast(0x1.921fb544p0)));
+	Vec r2, e2, r3, e3;
+	twoSum(r, mul(n, broadcast(-0x1.0b4611a6p-34)), r2, e2);
+	twoSum(r2, mul(n, broadcast(-0x1.3198a2ep-69)), r3, e3);
+	Vec tail = sub(add(e2, e3), mul(n, broadcast(0x1.b839a252049c1p-104)));
+	fastTwoSum(r3, tail, hi, lo);
+	return n;
+}
+
+// sin(x + y) for |x + y| <= pi/4, see fdlibm's "k_sin.c".
+inline Vec sinKernel(Vec x, Vec y)
+{
+	static constexpr double s[] = {
+		0x1.111111110f8a6p-7, -0x1.a01a019c161d5p-13, 0x1.71de357b1fe7dp-19, -0x1.ae5e68a2b9cebp-26,
+		0x1.5d93a5acfd57cp-33
+	};
+	Vec z = mul(x, x);
+	Vec v = mul(z, x);
+	Vec r = polynomial(z, s);
+	Vec t = sub(mul(z, sub(mul(broadcast(0.5), y), mul(v, r))), y);
+	return sub(x, sub(t, mul(v, broadcast(-0x1.5555555555549p-3))));
+}
+
+// cos(x + y) for |x + y| <= pi/4, see fdlibm's "k_cos.c".
+inline Vec cosKernel(Vec x, Vec y)
+{
+	static constexpr double c1[] = { 0x1.555555555554cp-5, -0x1.6c16c16c15177p-10, 0x1.a01a019cb159p-16 };
+	static constexpr double c2[] = { -0x1.27e4f809c52adp-22, 0x1.1ee9ebdb4b1c4p-29, -0x1.8fae9be8838d4p-37 };
+	Vec z = mul(x, x);
+	Vec w = mul(z, z);
+	Vec r = add(mul(z, polynomial(z, c1)), mul(mul(w, w), polynomial(z, c2)));
+	Vec hz = mul(broadcast(0.5), z);
+	Vec one = broadcast(1);
+	w = sub(one, hz);
+	return add(w, add(sub(sub(one, w), hz), sub(mul(z, r), mul(x, y))));
+}
+
+// Arguments whose reduction would need more bits of pi, infinities and NaNs are passed to the scalar functions.
+inline Mask needsScalarReduction(Vec x)
+{
+	return notMask(lt(abs(x), broadcast(1.6e6)));
+}
+
+// Computes sin(r) and cos(r) of the reduced argument and returns the quadrant `n mod 4` of `x` in the low bits.
+inline Bits sinCosReduced(Vec x, Vec& sinR, Vec& cosR)
+{
+	Vec hi, lo;
+	Vec n = reduceQuadrant(x, hi, lo);
+	sinR = sinKernel(hi, lo);
+	cosR = cosKernel(hi, lo);
+	return integerBits(n);
+}
+
+struct SinOp
+{
+	static Vec vector(Vec x, Mask& fallback)
+	{
+		fallback = needsScalarReduction(x);
+		Vec s, c;
+		Bits quadrant = sinCosReduced(x, s, c);
+
+		// sin(r + n pi/2) is sin(r), cos(r), -sin(r), -cos(r) for n = 0, 1, 2, 3 modulo 4.
+		Mask odd = eqBits(andBits(quadrant, broadcastBits(1)), broadcastBits(1));
+		Vec result = flipSign(select(odd, c, s), shiftLeft<62>(andBits(quadrant, broadcastBits(2))));
+
+		// Keep the sign of zero, which the reduction loses.
+		return select(eq(x, broadcast(0)), x, result);
+	}
+
+	static double scalar(double x) { return evaluate(Sin{ }, x); }
+};
+
+struct CosOp
+{
+	static Vec vector(Vec x, Mask& fallback)
+	{
+		fallback = needsScalarReduction(x);
+		Vec s, c;
+		Bits quadrant = addBits(sinCosReduced(x, s, c), broadcastBits(1));
+
+		// cos(x) = sin(x + pi/2)
+		Mask odd = eqBits(andBits(quadrant, broadcastBits(1)), broadcastBits(1));
+		return flipSign(select(odd, c, s), shiftLeft<62>(andBits(quadrant, broadcastBits(2))));
+	}
+
+	static double scalar(double x) { return evaluate(Cos{ }, x); }
+};
+
+struct TanOp
+{
+	static Vec vector(Vec x, Mask& fallback)
+	{
+		fallback = needsScalarReduction(x);
+		Vec s, c;
+		Bits quadrant = sinCosReduced(x, s, c);
+
+		// tan(r + n pi/2) is tan(r) for even n, and -cot(r) for odd n.
+		Mask odd = eqBits(andBits(quadrant, broadcastBits(1)), broadcastBits(1));
+		Vec result = div(select(odd, negate(c), s), select(odd, s, c));
+		return select(eq(x, broadcast(0)), x, result);
+	}
+
+	static double scalar(double x) { return evaluate(Tan{ }, x); }
+};
+
+
+// Inverse trigonometric functions
+
+// atan(x), see fdlibm's "s_atan.c".
+inline Vec atanKernel(Vec x)
+{
+	// atan(|x|) = atan(c) + atan(t) for one of the points c = 0, 1/2, 1, 3/2, infinity, where t is small.
+	Vec a = abs(x);
+	Vec one = broadcast(1);
+	Mask small = lt(a, broadcast(0x1.cp-2));  // 7/16
+	Mask half = lt(a, broadcast(0x1.6p-1));  // 11/16
+	Mask unit = lt(a, broadcast(0x1.3p0));  // 19/16
+	Mask threeHalves = lt(a, broadcast(0x1.38p1));  // 39/16
+
+	Vec num = select(small, a, select(half, sub(add(a, a), one), select(unit, sub(a, one),
+		select(threeHalves, sub(a, broadcast(1.5)), broadcast(-1)))));
+	Vec den = select(small, one, select(half, add(broadcast(2), a), select(unit, add(a, one),
+		select(threeHalves, mulAdd(broadcast(1.5), a, one), a))));
+	Vec atanHi = select(small, broadcast(0), select(half, broadcast(0x1.dac670561bb4fp-2),
+		select(unit, broadcast(0x1.921fb54442d18p-1), select(threeHalves, broadcast(0x1.f730bd281f69bp-1),
+			broadcast(0x1.921fb54442d18p0)))));
+	Vec atanLo = select(small, broadcast(0), select(half, broadcast(0x1.a2b7f222f65e2p-56),
+		select(unit, broadcast(0x1.1a62633145c07p-55), select(threeHalves, broadcast(0x1.007887af0cbbdp-56),
+			broadcast(0x1.1a62633145c07p-54)))));
+	Vec t = div(num, den);
+
+	static constexpr double odd[] = {
+		0x1.555555555550dp-2, 0x1.24924920083ffp-3, 0x1.745cdc54c206ep-4, 0x1.10d66a0d03d51p-4, 0x1.97b4b24760debp-5,
+		0x1.0ad3ae322da11p-6
+	};
+	static constexpr double even[] = {
+		-0x1.999999998ebc4p-3, -0x1.c71c6fe231671p-4, -0x1.3b0f2af749a6dp-4, -0x1.dde2d52defd9ap-5, -0x1.2b4442c6a6c2fp-5
+	};
+	Vec z = mul(t, t);
+	Vec w = mul(z, z);
+	Vec s = add(mul(z, polynomial(w, odd)), mul(w, polynomial(w, even)));
+	Vec result = sub(atanHi, sub(sub(mul(t, s), atanLo), t));
+	return flipSign(result, signBit(x));
+}
+
+struct ArcTanOp
+{
+	static Vec vector(Vec x, Mask&)
+	{
+		return atanKernel(x);
+	}
+
+	static double scalar(double x) { return evaluate(ArcTan{ }, x); }
+};
+
+struct ArcSinOp
+{
+	static Vec vector(Vec x, Mask&)
+	{
+		// asin(x) = atan(x / sqrt(1 - x^2)). Factoring 1 - x^2 avoids cancellation for |x| near 1, and yields NaN for
+		// |x| > 1.
+		Vec one = broadcast(1);
+		return atanKernel(div(x, sqrt(mul(sub(one, x), add(one, x)))));
+	}
+
+	static double scalar(double x) { return evaluate(ArcSin{ }, x); }
+};
+
+struct ArcCosOp
+{
+	static Vec vector(Vec x, Mask&)
+	{
+		// acos(x) = 2 atan(sqrt((1 - x) / (1 + x))), which is accurate near both ends, unlike pi/2 - asin(x).
+		Vec one = broadcast(1);
+		Vec a = atanKernel(sqrt(div(sub(one, x), add(one, x))));
+		return add(a, a);
+	}
+
+	static double scalar(double x) { return evaluate(ArcCos{ }, x); }
+};
+
+
+// Binary functions
+
+struct PowOp
+{
+	static Vec vector(Vec x, Vec y, Mask& fallback)
+	{
+		// Zeros, infinities and NaNs have many special cases, which are left to the scalar function, as are huge
+		// exponents, whose products overflow when they are split without FMA. The results of these are 0, 1 or infinite.
+		fallback = notMask(andMask(andMask(isFinite(x), ne(x, broadcast(0))), lt(abs(y), broadcast(0x1p64))));
+
+		// |x|^y = e^(y log|x|), where the logarithm and the product are computed as double-doubles, since the error of
+		// the exponent is multiplied by up to 710.
+		Vec logHi, logLo;
+		logExtendedKernel(abs(x), logHi, logLo);
+		Vec e, eLo;
+		twoProduct(y, logHi, e, eLo);
+		eLo = mulAdd(y, logLo, eLo);
+		Vec result = expKernel(e, eLo);
+
+		// Negative bases are only defined for integral exponents; odd exponents keep the sign.
+		Mask negative = lt(x, broadcast(0));
+		Mask integral = eq(round(y), y);
+		Vec halfY = mul(y, broadcast(0.5));
+		Mask odd = andMask(integral, ne(round(halfY), halfY));
+		result = select(andMask(negative, odd), negate(result), result);
+		result = select(andMask(negative, notMask(integral)), broadcast(std::numeric_limits<double>::quiet_NaN()), result);
+
+		// Squares are computed exactly like `evaluate(Pow, ...)` computes them.
+		return select(eq(y, broadcast(2)), mul(x, x), result);
+	}
+
+	static double scalar(double x, double y) { return evaluate(Pow{ }, x, y); }
+};
+
+struct LogBaseOp
+{
+	static Vec vector(Vec base, Vec val, Mask&)
+	{
+		return div(logKernel(val), logKernel(base));
+	}
+
+	static double scalar(double base, double val) { return evaluate(LogBase{ }, base, val); }
+};
+
+
+// Loops
+
+// Evaluates `Op` for one vector of arguments and stores the first `count` results. Lanes the vectorized algorithm
+// does not handle are computed with the scalar function.
+template <typename Op>
+inline void evaluateLanes(Vec x, double* result, std::size_t count)
+{
+	Mask fallback = noLanes();
+	Vec r = Op::vector(x, fallback);
+	unsigned fallbackLanes = laneBits(fallback);
+	double values[lanes];
+	store(values, r);
+	if (fallbackLanes != 0)
+	{
+		double xs[lanes];
+		store(xs, x);
+		for (std::size_t i = 0; i != lanes; ++i)
+		{
+			if ((fallbackLanes >> i) & 1)
+			{
+				values[i] = Op::scalar(xs[i]);
+			}
+		}
+	}
+	std::copy_n(values, count, result);
+}
+
+template <typename Op>
+inline void evaluateLanes(Vec x, Vec y, double* result, std::size_t count)
+{
+	Mask fallback = noLanes();
+	Vec r = Op::vector(x, y, fallback);
+	unsigned fallbackLanes = laneBits(fallback);
+	double values[lanes];
+	store(values, r);
+	if (fallbackLanes != 0)
+	{
+		double xs[lanes], ys[lanes];
+		store(xs, x);
+		store(ys, y);
+		for (std::size_t i = 0; i != lanes; ++i)
+		{
+			if ((fallbackLanes >> i) & 1)
+			{
+				values[i] = Op::scalar(xs[i], ys[i]);
+			}
+		}
+	}
+	std::copy_n(values, count, result);
+}
+
+// Reads the last `count < lanes` elements into a vector. The remaining lanes are set to 1, which is in the domain of
+// every function.
+inline Vec loadPartial(double const* x, std::size_t count)
+{
+	double values[lanes];
+	std::fill_n(values, lanes, 1.0);
+	std::copy_n(x, count, values);
+	return load(values);
+}
+
+template <typename Op>
+void unaryKernel(double const* x, double* result, std::size_t n)
+{
+	std::size_t i = 0;
+	for (; n - i >= lanes; i += lanes)
+	{
+		// A full vector is loaded before anything is stored, so `result` may be `x`.
+		evaluateLanes<Op>(load(x + i), result + i, lanes);
+	}
+	if (i != n)
+	{
+		evaluateLanes<Op>(loadPartial(x + i, n - i), result + i, n - i);
+	}
+}
+
+template <typename Op>
+void binaryKernel(double const* x, bool broadcastX, double const* y, bool broadcastY, double* result, std::size_t n)
+{
+	if (n == 0)
+	{
+		return;
+	}
+	Vec xScalar = broadcast(x[0]);
+	Vec yScalar = broadcast(y[0]);
+	std::size_t i = 0;
+	for (; n - i >= lanes; i += lanes)
+	{
+		evaluateLanes<Op>(broadcastX ? xScalar : load(x + i), broadcastY ? yScalar : load(y + i), result + i, lanes);
+	}
+	if (i != n)
+	{
+		evaluateLanes<Op>(broadcastX ? xScalar : loadPartial(x + i, n - i),
+			broadcastY ? yScalar : loadPartial(y + i, n - i), result + i, n - i);
+	}
+}
+
+// Loops over the scalar function, for where the vectorized algorithm is slower.
+template <typename Op>
+void scalarUnaryKernel(double const* x, double* result, std::size_t n)
+{
+	for (std::size_t i = 0; i != n; ++i)
+	{
+		result[i] = Op::scalar(x[i]);
+	}
+}
+
+template <typename Op>
+void scalarBinaryKernel(double const* x, bool broadcastX, double const* y, bool broadcastY, double* result,
+	std::size_t n)
+{
+	for (std::size_t i = 0; i != n; ++i)
+	{
+		result[i] = Op::scalar(x[broadcastX ? 0 : i], y[broadcastY ? 0 : i]);
+	}
+}
+
+inline constexpr VectorMathKernels kernels = {
+	name,
+	unaryKernel<SqrtOp>,
+	unaryKernel<ExpOp>,
+	unaryKernel<LogOp>,
+	// Without FMA, the vectorized trigonometric functions are slower than the C library.
+	hasFma ? unaryKernel<SinOp> : scalarUnaryKernel<SinOp>,
+	hasFma ? unaryKernel<CosOp> : scalarUnaryKernel<CosOp>,
+	hasFma ? unaryKernel<TanOp> : scalarUnaryKernel<TanOp>,
+	unaryKernel<ArcSinOp>,
+	unaryKernel<ArcCosOp>,
+	unaryKernel<ArcTanOp>,
+	// Without FMA, the double-double products of `PowOp` make it slower than the C library.
+	hasFma ? binaryKernel<PowOp> : scalarBinaryKernel<PowOp>,
+	binaryKernel<LogBaseOp>
+};
@@ -0,0 +1,383 @@
+#include <cmath>        // for HUGE_VAL
+#include <limits>
+#include <vector>
+#include <cstdint>      // for uint64_t
+#include <algorithm>    // for copy_n(), fill_n()
+
+#if defined(__x86_64__) || defined(_M_X64)
+# include <immintrin.h>
+# ifdef _MSC_VER
+#  include <intrin.h>  // for __cpuid(), __cpuidex()
+# endif // _MSC_VER
+#endif // defined(__x86_64__) || defined(_M_X64)
+
+#include "vector-math.h"
+
+namespace asc::cpp_practice_ws20::ex08 {
+
+	namespace expr {
+
+		namespace detail {
+
+#if defined(__x86_64__) || defined(_M_X64)
+
+			// GCC and Clang only emit instructions of an extension in functions compiled for it, so every function of
+			// the kernels is compiled for the instruction set of its namespace. Visual C++ emits whatever intrinsics are
+			// used.
+
+#if defined(__clang__)
+# pragma clang attribute push(__attribute__((target("sse4.2"))), apply_to = function)
+#elif defined(__GNUC__)
+# pragma GCC push_options
+# pragma GCC target("sse4.2")
+#endif
+
+			namespace sse42 {
+
+				using Vec = __m128d;
+				using Bits = __m128i;
+				using Mask = __m128d;
+
+				constexpr std::size_t lanes = 2;
+				constexpr bool hasFma = false;
+				constexpr char const* name = "SSE4.2";
+
+				inline Vec load(double const* p) { return _mm_loadu_pd(p); }
+				inline void store(double* p, Vec x) { _mm_storeu_pd(p, x); }
+				inline Vec broadcast(double x) { return _mm_set1_pd(x); }
+
+				inline Vec add(Vec a, Vec b) { return _mm_add_pd(a, b); }
+				inline Vec sub(Vec a, Vec b) { return _mm_sub_pd(a, b); }
+				inline Vec mul(Vec a, Vec b) { return _mm_mul_pd(a, b); }
+				inline Vec div(Vec a, Vec b) { return _mm_div_pd(a, b); }
+				inline Vec mulAdd(Vec a, Vec b, Vec c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+				inline Vec sqrt(Vec x) { return _mm_sqrt_pd(x); }
+				inline Vec round(Vec x) { return _mm_round_pd(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+
+				inline Mask lt(Vec a, Vec b) { return _mm_cmplt_pd(a, b); }
+				inline Mask eq(Vec a, Vec b) { return _mm_cmpeq_pd(a, b); }
+				inline Mask ne(Vec a, Vec b) { return _mm_cmpneq_pd(a, b); }  // true if either is NaN
+				inline Mask andMask(Mask a, Mask b) { return _mm_and_pd(a, b); }
+				inline Mask orMask(Mask a, Mask b) { return _mm_or_pd(a, b); }
+				inline Mask notMask(Mask a) { return _mm_xor_pd(a, _mm_castsi128_pd(_mm_set1_epi64x(-1))); }
+				inline Mask noLanes() { return _mm_setzero_pd(); }
+				inline unsigned laneBits(Mask m) { return unsigned(_mm_movemask_pd(m)); }
+				inline Vec select(Mask m, Vec ifTrue, Vec ifFalse) { return _mm_blendv_pd(ifFalse, ifTrue, m); }
+
+				inline Bits toBits(Vec x) { return _mm_castpd_si128(x); }
+				inline Vec fromBits(Bits x) { return _mm_castsi128_pd(x); }
+				inline Bits broadcastBits(std::uint64_t x) { return _mm_set1_epi64x(static_cast<long long>(x)); }
+				inline Bits addBits(Bits a, Bits b) { return _mm_add_epi64(a, b); }
+				inline Bits andBits(Bits a, Bits b) { return _mm_and_si128(a, b); }
+				inline Bits orBits(Bits a, Bits b) { return _mm_or_si128(a, b); }
+				inline Bits xorBits(Bits a, Bits b) { return _mm_xor_si128(a, b); }
+				template <int N> inline Bits shiftLeft(Bits x) { return _mm_slli_epi64(x, N); }
+				template <int N> inline Bits shiftRight(Bits x) { return _mm_srli_epi64(x, N); }
+				inline Mask eqBits(Bits a, Bits b) { return _mm_castsi128_pd(_mm_cmpeq_epi64(a, b)); }
+
+#include "vector-math-kernels.h"
+			}
+
+#if defined(__clang__)
+# pragma clang attribute pop
+# pragma clang attribute push(__attribute__((target("avx2,fma"))), apply_to = function)
+#elif defined(__GNUC__)
+# pragma GCC pop_options
+# pragma GCC push_options
+# pragma GCC target("avx2,fma")
+#endif
+
+			namespace avx2 {
+
+				using Vec = __m256d;
+				using Bits = __m256i;
+				using Mask = __m256d;
+
+				constexpr std::size_t lanes = 4;
+				constexpr bool hasFma = true;
+				constexpr char const* name = "AVX2";
+
+				inline Vec load(double const* p) { return _mm256_loadu_pd(p); }
+				inline void store(double* p, Vec x) { _mm256_storeu_pd(p, x); }
+				inline Vec broadcast(double x) { return _mm256_set1_pd(x); }
+
+				inline Vec add(Vec a, Vec b) { return _mm256_add_pd(a, b); }
+				inline Vec sub(Vec a, Vec b) { return _mm256_sub_pd(a, b); }
+				inline Vec mul(Vec a, Vec b) { return _mm256_mul_pd(a, b); }
+				inline Vec div(Vec a, Vec b) { return _mm256_div_pd(a, b); }
+				inline Vec mulAdd(Vec a, Vec b, Vec c) { return _mm256_fmadd_pd(a, b, c); }
+				inline Vec sqrt(Vec x) { return _mm256_sqrt_pd(x); }
+				inline Vec round(Vec x) { return _mm256_round_pd(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+
+				inline Mask lt(Vec a, Vec b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+				inline Mask eq(Vec a, Vec b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+				inline Mask ne(Vec a, Vec b) { return _mm256_cmp_pd(a, b, _CMP_NEQ_UQ); }
+				inline Mask andMask(Mask a, Mask b) { return _mm256_and_pd(a, b); }
+				inline Mask orMask(Mask a, Mask b) { return _mm256_or_pd(a, b); }
+				inline Mask notMask(Mask a) { return _mm256_xor_pd(a, _mm256_castsi256_pd(_mm256_set1_epi64x(-1))); }
+				inline Mask noLanes() { return _mm256_setzero_pd(); }
+				inline unsigned laneBits(Mask m) { return unsigned(_mm256_movemask_pd(m)); }
+				inline Vec select(Mask m, Vec ifTrue, Vec ifFalse) { return _mm256_blendv_pd(ifFalse, ifTrue, m); }
+
+				inline Bits toBits(Vec x) { return _mm256_castpd_si256(x); }
+				inline Vec fromBits(Bits x) { return _mm256_castsi256_pd(x); }
+				inline Bits broadcastBits(std::uint64_t x) { return _mm256_set1_epi64x(static_cast<long long>(x)); }
+				inline Bits addBits(Bits a, Bits b) { return _mm256_add_epi64(a, b); }
+				inline Bits andBits(Bits a, Bits b) { return _mm256_and_si256(a, b); }
+				inline Bits orBits(Bits a, Bits b) { return _mm256_or_si256(a, b); }
+				inline Bits xorBits(Bits a, Bits b) { return _mm256_xor_si256(a, b); }
+				template <int N> inline Bits shiftLeft(Bits x) { return _mm256_slli_epi64(x, N); }
+				template <int N> inline Bits shiftRight(Bits x) { return _mm256_srli_epi64(x, N); }
+				inline Mask eqBits(Bits a, Bits b) { return _mm256_castsi256_pd(_mm256_cmpeq_epi64(a, b)); }
+
+#include "vector-math-kernels.h"
+			}
+
+#if defined(__clang__)
+# pragma clang attribute pop
+# pragma clang attribute push(__attribute__((target("avx512f,avx2,fma"))), apply_to = function)
+#elif defined(__GNUC__)
+# pragma GCC pop_options
+# pragma GCC push_options
+# pragma GCC target("avx512f,avx2,fma")
+// GCC 12 warns about the undefined vectors many AVX-512 intrinsics start from.
+# pragma GCC diagnostic push
+# pragma GCC diagnostic ignored "-Wuninitialized"
+# pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+			namespace avx512 {
+
+				using Vec = __m512d;
+				using Bits = __m512i;
+				using Mask = __mmask8;
+
+				constexpr std::size_t lanes = 8;
+				constexpr bool hasFma = true;
+				constexpr char const* name = "AVX-512";
+
+				inline Vec load(double const* p) { return _mm512_loadu_pd(p); }
+				inline void store(double* p, Vec x) { _mm512_storeu_pd(p, x); }
+				inline Vec broadcast(double x) { return _mm512_set1_pd(x); }
+
+				inline Vec add(Vec a, Vec b) { return _mm512_add_pd(a, b); }
+				inline Vec sub(Vec a, Vec b) { return _mm512_sub_pd(a, b); }
+				inline Vec mul(Vec a, Vec b) { return _mm512_mul_pd(a, b); }
+				inline Vec div(Vec a, Vec b) { return _mm512_div_pd(a, b); }
+				inline Vec mulAdd(Vec a, Vec b, Vec c) { return _mm512_fmadd_pd(a, b, c); }
+				inline Vec sqrt(Vec x) { return _mm512_sqrt_pd(x); }
+				inline Vec round(Vec x) { return _mm512_roundscale_pd(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+
+				inline Mask lt(Vec a, Vec b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+				inline Mask eq(Vec a, Vec b) { return _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ); }
+				inline Mask ne(Vec a, Vec b) { return _mm512_cmp_pd_mask(a, b, _CMP_NEQ_UQ); }
+				inline Mask andMask(Mask a, Mask b) { return static_cast<Mask>(a & b); }
+				inline Mask orMask(Mask a, Mask b) { return static_cast<Mask>(a | b); }
+				inline Mask notMask(Mask a) { return static_cast<Mask>(~a); }
+				inline Mask noLanes() { return 0; }
+				inline unsigned laneBits(Mask m) { return m; }
+				inline Vec select(Mask m, Vec ifTrue, Vec ifFalse) { return _mm512_mask_blend_pd(m, ifFalse, ifTrue); }
+
+				inline Bits toBits(Vec x) { return _mm512_castpd_si512(x); }
+				inline Vec fromBits(Bits x) { return _mm512_castsi512_pd(x); }
+				inline Bits broadcastBits(std::uint64_t x) { return _mm512_set1_epi64(static_cast<long long>(x)); }
+				inline Bits addBits(Bits a, Bits b) { return _mm512_add_epi64(a, b); }
+				inline Bits andBits(Bits a, Bits b) { return _mm512_and_si512(a, b); }
+				inline Bits orBits(Bits a, Bits b) { return _mm512_or_si512(a, b); }
+				inline Bits xorBits(Bits a, Bits b) { return _mm512_xor_si512(a, b); }
+				template <int N> inline Bits shiftLeft(Bits x) { return _mm512_slli_epi64(x, N); }
+				template <int N> inline Bits shiftRight(Bits x) { return _mm512_srli_epi64(x, N); }
+				inline Mask eqBits(Bits a, Bits b) { return _mm512_cmpeq_epi64_mask(a, b); }
+
+#include "vector-math-kernels.h"
+			}
+
+#if defined(__clang__)
+# pragma clang attribute pop
+#elif defined(__GNUC__)
+# pragma GCC diagnostic pop
+# pragma GCC pop_options
+#endif
+
+			struct CpuFeatures
+			{
+				bool sse42 = false;
+				bool avx2 = false;  // with FMA
+				bool avx512 = false;
+			};
+
+			static CpuFeatures detectCpuFeatures() noexcept
+			{
+				auto features = CpuFeatures{ };
+#if defined(__GNUC__)
+				__builtin_cpu_init();
+				features.sse42 = __builtin_cpu_supports("sse4.2");
+				features.avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+				features.avx512 = __builtin_cpu_supports("avx512f");
+#else
+				// The extensions need support by the CPU (CPUID leaf 1, ECX bits 20 and 12, leaf 7, EBX bits 5 and 16) and
+				// by the OS, which must save the YMM and ZMM registers (CPUID leaf 1, ECX bit 27, and XCR0).
+				int info[4];
+				__cpuid(info, 1);
+				features.sse42 = (info[2] & (1 << 20)) != 0;
+				bool fma = (info[2] & (1 << 12)) != 0;
+				if ((info[2] & (1 << 27)) == 0)
+				{
+					return features;
+				}
+				auto xcr0 = _xgetbv(0);
+				__cpuidex(info, 7, 0);
+				features.avx2 = fma && (xcr0 & 0x6) == 0x6 && (info[1] & (1 << 5)) != 0;
+				features.avx512 = features.avx2 && (xcr0 & 0xe6) == 0xe6 && (info[1] & (1 << 16)) != 0;
+#endif
+				return features;
+			}
+
+			std::span<VectorMathKernels const> supportedVectorMathKernels()
+			{
+				static auto const supported = []
+				{
+					auto features = detectCpuFeatures();
+					auto result = std::vector<VectorMathKernels>{ };
+					if (features.sse42)
+					{
+						result.push_back(sse42::kernels);
+					}
+					if (features.avx2)
+					{
+						result.push_back(avx2::kernels);
+					}
+					if (features.avx512)
+					{
+						result.push_back(avx512::kernels);
+					}
+					return result;
+				}();
+				return supported;
+			}
+
+#else // defined(__x86_64__) || defined(_M_X64)
+
+			std::span<VectorMathKernels const> supportedVectorMathKernels()
+			{
+				return { };
+			}
+
+#endif // defined(__x86_64__) || defined(_M_X64)
+
+			static VectorMathKernels const* selectKernels()
+			{
+				auto supported = supportedVectorMathKernels();
+				return supported.empty() ? nullptr : &supported.back();
+			}
+
+			// Chosen once, when the program starts.
+			static VectorMathKernels const* const bestKernels = selectKernels();
+		}
+
+		template <typename F>
+		static void evaluateUnary(F f, detail::UnaryKernel detail::VectorMathKernels::* kernel,
+			std::span<double const> x, std::span<double> result)
+		{
+			if (detail::bestKernels == nullptr)
+			{
+				for (std::size_t i = 0, n = result.size(); i != n; ++i)
+				{
+					result[i] = evaluate(f, x[i]);
+				}
+				return;
+			}
+			(detail::bestKernels->*kernel)(x.data(), result.data(), result.size());
+		}
+
+		template <typename F>
+		static void evaluateBinary(F f, detail::BinaryKernel detail::VectorMathKernels::* kernel,
+			double const* x, bool broadcastX, double const* y, bool broadcastY, std::span<double> result)
+		{
+			if (detail::bestKernels == nullptr)
+			{
+				for (std::size_t i = 0, n = result.size(); i != n; ++i)
+				{
+					result[i] = evaluate(f, x[broadcastX ? 0 : i], y[broadcastY ? 0 : i]);
+				}
+				return;
+			}
+			(detail::bestKernels->*kernel)(x, broadcastX, y, broadcastY, result.data(), result.size());
+		}
+
+		void evaluate(Sqrt f, std::span<double const> x, std::span<double> result)
+		{
+			evaluateUnary(f, &detail::VectorMathKernels::sqrt, x, result);
+		}
+
+		void evaluate(Exp f, std::span<double const> x, std::span<double> result)
+		{
+			evaluateUnary(f, &detail::VectorMathKernels::exp, x, result);
+		}
+
+		void evaluate(Log f, std::span<double const> x, std::span<double> result)
+		{
+			evaluateUnary(f, &detail::VectorMathKernels::log, x, result);
+		}
+
+		void evaluate(Sin f, std::span<double const> x, std::span<double> result)
+		{
+			evaluateUnary(f, &detail::VectorMathKernels::sin, x, result);
+		}
+
+		void evaluate(Cos f, std::span<double const> x, std::span<double> result)
+		{
+			evaluateUnary(f, &detail::VectorMathKernels::cos, x, result);
+		}
+
+		void evaluate(Tan f, std::span<double const> x, std::span<double> result)
+		{
+			evaluateUnary(f, &detail::VectorMathKernels::tan, x, result);
+		}
+
+		void evaluate(ArcSin f, std::span<double const> x, std::span<double> result)
+		{
+			evaluateUnary(f, &detail::VectorMathKernels::arcSin, x, result);
+		}
+
+		void evaluate(ArcCos f, std::span<double const> x, std::span<double> result)
+		{
+			evaluateUnary(f, &detail::VectorMathKernels::arcCos, x, result);
+		}
+
+		void evaluate(ArcTan f, std::span<double const> x, std::span<double> result)
+		{
+			evaluateUnary(f, &detail::VectorMathKernels::arcTan, x, result);
+		}
+
+		void evaluate(Pow f, std::span<double const> base, std::span<double const> exp, std::span<double> result)
+		{
+			evaluateBinary(f, &detail::VectorMathKernels::pow, base.data(), false, exp.data(), false, result);
+		}
+
+		void evaluate(Pow f, std::span<double const> base, double exp, std::span<double> result)
+		{
+			evaluateBinary(f, &detail::VectorMathKernels::pow, base.data(), false, &exp, true, result);
+		}
+
+		void evaluate(Pow f, double base, std::span<double const> exp, std::span<double> result)
+		{
+			evaluateBinary(f, &detail::VectorMathKernels::pow, &base, true, exp.data(), false, result);
+		}
+
+		void evaluate(LogBase f, std::span<double const> base, std::span<double const> val, std::span<double> result)
+		{
+			evaluateBinary(f, &detail::VectorMathKernels::logBase, base.data(), false, val.data(), false, result);
+		}
+
+		void evaluate(LogBase f, std::span<double const> base, double val, std::span<double> result)
+		{
+			evaluateBinary(f, &detail::VectorMathKernels::logBase, base.data(), false, &val, true, result);
+		}
+
+		void evaluate(LogBase f, double base, std::span<double const> val, std::span<double> result)
+		{
+			evaluateBinary(f, &detail::VectorMathKernels::logBase, &base, true, val.data(), false, result);
+		}
+	}
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#ifndef ARITHMETIC_EXPRESSION_PARSER_VECTOR_MATH_HPP
+#define ARITHMETIC_EXPRESSION_PARSER_VECTOR_MATH_HPP
+
+#include <span>
+#include <cstddef>      // for size_t
+
+#include "expression.h"
+#include "expression-functions.h"
+
+namespace asc::cpp_practice_ws20::ex08 {
+
+	namespace expr {
+
+		// Array versions of the functions in "expression-functions.h", used by the vectorized evaluators. `result[i]` is
+		// the function value of the `i`-th elements of the arguments, and a scalar argument is broadcast. The result may
+		// be the same array as an argument; all arrays must have the same length.
+		//
+		// The transcendental functions are computed with SSE4.2, AVX2 and FMA, or AVX-512, whichever is the best the CPU
+		// supports, and differ from the scalar functions, i.e. from the C library, by at most (in units in the last place,
+		// measured by "vector-math-benchmark.cpp" with each instruction set):
+		//
+		//     Sqrt                0 (correctly rounded, like `std::sqrt()`)
+		//     Exp, Log            1
+		//     Sin, Cos            1 (0 with SSE4.2)
+		//     Tan                 2 (0 with SSE4.2)
+		//     ArcTan              1
+		//     ArcSin, ArcCos      2
+		//     Pow                 1 (0 with SSE4.2)
+		//     LogBase             3
+		//
+		// SSE4.2 lacks FMA, and without it the vectorized sine, cosine, tangent and power are slower than the C library,
+		// so with SSE4.2 these loop over the scalar functions.
+		//
+		// Squares, i.e. powers with the exponent 2, are computed exactly as by the scalar `evaluate(Pow, ...)`. Special
+		// values (infinities, NaNs, zeros, negative numbers) give the same results as the scalar functions. Arguments the
+		// vectorized algorithms do not cover, e.g. sines of numbers larger than 1.6e6, are passed to the scalar functions.
+		void evaluate(Sqrt, std::span<double const> x, std::span<double> result);
+		void evaluate(Exp, std::span<double const> x, std::span<double> result);
+		void evaluate(Log, std::span<double const> x, std::span<double> result);
+		void evaluate(Sin, std::span<double const> x, std::span<double> result);
+		void evaluate(Cos, std::span<double const> x, std::span<double> result);
+		void evaluate(Tan, std::span<double const> x, std::span<double> result);
+		void evaluate(ArcSin, std::span<double const> x, std::span<double> result);
+		void evaluate(ArcCos, std::span<double const> x, std::span<double> result);
+		void evaluate(ArcTan, std::span<double const> x, std::span<double> result);
+
+		void evaluate(Pow, std::span<double const> base, std::span<double const> exp, std::span<double> result);
+		void evaluate(Pow, std::span<double const> base, double exp, std::span<double> result);
+		void evaluate(Pow, double base, std::span<double const> exp, std::span<double> result);
+		void evaluate(LogBase, std::span<double const> base, std::span<double const> val, std::span<double> result);
+		void evaluate(LogBase, std::span<double const> base, double val, std::span<double> result);
+		void evaluate(LogBase, double base, std::span<double const> val, std::span<double> result);
+
+		// The remaining functions are plain loops, which the compiler vectorizes.
+		template <typename F>
+		void evaluate(F f, std::span<double const> x, std::span<double> result)
+		{
+			for (std::size_t i = 0, n = result.size(); i != n; ++i)
+			{
+				result[i] = evaluate(f, x[i]);
+			}
+		}
+
+		template <typename F>
+		void evaluate(F f, std::span<double const> x, std::span<double const> y, std::span<double> result)
+		{
+			for (std::size_t i = 0, n = result.size(); i != n; ++i)
+			{
+				result[i] = evaluate(f, x[i], y[i]);
+			}
+		}
+
+		template <typename F>
+		void evaluate(F f, std::span<double const> x, double y, std::span<double> result)
+		{
+			for (std::size_t i = 0, n = result.size(); i != n; ++i)
+			{
+				result[i] = evaluate(f, x[i], y);
+			}
+		}
+
+		template <typename F>
+		void evaluate(F f, double x, std::span<double const> y, std::span<double> result)
+		{
+			for (std::size_t i = 0, n = result.size(); i != n; ++i)
+			{
+				result[i] = evaluate(f, x, y[i]);
+			}
+		}
+
+		namespace detail {
+
+			using UnaryKernel = void (*)(double const* x, double* result, std::size_t n);
+
+			// A broadcast argument is read from `x[0]` or `y[0]` only.
+			using BinaryKernel = void (*)(double const* x, bool broadcastX, double const* y, bool broadcastY,
+				double* result, std::size_t n);
+
+			// The implementations of the array functions for one instruction set.
+			struct VectorMathKernels {
+				char const* name;
+				UnaryKernel sqrt;
+				UnaryKernel exp;
+				UnaryKernel log;
+				UnaryKernel sin;
+				UnaryKernel cos;
+				UnaryKernel tan;
+				UnaryKernel arcSin;
+				UnaryKernel arcCos;
+				UnaryKernel arcTan;
+				BinaryKernel pow;
+				BinaryKernel logBase;
+			};
+
+			// The kernels for every instruction set the CPU supports, from the oldest to the best, which is the one the
+			// array functions use. Empty on other architectures than x86-64; the array functions then call the scalar
+			// functions. Exposed for benchmarking.
+			std::span<VectorMathKernels const> supportedVectorMathKernels();
+		}
+	}
+}
+
+#endif // !ARITHMETIC_EXPRESSION_PARSER_VECTOR_MATH_HPP
@@ -0,0 +1,533 @@
+#include <bit>          // for bit_cast<>()
+#include <cstdint>      // for uint8_t, int32_t, uint64_t
+#include <cstring>      // for memcpy()
+#include <utility>      // for exchange()
+#include <stdexcept>    // for invalid_argument
+
+#include "expression-jit.h"
+#include "expression-evaluate.h"   // for BroadcastError
+#include "expression-functions.h"
+
+#if defined(__x86_64__) && !defined(_WIN32)
+# define ARITHMETIC_EXPRESSION_PARSER_NATIVE_JIT
+# include <sys/mman.h>  // for mmap(), mprotect(), munmap()
+#endif
+
+namespace asc::cpp_practice_ws20::ex08 {
+
+	namespace expr {
+
+#ifdef ARITHMETIC_EXPRESSION_PARSER_NATIVE_JIT
+
+		namespace {
+
+			// The functions which are not single instructions are called through these, so that the native code computes
+			// exactly what the interpreter computes.
+			template <typename F>
+			double callUnary(double x)
+			{
+				return evaluate(F{ }, x);
+			}
+
+			template <typename F>
+			double callBinary(double x, double y)
+			{
+				return evaluate(F{ }, x, y);
+			}
+
+			// A memory operand of the forms the generated code uses.
+			struct Memory {
+				enum class Kind {
+					stack,        // [rsp + offset], a stack slot or temporary
+					variable,     // [rbx + offset], a variable value of the scalar function
+					data,         // [rip + ...], the constant at `offset` from the start of the code memory
+					column,       // [rax + r14 * 8], the current row of the column `rax` points to
+					result        // [r12 + r14 * 8], the current row of the result
+				};
+
+				Kind kind;
+				std::int32_t offset = 0;
+			};
+
+			// Emits the few x86-64 instruction forms needed, with fixed registers: `xmm0` holds the top of the evaluation
+			// stack, `xmm1` the second argument of a binary operation, `rbx` the variable values or column pointers, and
+			// `r12`, `r13` and `r14` the result pointer, row count and row index of the batch function.
+			class Assembler {
+			private:
+				std::vector<std::uint8_t> bytes_;
+
+				void imm32(std::int32_t value)
+				{
+					auto bits = std::bit_cast<std::uint32_t>(value);
+					for (int i = 0; i != 4; ++i)
+					{
+						bytes_.push_back(static_cast<std::uint8_t>(bits >> (8 * i)));
+					}
+				}
+
+				// An SSE instruction `prefix 0F opcode` with a register and a memory operand.
+				void sse(std::uint8_t prefix, std::uint8_t opcode, int xmm, Memory memory)
+				{
+					bytes_.push_back(prefix);
+					if (memory.kind == Memory::Kind::column)
+					{
+						emit({ 0x42 });  // REX.X for the index r14
+					}
+					else if (memory.kind == Memory::Kind::result)
+					{
+						emit({ 0x43 });  // REX.X and REX.B for the index r14 and the base r12
+					}
+					emit({ 0x0f, opcode });
+					auto reg = static_cast<std::uint8_t>(xmm << 3);
+					switch (memory.kind)
+					{
+					case Memory::Kind::stack:
+						emit({ static_cast<std::uint8_t>(0x84 | reg), 0x24 });
+						imm32(memory.offset);
+						break;
+					case Memory::Kind::variable:
+						emit({ static_cast<std::uint8_t>(0x83 | reg) });
+						imm32(memory.offset);
+						break;
+					case Memory::Kind::data:
+						// The displacement is relative to the end of the instruction.
+						emit({ static_cast<std::uint8_t>(0x05 | reg) });
+						imm32(memory.offset - static_cast<std::int32_t>(bytes_.size() + 4));
+						break;
+					case Memory::Kind::column:
+						emit({ static_cast<std::uint8_t>(0x04 | reg), 0xf0 });
+						break;
+					case Memory::Kind::result:
+						emit({ static_cast<std::uint8_t>(0x04 | reg), 0xf4 });
+						break;
+					}
+				}
+
+			public:
+				std::vector<std::uint8_t> const& bytes() const noexcept
+				{
+					return bytes_;
+				}
+
+				std::size_t size() const noexcept
+				{
+					return bytes_.size();
+				}
+
+				void emit(std::initializer_list<std::uint8_t> bytes)
+				{
+					bytes_.insert(bytes_.end(), bytes);
+				}
+
+				void align(std::size_t alignment)
+				{
+					while (bytes_.size() % alignment != 0)
+					{
+						bytes_.push_back(0xcc);  // int3
+					}
+				}
+
+				// Stores a constant at the current position and returns its offset.
+				std::int32_t data(double value)
+				{
+					auto offset = static_cast<std::int32_t>(bytes_.size());
+					auto bits = std::bit_cast<std::uint64_t>(value);
+					for (int i = 0; i != 8; ++i)
+					{
+						bytes_.push_back(static_cast<std::uint8_t>(bits >> (8 * i)));
+					}
+					return offset;
+				}
+
+				void load(int xmm, Memory source) { sse(0xf2, 0x10, xmm, source); }        // movsd xmm, m64
+				void store(Memory target, int xmm) { sse(0xf2, 0x11, xmm, target); }       // movsd m64, xmm
+				void add(Memory y) { sse(0xf2, 0x58, 0, y); }                              // addsd xmm0, m64
+				void multiply(Memory y) { sse(0xf2, 0x59, 0, y); }                         // mulsd xmm0, m64
+				void subtract(Memory y) { sse(0xf2, 0x5c, 0, y); }                         // subsd xmm0, m64
+				void divide(Memory y) { sse(0xf2, 0x5e, 0, y); }                           // divsd xmm0, m64
+
+				// Binary operations of `xmm0` and `xmm1` into `xmm0`.
+				void add() { emit({ 0xf2, 0x0f, 0x58, 0xc1 }); }
+				void multiply() { emit({ 0xf2, 0x0f, 0x59, 0xc1 }); }
+				void subtract() { emit({ 0xf2, 0x0f, 0x5c, 0xc1 }); }
+				void divide() { emit({ 0xf2, 0x0f, 0x5e, 0xc1 }); }
+
+				void square() { emit({ 0xf2, 0x0f, 0x59, 0xc0 }); }                      // mulsd xmm0, xmm0
+				void sqrt() { emit({ 0xf2, 0x0f, 0x51, 0xc0 }); }                        // sqrtsd xmm0, xmm0
+				void copyToSecond() { emit({ 0x66, 0x0f, 0x28, 0xc8 }); }                // movapd xmm1, xmm0
+
+				void negate()
+				{
+					emit({ 0x66, 0x48, 0x0f, 0x7e, 0xc0 });  // movq rax, xmm0
+					emit({ 0x48, 0x0f, 0xba, 0xf8, 0x3f });  // btc rax, 63
+					emit({ 0x66, 0x48, 0x0f, 0x6e, 0xc0 });  // movq xmm0, rax
+				}
+
+				void call(void const* function)
+				{
+					emit({ 0x48, 0xb8 });  // mov rax, imm64
+					auto address = reinterpret_cast<std::uint64_t>(function);
+					for (int i = 0; i != 8; ++i)
+					{
+						bytes_.push_back(static_cast<std::uint8_t>(address >> (8 * i)));
+					}
+					emit({ 0xff, 0xd0 });  // call rax
+				}
+
+				// mov rax, [rbx + offset]
+				void loadColumnPointer(std::int32_t offset)
+				{
+					emit({ 0x48, 0x8b, 0x83 });
+					imm32(offset);
+				}
+
+				void allocateFrame(std::int32_t size)
+				{
+					emit({ 0x48, 0x81, 0xec });  // sub rsp, imm32
+					imm32(size);
+				}
+
+				void freeFrame(std::int32_t size)
+				{
+					emit({ 0x48, 0x81, 0xc4 });  // add rsp, imm32
+					imm32(size);
+				}
+
+				// A jump whose target is set by `patch()`. Returns the position of the displacement.
+				std::size_t jumpIfAboveOrEqual()
+				{
+					emit({ 0x0f, 0x83 });  // jae rel32
+					imm32(0);
+					return bytes_.size() - 4;
+				}
+
+				void jump(std::size_t target)
+				{
+					emit({ 0xe9 });  // jmp rel32
+					imm32(static_cast<std::int32_t>(target) - static_cast<std::int32_t>(bytes_.size() + 4));
+				}
+
+				// Makes the jump with the displacement at `position` go to the current position.
+				void patch(std::size_t position)
+				{
+					auto displacement = static_cast<std::int32_t>(bytes_.size() - (position + 4));
+					auto bits = std::bit_cast<std::uint32_t>(displacement);
+					for (int i = 0; i != 4; ++i)
+					{
+						bytes_[position + i] = static_cast<std::uint8_t>(bits >> (8 * i));
+					}
+				}
+			};
+
+			// The size of the native stack frame for the evaluation stack and the temporaries. The frame keeps the stack
+			// pointer aligned to 16 bytes for calls, given the number of registers pushed after the return address.
+			std::int32_t frameSize(CompiledExpression const& expr, int numPushes)
+			{
+				auto slotBytes = (expr.stackSize() + expr.temporaryCount()) * sizeof(double);
+				return static_cast<std::int32_t>((slotBytes + 15) / 16 * 16 + (8 * (1 + numPushes)) % 16);
+			}
+
+			// Emits the code computing the value of the expression into `xmm0`. The top of the evaluation stack is kept
+			// in `xmm0` and the values below it in stack slots, since every function call may change all SSE registers.
+			// `variable(slot)` returns the operand of a variable, emitting the instructions needed to address it.
+			template <typename VariableOperand>
+			void emitBody(Assembler& a, CompiledExpression const& expr, std::vector<std::int32_t> const& constants,
+				VariableOperand variable)
+			{
+				auto slot = [](std::size_t i) { return Memory{ Memory::Kind::stack, static_cast<std::int32_t>(8 * i) }; };
+				auto temporary = [&expr, slot](std::size_t i) { return slot(expr.stackSize() + i); };
+				auto constant = [&constants](std::size_t i) { return Memory{ Memory::Kind::data, constants[i] }; };
+
+				std::size_t sp = 0;
+				auto push = [&a, &sp, slot]
+				{
+					if (sp != 0)
+					{
+						a.store(slot(sp - 1), 0);
+					}
+					++sp;
+				};
+				// Moves the top into `xmm1` and the value below it into `xmm0`.
+				auto pop = [&a, &sp, slot]
+				{
+					--sp;
+					a.copyToSecond();
+					a.load(0, slot(sp - 1));
+				};
+
+				for (auto instruction : expr.code())
+				{
+					auto operand = instruction.operand;
+					switch (instruction.op)
+					{
+					case OpCode::constant: push(); a.load(0, constant(operand)); break;
+					case OpCode::variable: push(); a.load(0, variable(operand)); break;
+
+					case OpCode::negative: a.negate(); break;
+					case OpCode::sqrt: a.sqrt(); break;
+					case OpCode::exp: a.call(reinterpret_cast<void const*>(&callUnary<Exp>)); break;
+					case OpCode::log: a.call(reinterpret_cast<void const*>(&callUnary<Log>)); break;
+					case OpCode::sin: a.call(reinterpret_cast<void const*>(&callUnary<Sin>)); break;
+					case OpCode::cos: a.call(reinterpret_cast<void const*>(&callUnary<Cos>)); break;
+					case OpCode::tan: a.call(reinterpret_cast<void const*>(&callUnary<Tan>)); break;
+					case OpCode::arcSin: a.call(reinterpret_cast<void const*>(&callUnary<ArcSin>)); break;
+					case OpCode::arcCos: a.call(reinterpret_cast<void const*>(&callUnary<ArcCos>)); break;
+					case OpCode::arcTan: a.call(reinterpret_cast<void const*>(&callUnary<ArcTan>)); break;
+					case OpCode::square: a.square(); break;  // as `evaluate(Pow{ }, x, 2)` computes it
+
+					case OpCode::add: pop(); a.add(); break;
+					case OpCode::subtract: pop(); a.subtract(); break;
+					case OpCode::multiply: pop(); a.multiply(); break;
+					case OpCode::divide: pop(); a.divide(); break;
+					case OpCode::pow: pop(); a.call(reinterpret_cast<void const*>(&callBinary<Pow>)); break;
+					case OpCode::logBase: pop(); a.call(reinterpret_cast<void const*>(&callBinary<LogBase>)); break;
+
+					case OpCode::addConstant: a.add(constant(operand)); break;
+					case OpCode::subtractConstant: a.subtract(constant(operand)); break;
+					case OpCode::multiplyConstant: a.multiply(constant(operand)); break;
+					case OpCode::divideConstant: a.divide(constant(operand)); break;
+					case OpCode::addVariable: a.add(variable(operand)); break;
+					case OpCode::subtractVariable: a.subtract(variable(operand)); break;
+					case OpCode::multiplyVariable: a.multiply(variable(operand)); break;
+					case OpCode::divideVariable: a.divide(variable(operand)); break;
+
+					case OpCode::store: a.store(temporary(operand), 0); break;
+					case OpCode::load: push(); a.load(0, temporary(operand)); break;
+					}
+				}
+			}
+
+			// double f(double const* variableValues)
+			void emitScalarFunction(Assembler& a, CompiledExpression const& expr,
+				std::vector<std::int32_t> const& constants)
+			{
+				auto frame = frameSize(expr, 1);
+				a.emit({ 0x53 });              // push rbx
+				a.emit({ 0x48, 0x89, 0xfb });  // mov rbx, rdi
+				a.allocateFrame(frame);
+				emitBody(a, expr, constants, [](std::size_t i)
+					{
+						return Memory{ Memory::Kind::variable, static_cast<std::int32_t>(8 * i) };
+					});
+				a.freeFrame(frame);
+				a.emit({ 0x5b });              // pop rbx
+				a.emit({ 0xc3 });              // ret
+			}
+
+			// void f(double const* const* columns, double* result, size_t numRows)
+			void emitBatchFunction(Assembler& a, CompiledExpression const& expr,
+				std::vector<std::int32_t> const& constants)
+			{
+				auto frame = frameSize(expr, 4);
+				a.emit({ 0x53, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56 });  // push rbx, r12, r13, r14
+				a.emit({ 0x48, 0x89, 0xfb });  // mov rbx, rdi
+				a.emit({ 0x49, 0x89, 0xf4 });  // mov r12, rsi
+				a.emit({ 0x49, 0x89, 0xd5 });  // mov r13, rdx
+				a.emit({ 0x45, 0x31, 0xf6 });  // xor r14d, r14d
+				a.allocateFrame(frame);
+
+				auto loop = a.size();
+				a.emit({ 0x4d, 0x39, 0xee });  // cmp r14, r13
+				auto exit = a.jumpIfAboveOrEqual();
+				emitBody(a, expr, constants, [&a](std::size_t i)
+					{
+						a.loadColumnPointer(static_cast<std::int32_t>(8 * i));
+						return Memory{ Memory::Kind::column };
+					});
+				a.store(Memory{ Memory::Kind::result }, 0);
+				a.emit({ 0x49, 0xff, 0xc6 });  // inc r14
+				a.jump(loop);
+				a.patch(exit);
+
+				a.freeFrame(frame);
+				a.emit({ 0x41, 0x5e, 0x41, 0x5d, 0x41, 0x5c, 0x5b });  // pop r14, r13, r12, rbx
+				a.emit({ 0xc3 });              // ret
+			}
+		}
+
+		JitExpression::JitExpression(CompiledExpression compiled)
+			: compiled_(std::move(compiled))
+		{
+			// The constants are placed in front of the code, which addresses them relative to the instruction pointer.
+			Assembler a;
+			auto constants = std::vector<std::int32_t>{ };
+			for (double value : compiled_.constants())
+			{
+				constants.push_back(a.data(value));
+			}
+			a.align(16);
+			auto scalarOffset = a.size();
+			emitScalarFunction(a, compiled_, constants);
+			a.align(16);
+			auto batchOffset = a.size();
+			emitBatchFunction(a, compiled_, constants);
+
+			// The memory is never writable and executable at the same time.
+			void* memory = mmap(nullptr, a.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (memory == MAP_FAILED)
+			{
+				return;
+			}
+			std::memcpy(memory, a.bytes().data(), a.size());
+			if (mprotect(memory, a.size(), PROT_READ | PROT_EXEC) != 0)
+			{
+				munmap(memory, a.size());
+				return;
+			}
+			code_ = memory;
+			codeSize_ = a.size();
+			scalarFunction_ = reinterpret_cast<ScalarFunction>(static_cast<std::uint8_t*>(memory) + scalarOffset);
+			batchFunction_ = reinterpret_cast<BatchFunction>(static_cast<std::uint8_t*>(memory) + batchOffset);
+		}
+
+		JitExpression::~JitExpression()
+		{
+			if (code_ != nullptr)
+			{
+				munmap(code_, codeSize_);
+			}
+		}
+
+#else // ARITHMETIC_EXPRESSION_PARSER_NATIVE_JIT
+
+		JitExpression::JitExpression(CompiledExpression compiled)
+			: compiled_(std::move(compiled))
+		{
+		}
+
+		JitExpression::~JitExpression()
+		{
+		}
+
+#endif // ARITHMETIC_EXPRESSION_PARSER_NATIVE_JIT
+
+		JitExpression::JitExpression(JitExpression&& other) noexcept
+			: compiled_(std::move(other.compiled_)),
+			code_(std::exchange(other.code_, nullptr)),
+			codeSize_(std::exchange(other.codeSize_, 0)),
+			scalarFunction_(std::exchange(other.scalarFunction_, nullptr)),
+			batchFunction_(std::exchange(other.batchFunction_, nullptr))
+		{
+		}
+
+		JitExpression& JitExpression::operator =(JitExpression&& other) noexcept
+		{
+			std::swap(compiled_, other.compiled_);
+			std::swap(code_, other.code_);
+			std::swap(codeSize_, other.codeSize_);
+			std::swap(scalarFunction_, other.scalarFunction_);
+			std::swap(batchFunction_, other.batchFunction_);
+			return *this;
+		}
+
+		JitExpression jit(Expression const& expr)
+		{
+			return JitExpression(compile(expr));
+		}
+
+		JitExpression jit(ArenaExpression const& expr)
+		{
+			return JitExpression(compile(expr));
+		}
+
+		JitExpression jit(Expression const& expr, VariableLayout const& layout)
+		{
+			return JitExpression(compile(expr, layout));
+		}
+
+		JitExpression jit(ArenaExpression const& expr, VariableLayout const& layout)
+		{
+			return JitExpression(compile(expr, layout));
+		}
+
+		double evaluate(JitExpression const& expr, std::span<double const> variableValues)
+		{
+			if (variableValues.size() < expr.variables().size())
+			{
+				throw std::invalid_argument("not enough variable values");
+			}
+			if (!expr.isNative())
+			{
+				return evaluate(expr.compiled(), variableValues);
+			}
+			return expr.scalarFunction()(variableValues.data());
+		}
+
+		// Whether an expression only needs arithmetic operators, square roots and squares, which the native code and the
+		// array kernels compute alike. For these the native code, which evaluates one row at a time, is faster than the
+		// compiled stack machine, which evaluates a tile of rows at a time; other functions are called per row.
+		static bool isArithmetic(CompiledExpression const& expr)
+		{
+			for (auto instruction : expr.code())
+			{
+				switch (instruction.op)
+				{
+				case OpCode::exp:
+				case OpCode::log:
+				case OpCode::sin:
+				case OpCode::cos:
+				case OpCode::tan:
+				case OpCode::arcSin:
+				case OpCode::arcCos:
+				case OpCode::arcTan:
+				case OpCode::pow:
+				case OpCode::logBase:
+					return false;
+				default:
+					break;
+				}
+			}
+			return true;
+		}
+
+		std::vector<double> evaluate(JitExpression const& expr,
+			std::span<std::span<double const> const> variableValues)
+		{
+			if (!expr.isNative() || !isArithmetic(expr.compiled()))
+			{
+				return evaluate(expr.compiled(), variableValues);
+			}
+			auto numVariables = expr.variables().size();
+			if (variableValues.size() < numVariables)
+			{
+				throw std::invalid_argument("not enough variable values");
+			}
+			auto columns = variableValues.first(numVariables);
+
+			// Determine the number of results. Columns with a single value are broadcast.
+			std::size_t numResults = 1;
+			bool haveLength = false;
+			for (auto column : columns)
+			{
+				if (column.size() == 1)
+				{
+					continue;
+				}
+				if (haveLength && column.size() != numResults)
+				{
+					throw BroadcastError("operands with different shapes could not be broadcast together");
+				}
+				numResults = column.size();
+				haveLength = true;
+			}
+
+			// The native code reads every column row by row, so broadcast columns are expanded.
+			auto columnPointers = std::vector<double const*>(numVariables);
+			auto broadcastColumns = std::vector<std::vector<double> >{ };
+			for (std::size_t i = 0; i != numVariables; ++i)
+			{
+				if (columns[i].size() == 1 && numResults != 1)
+				{
+					columnPointers[i] = broadcastColumns.emplace_back(numResults, columns[i][0]).data();
+				}
+				else
+				{
+					columnPointers[i] = columns[i].data();
+				}
+			}
+			auto result = std::vector<double>(numResults);
+			expr.batchFunction()(columnPointers.data(), result.data(), numResults);
+			return result;
+		}
+	}
+}
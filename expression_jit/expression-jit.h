@@ -0,0 +1,98 @@
+#pragma once
+
+#ifndef ARITHMETIC_EXPRESSION_PARSER_EXPRESSION_JIT_HPP
+#define ARITHMETIC_EXPRESSION_PARSER_EXPRESSION_JIT_HPP
+
+#include <span>
+#include <string>
+#include <vector>
+#include <cstddef>      // for size_t
+
+#include "expression.h"
+#include "expression-arena.h"
+#include "expression-compile.h"
+#include "variable-layout.h"
+
+namespace asc::cpp_practice_ws20::ex08 {
+
+	namespace expr {
+
+		// A compiled expression translated into native x86-64 machine code, which lives in executable memory owned by the
+		// object. Arithmetic is done by SSE2 instructions and the other functions are called, so the results agree bit for
+		// bit with those of the scalar evaluators.
+		//
+		// Native code is generated for x86-64 with the System V calling convention, i.e. not on Windows. Elsewhere, or if
+		// the operating system refuses executable memory, the function pointers are null and the scalar `evaluate()`
+		// below interprets the compiled expression instead.
+		class JitExpression {
+		public:
+			// `variableValues[i]` is the value of the variable `variables()[i]`.
+			using ScalarFunction = double (*)(double const* variableValues);
+
+			// `columns[i]` points to `numRows` values of the variable `variables()[i]`, and `result[j]` is computed from
+			// the `j`-th value of every column. The rows are evaluated one at a time, and every result agrees bit for bit
+			// with the scalar evaluation of its row.
+			using BatchFunction = void (*)(double const* const* columns, double* result, std::size_t numRows);
+
+		private:
+			CompiledExpression compiled_;
+			void* code_ = nullptr;
+			std::size_t codeSize_ = 0;
+			ScalarFunction scalarFunction_ = nullptr;
+			BatchFunction batchFunction_ = nullptr;
+
+		public:
+			explicit JitExpression(CompiledExpression compiled);
+			JitExpression(JitExpression&& other) noexcept;
+			JitExpression& operator =(JitExpression&& other) noexcept;
+			~JitExpression();
+
+			// The native functions, or `nullptr` if there is no native code.
+			ScalarFunction scalarFunction() const noexcept {
+				return scalarFunction_;
+			}
+
+			BatchFunction batchFunction() const noexcept {
+				return batchFunction_;
+			}
+
+			bool isNative() const noexcept {
+				return scalarFunction_ != nullptr;
+			}
+
+			CompiledExpression const& compiled() const noexcept {
+				return compiled_;
+			}
+
+			// The names of the variables in slot order.
+			std::span<const std::string> variables() const noexcept {
+				return compiled_.variables();
+			}
+		};
+
+		// Compile an expression to native code. The variable slots are assigned as by `compile()`.
+		JitExpression jit(Expression const& expr);
+		JitExpression jit(ArenaExpression const& expr);
+		JitExpression jit(Expression const& expr, VariableLayout const& layout);
+		JitExpression jit(ArenaExpression const& expr, VariableLayout const& layout);
+
+		// Evaluates an expression compiled to native code. `variableValues[i]` is the value of the variable
+		// `expr.variables()[i]`.
+		// Throws `std::invalid_argument` if fewer values than variables are given.
+		double evaluate(JitExpression const& expr, std::span<double const> variableValues);
+
+		// Evaluates an expression compiled to native code for many sets of inputs, with the same results as the
+		// corresponding `evaluate()` of `expr.compiled()`. That function's array kernels may differ from the scalar
+		// evaluators in the last places, as documented in "vector-math.h", except for arithmetic, square roots and
+		// squares. So only expressions without other functions are evaluated by the native code; the others are
+		// evaluated by `expr.compiled()`, whose kernels outrun calling the scalar functions once per row. The
+		// `batchFunction()` computes the results of the scalar evaluators for any expression. Columns with a single
+		// value are broadcast.
+		// Throws `std::invalid_argument` if fewer columns than variables are given.
+		// Throws an exception of type `BroadcastError` if two columns of more than one value differ in length.
+		std::vector<double> evaluate(JitExpression const& expr,
+			std::span<std::span<double const> const> variableValues);
+	}
+}
+
+#endif // !ARITHMETIC_EXPRESSION_PARSER_EXPRESSION_JIT_HPP
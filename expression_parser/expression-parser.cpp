@@ -235,7 +235,7 @@ namespace asc::cpp_practice_ws20::ex08 {
             NamedConstantParser()
             {
                 add(U"e", { expr::NamedConstant::e });
-                add(U"", { expr::NamedConstant::pi });
+                add(U"\u03C0", { expr::NamedConstant::pi });
                 add(U"pi", { expr::NamedConstant::pi });
             }
         } namedConstant;
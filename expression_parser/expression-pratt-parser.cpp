@@ -0,0 +1,538 @@
+#include <string>
+#include <cstddef>      // for size_t, ptrdiff_t
+#include <utility>      // for move()
+#include <optional>
+#include <string_view>
+
+#include "expression.h"
+#include "expression-arena.h"
+#include "boost-spirit-helpers.h"
+
+
+// A hand-written alternative to the Spirit X3 grammar in "expression-parser.cpp". It accepts exactly the same language
+// and builds exactly the same expressions, but it works on the raw bytes of the input, never backtracks, and constructs
+// `Expression`s directly instead of going through the `AST*` intermediates. It completes every operand before the node
+// using it, so it can also append the nodes to an `ExpressionArena` in post-order without building a tree first.
+//
+// The grammar, in order of increasing precedence:
+//
+//     expression = unary-additive { ("+" | "-") unary-additive }
+//     unary-additive = ["+" | "-"] multiplicative
+//     multiplicative = factor { ("*" | "/") factor }
+//     factor = primary [("^" | "**") factor]
+//     primary = real | integer | "(" expression ")" | identifier "(" expression { "," expression } ")"
+//             | "e" | "pi" | "π" | identifier
+//
+// The X3 grammar has a few quirks which are reproduced here:
+//  - A sign at the start of an additive operand applies to the whole multiplicative expression, so "-a*b" is
+//    `-(a*b)`. Elsewhere a sign is only accepted as part of a number, so "a*-3" is `a*(-3)` but "a*-b" is an error.
+//  - Numbers are parsed with X3's own real and integer parsers so that they round identically. A real needs a dot or
+//    an exponent; "nan" and "inf" are reals as well, even where they could start an identifier.
+//  - A real whose exponent is out of range, such as "1e999", is skipped without producing an operand, so "1e999x" is
+//    the variable `x`, and "1e999 2" is the integer 2.
+//  - Named constants are matched as a prefix of an identifier, hence "pix" is not a variable but an error.
+
+
+namespace asc::cpp_practice_ws20::ex08 {
+
+    namespace parser {
+
+        namespace {
+
+
+            using namespace expr;
+
+
+            bool
+                isAsciiSpace(char c)
+            {
+                // Same as `x3::ascii::space`.
+                return c == ' ' || (c >= '\t' && c <= '\r');
+            }
+
+            bool
+                isAsciiAlpha(char c)
+            {
+                return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+            }
+
+            bool
+                isAsciiDigit(char c)
+            {
+                return c >= '0' && c <= '9';
+            }
+
+            // Decodes the UTF-8 encoded code point at the start of `s`. Returns nothing if `s` does not start with a
+            // well-formed sequence.
+            std::optional<std::pair<char32_t, std::size_t>>
+                decodeUtf8(std::string_view s)
+            {
+                auto byte = [s](std::size_t i) { return static_cast<unsigned char>(s[i]); };
+                std::size_t length = byte(0) < 0x80 ? 1 : byte(0) < 0xC2 ? 0 : byte(0) < 0xE0 ? 2 : byte(0) < 0xF0 ? 3
+                    : byte(0) < 0xF5 ? 4 : 0;
+                if (length == 0 || length > s.size())
+                {
+                    return std::nullopt;
+                }
+                char32_t cp = length == 1 ? byte(0) : byte(0) & (0x7F >> length);
+                for (std::size_t i = 1; i != length; ++i)
+                {
+                    if ((byte(i) & 0xC0) != 0x80)
+                    {
+                        return std::nullopt;
+                    }
+                    cp = (cp << 6) | (byte(i) & 0x3F);
+                }
+                return std::pair{ cp, length };
+            }
+
+
+            // Builds the parsed expression as an `Expression` tree.
+            class TreeBuilder
+            {
+            public:
+                using Node = Expression;
+
+                template <typename ConstantT>
+                Node
+                    constant(ConstantT c)
+                {
+                    return { c };
+                }
+
+                Node
+                    variable(std::string_view name)
+                {
+                    return { Variable{ std::string(name) } };
+                }
+
+                Node
+                    unary(UnaryFunction f, Node x)
+                {
+                    return { UnaryFunctionExpression{ f, std::move(x) } };
+                }
+
+                Node
+                    binary(BinaryFunction f, Node x, Node y)
+                {
+                    return { BinaryFunctionExpression{ f, std::move(x), std::move(y) } };
+                }
+            };
+
+            // Appends the nodes of the parsed expression to an arena.
+            class ArenaBuilder
+            {
+            private:
+                ExpressionArena& arena_;
+
+            public:
+                using Node = NodeIndex;
+
+                explicit ArenaBuilder(ExpressionArena& arena)
+                    : arena_(arena)
+                {
+                }
+
+                template <typename ConstantT>
+                Node
+                    constant(ConstantT c)
+                {
+                    return arena_.push(c);
+                }
+
+                Node
+                    variable(std::string_view name)
+                {
+                    return arena_.push(ArenaVariable{ arena_.internVariable(name) });
+                }
+
+                Node
+                    unary(UnaryFunction f, Node x)
+                {
+                    return arena_.push(ArenaUnaryFunctionExpression{ f, x });
+                }
+
+                Node
+                    binary(BinaryFunction f, Node x, Node y)
+                {
+                    return arena_.push(ArenaBinaryFunctionExpression{ f, x, y });
+                }
+            };
+
+
+            template <typename BuilderT>
+            class PrattParser
+            {
+            private:
+                using Node = typename BuilderT::Node;
+
+                BuilderT builder_;
+                std::string_view text_;
+                char const* first_;
+                char const* pos_;
+                char const* last_;
+
+                enum class Precedence { additive, multiplicative, power };
+
+                struct BinaryOperator
+                {
+                    BinaryFunction f;
+                    Precedence precedence;
+                    std::size_t length;
+                };
+
+                // The arguments of a function call. Functions take at most two arguments, so only their number is kept
+                // of any further ones.
+                struct Arguments
+                {
+                    std::size_t count = 0;
+                    std::optional<Node> x;
+                    std::optional<Node> y;
+                };
+
+            public:
+                PrattParser(std::string_view text, BuilderT builder)
+                    : builder_(std::move(builder)), text_(text), first_(text.data()), pos_(text.data()),
+                      last_(text.data() + text.size())
+                {
+                }
+
+                Node
+                    parse()
+                {
+                    auto result = parseBinary(Precedence::additive);
+                    skipSpaces();
+                    if (pos_ != last_)
+                    {
+                        fail("Parse failure");
+                    }
+                    return result;
+                }
+
+            private:
+                [[noreturn]] void
+                    fail(std::string_view msg) const
+                {
+                    // Mark the position like `detail::reportError()` does, counting code points rather than bytes.
+                    auto countCodePoints = [](char const* first, char const* last)
+                    {
+                        std::size_t result = 0;
+                        for (; first != last; ++first)
+                        {
+                            result += (static_cast<unsigned char>(*first) & 0xC0) != 0x80;
+                        }
+                        return result;
+                    };
+                    auto errorAnnotation = std::string(countCodePoints(first_, last_) + 1, ' ');
+                    errorAnnotation[countCodePoints(first_, pos_)] = '^';
+                    detail::doReportError(text_, errorAnnotation, msg);
+                }
+
+                void
+                    skipSpaces()
+                {
+                    while (pos_ != last_ && isAsciiSpace(*pos_))
+                    {
+                        ++pos_;
+                    }
+                }
+
+                bool
+                    skipChar(char c)
+                {
+                    skipSpaces();
+                    if (pos_ != last_ && *pos_ == c)
+                    {
+                        ++pos_;
+                        return true;
+                    }
+                    return false;
+                }
+
+                void
+                    expectChar(char c)
+                {
+                    if (!skipChar(c))
+                    {
+                        fail(std::string("Expected '") + c + "'");
+                    }
+                }
+
+                std::optional<BinaryOperator>
+                    peekBinaryOperator()
+                {
+                    skipSpaces();
+                    if (pos_ == last_)
+                    {
+                        return std::nullopt;
+                    }
+                    switch (*pos_)
+                    {
+                    case '+': return BinaryOperator{ Add{ }, Precedence::additive, 1 };
+                    case '-': return BinaryOperator{ Subtract{ }, Precedence::additive, 1 };
+                    case '/': return BinaryOperator{ Divide{ }, Precedence::multiplicative, 1 };
+                    case '^': return BinaryOperator{ Pow{ }, Precedence::power, 1 };
+                    case '*':
+                        if (pos_ + 1 != last_ && pos_[1] == '*')
+                        {
+                            return BinaryOperator{ Pow{ }, Precedence::power, 2 };
+                        }
+                        return BinaryOperator{ Multiply{ }, Precedence::multiplicative, 1 };
+                    default: return std::nullopt;
+                    }
+                }
+
+                // Parses a sequence of operands joined by operators of at least the given precedence. Additive and
+                // multiplicative operators associate to the left, the power operator associates to the right.
+                Node
+                    parseBinary(Precedence minPrecedence)
+                {
+                    auto lhs = minPrecedence == Precedence::additive ? parseUnaryAdditive() : parsePrimary();
+                    while (auto op = peekBinaryOperator())
+                    {
+                        if (op->precedence < minPrecedence)
+                        {
+                            break;
+                        }
+                        pos_ += op->length;
+                        auto rhs = op->precedence == Precedence::additive ? parseUnaryAdditive()
+                            : parseBinary(Precedence::power);
+                        lhs = builder_.binary(op->f, std::move(lhs), std::move(rhs));
+                    }
+                    return lhs;
+                }
+
+                Node
+                    parseUnaryAdditive()
+                {
+                    skipSpaces();
+                    if (pos_ != last_ && (*pos_ == '+' || *pos_ == '-'))
+                    {
+                        auto f = *pos_++ == '+' ? UnaryFunction{ Positive{ } } : UnaryFunction{ Negative{ } };
+                        return builder_.unary(f, parseBinary(Precedence::multiplicative));
+                    }
+                    return parseBinary(Precedence::multiplicative);
+                }
+
+                std::optional<Node>
+                    parseNumber()
+                {
+                    static auto const double_ = x3::real_parser<double, x3::strict_real_policies<double>>{ };
+
+                    // Plain integers are by far the most common numbers. They cannot be strict reals, so the real parser
+                    // only needs to run if the digits are followed by a dot or an exponent.
+                    auto digitsEnd = pos_;
+                    while (digitsEnd != last_ && isAsciiDigit(*digitsEnd))
+                    {
+                        ++digitsEnd;
+                    }
+                    bool maybeReal = digitsEnd == pos_
+                        || (digitsEnd != last_ && (*digitsEnd == '.' || *digitsEnd == 'e' || *digitsEnd == 'E'));
+                    if (maybeReal)
+                    {
+                        // When scaling by the exponent overflows, X3's real parser fails without resetting the
+                        // iterator, and the rest of the primary is parsed after the skipped number. We do the same.
+                        double d;
+                        bool isReal = x3::parse(pos_, last_, double_, d);
+                        if (isReal)
+                        {
+                            return builder_.constant(RealConstant{ d });
+                        }
+                        skipSpaces();
+                    }
+                    auto first = pos_;
+                    int i;
+                    if (x3::parse(first, last_, x3::int_, i))
+                    {
+                        pos_ = first;
+                        return builder_.constant(RationalConstant{ i });
+                    }
+                    return std::nullopt;
+                }
+
+                Arguments
+                    parseArguments()
+                {
+                    auto args = Arguments{ };
+                    do
+                    {
+                        auto arg = parseBinary(Precedence::additive);
+                        if (args.count == 0)
+                        {
+                            args.x = std::move(arg);
+                        }
+                        else if (args.count == 1)
+                        {
+                            args.y = std::move(arg);
+                        }
+                        ++args.count;
+                    } while (skipChar(','));
+                    expectChar(')');
+                    return args;
+                }
+
+                Node
+                    parseFunction(std::string_view name, char const* namePos)
+                {
+                    auto args = parseArguments();
+                    auto unary = [&](UnaryFunction f) -> Node
+                    {
+                        if (args.count != 1)
+                        {
+                            pos_ = namePos;
+                            fail("Function arguments number incorrect.");
+                        }
+                        return builder_.unary(f, std::move(*args.x));
+                    };
+                    auto binary = [&](BinaryFunction f) -> Node
+                    {
+                        if (args.count != 2)
+                        {
+                            pos_ = namePos;
+                            fail("Function arguments number incorrect.");
+                        }
+                        return builder_.binary(f, std::move(*args.x), std::move(*args.y));
+                    };
+                    if (name == "sin") return unary(Sin{ });
+                    if (name == "cos") return unary(Cos{ });
+                    if (name == "tan") return unary(Tan{ });
+                    if (name == "arcsin") return unary(ArcSin{ });
+                    if (name == "arccos") return unary(ArcCos{ });
+                    if (name == "arctan") return unary(ArcTan{ });
+                    if (name == "exp") return unary(Exp{ });
+                    if (name == "log")
+                    {
+                        if (args.count == 1) return unary(Log{ });
+                        if (args.count == 2) return binary(LogBase{ });
+                        pos_ = namePos;
+                        fail("expects 1 or 2 arguments.");
+                    }
+                    if (name == "sqrt") return unary(Sqrt{ });
+                    if (name == "pow") return binary(Pow{ });
+                    pos_ = namePos;
+                    fail("Unknown function.");
+                }
+
+                Node
+                    parseIdentifier()
+                {
+                    auto namePos = pos_;
+                    auto nameEnd = pos_ + 1;
+                    while (nameEnd != last_ && (isAsciiAlpha(*nameEnd) || isAsciiDigit(*nameEnd) || *nameEnd == '_'))
+                    {
+                        ++nameEnd;
+                    }
+                    auto name = std::string_view(namePos, std::size_t(nameEnd - namePos));
+                    pos_ = nameEnd;
+                    if (skipChar('('))
+                    {
+                        return parseFunction(name, namePos);
+                    }
+
+                    // The named constants are matched before variables and need not end at a word boundary, so any
+                    // other identifier starting with one of them leaves input that cannot be parsed.
+                    bool isPi = name.starts_with("pi");
+                    if (isPi || name.starts_with("e"))
+                    {
+                        pos_ = namePos + (isPi ? 2 : 1);
+                        if (pos_ != nameEnd)
+                        {
+                            fail("Parse failure");
+                        }
+                        return builder_.constant(isPi ? NamedConstant::pi : NamedConstant::e);
+                    }
+                    return builder_.variable(name);
+                }
+
+                Node
+                    parsePrimary()
+                {
+                    skipSpaces();
+                    if (pos_ == last_)
+                    {
+                        fail("Parse failure");
+                    }
+                    char c = *pos_;
+
+                    // Reals may also start with a sign or spell "nan" or "inf".
+                    if (isAsciiDigit(c) || c == '.' || c == '+' || c == '-' || c == 'n' || c == 'N' || c == 'i' || c == 'I')
+                    {
+                        if (auto number = parseNumber())
+                        {
+                            return std::move(*number);
+                        }
+                        skipSpaces();
+                        if (pos_ == last_)
+                        {
+                            fail("Parse failure");
+                        }
+                        c = *pos_;
+                    }
+                    if (c == '(')
+                    {
+                        ++pos_;
+                        auto result = parseBinary(Precedence::additive);
+                        expectChar(')');
+                        return result;
+                    }
+                    if (isAsciiAlpha(c))
+                    {
+                        return parseIdentifier();
+                    }
+                    if (static_cast<unsigned char>(c) >= 0x80)
+                    {
+                        // The only token outside of ASCII is "π".
+                        auto decoded = decodeUtf8(std::string_view(pos_, std::size_t(last_ - pos_)));
+                        if (decoded && decoded->first == U'\u03C0')
+                        {
+                            pos_ += decoded->second;
+                            return builder_.constant(NamedConstant::pi);
+                        }
+                    }
+                    fail("Parse failure");
+                }
+            };
+
+
+        } // anonymous namespace
+
+    } // namespace parser
+
+    namespace expr {
+
+
+        Expression
+            Expression::parse(std::string_view str, ParserBackend backend)
+        {
+            if (backend == ParserBackend::spirit)
+            {
+                return parse(str);
+            }
+            return parser::PrattParser(str, parser::TreeBuilder{ }).parse();
+        }
+
+        ArenaExpression
+            ExpressionArena::parse(std::string_view str)
+        {
+            auto numNodes = nodes_.size();
+            auto numVariables = variables_.size();
+            try
+            {
+                return { *this, parser::PrattParser(str, parser::ArenaBuilder(*this)).parse() };
+            }
+            catch (...)
+            {
+                // Drop the nodes and variables of the operands parsed before the error.
+                for (auto i = numVariables; i != variables_.size(); ++i)
+                {
+                    variableIndices_.erase(variables_[i].name);
+                }
+                variables_.erase(variables_.begin() + std::ptrdiff_t(numVariables), variables_.end());
+                nodes_.erase(nodes_.begin() + std::ptrdiff_t(numNodes), nodes_.end());
+                throw;
+            }
+        }
+
+
+    } // namespace expr
+}
@@ -1,123 +1,60 @@
 #pragma once
-#include <sstream>
+#include <string>
 #include <iostream>
+#include <functional>
+#include <string_view>
 
 #include "utility.h"     // for overload<>
 #include "expression.h"
+#include "expression-arena.h"
+#include "expression-precedence.h"
+#include "expression-profile.h"     // for printAnnotated()
+#include "output-sink.h"
 
 namespace asc::cpp_practice_ws20::ex08 {
 
     namespace expr {
 
-        std::ostream& operator <<(std::ostream& stream, RationalConstant c)
+        // The printing functions are templates so that they can write to a `std::ostream` as well as to an `OutputSink`.
+
+        template <typename StreamT>
+        void printLeaf(StreamT& stream, RationalConstant c)
         {
-            if (c.value.denominator() == 1)
+            // Same as `operator <<(std::ostream&, boost::rational<>)` for streams with default settings.
+            stream << c.value.numerator();
+            if (c.value.denominator() != 1)
             {
-                return stream << c.value.numerator();
+                stream << '/' << c.value.denominator();
             }
-            return stream << c.value;
         }
 
-        std::ostream& operator <<(std::ostream& stream, RealConstant c)
+        template <typename StreamT>
+        void printLeaf(StreamT& stream, RealConstant c)
         {
-            return stream << c.value;
+            stream << c.value;
         }
 
-        std::ostream& operator <<(std::ostream& stream, NamedConstant c)
+        template <typename StreamT>
+        void printLeaf(StreamT& stream, NamedConstant c)
         {
             switch (c)
             {
             case NamedConstant::e:
-                return stream << "e";
+                stream << "e";
+                return;
             case NamedConstant::pi:
-                return stream << "pi";
+                stream << "pi";
+                return;
             }
             std::terminate();
         }
 
-        std::ostream& operator <<(std::ostream& stream, Variable const& c)
+        template <typename StreamT>
+        void printLeaf(StreamT& stream, Variable const& c)
         {
-            return stream << c.name;
+            stream << std::string_view(c.name);
         }
 
-        constexpr auto
-            unaryFunctionName = overload{
-                [](Positive) { return "+";      },
-                [](Negative) { return "-";      },
-                [](Sqrt) { return "sqrt";   },
-                [](Exp) { return "exp";    },
-                [](Log) { return "log";    },
-                [](Sin) { return "sin";    },
-                [](Cos) { return "cos";    },
-                [](Tan) { return "tan";    },
-                [](ArcSin) { return "arcsin"; },
-                [](ArcCos) { return "arccos"; },
-                [](ArcTan) { return "arctan"; }
-        };
-
-        constexpr auto
-            binaryFunctionName = overload{
-                [](Add) { return " + "; },
-                [](Subtract) { return " - "; },
-                [](Multiply) { return "*";   },
-                [](Divide) { return "/";   },
-                [](Pow) { return "^";   },
-                [](LogBase) { return "log"; }
-        };
-
-        // ȼ
-        enum class OperatorPrecedence : int
-        {
-            additive = 0,
-            additiveUnary = 1,
-            multiplicative = 2,
-            power = 3,
-            none = -1
-        };
-
-        // C++17 and earlier: need to define all relational operators
-        //constexpr bool operator < (OperatorPrecedence lhs, OperatorPrecedence rhs) { return int(lhs) <  int(rhs); }
-        //constexpr bool operator > (OperatorPrecedence lhs, OperatorPrecedence rhs) { return int(lhs) >  int(rhs); }
-        //constexpr bool operator <=(OperatorPrecedence lhs, OperatorPrecedence rhs) { return int(lhs) <= int(rhs); }
-        //constexpr bool operator >=(OperatorPrecedence lhs, OperatorPrecedence rhs) { return int(lhs) >= int(rhs); }
-        // C++20 and later: only need to define "spaceship operator"
-        constexpr std::strong_ordering operator <=>(OperatorPrecedence lhs, OperatorPrecedence rhs)
-        {
-            return int(lhs) <=> int(rhs);
-        }
-
-        // һԪȼ
-        constexpr auto unaryOperatorPrecedence = overload{
-                [](Positive) { return OperatorPrecedence::additiveUnary; },
-                [](Negative) { return OperatorPrecedence::additiveUnary; },
-                [](auto) { return OperatorPrecedence::none;          }
-        };
-
-        // Ԫȼ
-        constexpr auto binaryOperatorPrecedence = overload{
-                [](Add) { return OperatorPrecedence::additive;       },
-                [](Subtract) { return OperatorPrecedence::additive;       },
-                [](Multiply) { return OperatorPrecedence::multiplicative; },
-                [](Divide) { return OperatorPrecedence::multiplicative; },
-                [](Pow) { return OperatorPrecedence::power;          },
-                [](auto) { return OperatorPrecedence::none;           }
-        };
-
-        using BinaryFunctionFlag = unsigned;
-        constexpr BinaryFunctionFlag bffNone = 0;
-        constexpr BinaryFunctionFlag bffLeftAssociative = 1; // 
-        constexpr BinaryFunctionFlag bffRightAssociative = 2; // ҹ
-        constexpr BinaryFunctionFlag bffAssociative = 4;
-
-        constexpr auto binaryFunctionFlags = overload{
-                [](Add) { return bffLeftAssociative | bffAssociative; },
-                [](Subtract) { return bffLeftAssociative;                  },
-                [](Multiply) { return bffLeftAssociative | bffAssociative; },
-                [](Divide) { return bffLeftAssociative;                  },
-                [](Pow) { return bffRightAssociative;                 },
-                [](auto) { return bffNone;                             }
-        };
-
         OperatorPrecedence expressionPrecedence(Expression const& e)
         {
             return std::visit(
@@ -129,6 +66,17 @@ namespace asc::cpp_practice_ws20::ex08 {
                 e.value());
         }
 
+        OperatorPrecedence expressionPrecedence(ArenaExpression const& e)
+        {
+            return std::visit(
+                overload{
+                    [](ArenaUnaryFunctionExpression const& unaryExpr) { return std::visit(unaryOperatorPrecedence, unaryExpr.f); },
+                    [](ArenaBinaryFunctionExpression const& binaryExpr) { return std::visit(binaryOperatorPrecedence, binaryExpr.f); },
+                    [](auto const&) { return OperatorPrecedence::none; }
+                },
+                e.value());
+        }
+
         BinaryFunctionFlag expressionBinaryFunctionFlags(Expression const& e)
         {
             return std::visit(
@@ -139,6 +87,16 @@ namespace asc::cpp_practice_ws20::ex08 {
                 e.value());
         }
 
+        BinaryFunctionFlag expressionBinaryFunctionFlags(ArenaExpression const& e)
+        {
+            return std::visit(
+                overload{
+                    [](ArenaBinaryFunctionExpression const& binaryExpr) { return std::visit(binaryFunctionFlags, binaryExpr.f); },
+                    [](auto const&) { return bffNone; }
+                },
+                e.value());
+        }
+
         bool needParentheses(
                 OperatorPrecedence outerPrecedence, OperatorPrecedence innerPrecedence, bool mustEnforceAssociativity = true)
         {
@@ -148,16 +106,18 @@ namespace asc::cpp_practice_ws20::ex08 {
                         || (outerPrecedence == innerPrecedence && mustEnforceAssociativity)));
         }
 
+        template <typename ExpressionT>
         bool needUnaryArgParentheses(
-                OperatorPrecedence outerPrecedence, Expression const& arg)
+                OperatorPrecedence outerPrecedence, ExpressionT const& arg)
         {
             auto innerPrecedence = expressionPrecedence(arg);
             return needParentheses(outerPrecedence, innerPrecedence);
         }
 
+        template <typename ExpressionT>
         bool needBinaryArgParentheses(
                 OperatorPrecedence outerPrecedence, BinaryFunctionFlag outerFlags,
-                Expression const& arg, BinaryFunctionFlag associativityMask)
+                ExpressionT const& arg, BinaryFunctionFlag associativityMask)
         {
             auto innerPrecedence = expressionPrecedence(arg);
             auto innerFlags = expressionBinaryFunctionFlags(arg);
@@ -174,16 +134,36 @@ namespace asc::cpp_practice_ws20::ex08 {
             return needParentheses(outerPrecedence, innerPrecedence, mustEnforceAssociativity);
         }
 
-        std::ostream& operator <<(std::ostream& stream, Expression const& expr)
+        // Annotates no subexpression; see `printAnnotated()`.
+        struct NoAnnotation
         {
-            auto argToStream = [&stream]
-            (Expression const& arg, bool needParens)
+            template <typename ExpressionT>
+            constexpr std::string_view operator()(ExpressionT const&) const noexcept
+            {
+                return { };
+            }
+        };
+
+        // The printing logic is shared by the `unique_ptr<>`-based tree and the arena representation.
+        template <typename StreamT, typename ExpressionT, typename AnnotationT = NoAnnotation>
+        StreamT& printExpression(StreamT& stream, ExpressionT const& expr, AnnotationT const& annotation = { })
+        {
+            using Traits = ExpressionTraits<ExpressionT>;
+
+            auto mark = annotation(expr);
+            if (!mark.empty())
+            {
+                stream << '[';
+            }
+
+            auto argToStream = [&stream, &annotation]
+            (ExpressionT const& arg, bool needParens)
             {
                 if (needParens)
                 {
                     stream << '(';
                 }
-                stream << arg;
+                printExpression(stream, arg, annotation);
                 if (needParens)
                 {
                     stream << ')';
@@ -191,16 +171,19 @@ namespace asc::cpp_practice_ws20::ex08 {
             };
 
             std::visit(overload{
-                    [&stream, argToStream]
-                    (UnaryFunctionExpression const& unaryExpr)
+                    [&stream, &expr, argToStream]
+                    (typename Traits::UnaryFunctionExpressionType const& unaryExpr)
                     {
+                        auto const& x = subexpression(expr, unaryExpr.x);
                         auto outerPrecedence = std::visit(unaryOperatorPrecedence, unaryExpr.f);
                         stream << std::visit(unaryFunctionName, unaryExpr.f);
-                        argToStream(unaryExpr.x, needUnaryArgParentheses(outerPrecedence, unaryExpr.x));
+                        argToStream(x, needUnaryArgParentheses(outerPrecedence, x));
                     },
-                    [&stream, argToStream]
-                    (BinaryFunctionExpression const& binaryExpr)
+                    [&stream, &expr, &annotation, argToStream]
+                    (typename Traits::BinaryFunctionExpressionType const& binaryExpr)
                     {
+                        auto const& x = subexpression(expr, binaryExpr.x);
+                        auto const& y = subexpression(expr, binaryExpr.y);
                         auto outerPrecedence = std::visit(binaryOperatorPrecedence, binaryExpr.f);
                         auto outerFlags = std::visit(binaryFunctionFlags, binaryExpr.f);
                         auto functionName = std::visit(binaryFunctionName, binaryExpr.f);
@@ -208,41 +191,79 @@ namespace asc::cpp_practice_ws20::ex08 {
                         bool isInfixOperator = outerPrecedence != OperatorPrecedence::none;
                         if (isInfixOperator)
                         {
-                            argToStream(binaryExpr.x, needBinaryArgParentheses(outerPrecedence, outerFlags, binaryExpr.x, bffLeftAssociative));
+                            argToStream(x, needBinaryArgParentheses(outerPrecedence, outerFlags, x, bffLeftAssociative));
                             stream << functionName;
-                            argToStream(binaryExpr.y, needBinaryArgParentheses(outerPrecedence, outerFlags, binaryExpr.y, bffRightAssociative));
+                            argToStream(y, needBinaryArgParentheses(outerPrecedence, outerFlags, y, bffRightAssociative));
                         }
                         else
                         {
-                            stream << functionName
-                                   << '('
-                                   << binaryExpr.x
-                                   << ", "
-                                   << binaryExpr.y
-                                   << ')';
+                            stream << functionName << '(';
+                            printExpression(stream, x, annotation);
+                            stream << ", ";
+                            printExpression(stream, y, annotation);
+                            stream << ')';
                         }
                     },
+                    [&stream, &expr]
+                    (typename Traits::VariableType const& v)
+                    {
+                        printLeaf(stream, variable(expr, v));
+                    },
                     [&stream]
                     (auto cv)
                     {
-                        stream << cv;
+                        printLeaf(stream, cv);
                     },
                 },
                 expr.value());
 
+            if (!mark.empty())
+            {
+                stream << ']' << mark;
+            }
             return stream;
         }
 
+        std::ostream& operator <<(std::ostream& stream, Expression const& expr)
+        {
+            return printExpression(stream, expr);
+        }
+
+        std::ostream& operator <<(std::ostream& stream, ArenaExpression const& expr)
+        {
+            return printExpression(stream, expr);
+        }
+
+        OutputSink& operator <<(OutputSink& sink, Expression const& expr)
+        {
+            return printExpression(sink, expr);
+        }
+
+        OutputSink& operator <<(OutputSink& sink, ArenaExpression const& expr)
+        {
+            return printExpression(sink, expr);
+        }
+
+        std::ostream& printAnnotated(std::ostream& stream, Expression const& expr,
+            std::function<std::string(Expression const&)> const& annotation)
+        {
+            return printExpression(stream, expr, annotation);
+        }
+
         std::string
             to_string(Expression const& expr)
         {
-            std::stringstream sstr;
-
-            // Set up the stream to throw exceptions in case of failure because this is what our caller expects.
-            sstr.exceptions(std::ios_base::badbit | std::ios_base::failbit);
+            auto sink = OutputSink{ };
+            sink << expr;
+            return std::string(sink.view());
+        }
 
-            sstr << expr;
-            return sstr.str();
+        std::string
+            to_string(ArenaExpression const& expr)
+        {
+            auto sink = OutputSink{ };
+            sink << expr;
+            return std::string(sink.view());
         }
     }
 }
\ No newline at end of file
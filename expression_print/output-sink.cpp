@@ -0,0 +1,84 @@
+#include <charconv>       // for to_chars()
+#include <algorithm>      // for max()
+#include <stdexcept>      // for runtime_error
+
+#include "output-sink.h"
+
+
+namespace asc::cpp_practice_ws20::ex08 {
+
+
+    // "%g" with the default precision of 6 needs at most 13 characters, e.g. "-1.23457e-308".
+    constexpr std::size_t maxDoubleChars = 16;
+    constexpr std::size_t maxIntChars = 11;
+
+    OutputSink::OutputSink()
+        : file_(nullptr), buffer_(256)
+    {
+    }
+
+    OutputSink::OutputSink(std::FILE* file, std::size_t bufferSize)
+        : file_(file), buffer_(std::max(bufferSize, maxDoubleChars))
+    {
+    }
+
+    OutputSink::~OutputSink()
+    {
+        try
+        {
+            flush();
+        }
+        catch (std::runtime_error const&)
+        {
+        }
+    }
+
+    void OutputSink::writeToFile(char const* data, std::size_t n)
+    {
+        if (std::fwrite(data, 1, n, file_) != n)
+        {
+            throw std::runtime_error("failed to write output");
+        }
+    }
+
+    void OutputSink::makeRoom(std::size_t n)
+    {
+        if (file_ == nullptr)
+        {
+            buffer_.resize(std::max(2 * buffer_.size(), size_ + n));
+            return;
+        }
+        flush();
+        if (buffer_.size() < n)
+        {
+            buffer_.resize(n);
+        }
+    }
+
+    void OutputSink::flush()
+    {
+        if (file_ == nullptr || size_ == 0)
+        {
+            return;
+        }
+        // Clear first, so that a failed write is not repeated by the destructor.
+        auto n = size_;
+        size_ = 0;
+        writeToFile(buffer_.data(), n);
+    }
+
+    void OutputSink::write(int value)
+    {
+        char* first = reserve(maxIntChars);
+        size_ += std::to_chars(first, first + maxIntChars, value).ptr - first;
+    }
+
+    void OutputSink::write(double value)
+    {
+        // `std::ostream` formats doubles with "%g" and a precision of 6 by default, as does `to_chars()` in general format.
+        char* first = reserve(maxDoubleChars);
+        size_ += std::to_chars(first, first + maxDoubleChars, value, std::chars_format::general, 6).ptr - first;
+    }
+
+
+} // namespace asc::cpp_practice_ws20::ex08
@@ -0,0 +1,111 @@
+#ifndef INCLUDED_CPP_PRACTICE_EX08_OUTPUT_SINK_H_
+#define INCLUDED_CPP_PRACTICE_EX08_OUTPUT_SINK_H_
+
+
+#include <cstdio>         // for FILE
+#include <vector>
+#include <cstddef>        // for size_t
+#include <cstring>        // for memcpy()
+#include <string_view>
+
+#include "expression.h"
+#include "expression-arena.h"
+
+
+namespace asc::cpp_practice_ws20::ex08 {
+
+
+    // A buffered text writer. Output is collected in a buffer which is reused, and either written to a file in large
+    // chunks or kept in memory. Numbers are formatted with `std::to_chars()` exactly as a `std::ostream` with default
+    // settings formats them, e.g. doubles like `printf("%g")`.
+    class OutputSink
+    {
+    private:
+        std::FILE* file_;
+        std::vector<char> buffer_;
+        std::size_t size_ = 0;
+
+        // Makes room for at least `n` more characters by flushing or growing the buffer.
+        void makeRoom(std::size_t n);
+        void writeToFile(char const* data, std::size_t n);
+
+        // Returns a pointer to at least `n` free characters at the end of the buffer.
+        char* reserve(std::size_t n)
+        {
+            if (buffer_.size() - size_ < n)
+            {
+                makeRoom(n);
+            }
+            return buffer_.data() + size_;
+        }
+
+    public:
+        static constexpr std::size_t defaultBufferSize = std::size_t(1) << 20;
+
+        // Collects all output in memory, see `view()`.
+        OutputSink();
+
+        // Writes output to the file whenever the buffer is full, when `flush()` is called, and on destruction.
+        explicit OutputSink(std::FILE* file, std::size_t bufferSize = defaultBufferSize);
+
+        OutputSink(OutputSink const&) = delete;
+        OutputSink& operator =(OutputSink const&) = delete;
+
+        // Flushes the output. Errors are ignored; call `flush()` first to detect them.
+        ~OutputSink();
+
+        void write(std::string_view s)
+        {
+            std::memcpy(reserve(s.size()), s.data(), s.size());
+            size_ += s.size();
+        }
+
+        void write(char c)
+        {
+            *reserve(1) = c;
+            ++size_;
+        }
+
+        void write(int value);
+        void write(double value);
+
+        OutputSink& operator <<(std::string_view s) { write(s); return *this; }
+        OutputSink& operator <<(char const* s) { write(std::string_view(s)); return *this; }
+        OutputSink& operator <<(char c) { write(c); return *this; }
+        OutputSink& operator <<(int value) { write(value); return *this; }
+        OutputSink& operator <<(double value) { write(value); return *this; }
+
+        // Writes the buffered output to the file.
+        // Throws `std::runtime_error` if writing fails. Does nothing if there is no file.
+        void flush();
+
+        // The buffered output, which for a sink without a file is all output since construction or the last `clear()`.
+        std::string_view view() const noexcept
+        {
+            return { buffer_.data(), size_ };
+        }
+
+        // Discards the buffered output.
+        void clear() noexcept
+        {
+            size_ = 0;
+        }
+    };
+
+
+    namespace expr {
+
+
+        // Write a string representation of the expression to the sink, the same as `operator <<(std::ostream&, ...)`.
+        // Implemented in "expression-print.cpp".
+        OutputSink& operator <<(OutputSink& sink, Expression const& expr);
+        OutputSink& operator <<(OutputSink& sink, ArenaExpression const& expr);
+
+
+    } // namespace expr
+
+
+} // namespace asc::cpp_practice_ws20::ex08
+
+
+#endif // INCLUDED_CPP_PRACTICE_EX08_OUTPUT_SINK_H_
@@ -0,0 +1,357 @@
+#include <cmath>        // for trunc(), abs(), signbit(), isfinite()
+#include <limits>       // for numeric_limits<>
+#include <variant>
+#include <optional>
+#include <stdexcept>    // for runtime_error
+
+#include <boost/rational.hpp>
+
+#include "utility.h"    // for overload<>
+#include "expression-simplify.h"
+#include "expression-functions.h"
+
+namespace asc::cpp_practice_ws20::ex08 {
+
+	namespace expr {
+
+		namespace {
+
+			// Intermediate results are computed with 64-bit integers, which cannot overflow for operands that fit into
+			// the `int` of a `RationalConstant`. Results are converted back only if they fit.
+			using Rational = boost::rational<long long>;
+
+			// The value of a constant subexpression: exact if only rational constants were involved, real otherwise.
+			using ConstantValue = std::variant<Rational, double>;
+
+			struct Simplified {
+				Expression expr;
+				std::optional<ConstantValue> value;
+			};
+
+			constexpr long long maxRationalConstant = std::numeric_limits<int>::max();
+
+			double toDouble(ConstantValue const& value)
+			{
+				return std::visit(
+					overload{
+						// Same as `boost::rational_cast<double>()`, which is what `evaluate(RationalConstant)` uses.
+						[](Rational r) { return double(r.numerator()) / double(r.denominator()); },
+						[](double d) { return d; }
+					}, value);
+			}
+
+			bool isConstant(std::optional<ConstantValue> const& value, double n)
+			{
+				return value && toDouble(*value) == n;
+			}
+
+			// Whether the value is a zero of the given sign. Only adding `-0.0` and subtracting `+0.0` leave every operand
+			// unchanged, since `-0.0 + 0.0` and `-0.0 - -0.0` are `+0.0`.
+			bool isZero(std::optional<ConstantValue> const& value, bool isNegative)
+			{
+				return isConstant(value, 0) && std::signbit(toDouble(*value)) == isNegative;
+			}
+
+			bool fitsRationalConstant(Rational r)
+			{
+				return r.numerator() >= -maxRationalConstant && r.numerator() <= maxRationalConstant
+					&& r.denominator() <= maxRationalConstant;
+			}
+
+			// Builds the expression the parser would produce for the string representation of `r`. The parser never
+			// yields a negative or fractional `RationalConstant` for "-3" or "3/4", so neither must we.
+			Expression rationalExpression(Rational r)
+			{
+				if (r.numerator() < 0)
+				{
+					return { UnaryFunctionExpression{ Negative{ }, rationalExpression(-r) } };
+				}
+				auto numerator = RationalConstant{ static_cast<int>(r.numerator()) };
+				if (r.denominator() == 1)
+				{
+					return { numerator };
+				}
+				return { BinaryFunctionExpression{
+					Divide{ }, Expression{ numerator }, Expression{ RationalConstant{ static_cast<int>(r.denominator()) } } } };
+			}
+
+			bool roundTrips(Expression const& expr)
+			{
+				try
+				{
+					return Expression::parse(to_string(expr)) == expr;
+				}
+				catch (std::runtime_error const&)
+				{
+					return false;
+				}
+			}
+
+			// Returns a constant expression for a real value, or nothing if the value cannot be represented faithfully.
+			// Real constants are printed with limited precision, so a value is only accepted if it survives printing and
+			// parsing unchanged.
+			std::optional<Expression> realExpression(double value)
+			{
+				if (!std::isfinite(value) || (value == 0 && std::signbit(value)))
+				{
+					return std::nullopt;
+				}
+				if (std::trunc(value) == value && std::abs(value) <= double(maxRationalConstant))
+				{
+					return rationalExpression(Rational(static_cast<long long>(value)));
+				}
+				auto candidate = value < 0
+					? Expression{ UnaryFunctionExpression{ Negative{ }, Expression{ RealConstant{ -value } } } }
+					: Expression{ RealConstant{ value } };
+				if (!roundTrips(candidate))
+				{
+					return std::nullopt;
+				}
+				return candidate;
+			}
+
+			// Returns the exact result of a function of two rational numbers, or nothing if it is not rational or does not
+			// fit into a `RationalConstant`.
+			std::optional<Rational> foldRational(BinaryFunction f, Rational x, Rational y)
+			{
+				auto result = std::visit(
+					overload{
+						[x, y](Add) -> std::optional<Rational> { return x + y; },
+						[x, y](Subtract) -> std::optional<Rational> { return x - y; },
+						[x, y](Multiply) -> std::optional<Rational> { return x * y; },
+						[x, y](Divide) -> std::optional<Rational>
+						{
+							if (y == Rational(0))
+							{
+								return std::nullopt;
+							}
+							return x / y;
+						},
+						[x, y](Pow) -> std::optional<Rational>
+						{
+							// Only integral exponents have rational results in general.
+							if (y.denominator() != 1 || (x == Rational(0) && y.numerator() < 0))
+							{
+								return std::nullopt;
+							}
+							auto base = y.numerator() < 0 ? Rational(1) / x : x;
+							auto exponent = y.numerator() < 0 ? -y.numerator() : y.numerator();
+
+							// Powers of other bases overflow long before this.
+							constexpr long long maxExponent = 64;
+							if (exponent > maxExponent)
+							{
+								if (base == Rational(0) || base == Rational(1))
+								{
+									return base;
+								}
+								if (base == Rational(-1))
+								{
+									return exponent % 2 == 0 ? Rational(1) : base;
+								}
+								return std::nullopt;
+							}
+							auto power = Rational(1);
+							for (long long i = 0; i != exponent; ++i)
+							{
+								power *= base;
+								if (!fitsRationalConstant(power))
+								{
+									return std::nullopt;
+								}
+							}
+							return power;
+						},
+						[](LogBase) -> std::optional<Rational> { return std::nullopt; }
+					}, f);
+				if (!result || !fitsRationalConstant(*result))
+				{
+					return std::nullopt;
+				}
+				return result;
+			}
+
+			// Deep copy, needed where a simplification drops a node but keeps its child.
+			Expression clone(Expression const& expr)
+			{
+				return std::visit(
+					overload{
+						[](UnaryFunctionExpression const& unaryExpr) -> Expression
+						{
+							return { UnaryFunctionExpression{ unaryExpr.f, clone(unaryExpr.x) } };
+						},
+						[](BinaryFunctionExpression const& binaryExpr) -> Expression
+						{
+							return { BinaryFunctionExpression{ binaryExpr.f, clone(binaryExpr.x), clone(binaryExpr.y) } };
+						},
+						[](auto const& leaf) -> Expression
+						{
+							return { leaf };
+						}
+					}, expr.value());
+			}
+
+			// Folds a function of a constant value that could not be folded exactly. The unfolded expression is kept if
+			// the result cannot be represented as a constant.
+			Simplified foldReal(double value, Expression unfolded)
+			{
+				if (auto folded = realExpression(value))
+				{
+					return { std::move(*folded), value };
+				}
+				return { std::move(unfolded), value };
+			}
+
+			Simplified simplifyNegative(Simplified x)
+			{
+				std::optional<ConstantValue> value;
+				if (x.value)
+				{
+					value = std::visit(
+						overload{
+							// The negation of an exact zero is `-0.0` when evaluating, which only a real can represent.
+							[](Rational r) { return r == Rational(0) ? ConstantValue{ -0.0 } : ConstantValue{ -r }; },
+							[](double d) { return ConstantValue{ -d }; }
+						}, *x.value);
+				}
+
+				// --x = x
+				if (auto const* unaryExpr = std::get_if<UnaryFunctionExpression>(&x.expr.value());
+					unaryExpr && std::holds_alternative<Negative>(unaryExpr->f))
+				{
+					return { clone(unaryExpr->x), value };
+				}
+				if (auto const* r = value ? std::get_if<Rational>(&*value) : nullptr; r && fitsRationalConstant(*r))
+				{
+					return { rationalExpression(*r), value };
+				}
+				return { Expression{ UnaryFunctionExpression{ Negative{ }, std::move(x.expr) } }, value };
+			}
+
+			Simplified simplifyImpl(Expression const& expr)
+			{
+				return std::visit(
+					overload{
+						[](RationalConstant c) -> Simplified
+						{
+							return { Expression{ c }, Rational(c.value.numerator(), c.value.denominator()) };
+						},
+
+						[](Variable const& v) -> Simplified
+						{
+							return { Expression{ v }, std::nullopt };
+						},
+
+						[](UnaryFunctionExpression const& unaryExpr) -> Simplified
+						{
+							auto x = simplifyImpl(unaryExpr.x);
+							return std::visit(
+								overload{
+									// +x = x
+									[&x](Positive) { return std::move(x); },
+									[&x](Negative) { return simplifyNegative(std::move(x)); },
+									[&x, &unaryExpr](auto f) -> Simplified
+									{
+										auto unfolded = Expression{ UnaryFunctionExpression{ unaryExpr.f, std::move(x.expr) } };
+										if (!x.value)
+										{
+											return { std::move(unfolded), std::nullopt };
+										}
+										return foldReal(evaluate(f, toDouble(*x.value)), std::move(unfolded));
+									}
+								}, unaryExpr.f);
+						},
+
+						[](BinaryFunctionExpression const& binaryExpr) -> Simplified
+						{
+							auto x = simplifyImpl(binaryExpr.x);
+							auto y = simplifyImpl(binaryExpr.y);
+
+							std::optional<ConstantValue> value;
+							if (x.value && y.value)
+							{
+								auto const* rx = std::get_if<Rational>(&*x.value);
+								auto const* ry = std::get_if<Rational>(&*y.value);
+								double real = std::visit(
+									[vx = toDouble(*x.value), vy = toDouble(*y.value)](auto f) { return evaluate(f, vx, vy); },
+									binaryExpr.f);
+								if (rx && ry)
+								{
+									// An exact zero cannot represent the `-0.0` that evaluation yields for e.g. `-1*0`.
+									auto r = foldRational(binaryExpr.f, *rx, *ry);
+									if (r && !(*r == Rational(0) && std::signbit(real)))
+									{
+										return { rationalExpression(*r), *r };
+									}
+								}
+								if (auto folded = realExpression(real))
+								{
+									return { std::move(*folded), real };
+								}
+								// The identities below may still apply, e.g. to `pi*1`.
+								value = real;
+							}
+
+							auto identity = std::visit(
+								overload{
+									// x + (-0.0) = (-0.0) + x = x
+									[&x, &y](Add) -> std::optional<Simplified>
+									{
+										if (isZero(y.value, true)) return std::move(x);
+										if (isZero(x.value, true)) return std::move(y);
+										return std::nullopt;
+									},
+									// x - 0 = x
+									[&x, &y](Subtract) -> std::optional<Simplified>
+									{
+										if (isZero(y.value, false)) return std::move(x);
+										return std::nullopt;
+									},
+									// x*1 = 1*x = x
+									[&x, &y](Multiply) -> std::optional<Simplified>
+									{
+										if (isConstant(y.value, 1)) return std::move(x);
+										if (isConstant(x.value, 1)) return std::move(y);
+										return std::nullopt;
+									},
+									// x/1 = x
+									[&x, &y](Divide) -> std::optional<Simplified>
+									{
+										if (isConstant(y.value, 1)) return std::move(x);
+										return std::nullopt;
+									},
+									// x^1 = x, x^0 = 1 (`std::pow()` returns 1 for any base if the exponent is 0), but only
+									// for a constant base, since dropping its variables would drop the error for a variable
+									// without a value
+									[&x, &y](Pow) -> std::optional<Simplified>
+									{
+										if (isConstant(y.value, 1)) return std::move(x);
+										if (x.value && isConstant(y.value, 0)) return Simplified{ Expression{ RationalConstant{ 1 } }, Rational(1) };
+										return std::nullopt;
+									},
+									[](LogBase) -> std::optional<Simplified> { return std::nullopt; }
+								}, binaryExpr.f);
+							if (identity)
+							{
+								return std::move(*identity);
+							}
+							return { Expression{ BinaryFunctionExpression{ binaryExpr.f, std::move(x.expr), std::move(y.expr) } },
+								value };
+						},
+
+						// Real and named constants are left as they are, but their values take part in folding.
+						[](auto c) -> Simplified
+						{
+							return { Expression{ c }, evaluate(c) };
+						}
+					}, expr.value());
+			}
+
+		} // anonymous namespace
+
+		Expression simplify(Expression const& expr)
+		{
+			return simplifyImpl(expr).expr;
+		}
+	}
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#ifndef ARITHMETIC_EXPRESSION_PARSER_EXPRESSION_SIMPLIFY_HPP
+#define ARITHMETIC_EXPRESSION_PARSER_EXPRESSION_SIMPLIFY_HPP
+
+#include "expression.h"
+
+namespace asc::cpp_practice_ws20::ex08 {
+
+	namespace expr {
+
+		// Returns a simplified copy of the expression.
+		//
+		// Constant subexpressions of rational constants are folded exactly; a folded rational is represented as a
+		// `RationalConstant`, negated with `Negative` and divided with `Divide` as needed, because these are the shapes
+		// the parser produces for its string representation. Constant subexpressions involving real or named constants
+		// are folded only if the folded value is integral or survives printing and parsing unchanged; otherwise the
+		// subexpression is kept as it is.
+		//
+		// The following identities are applied: `x*1`, `1*x`, `x/1`, `x+(-0.0)`, `(-0.0)+x`, `x-0`, `x^1` and `+x` become
+		// `x`, `--x` becomes `x`, and `c^0` becomes `1` for a constant `c`. The identities keep the sign of zero
+		// results and the errors for variables without a value; hence `x+0` is kept, since it is `+0.0` for `x = -0.0`,
+		// and so is `x^0`, which needs a value for `x`.
+		Expression simplify(Expression const& expr);
+	}
+}
+
+#endif // !ARITHMETIC_EXPRESSION_PARSER_EXPRESSION_SIMPLIFY_HPP
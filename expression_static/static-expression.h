@@ -0,0 +1,651 @@
+#pragma once
+
+#ifndef ARITHMETIC_EXPRESSION_PARSER_STATIC_EXPRESSION_HPP
+#define ARITHMETIC_EXPRESSION_PARSER_STATIC_EXPRESSION_HPP
+
+#include <array>
+#include <limits>       // for numeric_limits<>
+#include <span>
+#include <string>
+#include <cstddef>      // for size_t
+#include <cstdint>      // for uint64_t
+#include <utility>      // for index_sequence<>
+#include <variant>
+#include <optional>
+#include <stdexcept>    // for invalid_argument
+#include <string_view>
+#include <type_traits>  // for type_identity<>, integral_constant<>
+
+#include "expression.h"
+#include "expression-precedence.h"
+#include "expression-functions.h"
+
+namespace asc::cpp_practice_ws20::ex08 {
+
+	namespace expr {
+
+		// A string literal which can be passed as a template argument.
+		template <std::size_t N>
+		struct FixedString {
+			char data[N] { };
+
+			constexpr FixedString(char const (&str)[N])
+			{
+				for (std::size_t i = 0; i != N; ++i)
+				{
+					data[i] = str[i];
+				}
+			}
+
+			constexpr std::string_view view() const noexcept {
+				return { data, N - 1 };
+			}
+		};
+
+		namespace static_expression {
+
+			enum class NodeKind { rational, real, named, variable, unary, binary };
+
+			struct Node {
+				NodeKind kind = NodeKind::real;
+				// The index of the function in `UnaryFunction` or `BinaryFunction`, or the `NamedConstant`.
+				std::size_t function = 0;
+				// The value of a constant as `evaluate()` computes it.
+				double value = 0;
+				// The operands, or the slot of a variable.
+				std::size_t x = 0;
+				std::size_t y = 0;
+			};
+
+			// A name as a range of the parsed text.
+			struct Name {
+				std::size_t offset = 0;
+				std::size_t length = 0;
+			};
+
+			// The nodes of a parsed expression, children before their parents. Every node takes at least one character
+			// of the text, so a capacity of the text size suffices.
+			template <std::size_t Capacity>
+			struct ParsedExpression {
+				Node nodes[Capacity] { };
+				std::size_t numNodes = 0;
+				std::size_t root = 0;
+				Name variables[Capacity] { };
+				std::size_t numVariables = 0;
+			};
+
+			// Calls `f(std::integral_constant<std::size_t, I>{ }, Alternative{ })` for all alternatives of a variant.
+			template <typename Variant, typename F>
+			constexpr void forEachAlternative(F f)
+			{
+				[&f]<std::size_t... I>(std::index_sequence<I...>)
+				{
+					(f(std::integral_constant<std::size_t, I>{ }, std::variant_alternative_t<I, Variant>{ }), ...);
+				}(std::make_index_sequence<std::variant_size_v<Variant>>{ });
+			}
+
+			// Parses the language of `Expression::parse()` in a constant expression. The operators and function names,
+			// their precedence and associativity are taken from "expression-precedence.h". Errors are reported by
+			// throwing, which makes the parse ill-formed at compile time.
+			//
+			// Numbers must be converted exactly to agree with the runtime parser, so a real is only accepted if its
+			// significant digits and its decimal exponent are small enough that a single multiplication or division
+			// rounds it correctly, which covers all numbers seen in practice.
+			template <std::size_t Capacity>
+			class Parser {
+			private:
+				struct BinaryOperator {
+					std::size_t function;
+					OperatorPrecedence precedence;
+					BinaryFunctionFlag flags;
+					std::size_t length;
+				};
+
+				std::string_view text_;
+				std::size_t pos_ = 0;
+				ParsedExpression<Capacity> result_{ };
+
+			public:
+				constexpr explicit Parser(std::string_view text)
+					: text_(text)
+				{
+				}
+
+				constexpr ParsedExpression<Capacity> parse()
+				{
+					result_.root = parseBinary(OperatorPrecedence::additive);
+					skipSpaces();
+					if (pos_ != text_.size())
+					{
+						throw std::invalid_argument("Parse failure");
+					}
+					return result_;
+				}
+
+			private:
+				static constexpr bool isAsciiAlpha(char c)
+				{
+					return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+				}
+
+				static constexpr bool isAsciiDigit(char c)
+				{
+					return c >= '0' && c <= '9';
+				}
+
+				static constexpr std::string_view trimmed(std::string_view s)
+				{
+					while (!s.empty() && s.front() == ' ') s.remove_prefix(1);
+					while (!s.empty() && s.back() == ' ') s.remove_suffix(1);
+					return s;
+				}
+
+				constexpr std::size_t addNode(Node node)
+				{
+					result_.nodes[result_.numNodes] = node;
+					return result_.numNodes++;
+				}
+
+				constexpr void skipSpaces()
+				{
+					while (pos_ != text_.size() && (text_[pos_] == ' ' || (text_[pos_] >= '\t' && text_[pos_] <= '\r')))
+					{
+						++pos_;
+					}
+				}
+
+				constexpr bool skipChar(char c)
+				{
+					skipSpaces();
+					if (pos_ != text_.size() && text_[pos_] == c)
+					{
+						++pos_;
+						return true;
+					}
+					return false;
+				}
+
+				constexpr std::optional<BinaryOperator> peekBinaryOperator()
+				{
+					skipSpaces();
+					auto rest = text_.substr(pos_);
+					if (rest.starts_with("**"))
+					{
+						return BinaryOperator{ BinaryFunction(Pow{ }).index(), binaryOperatorPrecedence(Pow{ }),
+							binaryFunctionFlags(Pow{ }), 2 };
+					}
+					auto result = std::optional<BinaryOperator>{ };
+					forEachAlternative<BinaryFunction>([&rest, &result](auto index, auto f)
+						{
+							auto symbol = trimmed(binaryFunctionName(f));
+							if (binaryOperatorPrecedence(f) != OperatorPrecedence::none && rest.starts_with(symbol))
+							{
+								result = BinaryOperator{ index, binaryOperatorPrecedence(f), binaryFunctionFlags(f),
+									symbol.size() };
+							}
+						});
+					return result;
+				}
+
+				// Parses a sequence of operands joined by operators of at least the given precedence. A unary sign is
+				// accepted where an operator of additive precedence may follow, and applies to the multiplicative
+				// expression after it.
+				constexpr std::size_t parseBinary(OperatorPrecedence minPrecedence)
+				{
+					auto lhs = std::size_t{ };
+					skipSpaces();
+					if (minPrecedence <= OperatorPrecedence::additiveUnary && pos_ != text_.size()
+						&& (text_[pos_] == '+' || text_[pos_] == '-'))
+					{
+						auto f = text_[pos_++] == '+' ? UnaryFunction(Positive{ }) : UnaryFunction(Negative{ });
+						auto x = parseBinary(OperatorPrecedence::multiplicative);
+						lhs = addNode({ NodeKind::unary, f.index(), 0, x });
+					}
+					else
+					{
+						lhs = parsePrimary();
+					}
+					while (auto op = peekBinaryOperator())
+					{
+						if (op->precedence < minPrecedence)
+						{
+							break;
+						}
+						pos_ += op->length;
+						auto rhsPrecedence = (op->flags & bffRightAssociative) != 0 ? op->precedence
+							: OperatorPrecedence(int(op->precedence) + 1);
+						auto rhs = parseBinary(rhsPrecedence);
+						lhs = addNode({ NodeKind::binary, op->function, 0, lhs, rhs });
+					}
+					return lhs;
+				}
+
+				constexpr bool skipWordIgnoringCase(std::string_view word)
+				{
+					if (text_.size() - pos_ < word.size())
+					{
+						return false;
+					}
+					for (std::size_t i = 0; i != word.size(); ++i)
+					{
+						char c = text_[pos_ + i];
+						if ((c >= 'A' && c <= 'Z' ? char(c - 'A' + 'a') : c) != word[i])
+						{
+							return false;
+						}
+					}
+					pos_ += word.size();
+					return true;
+				}
+
+				// Parses an integer or a real with an optional sign. Leaves the position unchanged if there is none.
+				constexpr std::optional<std::size_t> parseNumber()
+				{
+					auto start = pos_;
+					bool isNegative = text_[pos_] == '-';
+					if (text_[pos_] == '+' || text_[pos_] == '-')
+					{
+						++pos_;
+					}
+					double sign = isNegative ? -1.0 : 1.0;
+					if (skipWordIgnoringCase("nan"))
+					{
+						return addNode({ NodeKind::real, 0, sign * std::numeric_limits<double>::quiet_NaN() });
+					}
+					if (skipWordIgnoringCase("infinity") || skipWordIgnoringCase("inf"))
+					{
+						return addNode({ NodeKind::real, 0, sign * std::numeric_limits<double>::infinity() });
+					}
+
+					std::uint64_t mantissa = 0;
+					int numDigits = 0;
+					int exponent = 0;
+					bool isReal = false;
+					bool haveDigits = false;
+					auto digit = [&](char c, bool isFraction)
+					{
+						haveDigits = true;
+						if (mantissa == 0 && c == '0')
+						{
+							exponent -= isFraction;
+							return;
+						}
+						if (++numDigits > 19)
+						{
+							throw std::invalid_argument("number has too many digits to be converted at compile time");
+						}
+						mantissa = mantissa * 10 + std::uint64_t(c - '0');
+						exponent -= isFraction;
+					};
+					while (pos_ != text_.size() && isAsciiDigit(text_[pos_]))
+					{
+						digit(text_[pos_++], false);
+					}
+					if (pos_ != text_.size() && text_[pos_] == '.')
+					{
+						isReal = true;
+						++pos_;
+						while (pos_ != text_.size() && isAsciiDigit(text_[pos_]))
+						{
+							digit(text_[pos_++], true);
+						}
+					}
+					if (!haveDigits)
+					{
+						pos_ = start;
+						return std::nullopt;
+					}
+					if (pos_ != text_.size() && (text_[pos_] == 'e' || text_[pos_] == 'E'))
+					{
+						// Only an exponent with digits belongs to the number.
+						auto p = pos_ + 1;
+						bool isNegativeExponent = p != text_.size() && text_[p] == '-';
+						p += p != text_.size() && (text_[p] == '+' || text_[p] == '-');
+						if (p != text_.size() && isAsciiDigit(text_[p]))
+						{
+							int e = 0;
+							for (; p != text_.size() && isAsciiDigit(text_[p]); ++p)
+							{
+								e = e < 1000 ? e * 10 + (text_[p] - '0') : e;
+							}
+							exponent += isNegativeExponent ? -e : e;
+							pos_ = p;
+							isReal = true;
+						}
+					}
+
+					if (!isReal)
+					{
+						if (mantissa > std::uint64_t(std::numeric_limits<int>::max()) + isNegative)
+						{
+							throw std::invalid_argument("integer out of range");
+						}
+						return addNode({ NodeKind::rational, 0, sign * double(mantissa) });
+					}
+					if (mantissa >= (std::uint64_t(1) << 53) || (mantissa != 0 && (exponent < -22 || exponent > 22)))
+					{
+						throw std::invalid_argument("number cannot be converted exactly at compile time");
+					}
+					double powerOfTen = 1;
+					for (int i = 0; i != (exponent < 0 ? -exponent : exponent); ++i)
+					{
+						powerOfTen *= 10;
+					}
+					double value = exponent < 0 ? double(mantissa) / powerOfTen : double(mantissa) * powerOfTen;
+					return addNode({ NodeKind::real, 0, sign * value });
+				}
+
+				constexpr std::size_t parseFunction(std::string_view name)
+				{
+					std::size_t args[2] = { };
+					std::size_t numArgs = 0;
+					do
+					{
+						auto arg = parseBinary(OperatorPrecedence::additive);
+						if (numArgs < 2)
+						{
+							args[numArgs] = arg;
+						}
+						++numArgs;
+					} while (skipChar(','));
+					if (!skipChar(')'))
+					{
+						throw std::invalid_argument("Expected ')'");
+					}
+
+					auto result = std::optional<Node>{ };
+					bool isKnown = false;
+					forEachAlternative<UnaryFunction>([&](auto index, auto f)
+						{
+							if (unaryOperatorPrecedence(f) == OperatorPrecedence::none && name == unaryFunctionName(f))
+							{
+								isKnown = true;
+								if (numArgs == 1)
+								{
+									result = Node{ NodeKind::unary, index, 0, args[0] };
+								}
+							}
+						});
+					forEachAlternative<BinaryFunction>([&](auto index, auto f)
+						{
+							bool isFunction = binaryOperatorPrecedence(f) == OperatorPrecedence::none
+								&& name == binaryFunctionName(f);
+							if (isFunction || (name == "pow" && index == BinaryFunction(Pow{ }).index()))
+							{
+								isKnown = true;
+								if (numArgs == 2)
+								{
+									result = Node{ NodeKind::binary, index, 0, args[0], args[1] };
+								}
+							}
+						});
+					if (!isKnown)
+					{
+						throw std::invalid_argument("Unknown function.");
+					}
+					if (!result)
+					{
+						throw std::invalid_argument("Function arguments number incorrect.");
+					}
+					return addNode(*result);
+				}
+
+				constexpr std::size_t parseIdentifier()
+				{
+					auto nameStart = pos_;
+					auto nameEnd = pos_ + 1;
+					while (nameEnd != text_.size()
+						&& (isAsciiAlpha(text_[nameEnd]) || isAsciiDigit(text_[nameEnd]) || text_[nameEnd] == '_'))
+					{
+						++nameEnd;
+					}
+					auto name = text_.substr(nameStart, nameEnd - nameStart);
+					pos_ = nameEnd;
+					if (skipChar('('))
+					{
+						return parseFunction(name);
+					}
+
+					// Like the runtime parsers, the named constants are matched as a prefix of an identifier.
+					bool isPi = name.starts_with("pi");
+					if (isPi || name.starts_with("e"))
+					{
+						if (name.size() != (isPi ? 2u : 1u))
+						{
+							throw std::invalid_argument("Parse failure");
+						}
+						auto c = isPi ? NamedConstant::pi : NamedConstant::e;
+						return addNode({ NodeKind::named, std::size_t(c), evaluate(c) });
+					}
+
+					// Variables are assigned slots in order of first occurrence.
+					auto slot = std::size_t{ 0 };
+					while (slot != result_.numVariables
+						&& text_.substr(result_.variables[slot].offset, result_.variables[slot].length) != name)
+					{
+						++slot;
+					}
+					if (slot == result_.numVariables)
+					{
+						result_.variables[result_.numVariables++] = { nameStart, name.size() };
+					}
+					return addNode({ NodeKind::variable, 0, 0, slot });
+				}
+
+				constexpr std::size_t parsePrimary()
+				{
+					skipSpaces();
+					if (pos_ == text_.size())
+					{
+						throw std::invalid_argument("Parse failure");
+					}
+					char c = text_[pos_];
+					if (isAsciiDigit(c) || c == '.' || c == '+' || c == '-' || c == 'n' || c == 'N' || c == 'i' || c == 'I')
+					{
+						if (auto number = parseNumber())
+						{
+							return *number;
+						}
+					}
+					if (c == '(')
+					{
+						++pos_;
+						auto result = parseBinary(OperatorPrecedence::additive);
+						if (!skipChar(')'))
+						{
+							throw std::invalid_argument("Expected ')'");
+						}
+						return result;
+					}
+					if (isAsciiAlpha(c))
+					{
+						return parseIdentifier();
+					}
+					if (text_.substr(pos_).starts_with("\xCF\x80"))  // "π" in UTF-8
+					{
+						pos_ += 2;
+						return addNode({ NodeKind::named, std::size_t(NamedConstant::pi), evaluate(NamedConstant::pi) });
+					}
+					throw std::invalid_argument("Parse failure");
+				}
+			};
+
+			// The nodes of the type-level expression. Each one evaluates to exactly what the scalar evaluators compute.
+
+			template <double Value>
+			struct Constant {
+				static constexpr double evaluate(double const*) noexcept
+				{
+					return Value;
+				}
+			};
+
+			template <std::size_t Slot>
+			struct VariableSlot {
+				static constexpr double evaluate(double const* variableValues) noexcept
+				{
+					return variableValues[Slot];
+				}
+			};
+
+			template <typename F, typename X>
+			struct UnaryNode {
+				static double evaluate(double const* variableValues) noexcept
+				{
+					return expr::evaluate(F{ }, X::evaluate(variableValues));
+				}
+			};
+
+			template <typename F, typename X, typename Y>
+			struct BinaryNode {
+				static double evaluate(double const* variableValues) noexcept
+				{
+					return expr::evaluate(F{ }, X::evaluate(variableValues), Y::evaluate(variableValues));
+				}
+			};
+
+			template <auto Parsed, std::size_t I>
+			constexpr auto nodeType()
+			{
+				constexpr Node node = Parsed.nodes[I];
+				if constexpr (node.kind == NodeKind::variable)
+				{
+					return std::type_identity<VariableSlot<node.x>>{ };
+				}
+				else if constexpr (node.kind == NodeKind::unary)
+				{
+					using F = std::variant_alternative_t<node.function, UnaryFunction>;
+					using X = typename decltype(nodeType<Parsed, node.x>())::type;
+					return std::type_identity<UnaryNode<F, X>>{ };
+				}
+				else if constexpr (node.kind == NodeKind::binary)
+				{
+					using F = std::variant_alternative_t<node.function, BinaryFunction>;
+					using X = typename decltype(nodeType<Parsed, node.x>())::type;
+					using Y = typename decltype(nodeType<Parsed, node.y>())::type;
+					return std::type_identity<BinaryNode<F, X, Y>>{ };
+				}
+				else
+				{
+					return std::type_identity<Constant<node.value>>{ };
+				}
+			}
+
+			template <auto Parsed, std::size_t I>
+			using NodeType = typename decltype(nodeType<Parsed, I>())::type;
+
+			template <std::size_t Capacity>
+			Expression toExpression(ParsedExpression<Capacity> const& parsed, std::size_t i, std::string_view text)
+			{
+				auto const& node = parsed.nodes[i];
+				switch (node.kind)
+				{
+				case NodeKind::rational:
+					return { RationalConstant{ int(node.value) } };
+				case NodeKind::real:
+					return { RealConstant{ node.value } };
+				case NodeKind::named:
+					return { NamedConstant(node.function) };
+				case NodeKind::variable:
+				{
+					auto name = parsed.variables[node.x];
+					return { Variable{ std::string(text.substr(name.offset, name.length)) } };
+				}
+				case NodeKind::unary:
+				{
+					auto f = UnaryFunction{ };
+					forEachAlternative<UnaryFunction>([&f, &node](auto index, auto g) { if (index == node.function) f = g; });
+					return { UnaryFunctionExpression{ f, toExpression(parsed, node.x, text) } };
+				}
+				case NodeKind::binary:
+				{
+					auto f = BinaryFunction{ };
+					forEachAlternative<BinaryFunction>([&f, &node](auto index, auto g) { if (index == node.function) f = g; });
+					return { BinaryFunctionExpression{ f, toExpression(parsed, node.x, text),
+						toExpression(parsed, node.y, text) } };
+				}
+				}
+				std::terminate();
+			}
+		}
+
+		// An expression parsed at compile time into a type. Evaluating it is straight-line code: there is no tree to
+		// walk, no dispatch on the kind of a node and no allocation, and the functions are those of
+		// "expression-functions.h", so the result agrees bit for bit with `evaluate()` of the parsed `Expression`.
+		//
+		// The variables are assigned slots in order of first occurrence, like `compile()` does:
+		//
+		//     constexpr auto f = "a*x^2 + b*x + c"_cexpr;
+		//     static_assert(f.slot("x") == 1);
+		//     double y = f(a, x, b, c);
+		template <FixedString Text>
+		class StaticExpression {
+		private:
+			static constexpr auto parsed_ = static_expression::Parser<sizeof(Text.data)>(Text.view()).parse();
+
+			using Root = static_expression::NodeType<parsed_, parsed_.root>;
+
+		public:
+			static constexpr std::string_view text = Text.view();
+
+			static constexpr std::size_t numVariables = parsed_.numVariables;
+
+			// The names of the variables in slot order.
+			static constexpr std::array<std::string_view, numVariables> variables = []
+			{
+				auto result = std::array<std::string_view, numVariables>{ };
+				for (std::size_t i = 0; i != numVariables; ++i)
+				{
+					result[i] = Text.view().substr(parsed_.variables[i].offset, parsed_.variables[i].length);
+				}
+				return result;
+			}();
+
+			// The slot of the named variable.
+			// Throws `std::invalid_argument` if there is no such variable, which is a compile-time error in a constant
+			// expression.
+			static constexpr std::size_t slot(std::string_view name)
+			{
+				for (std::size_t i = 0; i != numVariables; ++i)
+				{
+					if (variables[i] == name)
+					{
+						return i;
+					}
+				}
+				throw std::invalid_argument("unknown variable");
+			}
+
+			// `variableValues[i]` is the value of the variable `variables[i]`.
+			static double evaluate(std::span<double const, numVariables> variableValues) noexcept
+			{
+				return Root::evaluate(variableValues.data());
+			}
+
+			template <typename... Ts>
+				requires (sizeof...(Ts) == numVariables && (std::is_convertible_v<Ts, double> && ...))
+			double operator ()(Ts... variableValues) const noexcept
+			{
+				auto values = std::array<double, numVariables>{ double(variableValues)... };
+				return Root::evaluate(values.data());
+			}
+
+			// The same expression as `Expression::parse()` of the text builds.
+			static Expression toExpression()
+			{
+				return static_expression::toExpression(parsed_, parsed_.root, Text.view());
+			}
+		};
+
+		inline namespace literals {
+
+			template <FixedString Text>
+			constexpr StaticExpression<Text> operator ""_cexpr() noexcept
+			{
+				return { };
+			}
+		}
+	}
+}
+
+#endif // !ARITHMETIC_EXPRESSION_PARSER_STATIC_EXPRESSION_HPP
@@ -3,6 +3,13 @@
 #include <stdexcept>  // for runtime_error
 #include <string>
 
+#ifndef _WIN32
+# include <fcntl.h>     // for open()
+# include <unistd.h>    // for close()
+# include <sys/mman.h>  // for mmap(), madvise(), munmap()
+# include <sys/stat.h>  // for fstat()
+#endif // _WIN32
+
 #include "file-io.h"
 
 namespace arithmetic_expression_::file_reader {
@@ -77,4 +84,38 @@ namespace arithmetic_expression_::file_reader {
             return std::ferror(file.get()) == 0 && numElementsWritten == buffer.size();
         }
 	}
+
+    std::optional<MappedFileReader> MappedFileReader::tryOpen(const std::filesystem::path& path) {
+#ifdef _WIN32
+        (void) path;
+        return std::nullopt;
+#else // _WIN32
+        int fd = ::open(path.c_str(), O_RDONLY);
+        detail::posixAssert(fd != -1);
+
+        // Files in e.g. /proc are reported as empty regular files even though they can be read, so empty files are left
+        // to `FileReader` as well. The mapping stays valid after the file descriptor is closed.
+        struct stat status;
+        bool canMap = ::fstat(fd, &status) == 0 && S_ISREG(status.st_mode) && status.st_size > 0;
+        std::size_t size = canMap ? static_cast<std::size_t>(status.st_size) : 0;
+        void* data = canMap ? ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        ::close(fd);
+        if (data == MAP_FAILED) {
+            return std::nullopt;
+        }
+
+        // The file is read front to back exactly once, so the kernel should read ahead aggressively. This is only a hint,
+        // hence errors are ignored.
+        ::madvise(data, size, MADV_SEQUENTIAL);
+        return MappedFileReader(static_cast<char const*>(data), size);
+#endif // _WIN32
+    }
+
+    MappedFileReader::~MappedFileReader() {
+#ifndef _WIN32
+        if (data_ != nullptr) {
+            ::munmap(const_cast<char*>(data_), size_);
+        }
+#endif // _WIN32
+    }
 } // namespace arithmetic_expression_::file_reader
\ No newline at end of file
@@ -7,8 +7,10 @@
 #include <cstdio>      // for FILE etc.
 #include <memory>      // for unique_ptr<>
 #include <cstddef>     // for byte
-#include <utility>     // for move()
+#include <utility>     // for move(), exchange()
+#include <optional>
 #include <filesystem>  // for path
+#include <string_view>
 
 namespace arithmetic_expression_::file_reader {
 	// General helper functions and types
@@ -48,7 +50,6 @@ namespace arithmetic_expression_::file_reader {
         bool writeFile(FileHandle& file, std::span<char>& buffer);
     } // namespace detail
 
-    // Singleton
     class FileReader {
     private:
         detail::FileHandle file_;
@@ -57,9 +58,9 @@ namespace arithmetic_expression_::file_reader {
             : file_(std::move(detail::openFile(path, detail::FileAccessMode::read, mode))) {}
 
     public:
-        static FileReader* open(const std::filesystem::path& path, FileMode&& mode) {
-            static FileReader instance(path, mode);
-            return &instance;
+        // Every call opens the file anew, so several files can be read at the same time.
+        static FileReader open(const std::filesystem::path& path, FileMode mode) {
+            return FileReader(path, mode);
         }
 
         [[nodiscard]] FileReadResult readTo(std::span<char>& buffer) {
@@ -77,6 +78,37 @@ namespace arithmetic_expression_::file_reader {
         }
     };
 
+    // A read-only memory mapping of an entire file. Its contents can be used in place, without copying them into a buffer.
+    class MappedFileReader {
+    private:
+        char const* data_;
+        std::size_t size_;
+
+        MappedFileReader(char const* data, std::size_t size)
+            : data_(data), size_(size) {}
+
+    public:
+        // Maps the file at the given path. Returns nothing if the file cannot be mapped, because it is not a non-empty
+        // regular file (e.g. a pipe) or because memory mapping is not supported on this platform; use `FileReader` then.
+        // Throws `std::system_error` if the file cannot be opened.
+        static std::optional<MappedFileReader> tryOpen(const std::filesystem::path& path);
+
+        MappedFileReader(MappedFileReader&& rhs) noexcept
+            : data_(std::exchange(rhs.data_, nullptr)), size_(std::exchange(rhs.size_, 0)) {}
+
+        MappedFileReader& operator =(MappedFileReader&& rhs) noexcept {
+            std::swap(data_, rhs.data_);
+            std::swap(size_, rhs.size_);
+            return *this;
+        }
+
+        ~MappedFileReader();
+
+        std::string_view contents() const noexcept {
+            return { data_, size_ };
+        }
+    };
+
     // Singleton
     class FileWriter {
     private:
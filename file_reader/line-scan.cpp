@@ -0,0 +1,136 @@
+#include <bit>        // for countr_zero()
+#include <algorithm>  // for find(), any_of(), all_of()
+
+#if defined(__x86_64__) || defined(_M_X64)
+# include <immintrin.h>
+# ifdef _MSC_VER
+#  include <intrin.h>  // for __cpuid(), __cpuidex()
+# endif // _MSC_VER
+#endif // defined(__x86_64__) || defined(_M_X64)
+
+#include "line-scan.h"
+
+// GCC and Clang only emit AVX2 instructions in functions compiled for that target. Visual C++ emits whatever
+// intrinsics are used.
+#if defined(__GNUC__)
+# define ARITHMETIC_EXPRESSION_PARSER_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+# define ARITHMETIC_EXPRESSION_PARSER_TARGET_AVX2
+#endif
+
+namespace arithmetic_expression_::read_lines {
+
+	namespace detail {
+
+		char const* findNewlineScalar(char const* first, char const* last) noexcept
+		{
+			return std::find(first, last, '\n');
+		}
+
+#if defined(__x86_64__) || defined(_M_X64)
+		// SSE2 is part of x86-64, so this needs no runtime check.
+		char const* findNewlineSse2(char const* first, char const* last) noexcept
+		{
+			auto const newline = _mm_set1_epi8('\n');
+			for (; last - first >= 64; first += 64)
+			{
+				auto eq0 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const*>(first)), newline);
+				auto eq1 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const*>(first + 16)), newline);
+				auto eq2 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const*>(first + 32)), newline);
+				auto eq3 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const*>(first + 48)), newline);
+
+				// Test all four blocks at once, and only find out which one matched if any did.
+				auto any = _mm_or_si128(_mm_or_si128(eq0, eq1), _mm_or_si128(eq2, eq3));
+				if (_mm_movemask_epi8(any) != 0)
+				{
+					unsigned long long mask = unsigned(_mm_movemask_epi8(eq0))
+						| (unsigned long long)unsigned(_mm_movemask_epi8(eq1)) << 16
+						| (unsigned long long)unsigned(_mm_movemask_epi8(eq2)) << 32
+						| (unsigned long long)unsigned(_mm_movemask_epi8(eq3)) << 48;
+					return first + std::countr_zero(mask);
+				}
+			}
+			for (; last - first >= 16; first += 16)
+			{
+				auto eq = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const*>(first)), newline);
+				if (int mask = _mm_movemask_epi8(eq); mask != 0)
+				{
+					return first + std::countr_zero(unsigned(mask));
+				}
+			}
+			return findNewlineScalar(first, last);
+		}
+
+		ARITHMETIC_EXPRESSION_PARSER_TARGET_AVX2
+		char const* findNewlineAvx2(char const* first, char const* last) noexcept
+		{
+			auto const newline = _mm256_set1_epi8('\n');
+			for (; last - first >= 64; first += 64)
+			{
+				auto eq0 = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(first)), newline);
+				auto eq1 = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(first + 32)), newline);
+				if (_mm256_movemask_epi8(_mm256_or_si256(eq0, eq1)) != 0)
+				{
+					unsigned long long mask = unsigned(_mm256_movemask_epi8(eq0))
+						| (unsigned long long)unsigned(_mm256_movemask_epi8(eq1)) << 32;
+					return first + std::countr_zero(mask);
+				}
+			}
+			return findNewlineSse2(first, last);
+		}
+
+		bool cpuSupportsAvx2() noexcept
+		{
+#if defined(__GNUC__)
+			// Required when called from a static initializer, which is where `findNewline()` is selected.
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("avx2");
+#else
+			// AVX2 needs support by the CPU (CPUID leaf 7, EBX bit 5) and by the OS, which must save the YMM registers
+			// (CPUID leaf 1, ECX bit 27, and the XCR0 bits for SSE and AVX state).
+			int info[4];
+			__cpuid(info, 1);
+			if ((info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 0x6) != 0x6)
+			{
+				return false;
+			}
+			__cpuidex(info, 7, 0);
+			return (info[1] & (1 << 5)) != 0;
+#endif
+		}
+#endif // defined(__x86_64__) || defined(_M_X64)
+
+		using FindNewlineFunction = char const* (*)(char const* first, char const* last) noexcept;
+
+		static FindNewlineFunction selectFindNewline() noexcept
+		{
+#if defined(__x86_64__) || defined(_M_X64)
+			return cpuSupportsAvx2() ? findNewlineAvx2 : findNewlineSse2;
+#else
+			return findNewlineScalar;
+#endif
+		}
+
+		// Chosen once, when the program starts.
+		static FindNewlineFunction const findNewlineImpl = selectFindNewline();
+	}
+
+	char const* findNewline(char const* first, char const* last) noexcept
+	{
+		return detail::findNewlineImpl(first, last);
+	}
+
+	LineKind classifyLine(std::string_view line, std::span<std::string const> commentPrefixes) noexcept
+	{
+		if (std::any_of(commentPrefixes.begin(), commentPrefixes.end(),
+			[line](std::string const& commentPrefix)
+			{
+				return line.starts_with(commentPrefix);
+			}))
+		{
+			return LineKind::comment;
+		}
+		auto isBlankChar = [](char c) { return c == ' ' || c == '\t' || c == '\r'; };
+		return std::all_of(line.begin(), line.end(), isBlankChar) ? LineKind::blank : LineKind::content;
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#ifndef ARITHMETIC_EXPRESSION_PARSER_LINE_SCAN_HPP
+#define ARITHMETIC_EXPRESSION_PARSER_LINE_SCAN_HPP
+
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace arithmetic_expression_::read_lines {
+
+	// Returns a pointer to the first newline character in [first, last), or `last` if there is none.
+	// Compares 64 bytes at a time with AVX2 or SSE2, whichever is the best the CPU supports.
+	char const* findNewline(char const* first, char const* last) noexcept;
+
+	enum class LineKind { blank, comment, content };
+
+	// Classifies a line as blank (only spaces, tabs and carriage returns), as a comment (starting with one of the given
+	// prefixes), or as content. Only looks at as many bytes as needed, which for most lines is one or two.
+	LineKind classifyLine(std::string_view line, std::span<std::string const> commentPrefixes) noexcept;
+
+	namespace detail {
+
+		// The implementations `findNewline()` chooses from. The vectorized ones must only be called if the CPU supports
+		// them; they are exposed for benchmarking.
+		char const* findNewlineScalar(char const* first, char const* last) noexcept;
+#if defined(__x86_64__) || defined(_M_X64)
+		char const* findNewlineSse2(char const* first, char const* last) noexcept;
+		char const* findNewlineAvx2(char const* first, char const* last) noexcept;
+		bool cpuSupportsAvx2() noexcept;
+#endif // defined(__x86_64__) || defined(_M_X64)
+	}
+}
+
+#endif // !ARITHMETIC_EXPRESSION_PARSER_LINE_SCAN_HPP
@@ -1,21 +1,50 @@
 #include "lines.h"
+#include "line-scan.h"  // for findNewline()
+#include "instrumentation.h"
 
 using arithmetic_expression_::file_reader::FileReader;
+using arithmetic_expression_::file_reader::MappedFileReader;
+namespace instrumentation = asc::cpp_practice_ws20::ex08::instrumentation;
 
 namespace arithmetic_expression_::read_lines {
 
 	constexpr std::size_t bufSize = 4096;
 
 	LineRange::LineRange(FileReader&& _fileReader)
-	: fileReader_(std::move(_fileReader)), readBuf_(bufSize, '\0') {}
+	: file_(std::move(_fileReader)), readBuf_(bufSize, '\0') {}
+
+	LineRange::LineRange(MappedFileReader&& _mappedFile)
+	: file_(std::move(_mappedFile)) {}
 
     bool LineRange::tryReadNextLine()
+    {
+        auto timer = instrumentation::PhaseTimer(instrumentation::Phase::read);
+        if (auto* mappedFile = std::get_if<MappedFileReader>(&file_))
+        {
+            return tryReadNextMappedLine(mappedFile->contents());
+        }
+        return tryReadNextBufferedLine(std::get<FileReader>(file_));
+    }
+
+    bool LineRange::tryReadNextMappedLine(std::string_view contents)
+    {
+        // The whole file is available, so lines are views into the mapping and never need to be copied.
+        if (pos_ == contents.size())
+        {
+            return false;
+        }
+        auto lineEnd = std::size_t(findNewline(contents.data() + pos_, contents.data() + contents.size()) - contents.data());
+        nextLine_ = contents.substr(pos_, lineEnd - pos_);
+        pos_ = lineEnd != contents.size() ? lineEnd + 1 : lineEnd;
+        return true;
+    }
+
+    bool LineRange::tryReadNextBufferedLine(FileReader& fileReader)
     {
         while (!(pos_ == end_ && endOfFile_))
         {
-            auto posIt = readBuf_.begin() + pos_;
             auto endIt = readBuf_.begin() + end_;
-            auto newlinePos = pos_ + (std::find(posIt, endIt, '\n') - posIt);
+            auto newlinePos = std::size_t(findNewline(readBuf_.data() + pos_, readBuf_.data() + end_) - readBuf_.data());
             if (newlinePos == end_ && !endOfFile_)
             {
                 // No newline found in buffer, but not at the end of the file yet. We need to read more data to get the rest of
@@ -49,7 +78,7 @@ namespace arithmetic_expression_::read_lines {
                 }
 
                 auto readSpan = std::span(readBuf_.begin() + pos_, readBuf_.end());
-                auto readResult = fileReader_.readTo(readSpan);
+                auto readResult = fileReader.readTo(readSpan);
                 end_ = pos_ + readResult.numBytesRead;
                 endOfFile_ = readResult.endOfFile || readResult.numBytesRead < std::ssize(readSpan);
             }
@@ -63,8 +92,13 @@ namespace arithmetic_expression_::read_lines {
                 if (lineEnd != end_)
                 {
                     pos_ = lineEnd + 1;
-                    lineStart_ = pos_;
                 }
+                else
+                {
+                    // Consume the last line, otherwise it would be found again.
+                    pos_ = end_;
+                }
+                lineStart_ = pos_;
 
                 // Store the line and indicate sucess.
                 nextLine_ = lineView;
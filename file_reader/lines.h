@@ -8,17 +8,21 @@
 #include <iterator>
 #include <algorithm>
 #include <iostream>
+#include <variant>
+#include <filesystem>  // for path
 
-#include "file-io.h"  // for FileReader
+#include "file-io.h"  // for FileReader, MappedFileReader
 
 using arithmetic_expression_::file_reader::FileReader;
+using arithmetic_expression_::file_reader::MappedFileReader;
 
 namespace arithmetic_expression_::read_lines {
 	
 	class LineRange
 	{
 	private:
-		FileReader fileReader_;
+		// Lines are either read into `readBuf_` or taken directly from a memory mapping of the whole file.
+		std::variant<FileReader, MappedFileReader> file_;
 
 		std::string readBuf_;
 
@@ -30,9 +34,12 @@ namespace arithmetic_expression_::read_lines {
 		std::string_view nextLine_;
 
 		bool tryReadNextLine();
+		bool tryReadNextBufferedLine(FileReader& fileReader);
+		bool tryReadNextMappedLine(std::string_view contents);
 
 	public:
 		LineRange(FileReader&& _fileReader);
+		LineRange(MappedFileReader&& _mappedFile);
 
 		class iterator
 		{
@@ -117,6 +124,21 @@ namespace arithmetic_expression_::read_lines {
 	{
 		return { std::move(fileReader) };
 	}
+
+	inline LineRange linesInFile(MappedFileReader&& mappedFile)
+	{
+		return { std::move(mappedFile) };
+	}
+
+	// Returns the lines of a text file, read from a memory mapping if possible.
+	inline LineRange linesInFile(const std::filesystem::path& path)
+	{
+		if (auto mappedFile = MappedFileReader::tryOpen(path))
+		{
+			return { std::move(*mappedFile) };
+		}
+		return { FileReader::open(path, arithmetic_expression_::file_reader::FileMode::text) };
+	}
 }
 
 #endif // !ARITHMETIC_EXPRESSION_PARSER_LINES_HPP
@@ -1,23 +1,42 @@
 
+#include <deque>
+#include <future>
+#include <cstdio>         // for stdout
+#include <memory>         // for shared_ptr<>
+#include <string>         // for stoul()
 #include <iostream>
+#include <utility>        // for move(), exchange()
+#include <exception>      // for exception_ptr, current_exception(), rethrow_exception()
 #include <stdexcept>      // for runtime_error
 #include <string_view>
 #include <unordered_map>
 #include <unordered_set>
 #include "expression.h"
 #include "expression-evaluate.h"
+#include "expression-simplify.h"
+#include "output-sink.h"
 
 #include "utf8-console.h"
 #include "variable-parse.h"
 
 #include "lines.h"
+#include "line-scan.h"
+#include "lru-cache.h"
+#include "thread-pool.h"
+#include "instrumentation.h"
 
 
 using namespace asc::cpp_practice_ws20::ex08;
+using arithmetic_expression_::read_lines::linesInFile;
+using arithmetic_expression_::read_lines::classifyLine;
+using arithmetic_expression_::read_lines::LineKind;
+using instrumentation::Phase;
+using instrumentation::PhaseTimer;
 
 
 void
 printVariableSubstitutions(
+    OutputSink& out,
     std::unordered_map<std::string, double> const& variableSubstitutions)
 {
     bool first = true;
@@ -29,31 +48,31 @@ printVariableSubstitutions(
         }
         else
         {
-            std::cout << ", ";
+            out << ", ";
         }
-        std::cout << variableSubstitution.first << " = " << variableSubstitution.second;
+        out << variableSubstitution.first << " = " << variableSubstitution.second;
     }
 }
 
-std::vector<std::string>
-preprocess2(
-    FileReader fileReader,
-    std::vector<std::string> const& commentPrefixes)
+// An input expression together with its simplified form. Expressions are cached in this form so that lines sharing the
+// same expression text are parsed and simplified only once.
+struct ParsedExpression
 {
-    std::vector<std::string> result;
-    for (std::string_view line : linesInFile(std::move(fileReader)))
-    {
-        if (std::none_of(commentPrefixes.begin(), commentPrefixes.end(),
-            [line](std::string const& commentPrefix)
-            {
-                return line.starts_with(commentPrefix);
-            }))
-        {
-            result.push_back(std::string(line));
-        }
-    }
-    return result;
-}
+    expr::Expression expression;
+    expr::Expression simplified;
+};
+
+using ExpressionCache = LruCache<std::string, std::shared_ptr<ParsedExpression const>>;
+
+// The output of a batch of lines processed by a worker, and how the batch used the worker's expression cache. If a line
+// fails, `output` holds the results of the lines before it and `error` the exception.
+struct BatchResult
+{
+    std::string output;
+    std::size_t cacheHits = 0;
+    std::size_t cacheMisses = 0;
+    std::exception_ptr error;
+};
 
 std::vector<std::string> splitExpression(const std::string_view& expr)
 {
@@ -79,55 +98,293 @@ std::vector<std::string> splitExpression(const std::string_view& expr)
     return res;
 }
 
+// Parses, simplifies and evaluates the expression in a line, and writes the results to the stream.
+void
+processLine(std::string_view line, ExpressionCache& expressionCache, expr::ParserBackend parserBackend, OutputSink& out)
+{
+    auto splittedLine = instrumentation::timed(Phase::split, [line] { return splitExpression(line); });
+
+    auto parsed = expressionCache.findOrInsert(splittedLine[0], [&splittedLine, parserBackend]
+        {
+            auto e = instrumentation::timed(Phase::parse, [&]
+                {
+                    return expr::Expression::parse(splittedLine[0], parserBackend);
+                });
+            auto simplified = instrumentation::timed(Phase::simplify, [&e] { return expr::simplify(e); });
+            return std::make_shared<ParsedExpression const>(ParsedExpression{ std::move(e), std::move(simplified) });
+        });
+    auto const& e = parsed->expression;
+    auto const& simplified = parsed->simplified;
+    {
+        auto timer = PhaseTimer(Phase::print);
+        out << "Expression: " << e << '\n'; // print expression
+        if (simplified != e)
+        {
+            out << "Simplified: " << simplified << '\n';
+        }
+    }
+
+    auto variableSubstitutions = std::unordered_map<std::string, double>{ };
+    {
+        auto timer = PhaseTimer(Phase::substitutions);
+        for (int i = 1; i < splittedLine.size(); ++i)
+        {
+            variableSubstitutions.insert(parseVariableSubstitution(splittedLine[i]));
+        }
+    }
+
+    double value = instrumentation::timed(Phase::evaluate, [&]
+        {
+            return evaluate(simplified, variableSubstitutions);
+        });
+
+    auto timer = PhaseTimer(Phase::print);
+    if (!variableSubstitutions.empty())
+    {
+        out << "Substitutions: ";
+        printVariableSubstitutions(out, variableSubstitutions);
+        out << "\n";
+    }
+    out << "Value: " << value << "\n\n";
+}
+
+// Every worker thread has an expression cache of its own, so workers never wait for each other.
+ExpressionCache&
+workerExpressionCache(std::size_t capacity)
+{
+    thread_local auto expressionCache = ExpressionCache(capacity);
+    return expressionCache;
+}
+
+BatchResult
+processBatch(std::vector<std::string> const& lines, std::size_t cacheSize, expr::ParserBackend parserBackend)
+{
+    auto& expressionCache = workerExpressionCache(cacheSize);
+    auto hitsBefore = expressionCache.hits();
+    auto missesBefore = expressionCache.misses();
+    // The output buffer of a worker is reused for all batches it processes.
+    thread_local auto out = OutputSink{ };
+    out.clear();
+    auto result = BatchResult{ };
+    try
+    {
+        for (auto const& line : lines)
+        {
+            processLine(line, expressionCache, parserBackend, out);
+        }
+    }
+    catch (...)
+    {
+        result.error = std::current_exception();
+    }
+    result.output = out.view();
+    result.cacheHits = expressionCache.hits() - hitsBefore;
+    result.cacheMisses = expressionCache.misses() - missesBefore;
+    return result;
+}
+
+enum class StatisticsFormat { none, text, json };
+
+// Writes the per-phase statistics to the standard error stream when `main()` returns, also if it fails.
+struct StatisticsReport
+{
+    StatisticsFormat format = StatisticsFormat::none;
+
+    ~StatisticsReport()
+    {
+        if (format == StatisticsFormat::text)
+        {
+            instrumentation::writeText(std::cerr, instrumentation::collectStatistics());
+        }
+        else if (format == StatisticsFormat::json)
+        {
+            instrumentation::writeJson(std::cerr, instrumentation::collectStatistics());
+        }
+    }
+};
+
 int main(int argc, char* argv[])
 try
 {
     enableUTF8Console();
 
-    if (argc < 2 || std::string_view(argv[1]) == "-h")
+    auto statisticsReport = StatisticsReport{ };
+    std::size_t cacheSize = 1024;
+    auto parserBackend = expr::ParserBackend::spirit;
+    std::size_t numJobs = 1;
+    int argi = 1;
+    while (argi + 1 < argc && std::string_view(argv[argi]).starts_with("--"))
+    {
+        auto option = std::string_view(argv[argi]);
+        if (option == "--cache-size")
+        {
+            cacheSize = std::stoul(argv[argi + 1]);
+        }
+        else if (option == "--jobs")
+        {
+            numJobs = std::stoul(argv[argi + 1]);
+        }
+        else if (option == "--parser")
+        {
+            auto backend = std::string_view(argv[argi + 1]);
+            if (backend == "spirit")
+            {
+                parserBackend = expr::ParserBackend::spirit;
+            }
+            else if (backend == "pratt")
+            {
+                parserBackend = expr::ParserBackend::pratt;
+            }
+            else
+            {
+                throw std::runtime_error("unknown parser " + std::string(backend));
+            }
+        }
+        else if (option == "--stats")
+        {
+            auto format = std::string_view(argv[argi + 1]);
+            if (format == "text")
+            {
+                statisticsReport.format = StatisticsFormat::text;
+            }
+            else if (format == "json")
+            {
+                statisticsReport.format = StatisticsFormat::json;
+            }
+            else
+            {
+                throw std::runtime_error("unknown statistics format " + std::string(format));
+            }
+            if (!instrumentation::isCompiledIn)
+            {
+                throw std::runtime_error("--stats is not available: instrumentation was compiled out");
+            }
+        }
+        else
+        {
+            throw std::runtime_error("unknown option " + std::string(option));
+        }
+        argi += 2;
+    }
+
+    if (argc <= argi || std::string_view(argv[argi]) == "-h")
     {
         static constexpr std::string_view helpString =
             R"raw(Usage:
-  expr <expr> [<substitutions> ...]
+  expr [--cache-size <n>] [--parser <spirit|pratt>] [--jobs <n>] [--stats <text|json>] <file>
+
+Simplifies and evaluates the arithmetic expressions in the given file, one per line.
+Each expression may be followed by variable substitutions of the form <name>=<value>.
+Blank lines and lines starting with "//" or "#" are skipped.
 
-Simplifies and evaluates the arithmetic expression given as command-line argument.
-Variable substitutions have the form <name>=<value>.
+Options:
+  --cache-size <n>  Number of distinct expressions kept parsed (default 1024, 0 disables the cache).
+  --parser <name>   Parser to use: "spirit" (default) or the faster "pratt". Both accept the same expressions.
+  --jobs <n>        Number of worker threads (default 1, 0 uses all hardware threads). With more than one worker,
+                    every worker has a cache of the given size. Results are written in input order regardless.
+  --stats <format>  Write the time, calls and heap allocations of every processing phase to the standard error stream
+                    when done, as "text" or as "json".
 )raw";
 
         std::cout << helpString;
         return 0;
     }
-    
-    auto filename = std::filesystem::path(argv[1]);
+
+    // Recording starts before any worker threads are started.
+    if (statisticsReport.format != StatisticsFormat::none)
+    {
+        instrumentation::enable();
+    }
+
+    auto filename = std::filesystem::path(argv[argi]);
     auto commentPrefixes = std::vector<std::string>{ "//", "#" };
-    auto preprocessedLines = preprocess2(
-        FileReader::open(filename, FileMode::text),
-        commentPrefixes);
 
-    for (const auto& line : preprocessedLines)
+    // Lines are processed as they are read, so memory use does not depend on the size of the file, and the first results
+    // are written right away. Regular files are memory-mapped, other files such as pipes are read through a buffer.
+    auto lines = linesInFile(filename);
+
+    // Results are collected in a large buffer and written in chunks, rather than flushing the output after every line.
+    auto out = OutputSink(stdout);
+    std::size_t cacheHits = 0;
+    std::size_t cacheMisses = 0;
+    if (numJobs == 1)
     {
-        if (line[0] == '\n') continue;
-        auto splittedLine = splitExpression(line);
-        
-        // We can assume `argc > 1` henceforth.
-        auto e = expr::Expression::parse(splittedLine[0]);
-        std::cout << "Expression: " << e << '\n'; // print expression
-
-        auto variableSubstitutions = std::unordered_map<std::string, double>{ };
-        for (int i = 1; i < splittedLine.size(); ++i)
+        auto expressionCache = ExpressionCache(cacheSize);
+        for (std::string_view line : lines)
         {
-            variableSubstitutions.insert(parseVariableSubstitution(splittedLine[i]));
+            auto kind = instrumentation::timed(Phase::classify, [&] { return classifyLine(line, commentPrefixes); });
+            if (kind == LineKind::content)
+            {
+                processLine(line, expressionCache, parserBackend, out);
+            }
         }
-        if (!variableSubstitutions.empty())
+        cacheHits = expressionCache.hits();
+        cacheMisses = expressionCache.misses();
+    }
+    else
+    {
+        // Lines are handed to the workers in batches to keep the scheduling overhead small.
+        constexpr std::size_t batchSize = 256;
+
+        auto pool = ThreadPool(numJobs);
+
+        // The batches in flight in input order, which serves as a reorder buffer: a result is written only when all
+        // results before it have been written, no matter in which order the workers finish. Bounding the number of batches
+        // in flight bounds the memory held by lines waiting to be processed and results waiting to be written.
+        auto pendingBatches = std::deque<std::future<BatchResult>>{ };
+        std::size_t const maxPendingBatches = 4 * pool.size();
+        auto writeFirstBatch = [&]
         {
-            std::cout << "Substitutions: ";
-            printVariableSubstitutions(variableSubstitutions);
-            std::cout << "\n";
+            auto result = pendingBatches.front().get();
+            pendingBatches.pop_front();
+            instrumentation::timed(Phase::print, [&] { out << result.output; });
+            cacheHits += result.cacheHits;
+            cacheMisses += result.cacheMisses;
+            if (result.error)
+            {
+                std::rethrow_exception(result.error);
+            }
+        };
+
+        // The lines of a batch must be copied: a line read is only valid until the next one is read.
+        auto submitBatch = [&](std::vector<std::string> batch)
+        {
+            pendingBatches.push_back(pool.submit([batch = std::move(batch), cacheSize, parserBackend]
+                {
+                    return processBatch(batch, cacheSize, parserBackend);
+                }));
+            if (pendingBatches.size() == maxPendingBatches)
+            {
+                writeFirstBatch();
+            }
+        };
+
+        auto batch = std::vector<std::string>{ };
+        for (std::string_view line : lines)
+        {
+            auto kind = instrumentation::timed(Phase::classify, [&] { return classifyLine(line, commentPrefixes); });
+            if (kind != LineKind::content)
+            {
+                continue;
+            }
+            batch.emplace_back(line);
+            if (batch.size() == batchSize)
+            {
+                submitBatch(std::exchange(batch, { }));
+            }
+        }
+        if (!batch.empty())
+        {
+            submitBatch(std::move(batch));
         }
+        while (!pendingBatches.empty())
+        {
+            writeFirstBatch();
+        }
+    }
 
-        double value = evaluate(e, variableSubstitutions);
-        std::cout << "Value: " << value << '\n' << std::endl;
-    }  
+    instrumentation::timed(Phase::print, [&] { out.flush(); });
+    std::cerr << "Expression cache: " << cacheHits << " hits, " << cacheMisses << " misses\n";
 }
 catch (std::runtime_error const& e)
 {
@@ -0,0 +1,206 @@
+#include <new>          // for bad_alloc
+#include <mutex>
+#include <vector>
+#include <cstdlib>      // for malloc(), free()
+#include <iomanip>      // for setw(), setprecision()
+#include <ostream>
+#include <algorithm>    // for find()
+
+#include "instrumentation.h"
+
+
+namespace asc::cpp_practice_ws20::ex08::instrumentation {
+
+
+    std::string_view phaseName(Phase phase) noexcept
+    {
+        switch (phase)
+        {
+        case Phase::read: return "read";
+        case Phase::classify: return "classify";
+        case Phase::split: return "split";
+        case Phase::parse: return "parse";
+        case Phase::simplify: return "simplify";
+        case Phase::substitutions: return "substitutions";
+        case Phase::evaluate: return "evaluate";
+        case Phase::print: return "print";
+        }
+        return "unknown";
+    }
+
+#ifdef ARITHMETIC_EXPRESSION_PARSER_INSTRUMENTATION
+
+    namespace detail {
+
+
+        // Constant-initialized, so that the allocation functions can use it without allocating.
+        thread_local std::uint64_t numThreadAllocations = 0;
+
+        // The counters of one thread. Only the owning thread writes them, but `collectStatistics()` may read them from
+        // another thread at any time.
+        struct ThreadStatistics
+        {
+            struct Counters
+            {
+                std::atomic<std::uint64_t> nanoseconds{ 0 };
+                std::atomic<std::uint64_t> calls{ 0 };
+                std::atomic<std::uint64_t> allocations{ 0 };
+            };
+
+            std::array<Counters, numPhases> phases;
+
+            ThreadStatistics();
+            ~ThreadStatistics();
+        };
+
+        struct Registry
+        {
+            std::mutex mutex;
+            std::vector<ThreadStatistics const*> threads;
+
+            // The statistics of the threads which have exited.
+            std::array<PhaseStatistics, numPhases> exited;
+
+            std::chrono::steady_clock::time_point start;
+        };
+
+        Registry& registry()
+        {
+            static auto instance = Registry{ };
+            return instance;
+        }
+
+        void add(std::array<PhaseStatistics, numPhases>& sum, ThreadStatistics const& thread)
+        {
+            for (std::size_t i = 0; i != numPhases; ++i)
+            {
+                sum[i].nanoseconds += thread.phases[i].nanoseconds.load(std::memory_order_relaxed);
+                sum[i].calls += thread.phases[i].calls.load(std::memory_order_relaxed);
+                sum[i].allocations += thread.phases[i].allocations.load(std::memory_order_relaxed);
+            }
+        }
+
+        ThreadStatistics::ThreadStatistics()
+        {
+            auto& r = registry();
+            auto lock = std::scoped_lock(r.mutex);
+            r.threads.push_back(this);
+        }
+
+        ThreadStatistics::~ThreadStatistics()
+        {
+            auto& r = registry();
+            auto lock = std::scoped_lock(r.mutex);
+            add(r.exited, *this);
+            r.threads.erase(std::find(r.threads.begin(), r.threads.end(), this));
+        }
+
+        // The single writer does not need an atomic read-modify-write.
+        void increase(std::atomic<std::uint64_t>& counter, std::uint64_t amount) noexcept
+        {
+            counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+        }
+
+        std::uint64_t threadAllocationCount() noexcept
+        {
+            return numThreadAllocations;
+        }
+
+        void record(Phase phase, std::chrono::steady_clock::duration duration, std::uint64_t allocations) noexcept
+        {
+            thread_local auto statistics = ThreadStatistics{ };
+            auto& counters = statistics.phases[std::size_t(phase)];
+            increase(counters.nanoseconds, std::uint64_t(std::chrono::nanoseconds(duration).count()));
+            increase(counters.calls, 1);
+            increase(counters.allocations, allocations);
+        }
+
+
+    } // namespace detail
+
+    void enable() noexcept
+    {
+        detail::registry().start = std::chrono::steady_clock::now();
+        detail::isEnabled.store(true, std::memory_order_relaxed);
+    }
+
+    Statistics collectStatistics()
+    {
+        auto& r = detail::registry();
+        auto lock = std::scoped_lock(r.mutex);
+        auto result = Statistics{ r.exited };
+        for (auto const* thread : r.threads)
+        {
+            detail::add(result.phases, *thread);
+        }
+        if (isEnabled())
+        {
+            result.wallNanoseconds = std::uint64_t(std::chrono::nanoseconds(std::chrono::steady_clock::now() - r.start).count());
+        }
+        return result;
+    }
+
+#endif // ARITHMETIC_EXPRESSION_PARSER_INSTRUMENTATION
+
+    void writeText(std::ostream& stream, Statistics const& statistics)
+    {
+        auto flags = stream.flags();
+        stream << std::left << std::setw(14) << "phase" << std::right << std::setw(12) << "time [ms]" << std::setw(8)
+               << "share" << std::setw(12) << "calls" << std::setw(14) << "allocations" << '\n';
+        stream << std::fixed;
+        for (std::size_t i = 0; i != numPhases; ++i)
+        {
+            auto const& phase = statistics.phases[i];
+            double share = statistics.wallNanoseconds != 0
+                ? 100.0 * double(phase.nanoseconds) / double(statistics.wallNanoseconds) : 0.0;
+            stream << std::left << std::setw(14) << phaseName(Phase(i)) << std::right << std::setprecision(3)
+                   << std::setw(12) << double(phase.nanoseconds) / 1e6 << std::setprecision(1) << std::setw(7) << share
+                   << '%' << std::setw(12) << phase.calls << std::setw(14) << phase.allocations << '\n';
+        }
+        stream << std::left << std::setw(14) << "wall time" << std::right << std::setprecision(3) << std::setw(12)
+               << double(statistics.wallNanoseconds) / 1e6 << '\n';
+        stream.flags(flags);
+    }
+
+    void writeJson(std::ostream& stream, Statistics const& statistics)
+    {
+        stream << "{\n  \"wall_ns\": " << statistics.wallNanoseconds << ",\n  \"phases\": [";
+        for (std::size_t i = 0; i != numPhases; ++i)
+        {
+            auto const& phase = statistics.phases[i];
+            stream << (i == 0 ? "\n" : ",\n") << "    { \"phase\": \"" << phaseName(Phase(i)) << "\", \"ns\": "
+                   << phase.nanoseconds << ", \"calls\": " << phase.calls << ", \"allocations\": " << phase.allocations
+                   << " }";
+        }
+        stream << "\n  ]\n}\n";
+    }
+
+
+} // namespace asc::cpp_practice_ws20::ex08::instrumentation
+
+
+#ifdef ARITHMETIC_EXPRESSION_PARSER_INSTRUMENTATION
+
+// Replacements of the global allocation functions. The array and nothrow forms forward to these by default.
+
+void* operator new(std::size_t size)
+{
+    ++asc::cpp_practice_ws20::ex08::instrumentation::detail::numThreadAllocations;
+    if (void* p = std::malloc(size == 0 ? 1 : size))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+#endif // ARITHMETIC_EXPRESSION_PARSER_INSTRUMENTATION
@@ -0,0 +1,179 @@
+#pragma once
+
+#ifndef INCLUDED_CPP_PRACTICE_EX08_INSTRUMENTATION_H_
+#define INCLUDED_CPP_PRACTICE_EX08_INSTRUMENTATION_H_
+
+
+#include <array>
+#include <chrono>
+#include <atomic>
+#include <cstddef>      // for size_t
+#include <cstdint>      // for uint64_t
+#include <iosfwd>       // for ostream
+#include <string_view>
+
+
+// Wall time, call counts and heap allocations per phase of processing an input file. The instrumentation is compiled
+// in unless `ARITHMETIC_EXPRESSION_PARSER_NO_INSTRUMENTATION` is defined, and records nothing until `enable()` is
+// called; a `PhaseTimer` then costs two clock reads. Without the macro, `PhaseTimer` is an empty object. The CMake
+// option `ARITHMETIC_EXPRESSION_PARSER_INSTRUMENTATION=OFF` defines it.
+//
+// Linking "instrumentation.cpp" replaces the global allocation functions with counting versions, hence it must not be
+// linked together with "allocation-counter.cpp" of the benchmarks; "CMakeLists.txt" refuses to configure such a program.
+
+#ifndef ARITHMETIC_EXPRESSION_PARSER_NO_INSTRUMENTATION
+# define ARITHMETIC_EXPRESSION_PARSER_INSTRUMENTATION
+#endif
+
+
+namespace asc::cpp_practice_ws20::ex08::instrumentation {
+
+
+    enum class Phase
+    {
+        read,           // splitting the input file into lines
+        classify,       // skipping comments and blank lines
+        split,          // splitting a line into the expression and the substitutions
+        parse,
+        simplify,
+        substitutions,  // parsing the variable substitutions
+        evaluate,
+        print
+    };
+
+    constexpr std::size_t numPhases = 8;
+
+    std::string_view phaseName(Phase phase) noexcept;
+
+    struct PhaseStatistics
+    {
+        std::uint64_t nanoseconds = 0;
+        std::uint64_t calls = 0;
+        std::uint64_t allocations = 0;
+    };
+
+    struct Statistics
+    {
+        std::array<PhaseStatistics, numPhases> phases;
+
+        // The wall time since `enable()`. The times of the phases are summed over all threads, so with several threads
+        // they may add up to more than this.
+        std::uint64_t wallNanoseconds = 0;
+    };
+
+#ifdef ARITHMETIC_EXPRESSION_PARSER_INSTRUMENTATION
+
+    constexpr bool isCompiledIn = true;
+
+    namespace detail {
+
+        inline std::atomic<bool> isEnabled{ false };
+
+        // The number of calls to the global `operator new` made by the calling thread.
+        std::uint64_t threadAllocationCount() noexcept;
+
+        void record(Phase phase, std::chrono::steady_clock::duration duration, std::uint64_t allocations) noexcept;
+
+    } // namespace detail
+
+    // Starts recording. Should be called before any other threads are started.
+    void enable() noexcept;
+
+    inline bool isEnabled() noexcept
+    {
+        return detail::isEnabled.load(std::memory_order_relaxed);
+    }
+
+    // Records the time from its construction to its destruction, and the allocations made by the thread meanwhile, as
+    // one call of the phase. Phases should not be nested, or time and allocations are counted for both.
+    class PhaseTimer
+    {
+    private:
+        Phase phase_;
+        bool isActive_;
+        std::uint64_t allocations_ = 0;
+        std::chrono::steady_clock::time_point start_;
+
+    public:
+        explicit PhaseTimer(Phase phase) noexcept
+            : phase_(phase), isActive_(isEnabled())
+        {
+            if (isActive_)
+            {
+                allocations_ = detail::threadAllocationCount();
+                start_ = std::chrono::steady_clock::now();
+            }
+        }
+
+        PhaseTimer(PhaseTimer const&) = delete;
+        PhaseTimer& operator =(PhaseTimer const&) = delete;
+
+        ~PhaseTimer()
+        {
+            if (isActive_)
+            {
+                auto duration = std::chrono::steady_clock::now() - start_;
+                detail::record(phase_, duration, detail::threadAllocationCount() - allocations_);
+            }
+        }
+    };
+
+    // Returns the statistics of all threads, including those which have exited already.
+    Statistics collectStatistics();
+
+#else // ARITHMETIC_EXPRESSION_PARSER_INSTRUMENTATION
+
+    constexpr bool isCompiledIn = false;
+
+    inline void enable() noexcept
+    {
+    }
+
+    constexpr bool isEnabled() noexcept
+    {
+        return false;
+    }
+
+    class PhaseTimer
+    {
+    public:
+        explicit PhaseTimer(Phase) noexcept
+        {
+        }
+
+        PhaseTimer(PhaseTimer const&) = delete;
+        PhaseTimer& operator =(PhaseTimer const&) = delete;
+
+        // Not trivial, so that compilers do not warn about unused timers.
+        ~PhaseTimer()
+        {
+        }
+    };
+
+    inline Statistics collectStatistics()
+    {
+        return { };
+    }
+
+#endif // ARITHMETIC_EXPRESSION_PARSER_INSTRUMENTATION
+
+    // Calls `f()` and records the call as one call of the phase.
+    template <typename F>
+    decltype(auto)
+        timed(Phase phase, F&& f)
+    {
+        auto timer = PhaseTimer(phase);
+        return f();
+    }
+
+    // Writes a table of the statistics, one phase per line.
+    void writeText(std::ostream& stream, Statistics const& statistics);
+
+    // Writes the statistics as a JSON object.
+    void writeJson(std::ostream& stream, Statistics const& statistics);
+
+
+} // namespace asc::cpp_practice_ws20::ex08::instrumentation
+
+
+#endif // INCLUDED_CPP_PRACTICE_EX08_INSTRUMENTATION_H_
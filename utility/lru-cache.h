@@ -0,0 +1,112 @@
+#ifndef INCLUDED_CPP_PRACTICE_EX08_LRU_CACHE_H_
+#define INCLUDED_CPP_PRACTICE_EX08_LRU_CACHE_H_
+
+
+#include <list>
+#include <cstddef>        // for size_t
+#include <utility>        // for move(), pair<>
+#include <optional>
+#include <functional>     // for hash<>, equal_to<>
+#include <unordered_map>
+
+
+namespace asc::cpp_practice_ws20::ex08 {
+
+
+    // A map of bounded size which evicts the least recently used entry when it is full. Lookups are counted as hits or
+    // misses. A capacity of 0 disables the cache: nothing is stored and every lookup is a miss.
+    template <typename Key, typename Value, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+    class LruCache
+    {
+    private:
+        using Entry = std::pair<Key, Value>;
+
+        // Entries in order of use, most recently used first.
+        std::list<Entry> entries_;
+        std::unordered_map<Key, typename std::list<Entry>::iterator, Hash, KeyEqual> index_;
+        std::size_t capacity_;
+        std::size_t hits_ = 0;
+        std::size_t misses_ = 0;
+
+    public:
+        explicit LruCache(std::size_t _capacity)
+            : capacity_(_capacity)
+        {
+        }
+
+        // Returns the value stored for the key and marks it as most recently used, or nothing if there is none.
+        std::optional<Value> find(Key const& key)
+        {
+            auto it = index_.find(key);
+            if (it == index_.end())
+            {
+                ++misses_;
+                return std::nullopt;
+            }
+            ++hits_;
+            entries_.splice(entries_.begin(), entries_, it->second);
+            return it->second->second;
+        }
+
+        // Stores a value for the key, replacing any previous value, and evicts the least recently used entry if the
+        // cache is full.
+        void insert(Key key, Value value)
+        {
+            if (capacity_ == 0)
+            {
+                return;
+            }
+            if (auto it = index_.find(key); it != index_.end())
+            {
+                it->second->second = std::move(value);
+                entries_.splice(entries_.begin(), entries_, it->second);
+                return;
+            }
+            if (entries_.size() == capacity_)
+            {
+                index_.erase(entries_.back().first);
+                entries_.pop_back();
+            }
+            entries_.emplace_front(key, std::move(value));
+            index_.emplace(std::move(key), entries_.begin());
+        }
+
+        // Returns the value stored for the key. On a miss, stores and returns the value `make()`.
+        template <typename F>
+        Value findOrInsert(Key const& key, F&& make)
+        {
+            if (auto value = find(key))
+            {
+                return std::move(*value);
+            }
+            Value value = std::forward<F>(make)();
+            insert(key, value);
+            return value;
+        }
+
+        std::size_t size() const noexcept
+        {
+            return entries_.size();
+        }
+
+        std::size_t capacity() const noexcept
+        {
+            return capacity_;
+        }
+
+        std::size_t hits() const noexcept
+        {
+            return hits_;
+        }
+
+        std::size_t misses() const noexcept
+        {
+            return misses_;
+        }
+    };
+
+
+} // namespace asc::cpp_practice_ws20::ex08
+
+
+#endif // INCLUDED_CPP_PRACTICE_EX08_LRU_CACHE_H_
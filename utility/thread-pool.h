@@ -0,0 +1,104 @@
+#ifndef INCLUDED_CPP_PRACTICE_EX08_THREAD_POOL_H_
+#define INCLUDED_CPP_PRACTICE_EX08_THREAD_POOL_H_
+
+
+#include <deque>
+#include <mutex>
+#include <memory>         // for make_shared<>()
+#include <thread>
+#include <vector>
+#include <cstddef>        // for size_t
+#include <algorithm>      // for max()
+#include <functional>     // for function<>
+#include <future>
+#include <type_traits>    // for invoke_result_t<>
+#include <condition_variable>
+
+
+namespace asc::cpp_practice_ws20::ex08 {
+
+
+    // A fixed set of worker threads which run submitted tasks in submission order. Destroying the pool waits until all
+    // tasks submitted so far have run.
+    class ThreadPool
+    {
+    private:
+        std::mutex mutex_;
+        std::condition_variable tasksAvailable_;
+        std::deque<std::function<void()>> tasks_;
+        bool stopping_ = false;
+        std::vector<std::jthread> workers_;
+
+        void run()
+        {
+            for (;;)
+            {
+                std::function<void()> task;
+                {
+                    auto lock = std::unique_lock(mutex_);
+                    tasksAvailable_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+                    if (tasks_.empty())
+                    {
+                        return;
+                    }
+                    task = std::move(tasks_.front());
+                    tasks_.pop_front();
+                }
+                task();
+            }
+        }
+
+    public:
+        // Starts the given number of workers. A value of 0 starts one worker per hardware thread.
+        explicit ThreadPool(std::size_t numThreads)
+        {
+            if (numThreads == 0)
+            {
+                numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+            }
+            workers_.reserve(numThreads);
+            for (std::size_t i = 0; i != numThreads; ++i)
+            {
+                workers_.emplace_back([this] { run(); });
+            }
+        }
+
+        ThreadPool(ThreadPool const&) = delete;
+        ThreadPool& operator =(ThreadPool const&) = delete;
+
+        ~ThreadPool()
+        {
+            {
+                auto lock = std::lock_guard(mutex_);
+                stopping_ = true;
+            }
+            tasksAvailable_.notify_all();
+            // The `jthread`s join on destruction.
+        }
+
+        // Schedules `f()` to run on a worker. The returned future yields its result or rethrows its exception.
+        template <typename F>
+        std::future<std::invoke_result_t<F&>> submit(F f)
+        {
+            // `std::function<>` requires a copyable target, hence the task is shared rather than moved in.
+            auto task = std::make_shared<std::packaged_task<std::invoke_result_t<F&>()>>(std::move(f));
+            auto result = task->get_future();
+            {
+                auto lock = std::lock_guard(mutex_);
+                tasks_.emplace_back([task] { (*task)(); });
+            }
+            tasksAvailable_.notify_one();
+            return result;
+        }
+
+        std::size_t size() const noexcept
+        {
+            return workers_.size();
+        }
+    };
+
+
+} // namespace asc::cpp_practice_ws20::ex08
+
+
+#endif // INCLUDED_CPP_PRACTICE_EX08_THREAD_POOL_H_